@@ -17,6 +17,7 @@ typedef enum   __attribute__((packed))
 	// Don't change the enums above or the generic RTApp implementation will break //
 	/////////////////////////////////////////////////////////////////////////////////
   	IC_LIGHTSENSOR_READ_SENSOR, 
+	IC_LIGHTSENSOR_SET_SAMPLE_CONFIG,
 
 } INTER_CORE_CMD_LIGHTSENSOR;
 
@@ -28,6 +29,9 @@ typedef struct  __attribute__((packed))
 	////////////////////////////////////////////////////////////////////////////////////////
 	// Don't change the declarations above or the generic RTApp implementation will break //
 	////////////////////////////////////////////////////////////////////////////////////////
+    uint32_t outputRateHz;          // Output (decimated) sample rate, 0 keeps the current rate (default 100Hz)
+    uint8_t oversampleBits;         // 0 - 4, 4^oversampleBits ADC samples per output sample (default 2)
+    uint8_t averageWindow;          // Output samples in the moving average, 1 - 64, 0 keeps the current window (default 16)
 } IC_COMMAND_BLOCK_ALS_PT19_HL_TO_RT;
 
 typedef struct  __attribute__((packed))
@@ -40,4 +44,10 @@ typedef struct  __attribute__((packed))
 	////////////////////////////////////////////////////////////////////////////////////////
     uint32_t sensorData;
     double lightSensorLuxData;    
+    uint32_t sensorDataOversampled; // Moving average with oversampleBits extra bits of resolution
+    uint8_t oversampleBits;
+    uint8_t averageWindow;
+    uint32_t outputRateHz;
+    uint32_t adcSampleRateHz;       // outputRateHz * 4^oversampleBits
+    uint32_t sampleCount;           // Output samples since the configuration was set
 } IC_COMMAND_BLOCK_ALS_PT19_RT_TO_HL;
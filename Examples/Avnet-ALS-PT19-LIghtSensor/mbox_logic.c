@@ -50,14 +50,57 @@
 #define ADC_DATA_MASK           (BITS(4, 15))  /* ADC sample data mask (bit_4 ~ bit_15) */
 #define ADC_DATA_BIT_OFFSET     4            /* ADC sample data bit offset */
 
-// One Shot Mode: ADC0 is configured to capture ADC data.
+// Periodic Mode: ADC0 is sampled continuously and the DMA engine moves the samples into the vFIFO
 #define BIT_MAP                     0x1 /* ADC0 */
-#define CHANNEL_NUM                 1   /* ADC0 */
+#define ADC_CHANNEL_COUNT           8   /* Channels in the MT3620 ADC, mtk_os_hal_adc_period_get_data() returns all of them */
+#define ADC_CLOCK_HZ                2000000 /* The periodic mode sample period is set in ADC clocks */
+#define ADC_RX_BUF_LEN              32  /* Samples per channel returned by mtk_os_hal_adc_period_get_data() */
+#define ADC_VFIFO_LEN               (ADC_RX_BUF_LEN * 2)
+#define ADC_CALLBACK_RATE_HZ        50  /* Target rate for the rx callback, sets how many samples it collects */
+
+// Sampling configuration, see IC_LIGHTSENSOR_SET_SAMPLE_CONFIG.  Every output sample is the sum of 4^oversampleBits
+// ADC samples shifted right by oversampleBits, which adds oversampleBits bits of resolution when the signal
+// carries at least 1 LSB of noise.  The moving average then runs over averageWindow output samples.
+#define OUTPUT_RATE_DEFAULT_HZ      100 /* The rate the one shot implementation polled the ADC at */
+#define OUTPUT_RATE_MAX_HZ          1000
+#define OVERSAMPLE_BITS_DEFAULT     2   /* 16 ADC samples per output sample, 14 bit result */
+#define OVERSAMPLE_BITS_MAX         4   /* 256 ADC samples per output sample, 16 bit result */
+#define ADC_SAMPLE_RATE_MAX_HZ      32000
+#define AVERAGE_WINDOW_DEFAULT      16
+#define AVERAGE_WINDOW_MAX          64
+
+// Decimator and moving average state, updated from the ADC rx callback.  The running sum is updated with the
+// sample entering and the sample leaving the window, so each output sample costs the same whatever the window.
+typedef struct
+{
+    uint32_t decimateLength;    // ADC samples per output sample, 4^oversampleBits
+    uint8_t oversampleBits;
+    uint32_t decimateCount;
+    uint32_t decimateSum;
+    uint32_t window[AVERAGE_WINDOW_MAX];
+    uint8_t windowLength;
+    uint8_t windowIndex;
+    uint8_t windowCount;        // Output samples in the window, windowLength once it has filled
+    uint32_t runningSum;
+} AdcFilter;
 
 // Define global variables
 struct adc_fsm_param adc_fsm_parameter;
-UINT adc_rx_buf_one_shot_mode[CHANNEL_NUM];
-uint32_t sensorDataAverage = 0;
+static AdcFilter adcFilter;
+static bool adcRunning = false;
+
+// The DMA engine can't reach TCM, the vFIFO lives in SYSRAM
+static u32 adc_vfifo[ADC_VFIFO_LEN] __attribute__((section(".sysram")));
+static u32 adc_rx_buf[ADC_CHANNEL_COUNT][ADC_RX_BUF_LEN];
+
+// Sampling configuration in use
+static uint32_t adcOutputRateHz = OUTPUT_RATE_DEFAULT_HZ;
+static uint32_t adcSampleRateHz = 0;
+
+// Moving average in units of 1/2^oversampleBits ADC counts and the number of output samples since the ADC was
+// started, written by the rx callback
+static volatile uint32_t sensorDataAverageOversampled = 0;
+static volatile uint32_t sensorSampleCount = 0;
 
 // Add MT3620 constant
 #define MT3620_TIMER_TICKS_PER_SECOND ((ULONG) 100*10)
@@ -125,7 +168,6 @@ volatile UCHAR  blockFifoSema;
 TX_THREAD               thread_mbox;
 TX_THREAD               thread_set_telemetry_flag;
 TX_THREAD               tx_hardware_init_thread;
-TX_THREAD               tx_read_sensor_thread;
 
 // Application memory pool
 TX_BYTE_POOL            byte_pool_0;
@@ -139,7 +181,6 @@ TX_EVENT_FLAGS_GROUP    hardware_event_flags_0;
 void tx_thread_mbox_entry(ULONG thread_input);
 void set_telemetry_flag_thread_entry(ULONG thread_input);
 void hardware_init_thread(ULONG thread_input);
-void read_sensor_thread(ULONG thread_input);
 
 /* Function prototypes */
 void mbox_fifo_cb(struct mtk_os_hal_mbox_cb_data *data);
@@ -147,7 +188,11 @@ void mbox_swint_cb(struct mtk_os_hal_mbox_cb_data *data);
 void mbox_print(UCHAR *mbox_buf, UINT mbox_data_len);
 bool initialize_hardware(void);
 void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
-u32 adcRead(void);
+bool configureAdc(uint32_t outputRateHz, uint8_t oversampleBits, uint8_t averageWindow);
+void fillSensorReading(IC_COMMAND_BLOCK_ALS_PT19_RT_TO_HL* payload);
+float sensorAverageCounts(void);
+float countsToLux(float counts);
+static void adc_rx_callback(void *data);
 
 /* Define main entry point.  */
 void tx_main(void)
@@ -207,13 +252,6 @@ void tx_application_define(void *first_unused_memory)
     tx_thread_create(&tx_hardware_init_thread, "hardware init thread", hardware_init_thread, 0,
         pointer, APP_STACK_SIZE, 6, 6, TX_NO_TIME_SLICE, TX_AUTO_START);    
 
-    /* Allocate the stack for the read_sensor_thread  */
-    tx_byte_allocate(&byte_pool_0, (VOID**) &pointer, APP_STACK_SIZE, TX_NO_WAIT);
-    
-    // Create a read sensor thread.
-    tx_thread_create(&tx_read_sensor_thread, "read sensor thread", read_sensor_thread, 0,
-        pointer, APP_STACK_SIZE, 6, 6, TX_NO_TIME_SLICE, TX_AUTO_START);    
-
     // -------------------------------- mailbox channels --------------------------------
 
     /* Open the MBOX channel of A7 <-> M4 */
@@ -349,18 +387,31 @@ void tx_thread_mbox_entry(ULONG thread_input)
                     // understand what the data is and what needs to be done with it at both the high level and real time applcations.
                     case IC_LIGHTSENSOR_READ_SENSOR:
 
-                        // Read the light sensor data and copy it into the response buffer
-                        payloadPtrOutgoing->payload.sensorData = sensorDataAverage;
+                        // Copy the averaged light sensor data into the response buffer
+                        fillSensorReading(&payloadPtrOutgoing->payload);
                         printf("RealTime App sending sensor reading 32-bit: %lu\n", payloadPtrOutgoing->payload.sensorData);
-
-                        // Read the light sensor data and copy it into the response buffer
-                        payloadPtrOutgoing->payload.lightSensorLuxData = (float)(payloadPtrOutgoing->payload.sensorData*2.5/4095)*1000000 / (float)(3650*0.1428);
                         printf("RealTime App sending LUX data: %.2f\n", payloadPtrOutgoing->payload.lightSensorLuxData);
 
                         // Write to A7, enqueue to mailbox, we're just echoing back the Read Sensor command with the additional data
                         EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
                         break;
 
+                    // The high level application is changing the ADC sampling, oversampling and averaging
+                    case IC_LIGHTSENSOR_SET_SAMPLE_CONFIG:
+
+                        if(hardwareInitOK){
+                            configureAdc(payloadPtrIncomming->payload.outputRateHz,
+                                         payloadPtrIncomming->payload.oversampleBits,
+                                         payloadPtrIncomming->payload.averageWindow);
+                        }
+
+                        // Echo back the configuration in use, the average restarts with the new configuration
+                        fillSensorReading(&payloadPtrOutgoing->payload);
+
+                        // Write to A7, enqueue to mailbox
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
                     case IC_LIGHTSENSOR_HEARTBEAT:
                         printf("Realtime app processing heartbeat command\n");
 
@@ -436,47 +487,46 @@ void hardware_init_thread(ULONG thread_input)
 }
 
 
-// This thread is used to frequenty read the light sensor and continually compute an average
-// reading to smooth out the data
-void read_sensor_thread(ULONG thread_input)
+// ADC rx callback, called from the ADC interrupt each time rx_period_len samples have been moved into the vFIFO.
+// Each sample is added to the decimator, and every decimateLength samples the decimated result enters the moving
+// average.  Integer only, this runs in interrupt context.
+static void adc_rx_callback(void *data)
 {
+    u32 length[ADC_CHANNEL_COUNT] = {0};
+    AdcFilter *filter = &adcFilter;
 
-#define DATA_ARRAY_SIZE 16
-    // Define an array to hold the data
-    static uint32_t sensorData[DATA_ARRAY_SIZE] = {0x00};
-    static uint64_t runningTotal = 0x00;
-    static uint8_t index = 0;
-    static uint8_t dataCount = 0;
-
-    while (1) {
-
-        if (hardwareInitOK){
+    // Copy the samples out of the vFIFO, the data comes back per channel with the sample value already extracted
+    if (mtk_os_hal_adc_period_get_data(adc_rx_buf, length)) {
+        return;
+    }
 
-            // Update the current index with a new read
-            sensorData[index] = adcRead();
+    for (u32 i = 0; i < length[0] && i < ADC_RX_BUF_LEN; i++) {
 
-            // Increment and mask off the index to constrain it to our array
-            index++;
-            index &= 0x1F;
+        filter->decimateSum += adc_rx_buf[0][i];
+        if (++filter->decimateCount < filter->decimateLength) {
+            continue;
+        }
 
-            // Don't calculate an average unless we have a full array
-            if(dataCount++ > DATA_ARRAY_SIZE){
+        // The sum of 4^n samples has 2n extra bits, keep n of them
+        uint32_t sample = filter->decimateSum >> filter->oversampleBits;
+        filter->decimateSum = 0;
+        filter->decimateCount = 0;
 
-                // reset the dataCount to let us back into this code section on every next pass
-                dataCount = DATA_ARRAY_SIZE+1;
+        // Replace the oldest sample in the window
+        if (filter->windowCount == filter->windowLength) {
+            filter->runningSum -= filter->window[filter->windowIndex];
+        }
+        else {
+            filter->windowCount++;
+        }
+        filter->window[filter->windowIndex] = sample;
+        filter->runningSum += sample;
+        if (++filter->windowIndex >= filter->windowLength) {
+            filter->windowIndex = 0;
+        }
 
-                // Calculate the average of the data in the array                
-                runningTotal = 0;
-                for(u8 i = 0; i < DATA_ARRAY_SIZE; i++){
-                    runningTotal += sensorData[i];
-                }
-                
-                // Update the global variable with the new average
-                sensorDataAverage = runningTotal/DATA_ARRAY_SIZE;              
-            }
-        }    
-        // Sleep
-        tx_thread_sleep(MT3620_TIMER_TICKS_PER_SECOND/100);
+        sensorDataAverageOversampled = filter->runningSum / filter->windowCount;
+        sensorSampleCount++;
     }
 }
 
@@ -565,16 +615,8 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
 
     if(hardwareInitOK){
 
-        // Read the light sensor and calculate Lux
-	    //
-        // get voltage (2.5*adc_reading/4096)
-	    // divide by 3650 (3.65 kohm) to get current (A)
-	    // multiply by 1000000 to get uA
-	    // divide by 0.1428 to get Lux (based on fluorescent light Fig. 1 datasheet)
-	    // divide by 0.5 to get Lux (based on incandescent light Fig. 1 datasheet)
-	    // We can simplify the factors, but for demostration purpose it's OK
-	    
-        float light_sensor = (float)(sensorDataAverage*2.5/4095)*1000000 / (float)(3650*0.1428);        
+        // Convert the moving average maintained by the ADC rx callback to Lux
+        float light_sensor = countsToLux(sensorAverageCounts());        
         //printf("ALSPT19: Ambient Light[Lux] : %.2f\r\n", light_sensor);
 
         // Construct the telemetry response
@@ -601,38 +643,122 @@ bool initialize_hardware(void) {
         return false;
     }
 
-    adc_fsm_parameter.pmode = ADC_PMODE_ONE_TIME;
+    return configureAdc(OUTPUT_RATE_DEFAULT_HZ, OVERSAMPLE_BITS_DEFAULT, AVERAGE_WINDOW_DEFAULT);
+}
+
+// (Re)start the ADC in periodic mode.  outputRateHz and averageWindow of 0 keep the current setting.  The
+// oversampling is reduced if the ADC sample rate it needs is above ADC_SAMPLE_RATE_MAX_HZ.
+bool configureAdc(uint32_t outputRateHz, uint8_t oversampleBits, uint8_t averageWindow)
+{
+    INT ret;
+    uint32_t sampleRateHz;
+    uint32_t periodLength;
+
+    if (outputRateHz == 0) {
+        outputRateHz = adcOutputRateHz;
+    }
+    if (outputRateHz > OUTPUT_RATE_MAX_HZ) {
+        outputRateHz = OUTPUT_RATE_MAX_HZ;
+    }
+    if (averageWindow == 0) {
+        averageWindow = (adcFilter.windowLength == 0) ? AVERAGE_WINDOW_DEFAULT : adcFilter.windowLength;
+    }
+    if (averageWindow > AVERAGE_WINDOW_MAX) {
+        averageWindow = AVERAGE_WINDOW_MAX;
+    }
+    if (oversampleBits > OVERSAMPLE_BITS_MAX) {
+        oversampleBits = OVERSAMPLE_BITS_MAX;
+    }
+    while (oversampleBits > 0 && (outputRateHz << (2 * oversampleBits)) > ADC_SAMPLE_RATE_MAX_HZ) {
+        oversampleBits--;
+    }
+    sampleRateHz = outputRateHz << (2 * oversampleBits);
+
+    // Collect enough samples per callback to keep the callback rate near ADC_CALLBACK_RATE_HZ
+    periodLength = sampleRateHz / ADC_CALLBACK_RATE_HZ;
+    if (periodLength == 0) {
+        periodLength = 1;
+    }
+    if (periodLength > ADC_RX_BUF_LEN) {
+        periodLength = ADC_RX_BUF_LEN;
+    }
+
+    // Stop the ADC while the filter is reset, the rx callback does not run while the ADC is stopped
+    if (adcRunning) {
+        mtk_os_hal_adc_period_stop();
+        adcRunning = false;
+    }
+
+    memset(&adcFilter, 0, sizeof(adcFilter));
+    adcFilter.oversampleBits = oversampleBits;
+    adcFilter.decimateLength = 1UL << (2 * oversampleBits);
+    adcFilter.windowLength = averageWindow;
+    sensorDataAverageOversampled = 0;
+    sensorSampleCount = 0;
+    adcOutputRateHz = outputRateHz;
+    adcSampleRateHz = sampleRateHz;
+
+    adc_fsm_parameter.pmode = ADC_PMODE_PERIODIC;
+    adc_fsm_parameter.avg_mode = ADC_AVG_1_SAMPLE;
     adc_fsm_parameter.channel_map = BIT_MAP;
-    adc_fsm_parameter.fifo_mode = ADC_FIFO_DIRECT;
+    adc_fsm_parameter.period = ADC_CLOCK_HZ / sampleRateHz;
+    adc_fsm_parameter.fifo_mode = ADC_FIFO_DMA;
     adc_fsm_parameter.ier_mode = ADC_FIFO_IER_RXFULL;
-    adc_fsm_parameter.vfifo_addr = adc_rx_buf_one_shot_mode;
-    adc_fsm_parameter.vfifo_len = CHANNEL_NUM;
-    adc_fsm_parameter.rx_callback_func = NULL;
+    adc_fsm_parameter.vfifo_addr = adc_vfifo;
+    adc_fsm_parameter.vfifo_len = ADC_VFIFO_LEN;
+    adc_fsm_parameter.rx_callback_func = adc_rx_callback;
     adc_fsm_parameter.rx_callback_data = NULL;
-    adc_fsm_parameter.rx_period_len = CHANNEL_NUM;
-    
+    adc_fsm_parameter.rx_period_len = periodLength;
+
     ret = mtk_os_hal_adc_fsm_param_set(&adc_fsm_parameter);
     if (ret) {
         printf("Func:%s, line:%d fail\r\n", __func__, __LINE__);
         return false;
     }
 
+    ret = mtk_os_hal_adc_period_start();
+    if (ret) {
+        printf("Func:%s, line:%d fail\r\n", __func__, __LINE__);
+        return false;
+    }
+    adcRunning = true;
+
+    printf("ADC: %lu Hz sample rate, %u bit oversampling, %lu Hz output, %u sample average\n",
+           sampleRateHz, oversampleBits, outputRateHz, averageWindow);
+
     return true;
 }
 
-u32 adcRead(void)
+// Moving average in 12 bit ADC counts, the oversampled bits become the fraction
+float sensorAverageCounts(void)
 {
-    INT ret = 0;
+    return (float)sensorDataAverageOversampled / (float)(1UL << adcFilter.oversampleBits);
+}
 
-    // printf("\nADC One Shot Mode:\n");
+// Convert ADC counts to Lux
+//
+// get voltage (2.5*adc_reading/4096)
+// divide by 3650 (3.65 kohm) to get current (A)
+// multiply by 1000000 to get uA
+// divide by 0.1428 to get Lux (based on fluorescent light Fig. 1 datasheet)
+// divide by 0.5 to get Lux (based on incandescent light Fig. 1 datasheet)
+// We can simplify the factors, but for demostration purpose it's OK
+float countsToLux(float counts)
+{
+    return (float)(counts*2.5/4095)*1000000 / (float)(3650*0.1428);
+}
 
-    ret = mtk_os_hal_adc_trigger_one_shot_once();
-    if (ret) {
-        printf("Func:%s, line:%d fail\r\n", __func__, __LINE__);
-        return UINT32_MAX;
-    }
-    
-    u32 rawData = (u32)((adc_rx_buf_one_shot_mode[0] & ADC_DATA_MASK) >> ADC_DATA_BIT_OFFSET);
-    
-    return rawData;
+// Fill in the averaged reading and the sampling configuration for the high level application
+void fillSensorReading(IC_COMMAND_BLOCK_ALS_PT19_RT_TO_HL* payload)
+{
+    float counts = sensorAverageCounts();
+
+    payload->sensorData = (uint32_t)(counts + 0.5f);
+    payload->lightSensorLuxData = countsToLux(counts);
+    payload->sensorDataOversampled = sensorDataAverageOversampled;
+    payload->oversampleBits = adcFilter.oversampleBits;
+    payload->averageWindow = adcFilter.windowLength;
+    payload->outputRateHz = adcOutputRateHz;
+    payload->adcSampleRateHz = adcSampleRateHz;
+    payload->sampleCount = sensorSampleCount;
 }
@@ -0,0 +1,16 @@
+#pragma once
+/*
+ * crc8.h
+ *
+ * Table driven CRC-8 used by TE and Sensirion sensors to protect their
+ * I2C result frames.  Polynomial X^8 + X^5 + X^4 + 1 (0x31), MSB first,
+ * no final XOR.  The HTU21D starts the CRC at 0x00.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CRC8_INIT_HTU21D	(0x00)
+
+uint8_t	crc8_compute(const uint8_t* data, uint32_t length, uint8_t init);
+bool	crc8_check(const uint8_t* frame, uint32_t length, uint8_t init);
@@ -100,14 +100,13 @@ htu21d_status htu21d_reset(void){
  *********************************************************************/
 htu21d_status	htu21d_set_resolution(htu21d_resolution res){
 
-	htu21d_res = res;
-	uint8_t tx_buf[1];
+	uint8_t tx_buf[2];
     uint8_t rx_buf[1];
-	uint32_t ret;
+	int32_t ret;
 
 	// Read user register
 	tx_buf[0] = HTU21D_I2C_CMD_READ_USER_REG;
-	ret = mtk_os_hal_i2c_write_read(i2cHandle, HTU21D_I2C_ADDR, tx_buf, rx_buf, sizeof(tx_buf), sizeof(rx_buf));
+	ret = mtk_os_hal_i2c_write_read(i2cHandle, HTU21D_I2C_ADDR, tx_buf, rx_buf, 1, sizeof(rx_buf));
 	if(ret < 0){
 		return htu21d_status_i2c_transfer_error;
 	}
@@ -126,118 +125,236 @@ htu21d_status	htu21d_set_resolution(htu21d_resolution res){
 		return htu21d_status_i2c_transfer_error;
 	}
 
+	// Only track the new resolution once the sensor is using it, the conversion times depend on it
+	htu21d_res = res;
+
 	return htu21d_status_ok;
 }
 
+// Conversion times in ms from the datasheet, indexed by htu21d_resolution.  Polling starts after the
+// typical time, the sensor NACKs reads until the conversion is done.
+static const uint8_t temperature_typical_ms[] = {44, 11, 22, 6};
+static const uint8_t temperature_max_ms[] = {HTU21D_14B_CONV_DELAY_MS, HTU21D_12B_CONV_DELAY_MS,
+											 HTU21D_13B_CONV_DELAY_MS, HTU21D_11B_CONV_DELAY_MS};
+static const uint8_t humidity_typical_ms[] = {14, 2, 4, 7};
+static const uint8_t humidity_max_ms[] = {16, 3, 5, 8};
+
 /*********************************************************************
  *
- * Function:    htu21d_read_temperature_and_relative_humidity
+ * Function:    htu21d_start_conversion
  *
- * Description:	Send I2C commands to start a temperature conversion,
- * 				wait for completion, read the temperature value, start
- * 				a relative humidity conversion, wait for completion,
- * 				and read the relative humidity value
+ * Description:	Send the I2C command to start a temperature or relative
+ * 				humidity conversion in no hold master mode
  *
- * Parameters:	float* temperature -
- * 					pointer to temperature variable
- * 				float* relative_humidity -
- * 					pointer to relative humidity variable
+ *********************************************************************/
+static htu21d_status htu21d_start_conversion(htu21d_measurement* m, uint8_t command){
+
+	uint8_t tx_buf[1];
+
+	tx_buf[0] = command;
+	if(mtk_os_hal_i2c_write(i2cHandle, HTU21D_I2C_ADDR, tx_buf, sizeof(tx_buf)) < 0){
+		m->state = htu21d_measurement_idle;
+		return htu21d_status_i2c_transfer_error;
+	}
+
+	m->conversion_start = tx_time_get();
+	return htu21d_status_ok;
+}
+
+/*********************************************************************
+ *
+ * Function:    htu21d_start_measurement
+ *
+ * Description:	Start a temperature conversion.  The measurement then
+ * 				runs by calling htu21d_poll_measurement() until it
+ * 				returns something other than htu21d_status_busy,
+ * 				sleeping htu21d_measurement_wait_ms() between calls
+ *
+ * Parameters:	htu21d_measurement* m -
+ * 					measurement state, owned by the caller
  *
  * Returns:		Enumerated type htu21d_status with possible values
  * 				htu21d_status_ok or htu21d_status_i2c_transfer_error
- * 				or htu21d_status_crc_error
  *
  *********************************************************************/
-htu21d_status	htu21d_read_temperature_and_relative_humidity(float* temperature, float* relative_humidity){
+htu21d_status htu21d_start_measurement(htu21d_measurement* m){
 
-	uint8_t tx_buf[1];
-    uint8_t rx_buf[3];
-	uint16_t adc16;
-	float humidity=0;
+	m->state = htu21d_measurement_temperature;
+	m->temperature_ready = false;
+	m->temperature = NAN;
+	m->relative_humidity = NAN;
 
-	// Start temperature ADC conversion
-	tx_buf[0] = HTU21D_I2C_CMD_MEAS_TEMP_WITHOUT_HOLD;
-	int ret = mtk_os_hal_i2c_write(i2cHandle, HTU21D_I2C_ADDR, tx_buf, sizeof(tx_buf));
+	return htu21d_start_conversion(m, HTU21D_I2C_CMD_MEAS_TEMP_WITHOUT_HOLD);
+}
 
-	if(ret < 0){
-		return htu21d_status_i2c_transfer_error;
-	}
+/*********************************************************************
+ *
+ * Function:    htu21d_measurement_wait_ms
+ *
+ * Description:	Time until the running conversion is typically done,
+ * 				0 once it's time to poll
+ *
+ *********************************************************************/
+uint32_t htu21d_measurement_wait_ms(const htu21d_measurement* m){
 
-	// Wait only as long as is needed for the resolution that is currently set
-	if(htu21d_res == htu21d_resolution_t_11b_rh_11b){
-		tx_thread_sleep(MS_TO_TICK(HTU21D_11B_CONV_DELAY_MS));
-	}else if(htu21d_res == htu21d_resolution_t_12b_rh_8b){
-		tx_thread_sleep(MS_TO_TICK(HTU21D_12B_CONV_DELAY_MS));
-	}else if(htu21d_res == htu21d_resolution_t_13b_rh_10b){
-		tx_thread_sleep(MS_TO_TICK(HTU21D_13B_CONV_DELAY_MS));
+	uint32_t typical_ms;
+	uint32_t elapsed_ms;
+
+	if(m->state == htu21d_measurement_temperature){
+		typical_ms = temperature_typical_ms[htu21d_res];
+	}else if(m->state == htu21d_measurement_humidity){
+		typical_ms = humidity_typical_ms[htu21d_res];
 	}else{
-		tx_thread_sleep(MS_TO_TICK(HTU21D_14B_CONV_DELAY_MS));
+		return 0;
 	}
 
-	// Read temperature ADC result
-	ret = mtk_os_hal_i2c_read(i2cHandle, HTU21D_I2C_ADDR, rx_buf, sizeof(rx_buf));
-	if(ret < 0){
+	elapsed_ms = (tx_time_get() - m->conversion_start) * (1000 / HTU21D_TICKS_PER_SECOND);
+	return (elapsed_ms < typical_ms) ? typical_ms - elapsed_ms : 0;
+}
+
+/*********************************************************************
+ *
+ * Function:    htu21d_conversion_time_ms
+ *
+ * Description:	Worst case time for a temperature plus relative
+ * 				humidity measurement at resolution res, the fastest
+ * 				rate a caller can sample at
+ *
+ *********************************************************************/
+uint32_t htu21d_conversion_time_ms(htu21d_resolution res){
+
+	return temperature_max_ms[res] + humidity_max_ms[res];
+}
+
+/*********************************************************************
+ *
+ * Function:    htu21d_poll_measurement
+ *
+ * Description:	Try to read the result of the running conversion.  The
+ * 				sensor NACKs the read while it is converting.  When
+ * 				the temperature result arrives the humidity conversion
+ * 				is started right away, m->temperature is valid from
+ * 				then on (m->temperature_ready)
+ *
+ * Parameters:	htu21d_measurement* m -
+ * 					measurement started with htu21d_start_measurement
+ *
+ * Returns:		Enumerated type htu21d_status with possible values
+ * 				htu21d_status_busy while a conversion is running,
+ * 				htu21d_status_ok once both results are available,
+ * 				htu21d_status_timeout, htu21d_status_crc_error or
+ * 				htu21d_status_i2c_transfer_error
+ *
+ *********************************************************************/
+htu21d_status htu21d_poll_measurement(htu21d_measurement* m){
+
+	uint8_t rx_buf[3];
+	uint16_t adc16;
+	uint32_t max_ms;
+	float humidity;
+
+	if(m->state == htu21d_measurement_complete){
+		return htu21d_status_ok;
+	}
+	if(m->state == htu21d_measurement_idle){
 		return htu21d_status_i2c_transfer_error;
 	}
 
-	// CRC Temperature Data
-	if(CRC16(rx_buf) == true){
+	// A NACK means the conversion is still running
+	if(mtk_os_hal_i2c_read(i2cHandle, HTU21D_I2C_ADDR, rx_buf, sizeof(rx_buf)) < 0){
 
-		// Remove lowest 2 bits because they are status
-            adc16 = (uint16_t)((rx_buf[0] << 8) | rx_buf[1]) & 0xFFFC;
-                *temperature = ((float)(adc16 / (float)65536.0) * (float)175.72) - (float)46.85;
+		max_ms = (m->state == htu21d_measurement_temperature) ? temperature_max_ms[htu21d_res] : humidity_max_ms[htu21d_res];
+		if((tx_time_get() - m->conversion_start) > MS_TO_TICK(max_ms + HTU21D_CONV_TIMEOUT_MS)){
+			m->state = htu21d_measurement_idle;
+			return htu21d_status_timeout;
+		}
+		return htu21d_status_busy;
+	}
 
-	}else{
-		*temperature = 0;
+	if(CRC16(rx_buf) != true){
+		m->state = htu21d_measurement_idle;
 		return htu21d_status_crc_error;
 	}
 
-	// Start relative humidity ADC conversion
-	tx_buf[0] = HTU21D_I2C_CMD_MEAS_HUM_WITHOUT_HOLD;
-	ret = mtk_os_hal_i2c_write(i2cHandle, HTU21D_I2C_ADDR, tx_buf, sizeof(tx_buf));
+	if(m->state == htu21d_measurement_temperature){
 
-	if(ret < 0){
-		return htu21d_status_i2c_transfer_error;
+		// Remove lowest 2 bits because they are status
+		adc16 = (uint16_t)((rx_buf[0] << 8) | rx_buf[1]) & 0xFFFC;
+		m->temperature = ((float)(adc16 / (float)65536.0) * (float)175.72) - (float)46.85;
+		m->temperature_ready = true;
+
+		// Start relative humidity ADC conversion, the caller can use the temperature meanwhile
+		m->state = htu21d_measurement_humidity;
+		if(htu21d_start_conversion(m, HTU21D_I2C_CMD_MEAS_HUM_WITHOUT_HOLD) != htu21d_status_ok){
+			return htu21d_status_i2c_transfer_error;
+		}
+		return htu21d_status_busy;
 	}
 
-	// Wait only as long as is needed for the resolution that is currently set
-	if(htu21d_res == htu21d_resolution_t_11b_rh_11b){
-		tx_thread_sleep(MS_TO_TICK(HTU21D_11B_CONV_DELAY_MS));
-	}else if(htu21d_res == htu21d_resolution_t_12b_rh_8b){
-		tx_thread_sleep(MS_TO_TICK(HTU21D_12B_CONV_DELAY_MS));
-	}else if(htu21d_res == htu21d_resolution_t_13b_rh_10b){
-		tx_thread_sleep(MS_TO_TICK(HTU21D_13B_CONV_DELAY_MS));
-	}else{
-		tx_thread_sleep(MS_TO_TICK(HTU21D_14B_CONV_DELAY_MS));
+	//Concatenate the received bytes into the 16 bit result
+	adc16 = (uint16_t)(256 * rx_buf[0] + (uint16_t)(rx_buf[1] & 0xF0));
+	// Use formula to convert ADC result to relative humidity as a percentage
+	humidity = (float)-6.0 + (float)125.0 * (float)adc16 / (float)65536.0;
+	// Bound humidity from 0% to 100%
+	if(humidity<0){
+		humidity = 0;
+	}else if(humidity>100){
+		humidity = 100;
 	}
 
-	// Read relative humidity ADC result
-	// Read temperature ADC result
-	ret = mtk_os_hal_i2c_read(i2cHandle, HTU21D_I2C_ADDR, rx_buf, sizeof(rx_buf));
-	if(ret < 0){
-		return htu21d_status_i2c_transfer_error;
-	}
+	m->relative_humidity = humidity;
+	m->state = htu21d_measurement_complete;
+
+	return htu21d_status_ok;
+}
 
-	// CRC relative humidity data
-	if(CRC16(rx_buf) == true){
-		//Concatenate the received bytes into the 16 bit result
-            adc16 = (uint16_t)(256 * rx_buf[0] + (uint16_t)(rx_buf[1] & 0xF0));
-		// Use formula to convert ADC result to relative humidity as a percentage
-            humidity = (float)-6.0 + (float)125.0 * (float)adc16 / (float)65536.0;
-		// Bound humidity from 0% to 100%
-		if(humidity<0){
-			humidity = 0;
-		}else if(humidity>100){
-			humidity = 100;
+/*********************************************************************
+ *
+ * Function:    htu21d_read_temperature_and_relative_humidity
+ *
+ * Description:	Blocking temperature and relative humidity measurement
+ * 				built on the non-blocking measurement API.  Sleeps
+ * 				for the typical conversion time and then polls the
+ * 				sensor every tick until the result is ready
+ *
+ * Parameters:	float* temperature -
+ * 					pointer to temperature variable
+ * 				float* relative_humidity -
+ * 					pointer to relative humidity variable
+ *
+ * Returns:		Enumerated type htu21d_status with possible values
+ * 				htu21d_status_ok, htu21d_status_i2c_transfer_error,
+ * 				htu21d_status_crc_error or htu21d_status_timeout
+ *
+ *********************************************************************/
+htu21d_status	htu21d_read_temperature_and_relative_humidity(float* temperature, float* relative_humidity){
+
+	htu21d_measurement m;
+	htu21d_status status;
+	uint32_t wait_ms;
+
+	status = htu21d_start_measurement(&m);
+
+	while(status == htu21d_status_ok || status == htu21d_status_busy){
+
+		if(m.state == htu21d_measurement_complete){
+			break;
 		}
-	}else{
-		return htu21d_status_crc_error;
+
+		wait_ms = htu21d_measurement_wait_ms(&m);
+		tx_thread_sleep((wait_ms > 0) ? MS_TO_TICK(wait_ms) : 1);
+
+		status = htu21d_poll_measurement(&m);
 	}
 
-	// Assign relative humidity
-	*relative_humidity = humidity;
+	if(m.temperature_ready){
+		*temperature = m.temperature;
+	}
+	if(status == htu21d_status_ok){
+		*relative_humidity = m.relative_humidity;
+	}
 
-	return htu21d_status_ok;
+	return status;
 }
 
 /*********************************************************************
@@ -433,23 +550,8 @@ float htu21d_compute_dew_point(float Tamb, float RHamb){
  *
  *********************************************************************/
 int CRC8(uint8_t* data){
-	uint32_t div, poly;
-	int i;
-	div = 256u*data[0]+data[1];
-	poly = CRC_POLY;
-	//printf("Divisor: 0x%X\n",(unsigned int)div);
-	for(i=0;i<8;i++){
-		if( (uint32_t)(1<<(15-i))&div ){
-			//printf("         0x%X\n         0x%X\n",(unsigned int)(poly<<(7-i)),(unsigned int)div);
-			div ^= (poly<<(7-i));
-		}
-	}
-	//printf("Result: 0x%X",(unsigned int)div);
-	if( (div&(0xFF))==0x00 ){
-		return true;
-	}else{
-		return false;
-	}
+
+	return crc8_check(data, 2, CRC8_INIT_HTU21D);
 }
 
 /*********************************************************************
@@ -471,21 +573,5 @@ int CRC8(uint8_t* data){
  *********************************************************************/
 int CRC16(uint8_t* data)
 {
-	uint32_t div, poly;
-	int i;
-	div = 256u*256u*data[0]+256u*data[1]+data[2];
-	poly = CRC_POLY;
-	//printf("Divisor: 0x%X\n",(unsigned int)div);
-	for(i=0;i<16;i++){
-		if((uint32_t)(1<<(23-i))&div ){
-			//printf("         0x%X\n         0x%X\n",(unsigned int)(poly<<(15-i)),(unsigned int)div);
-			div ^= (poly<<(15-i));
-		}
-	}
-	//printf("Result: 0x%X",(unsigned int)div);
-	if( (div&(0xFF))==0x00 ){
-		return true;
-	}else{
-		return false;
-	}
+	return crc8_check(data, 3, CRC8_INIT_HTU21D);
 }
@@ -17,9 +17,12 @@
 #include "os_hal_i2c.h"
 #include "tx_api.h"
 #include "buildOptions.h"
+#include "crc8.h"
 
-// 1 tick = 10ms. It is configurable.
-#define MS_TO_TICK(ms)  ((ms) * (TX_TIMER_TICKS_PER_SECOND) / 100) 
+// 1 tick = 1ms.  SysTick runs at 1kHz (tx_initialize_low_level.S), TX_TIMER_TICKS_PER_SECOND is still
+// the ThreadX default of 100 and can't be used to convert.
+#define HTU21D_TICKS_PER_SECOND	(1000)
+#define MS_TO_TICK(ms)  ((ms) * (HTU21D_TICKS_PER_SECOND) / 1000)
 
 // HTU21D Constants
 #define HTU21D_I2C_ADDR				(0x40)	// 1000_000x
@@ -27,6 +30,7 @@
 #define HTU21D_13B_CONV_DELAY_MS    (25)    // Datasheet claims max conversion time of 25ms for 13 bit resolution
 #define HTU21D_12B_CONV_DELAY_MS	(13)	// Datasheet claims max conversion time of 13ms for 12 bit resolution
 #define HTU21D_11B_CONV_DELAY_MS	(7)		// Datasheet claims max conversion time of  7ms for 11 bit resolution
+#define HTU21D_CONV_TIMEOUT_MS		(20)	// Polling gives up this long after the maximum conversion time
 #define CRC_POLY					(0x131)	// CRC Polynomial: X^8 + X^5 + X^4 + 1
 
 // HTU21D BIT MASKS
@@ -46,7 +50,9 @@
 typedef enum htu21d_status{
 	htu21d_status_ok = 0,
 	htu21d_status_i2c_transfer_error = 1,
-	htu21d_status_crc_error = 2
+	htu21d_status_crc_error = 2,
+	htu21d_status_busy = 3,				// Conversion still running, poll again
+	htu21d_status_timeout = 4			// The sensor never finished the conversion
 }htu21d_status;
 typedef enum htu21d_resolution{
 	htu21d_resolution_t_14b_rh_12b = 0,
@@ -62,6 +68,21 @@ typedef enum htu21d_heater_status{
 	htu21d_heater_off = 0,
 	htu21d_heater_on = 1
 }htu21d_heater_status;
+typedef enum htu21d_measurement_state{
+	htu21d_measurement_idle = 0,
+	htu21d_measurement_temperature = 1,	// Temperature conversion running
+	htu21d_measurement_humidity = 2,	// Temperature available, humidity conversion running
+	htu21d_measurement_complete = 3
+}htu21d_measurement_state;
+
+// State of one non-blocking temperature + humidity measurement
+typedef struct htu21d_measurement{
+	htu21d_measurement_state state;
+	bool temperature_ready;				// temperature is valid, set as soon as the first conversion completes
+	float temperature;
+	float relative_humidity;
+	ULONG conversion_start;				// Tick the running conversion was started
+}htu21d_measurement;
 
 
 // External variables
@@ -72,6 +93,10 @@ htu21d_status	htu21d_init(void);
 htu21d_status	htu21d_reset(void);
 htu21d_status	htu21d_set_resolution(htu21d_resolution);
 htu21d_status	htu21d_read_temperature_and_relative_humidity(float* t, float* rh);
+htu21d_status	htu21d_start_measurement(htu21d_measurement* m);
+htu21d_status	htu21d_poll_measurement(htu21d_measurement* m);
+uint32_t		htu21d_measurement_wait_ms(const htu21d_measurement* m);
+uint32_t		htu21d_conversion_time_ms(htu21d_resolution res);
 htu21d_status	htu21d_get_battery_status(htu21d_battery_status*);
 htu21d_status	htu21d_get_heater_status(htu21d_heater_status*);
 htu21d_status	htu21d_enable_heater(void);
@@ -16,10 +16,19 @@ typedef enum   __attribute__((packed))
 	/////////////////////////////////////////////////////////////////////////////////
 	// Don't change the enums above or the generic RTApp implementation will break //
 	/////////////////////////////////////////////////////////////////////////////////
-    IC_TEMPHUM_READ_SENSOR
+    IC_TEMPHUM_READ_SENSOR,
+    IC_TEMPHUM_SET_SAMPLE_CONFIG,
 
 } INTER_CORE_CMD_TEMPHUM;
 
+// Sensor resolutions for IC_TEMPHUM_SET_SAMPLE_CONFIG.  Lower resolutions convert faster and allow a
+// shorter sample interval.
+#define IC_TEMPHUM_RESOLUTION_KEEP          0   // Keep the current resolution
+#define IC_TEMPHUM_RESOLUTION_T14_RH12      1   // 14 bit temperature, 12 bit humidity, 66ms per sample (default)
+#define IC_TEMPHUM_RESOLUTION_T13_RH10      2   // 13 bit temperature, 10 bit humidity, 30ms per sample
+#define IC_TEMPHUM_RESOLUTION_T12_RH8       3   // 12 bit temperature,  8 bit humidity, 16ms per sample
+#define IC_TEMPHUM_RESOLUTION_T11_RH11      4   // 11 bit temperature, 11 bit humidity, 15ms per sample
+
 // Define the expected data structure. 
 typedef struct  __attribute__((packed))
 {
@@ -28,6 +37,8 @@ typedef struct  __attribute__((packed))
 	////////////////////////////////////////////////////////////////////////////////////////
 	// Don't change the declarations above or the generic RTApp implementation will break //
 	////////////////////////////////////////////////////////////////////////////////////////
+    uint32_t sampleIntervalMs;      // Time between background measurements, 0 keeps the current interval
+    uint8_t resolution;             // IC_TEMPHUM_RESOLUTION_*
 } IC_COMMAND_BLOCK_TEMPHUM_HL_TO_RT;
 
 typedef struct  __attribute__((packed))
@@ -40,4 +51,8 @@ typedef struct  __attribute__((packed))
 	////////////////////////////////////////////////////////////////////////////////////////
     float temp;
     float hum;
+    uint32_t sampleIntervalMs;      // Raised to the conversion time of the resolution if set lower
+    uint8_t resolution;             // IC_TEMPHUM_RESOLUTION_*
+    uint32_t sampleCount;           // Measurements completed, 0 until the first reading is available
+    uint32_t sampleAgeMs;           // Time since temp and hum were measured
 } IC_COMMAND_BLOCK_TEMPHUM_RT_TO_HL;
\ No newline at end of file
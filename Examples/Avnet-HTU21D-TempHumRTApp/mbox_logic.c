@@ -94,9 +94,41 @@ static UINT send_telemetry_thread_period = 0;
 // Variable to track if the harware has been initialized
 static volatile bool hardwareInitOK = false;
 
-// Variables to hold HTU21D sensor readings
-float temperature;
-float humidity;
+// Background sampling configuration.  The mbox thread writes these when the high level application sends
+// IC_TEMPHUM_SET_SAMPLE_CONFIG, the sensor sample thread applies them at the start of its next measurement.
+#define SAMPLE_INTERVAL_DEFAULT_MS  1000
+#define SAMPLE_INTERVAL_MAX_MS      (3600 * 1000)
+static volatile uint32_t sample_interval_ms = SAMPLE_INTERVAL_DEFAULT_MS;
+static volatile uint8_t sample_resolution = IC_TEMPHUM_RESOLUTION_T14_RH12;
+static volatile bool sampleConfigChanged = false;
+
+// Map the IC_TEMPHUM_RESOLUTION_* values onto the driver resolutions
+static const htu21d_resolution sample_resolution_map[] = {
+    htu21d_resolution_t_14b_rh_12b,     // IC_TEMPHUM_RESOLUTION_KEEP, not used
+    htu21d_resolution_t_14b_rh_12b,
+    htu21d_resolution_t_13b_rh_10b,
+    htu21d_resolution_t_12b_rh_8b,
+    htu21d_resolution_t_11b_rh_11b
+};
+
+// One HTU21D reading as published by the sensor sample thread
+typedef struct
+{
+    float temperature;
+    float humidity;
+    uint32_t sampleCount;   // 0 until the first measurement completes
+    ULONG timestamp;        // tx_time_get() when the measurement completed
+} SensorSnapshot;
+
+// Double buffered readings.  The sample thread fills the buffer readers are not using and then publishes it
+// by incrementing snapshot_sequence, so the mbox thread always answers from the last complete reading without
+// touching the I2C bus.  A reader copies snapshots[sequence & 1] and retries if another snapshot was published
+// while it was copying.
+static SensorSnapshot snapshots[2];
+static volatile uint32_t snapshot_sequence = 0;
+
+// Compiler barrier, keeps the snapshot accesses on the right side of the sequence counter accesses
+#define SNAPSHOT_BARRIER() __asm__ volatile("" ::: "memory")
 
 // Define the bits used for the telemetry event flag construct
 enum triggers {
@@ -115,6 +147,7 @@ volatile UCHAR  blockFifoSema;
 TX_THREAD               thread_mbox;
 TX_THREAD               thread_set_telemetry_flag;
 TX_THREAD               tx_hardware_init_thread;
+TX_THREAD               thread_sensor_sample;
 
 // Application memory pool
 TX_BYTE_POOL            byte_pool_0;
@@ -128,6 +161,7 @@ TX_EVENT_FLAGS_GROUP    hardware_event_flags_0;
 void tx_thread_mbox_entry(ULONG thread_input);
 void set_telemetry_flag_thread_entry(ULONG thread_input);
 void hardware_init_thread(ULONG thread_input);
+void sensor_sample_thread_entry(ULONG thread_input);
 
 /* Function prototypes */
 void mbox_fifo_cb(struct mtk_os_hal_mbox_cb_data *data);
@@ -135,6 +169,8 @@ void mbox_swint_cb(struct mtk_os_hal_mbox_cb_data *data);
 void mbox_print(UCHAR *mbox_buf, UINT mbox_data_len);
 bool initialize_hardware(void);
 void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void readSnapshot(SensorSnapshot* snapshot);
+void fillSensorReading(IC_COMMAND_BLOCK_TEMPHUM_RT_TO_HL* payload);
 
 /* Define main entry point.  */
 void tx_main(void)
@@ -194,6 +230,13 @@ void tx_application_define(void *first_unused_memory)
     tx_thread_create(&tx_hardware_init_thread, "hardware init thread", hardware_init_thread, 0,
         pointer, APP_STACK_SIZE, 6, 6, TX_NO_TIME_SLICE, TX_AUTO_START);    
 
+    /* Allocate the stack for the sensor sample thread  */
+    tx_byte_allocate(&byte_pool_0, (VOID**) &pointer, APP_STACK_SIZE, TX_NO_WAIT);
+
+    // Create the sensor sample thread, it runs ahead of the mbox thread so a reader never waits on a half written snapshot
+    tx_thread_create(&thread_sensor_sample, "sensor sample thread", sensor_sample_thread_entry, 0,
+        pointer, APP_STACK_SIZE, 7, 7, TX_NO_TIME_SLICE, TX_AUTO_START);
+
     // -------------------------------- mailbox channels --------------------------------
 
     /* Open the MBOX channel of A7 <-> M4 */
@@ -329,17 +372,57 @@ void tx_thread_mbox_entry(ULONG thread_input)
                     // understand what the data is and what needs to be done with it at both the high level and real time applcations.
                     case IC_TEMPHUM_READ_SENSOR:
 
-                        if(hardwareInitOK){
+                        // Answer from the last reading taken by the sensor sample thread, sampleCount is 0 if
+                        // there is no reading yet
+                        fillSensorReading(&payloadPtrOutgoing->payload);
+
+                        // Write to A7, enqueue to mailbox, we're just echoing back the Read Sensor command with the additional data
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
+                    // The high level application is trading resolution against sample rate.  The sensor sample thread
+                    // applies the new settings, the response echoes the configuration in use.
+                    case IC_TEMPHUM_SET_SAMPLE_CONFIG:
+                    {
+                        uint8_t resolution = payloadPtrIncomming->payload.resolution;
+                        uint32_t interval = payloadPtrIncomming->payload.sampleIntervalMs;
+                        uint32_t minInterval;
+
+                        if(resolution > IC_TEMPHUM_RESOLUTION_T11_RH11){
+                            printf("Unsupported resolution %d, keeping the current resolution\n", resolution);
+                            resolution = IC_TEMPHUM_RESOLUTION_KEEP;
+                        }
+                        if(resolution == IC_TEMPHUM_RESOLUTION_KEEP){
+                            resolution = sample_resolution;
+                        }
+                        if(interval == 0){
+                            interval = sample_interval_ms;
+                        }
 
-                            // Read the sensor
-                            htu21d_read_temperature_and_relative_humidity(&temperature, &humidity);
-                            payloadPtrOutgoing->payload.temp = temperature;
-                            payloadPtrOutgoing->payload.hum = humidity;
+                        // The sensor can't sample faster than it converts
+                        minInterval = htu21d_conversion_time_ms(sample_resolution_map[resolution]);
+                        if(interval < minInterval){
+                            interval = minInterval;
+                        }
+                        if(interval > SAMPLE_INTERVAL_MAX_MS){
+                            interval = SAMPLE_INTERVAL_MAX_MS;
                         }
 
-                        // Write to A7, enqueue to mailbox, we're just echoing back the Read Sensor command with the additional data
+                        printf("Set the sample interval to %lu ms, resolution %d\n", interval, resolution);
+
+                        sample_interval_ms = interval;
+                        sample_resolution = resolution;
+                        sampleConfigChanged = true;
+
+                        // Wake up the sensor sample thread so that the new configuration is used right away
+                        tx_thread_wait_abort(&thread_sensor_sample);
+
+                        fillSensorReading(&payloadPtrOutgoing->payload);
+
+                        // Write to A7, enqueue to mailbox, we're echoing back the command with the configuration in use
                         EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
                         break;
+                    }
 
                     case IC_TEMPHUM_HEARTBEAT:
                         printf("Realtime app processing heartbeat command\n");
@@ -398,6 +481,65 @@ void set_telemetry_flag_thread_entry(ULONG thread_input)
     }
 }
 
+// This thread owns the HTU21D.  It measures temperature and humidity every sample_interval_ms and publishes each
+// reading to the double buffered snapshot, so the mbox thread never blocks on a conversion.
+void sensor_sample_thread_entry(ULONG thread_input)
+{
+    htu21d_status status;
+    SensorSnapshot* next;
+    uint32_t sequence;
+    uint32_t sampleCount = 0;
+    float temperature;
+    float humidity;
+    ULONG started;
+    ULONG elapsed;
+    ULONG interval;
+
+    printf("Sensor Sample Task Started\n");
+
+    // The hardware init thread runs first, wait for it to bring up the sensor
+    while(!hardwareInitOK){
+        tx_thread_sleep(MS_TO_TICK(100));
+    }
+
+    while (1) {
+
+        started = tx_time_get();
+
+        // Apply a new configuration from the high level application
+        if(sampleConfigChanged){
+            sampleConfigChanged = false;
+            if(htu21d_set_resolution(sample_resolution_map[sample_resolution]) != htu21d_status_ok){
+                printf("Failed to set the HTU21D resolution\n");
+            }
+        }
+
+        // The driver sleeps through the conversions, only this thread waits on them
+        status = htu21d_read_temperature_and_relative_humidity(&temperature, &humidity);
+        if(status == htu21d_status_ok){
+
+            // Fill the buffer readers are not using, then publish it
+            sequence = snapshot_sequence;
+            next = &snapshots[(sequence + 1) & 1];
+            next->temperature = temperature;
+            next->humidity = humidity;
+            next->sampleCount = ++sampleCount;
+            next->timestamp = tx_time_get();
+            SNAPSHOT_BARRIER();
+            snapshot_sequence = sequence + 1;
+        }
+        else{
+            printf("HTU21D measurement failed (%d)\n", status);
+        }
+
+        // Sleep for the rest of the interval, tx_thread_wait_abort() ends the sleep early when the
+        // configuration changes
+        elapsed = tx_time_get() - started;
+        interval = MS_TO_TICK(sample_interval_ms);
+        tx_thread_sleep((elapsed < interval) ? interval - elapsed : 1);
+    }
+}
+
 // only purpose in life is to initialize the hardware.
 void hardware_init_thread(ULONG thread_input)
 {
@@ -492,16 +634,21 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
     // Set the response message ID
     payloadPtrOutgoing->payload.cmd = IC_TEMPHUM_READ_SENSOR_RESPOND_WITH_TELEMETRY;
 
-    if(hardwareInitOK){
+    SensorSnapshot snapshot;
+    readSnapshot(&snapshot);
 
-        // Read the sensor
-        htu21d_read_temperature_and_relative_humidity(&temperature, &humidity);
+    if(hardwareInitOK && snapshot.sampleCount > 0){
 
-        // Construct the telemetry response
+        // Construct the telemetry response from the last reading
         snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE,  "{\"tempC\": %.2f, \"hum\":%.2f}", 
-                                                                                temperature, humidity);
+                                                                                snapshot.temperature, snapshot.humidity);
        
     }
+    else if(hardwareInitOK){
+
+        // The sensor sample thread has not completed a measurement yet
+        snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE,  "{\"error\":\"No sensor reading available yet\"}");
+    }
     else{
                         
         // The hardware is not initialized, send an error message response
@@ -514,6 +661,33 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
     EnqueueData(inbound, outbound, mbox_shared_buf_size, payloadPtrOutgoing, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
 }
 
+// Copy the last published reading, retrying if the sensor sample thread published a new one meanwhile
+void readSnapshot(SensorSnapshot* snapshot)
+{
+    uint32_t sequence;
+
+    do {
+        sequence = snapshot_sequence;
+        SNAPSHOT_BARRIER();
+        *snapshot = snapshots[sequence & 1];
+        SNAPSHOT_BARRIER();
+    } while (sequence != snapshot_sequence);
+}
+
+// Fill in the cached reading and the sampling configuration for the high level application
+void fillSensorReading(IC_COMMAND_BLOCK_TEMPHUM_RT_TO_HL* payload)
+{
+    SensorSnapshot snapshot;
+    readSnapshot(&snapshot);
+
+    payload->temp = snapshot.temperature;
+    payload->hum = snapshot.humidity;
+    payload->sampleCount = snapshot.sampleCount;
+    payload->sampleAgeMs = (snapshot.sampleCount > 0) ? (tx_time_get() - snapshot.timestamp) * (1000 / MT3620_TIMER_TICKS_PER_SECOND) : 0;
+    payload->sampleIntervalMs = sample_interval_ms;
+    payload->resolution = sample_resolution;
+}
+
 // Update this routine to initialize any hardware interfaces required by your implementation
 bool initialize_hardware(void) {
 
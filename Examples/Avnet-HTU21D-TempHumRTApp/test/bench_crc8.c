@@ -0,0 +1,70 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Benchmark for the table driven CRC-8 against the bitwise implementations it replaced: the time per byte
+// over a long buffer and per 3 byte HTU21D frame check.  These are host times, the relative cost is what
+// carries over to the M4.
+
+#include "host_test.h"
+#include "crc8.h"
+#include "crc8_reference.h"
+
+#define BUFFER_LEN 4096
+#define PASSES 2000
+#define FRAMES 20000000
+
+static uint8_t buffer[BUFFER_LEN];
+
+// Keeps the compiler from dropping the loops
+static volatile uint32_t sink;
+
+// Both implementations are called through pointers, so neither gets inlined into the loop and overlapped
+// across passes
+static uint8_t (*volatile table_compute)(const uint8_t*, uint32_t, uint8_t) = crc8_compute;
+static uint8_t (*volatile bitwise_compute)(const uint8_t*, uint32_t, uint8_t) = crc8_reference_compute;
+static bool (*volatile table_check)(const uint8_t*, uint32_t, uint8_t) = crc8_check;
+static bool (*volatile division_check)(const uint8_t*) = crc8_reference_frame3;
+
+int main(void)
+{
+    uint8_t frame[3] = {0x68, 0x3A, 0x7C};
+    uint32_t acc = 0;
+    double start, table, bitwise;
+
+    for (int i = 0; i < BUFFER_LEN; i++) {
+        buffer[i] = (uint8_t)(i * 37 + 11);
+    }
+
+    start = host_time_ns();
+    for (int pass = 0; pass < PASSES; pass++) {
+        acc += table_compute(buffer, BUFFER_LEN, (uint8_t)pass);
+    }
+    table = (host_time_ns() - start) / ((double)PASSES * BUFFER_LEN);
+
+    start = host_time_ns();
+    for (int pass = 0; pass < PASSES; pass++) {
+        acc += bitwise_compute(buffer, BUFFER_LEN, (uint8_t)pass);
+    }
+    bitwise = (host_time_ns() - start) / ((double)PASSES * BUFFER_LEN);
+
+    printf("per byte: table %.2f ns, bitwise %.2f ns, %.1fx\n", table, bitwise, bitwise / table);
+
+    start = host_time_ns();
+    for (int i = 0; i < FRAMES; i++) {
+        frame[1] = (uint8_t)i;
+        acc += table_check(frame, 3, CRC8_INIT_HTU21D);
+    }
+    table = (host_time_ns() - start) / FRAMES;
+
+    start = host_time_ns();
+    for (int i = 0; i < FRAMES; i++) {
+        frame[1] = (uint8_t)i;
+        acc += division_check(frame);
+    }
+    bitwise = (host_time_ns() - start) / FRAMES;
+
+    printf("per HTU21D frame: table %.2f ns, division %.2f ns, %.1fx\n", table, bitwise, bitwise / table);
+
+    sink = acc;
+    return 0;
+}
@@ -0,0 +1,59 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Latency benchmark for the HTU21D measurement against the simulated sensor in htu21d_sim.h.  For every
+// resolution it reports the end to end time of htu21d_read_temperature_and_relative_humidity() in 1ms ticks
+// and the bus reads it took, with a sensor converting in the typical and in the maximum datasheet time, next
+// to the fixed sleeps the driver used before (the maximum temperature conversion time, once per conversion),
+// and the host time per htu21d_poll_measurement().
+
+#include "host_test.h"
+#include "htu21d_sim.h"
+
+#define POLLS 1000000
+
+static const char* resolution_names[] = {"T 14b RH 12b", "T 12b RH 8b", "T 13b RH 10b", "T 11b RH 11b"};
+
+int main(void)
+{
+    printf("%-14s %14s %14s %12s\n", "resolution", "typical ms", "slow ms", "fixed ms");
+
+    for (int res = 0; res < 4; res++) {
+
+        float temperature, humidity;
+        ULONG typicalTicks, slowTicks;
+        uint32_t typicalReads, slowReads;
+
+        htu21d_res = (htu21d_resolution)res;
+
+        sim_reset(sim_temperature_typical_ms[res], sim_humidity_typical_ms[res]);
+        ULONG start = tx_time_get();
+        htu21d_read_temperature_and_relative_humidity(&temperature, &humidity);
+        typicalTicks = tx_time_get() - start;
+        typicalReads = sim.reads;
+
+        sim_reset(sim_temperature_max_ms[res], sim_humidity_max_ms[res]);
+        start = tx_time_get();
+        htu21d_read_temperature_and_relative_humidity(&temperature, &humidity);
+        slowTicks = tx_time_get() - start;
+        slowReads = sim.reads;
+
+        printf("%-14s %6lu (%u rd) %6lu (%u rd) %12u\n", resolution_names[res], typicalTicks, typicalReads, slowTicks,
+               slowReads, 2 * sim_temperature_max_ms[res]);
+    }
+
+    // The poll itself, a conversion that never finishes so every call NACKs and checks the timeout
+    htu21d_measurement m;
+
+    sim_reset(50, 16);
+    sim.neverReady = true;
+    htu21d_start_measurement(&m);
+
+    double begin = host_time_ns();
+    for (int i = 0; i < POLLS; i++) {
+        htu21d_poll_measurement(&m);
+    }
+    printf("%.1f ns per busy poll on the host\n", (host_time_ns() - begin) / POLLS);
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Bitwise CRC-8 implementations the table driven crc8.c is checked against.  crc8_reference_frame2() and
+// crc8_reference_frame3() are the polynomial divisions htu21d.c used for CRC8() and CRC16() before the
+// table, crc8_reference_compute() is the textbook shift register, one bit per step.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CRC8_REFERENCE_POLY (0x131)
+
+// 1 data byte + CRC, true if the frame divides evenly
+static inline bool crc8_reference_frame2(const uint8_t* data)
+{
+    uint32_t div = 256u * data[0] + data[1];
+
+    for (int i = 0; i < 8; i++) {
+        if ((uint32_t)(1 << (15 - i)) & div) {
+            div ^= (CRC8_REFERENCE_POLY << (7 - i));
+        }
+    }
+    return (div & 0xFF) == 0x00;
+}
+
+// 2 data bytes + CRC
+static inline bool crc8_reference_frame3(const uint8_t* data)
+{
+    uint32_t div = 256u * 256u * data[0] + 256u * data[1] + data[2];
+
+    for (int i = 0; i < 16; i++) {
+        if ((uint32_t)(1 << (23 - i)) & div) {
+            div ^= (CRC8_REFERENCE_POLY << (15 - i));
+        }
+    }
+    return (div & 0xFF) == 0x00;
+}
+
+static inline uint8_t crc8_reference_compute(const uint8_t* data, uint32_t length, uint8_t init)
+{
+    uint8_t crc = init;
+
+    while (length--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
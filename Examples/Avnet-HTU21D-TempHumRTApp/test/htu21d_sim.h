@@ -0,0 +1,109 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// A simulated HTU21D on a simulated I2C bus and clock for the host tests.  A no hold master measurement
+// command starts a conversion that takes temperatureMs or humidityMs, reads NACK until it is done and then
+// returns the result frame.  The clock only moves when the driver sleeps, one tick is 1ms like on the M4.
+// The result frames default to the datasheet examples: 0x683A (24.69C) and 0x4E85 (32.33%RH).
+//
+// Include it in exactly one source file per executable, it defines the OS_HAL and ThreadX functions.
+
+#include <stdbool.h>
+#include <string.h>
+#include "htu21d.h"
+
+typedef struct
+{
+    ULONG now;                      // ticks
+    ULONG readyAt;                  // tick the running conversion completes
+    bool converting;
+    uint8_t command;                // last measurement command
+    uint32_t temperatureMs;         // conversion times
+    uint32_t humidityMs;
+    uint8_t temperatureFrame[3];    // MSB, LSB, CRC
+    uint8_t humidityFrame[3];
+    bool neverReady;                // the sensor hangs in the conversion
+    bool failWrites;                // commands aren't acknowledged
+    uint32_t reads;                 // read attempts, NACKed ones included
+    uint32_t nacks;
+    uint32_t writes;
+} SimulatedHtu21d;
+
+static SimulatedHtu21d sim;
+
+// Datasheet typical and maximum conversion times, ms, indexed by htu21d_resolution
+static const uint32_t sim_temperature_typical_ms[] = {44, 11, 22, 6};
+static const uint32_t sim_temperature_max_ms[] = {50, 13, 25, 7};
+static const uint32_t sim_humidity_typical_ms[] = {14, 2, 4, 7};
+static const uint32_t sim_humidity_max_ms[] = {16, 3, 5, 8};
+
+static inline void sim_reset(uint32_t temperatureMs, uint32_t humidityMs)
+{
+    const uint8_t temperatureFrame[3] = {0x68, 0x3A, 0x7C};
+    const uint8_t humidityFrame[3] = {0x4E, 0x85, 0x6B};
+
+    memset(&sim, 0, sizeof(sim));
+    sim.now = 1000;
+    sim.temperatureMs = temperatureMs;
+    sim.humidityMs = humidityMs;
+    memcpy(sim.temperatureFrame, temperatureFrame, 3);
+    memcpy(sim.humidityFrame, humidityFrame, 3);
+}
+
+ULONG tx_time_get(void)
+{
+    return sim.now;
+}
+
+UINT tx_thread_sleep(ULONG ticks)
+{
+    sim.now += ticks;
+    return 0;
+}
+
+int mtk_os_hal_i2c_ctrl_init(i2c_num bus_num)
+{
+    return 0;
+}
+
+int mtk_os_hal_i2c_speed_init(i2c_num bus_num, int speed)
+{
+    return 0;
+}
+
+int mtk_os_hal_i2c_write(i2c_num bus_num, uint8_t device_addr, uint8_t* buffer, uint16_t len)
+{
+    sim.writes++;
+    if (sim.failWrites) {
+        return -1;
+    }
+
+    if (buffer[0] == HTU21D_I2C_CMD_MEAS_TEMP_WITHOUT_HOLD || buffer[0] == HTU21D_I2C_CMD_MEAS_HUM_WITHOUT_HOLD) {
+        sim.command = buffer[0];
+        sim.converting = true;
+        sim.readyAt = sim.now + ((buffer[0] == HTU21D_I2C_CMD_MEAS_TEMP_WITHOUT_HOLD) ? sim.temperatureMs : sim.humidityMs);
+    }
+    return 0;
+}
+
+int mtk_os_hal_i2c_read(i2c_num bus_num, uint8_t device_addr, uint8_t* buffer, uint16_t len)
+{
+    sim.reads++;
+    if (!sim.converting || sim.neverReady || sim.now < sim.readyAt) {
+        sim.nacks++;
+        return -1;
+    }
+
+    memcpy(buffer, (sim.command == HTU21D_I2C_CMD_MEAS_TEMP_WITHOUT_HOLD) ? sim.temperatureFrame : sim.humidityFrame, len);
+    sim.converting = false;
+    return 0;
+}
+
+int mtk_os_hal_i2c_write_read(i2c_num bus_num, uint8_t device_addr, uint8_t* wr_buf, uint8_t* rd_buf,
+                              uint16_t wr_len, uint16_t rd_len)
+{
+    memset(rd_buf, 0, rd_len);
+    return 0;
+}
@@ -0,0 +1,28 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Just enough of the OS_HAL I2C API for the host tests to build the HTU21D driver, the transfers are
+// implemented by the simulated sensor in htu21d_sim.h
+
+#include <stdint.h>
+
+typedef enum
+{
+    OS_HAL_I2C_ISU0 = 0,
+    OS_HAL_I2C_ISU1,
+    OS_HAL_I2C_ISU2,
+    OS_HAL_I2C_ISU3,
+    OS_HAL_I2C_ISU4,
+    OS_HAL_I2C_ISU_MAX
+} i2c_num;
+
+#define I2C_SCL_1000kHz 5
+
+int mtk_os_hal_i2c_ctrl_init(i2c_num bus_num);
+int mtk_os_hal_i2c_speed_init(i2c_num bus_num, int speed);
+int mtk_os_hal_i2c_read(i2c_num bus_num, uint8_t device_addr, uint8_t* buffer, uint16_t len);
+int mtk_os_hal_i2c_write(i2c_num bus_num, uint8_t device_addr, uint8_t* buffer, uint16_t len);
+int mtk_os_hal_i2c_write_read(i2c_num bus_num, uint8_t device_addr, uint8_t* wr_buf, uint8_t* rd_buf,
+                              uint16_t wr_len, uint16_t rd_len);
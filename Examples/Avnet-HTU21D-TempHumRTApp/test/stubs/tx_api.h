@@ -0,0 +1,20 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Just enough of the ThreadX API for the host tests to build the HTU21D driver.  The clock and the
+// sleep are provided by the simulated sensor in htu21d_sim.h, one tick is 1ms like on the M4.
+
+#include <stdint.h>
+
+typedef unsigned long ULONG;
+typedef unsigned int UINT;
+typedef unsigned char UCHAR;
+typedef char CHAR;
+typedef void VOID;
+
+#define TX_TIMER_TICKS_PER_SECOND 100
+
+ULONG tx_time_get(void);
+UINT tx_thread_sleep(ULONG ticks);
@@ -0,0 +1,94 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for the table driven CRC-8 in crc8.c.  Every HTU21D result frame, all 2^24 of them, is checked
+// against the bitwise division htu21d.c used before, and crc8_compute() against a bitwise shift register for
+// random data, lengths and initial values.
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "crc8.h"
+#include "crc8_reference.h"
+
+// The HTU21D datasheet examples
+static void test_datasheet(void)
+{
+    const uint8_t temperature[3] = {0x68, 0x3A, 0x7C};
+    const uint8_t humidity[3] = {0x4E, 0x85, 0x6B};
+    const uint8_t sensirion[2] = {0xBE, 0xEF};
+
+    CHECK(crc8_compute(temperature, 2, CRC8_INIT_HTU21D) == 0x7C);
+    CHECK(crc8_compute(humidity, 2, CRC8_INIT_HTU21D) == 0x6B);
+    CHECK(crc8_check(temperature, 3, CRC8_INIT_HTU21D));
+    CHECK(crc8_check(humidity, 3, CRC8_INIT_HTU21D));
+
+    // Sensirion's example for the same polynomial started at 0xFF
+    CHECK(crc8_compute(sensirion, 2, 0xFF) == 0x92);
+
+    // A frame is at least one data byte and the CRC
+    CHECK(!crc8_check(temperature, 1, CRC8_INIT_HTU21D));
+    CHECK(!crc8_check(temperature, 0, CRC8_INIT_HTU21D));
+}
+
+// Every 2 and 3 byte frame gets the same verdict as the bitwise division it replaced
+static void test_all_frames(void)
+{
+    uint32_t mismatches = 0;
+    uint32_t valid = 0;
+    uint8_t frame[3];
+
+    for (uint32_t value = 0; value < (1u << 24); value++) {
+
+        frame[0] = (uint8_t)(value >> 16);
+        frame[1] = (uint8_t)(value >> 8);
+        frame[2] = (uint8_t)value;
+
+        bool table = crc8_check(frame, 3, CRC8_INIT_HTU21D);
+        if (table != crc8_reference_frame3(frame)) {
+            mismatches++;
+        }
+        valid += table;
+
+        if (value < (1u << 16)) {
+            if (crc8_check(&frame[1], 2, CRC8_INIT_HTU21D) != crc8_reference_frame2(&frame[1])) {
+                mismatches++;
+            }
+        }
+    }
+
+    CHECK(mismatches == 0);
+
+    // Exactly one CRC byte is valid for each data word
+    CHECK(valid == (1u << 16));
+}
+
+static void test_random(void)
+{
+    uint8_t data[64];
+    uint32_t mismatches = 0;
+
+    srand(35);
+    for (int i = 0; i < 100000; i++) {
+
+        uint32_t length = (uint32_t)(rand() % (int)sizeof(data));
+        uint8_t init = (uint8_t)rand();
+
+        for (uint32_t b = 0; b < length; b++) {
+            data[b] = (uint8_t)rand();
+        }
+        if (crc8_compute(data, length, init) != crc8_reference_compute(data, length, init)) {
+            mismatches++;
+        }
+    }
+
+    CHECK(mismatches == 0);
+}
+
+int main(void)
+{
+    test_datasheet();
+    test_all_frames();
+    test_random();
+
+    return host_test_result("crc8");
+}
@@ -0,0 +1,141 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for the HTU21D non-blocking measurement, run against the simulated sensor in htu21d_sim.h.  They
+// check the tick conversion, the measurement state machine and the end to end latency of the blocking read
+// at every resolution, and the timeout, CRC and bus error paths.
+
+#include "host_test.h"
+#include "htu21d_sim.h"
+
+#define RESOLUTIONS 4
+
+// One tick is 1ms on the M4, whatever TX_TIMER_TICKS_PER_SECOND says
+static void test_ticks(void)
+{
+    htu21d_measurement m;
+
+    CHECK(MS_TO_TICK(50) == 50);
+    CHECK(MS_TO_TICK(1) == 1);
+
+    sim_reset(50, 16);
+    htu21d_res = htu21d_resolution_t_14b_rh_12b;
+    CHECK(htu21d_start_measurement(&m) == htu21d_status_ok);
+    CHECK(htu21d_measurement_wait_ms(&m) == 44);
+    tx_thread_sleep(MS_TO_TICK(30));
+    CHECK(htu21d_measurement_wait_ms(&m) == 14);
+    tx_thread_sleep(MS_TO_TICK(30));
+    CHECK(htu21d_measurement_wait_ms(&m) == 0);
+}
+
+// Step through a measurement by hand: busy until the temperature arrives, then the temperature is ready while
+// the humidity conversion runs, then complete with the datasheet example values
+static void test_state_machine(void)
+{
+    htu21d_measurement m;
+
+    sim_reset(44, 14);
+    htu21d_res = htu21d_resolution_t_14b_rh_12b;
+
+    CHECK(htu21d_start_measurement(&m) == htu21d_status_ok);
+    CHECK(m.state == htu21d_measurement_temperature);
+    CHECK(!m.temperature_ready);
+
+    // Too early, the sensor NACKs
+    tx_thread_sleep(MS_TO_TICK(20));
+    CHECK(htu21d_poll_measurement(&m) == htu21d_status_busy);
+    CHECK(m.state == htu21d_measurement_temperature);
+    CHECK(sim.nacks == 1);
+
+    tx_thread_sleep(MS_TO_TICK(htu21d_measurement_wait_ms(&m)));
+    CHECK(htu21d_poll_measurement(&m) == htu21d_status_busy);
+    CHECK(m.state == htu21d_measurement_humidity);
+    CHECK(m.temperature_ready);
+    CHECK_NEAR(m.temperature, 24.69, 0.01);
+    CHECK(htu21d_measurement_wait_ms(&m) == 14);
+
+    tx_thread_sleep(MS_TO_TICK(htu21d_measurement_wait_ms(&m)));
+    CHECK(htu21d_poll_measurement(&m) == htu21d_status_ok);
+    CHECK(m.state == htu21d_measurement_complete);
+    CHECK_NEAR(m.relative_humidity, 32.33, 0.01);
+
+    // Polling a complete measurement doesn't touch the bus
+    uint32_t reads = sim.reads;
+    CHECK(htu21d_poll_measurement(&m) == htu21d_status_ok);
+    CHECK(sim.reads == reads);
+}
+
+// The blocking read takes the conversion time plus at most a tick per conversion: right at the typical time
+// with a typical sensor and polling every tick after that with a slow one
+static void test_latency(void)
+{
+    for (int res = 0; res < RESOLUTIONS; res++) {
+
+        float temperature = 0.0f, humidity = 0.0f;
+        uint32_t typical = sim_temperature_typical_ms[res] + sim_humidity_typical_ms[res];
+        uint32_t slowest = sim_temperature_max_ms[res] + sim_humidity_max_ms[res];
+
+        htu21d_res = (htu21d_resolution)res;
+
+        sim_reset(sim_temperature_typical_ms[res], sim_humidity_typical_ms[res]);
+        ULONG start = tx_time_get();
+        CHECK(htu21d_read_temperature_and_relative_humidity(&temperature, &humidity) == htu21d_status_ok);
+        CHECK(tx_time_get() - start == typical);
+        CHECK(sim.nacks == 0);
+        CHECK_NEAR(temperature, 24.69, 0.01);
+        CHECK_NEAR(humidity, 32.33, 0.01);
+
+        sim_reset(sim_temperature_max_ms[res], sim_humidity_max_ms[res]);
+        start = tx_time_get();
+        CHECK(htu21d_read_temperature_and_relative_humidity(&temperature, &humidity) == htu21d_status_ok);
+        CHECK(tx_time_get() - start == slowest);
+        CHECK(sim.nacks == slowest - typical);
+    }
+}
+
+// A sensor that never finishes times out HTU21D_CONV_TIMEOUT_MS after the maximum conversion time
+static void test_timeout(void)
+{
+    float temperature = NAN, humidity = NAN;
+
+    sim_reset(50, 16);
+    sim.neverReady = true;
+    htu21d_res = htu21d_resolution_t_14b_rh_12b;
+
+    ULONG start = tx_time_get();
+    CHECK(htu21d_read_temperature_and_relative_humidity(&temperature, &humidity) == htu21d_status_timeout);
+    CHECK(tx_time_get() - start == HTU21D_14B_CONV_DELAY_MS + HTU21D_CONV_TIMEOUT_MS + 1);
+    CHECK(isnan(temperature));
+    CHECK(isnan(humidity));
+}
+
+// A corrupted humidity frame is a CRC error, the temperature read before it is still handed out
+static void test_errors(void)
+{
+    float temperature = NAN, humidity = NAN;
+    htu21d_measurement m;
+
+    sim_reset(44, 14);
+    sim.humidityFrame[1] ^= 0x04;
+    htu21d_res = htu21d_resolution_t_14b_rh_12b;
+    CHECK(htu21d_read_temperature_and_relative_humidity(&temperature, &humidity) == htu21d_status_crc_error);
+    CHECK_NEAR(temperature, 24.69, 0.01);
+    CHECK(isnan(humidity));
+
+    sim_reset(44, 14);
+    sim.failWrites = true;
+    CHECK(htu21d_start_measurement(&m) == htu21d_status_i2c_transfer_error);
+    CHECK(m.state == htu21d_measurement_idle);
+    CHECK(htu21d_poll_measurement(&m) == htu21d_status_i2c_transfer_error);
+}
+
+int main(void)
+{
+    test_ticks();
+    test_state_machine();
+    test_latency();
+    test_timeout();
+    test_errors();
+
+    return host_test_result("htu21d_measurement");
+}
@@ -61,12 +61,21 @@ Acknowledgment: Built from ST Micro samples
 
 */
 
-// 1 tick = 10ms. It is configurable.
-#define MS_TO_TICK(ms)  ((ms) * (TX_TIMER_TICKS_PER_SECOND) / 1000)
-
+// 1 tick = 1ms.  SysTick runs at 1kHz (tx_initialize_low_level.S), TX_TIMER_TICKS_PER_SECOND is still
+// the ThreadX default of 100 and can't be used to convert.
+#define IMU_TICKS_PER_SECOND 1000
+#define MS_TO_TICK(ms)  ((ms) * (IMU_TICKS_PER_SECOND) / 1000)
+
+// With OSAI_ENABLE_DMA the I2C driver moves transfers longer than its 8 byte FIFO with DMA.  The DMA
+// engine can't reach TCM, so the transfer buffers live in SYSRAM.  Reads into a caller buffer that
+// is already in SYSRAM skip the bounce through i2c_rx_buf.
 #define I2C_MAX_LEN 64
-static uint8_t i2c_tx_buf[I2C_MAX_LEN];
-static uint8_t i2c_rx_buf[I2C_MAX_LEN];
+static uint8_t i2c_tx_buf[I2C_MAX_LEN + 1] __attribute__((section(".sysram")));
+static uint8_t i2c_rx_buf[I2C_MAX_LEN] __attribute__((section(".sysram")));
+
+#define SYSRAM_START 0x22000000UL
+#define SYSRAM_END   0x22010000UL
+#define IN_SYSRAM(buf, len) (((uintptr_t)(buf) >= SYSRAM_START) && ((uintptr_t)(buf) + (len) <= SYSRAM_END))
 
 static uint8_t i2cHandle = OS_HAL_I2C_ISU2;
 
@@ -109,6 +118,18 @@ static stmdev_ctx_t pressure_ctx;
 static bool lps22hhDetected;
 static bool initialized = false;
 
+// Continuous pressure mode, see lp_pressure_continuous_start()
+static bool pressureContinuous = false;
+static float continuousPressure_hPa = NAN;
+static float continuousTemperature_degC = NAN;
+
+// The LSM6DSO, and the LPS22HH behind its sensor hub, are on ISU2 through the I2C bus manager.  Every function
+// below that talks to them holds the bus for its whole register sequence, a sensor hub transaction switches the
+// LSM6DSO register bank and can't be interleaved with another thread's reads.  platform_read() and
+// platform_write() clear imuBusOk when a transfer fails, the error is counted when the bus is unlocked.
+static i2c_bus_device_t imuBus;
+static bool imuBusOk;
+
 /* Extern variables ----------------------------------------------------------*/
 
 /* Private functions ---------------------------------------------------------*/
@@ -123,6 +144,9 @@ static int32_t platform_write(void* handle, uint8_t reg, uint8_t* bufp, uint16_t
 static int32_t platform_read(void* handle, uint8_t reg, uint8_t* bufp, uint16_t len);
 static void platform_delay(uint32_t ms);
 static void platform_init(void);
+static void imu_bus_lock(void);
+static void imu_bus_unlock(void);
+static void pressure_continuous_stop(void);
 static int32_t lsm6dso_read_lps22hh_cx(void* ctx, uint8_t reg, uint8_t* data, uint16_t len);
 static int32_t lsm6dso_write_lps22hh_cx(void* ctx, uint8_t reg, uint8_t* data, uint16_t len);
 
@@ -151,7 +175,9 @@ static int32_t platform_write(void* handle, uint8_t reg, uint8_t* bufp, uint16_t
 		memcpy(&i2c_tx_buf[1], bufp, len);
 	}
 
-	mtk_os_hal_i2c_write(*(int*)handle, LSM6DSO_ADDRESS, i2c_tx_buf, len + 1);
+	if (mtk_os_hal_i2c_write(*(int*)handle, LSM6DSO_ADDRESS, i2c_tx_buf, len + 1) != 0) {
+		imuBusOk = false;
+	}
 
 	return 0;
 }
@@ -169,16 +195,31 @@ static int32_t platform_write(void* handle, uint8_t reg, uint8_t* bufp, uint16_t
  */
 static int32_t platform_read(void* handle, uint8_t reg, uint8_t* bufp, uint16_t len)
 {
+	int result;
+
 	if (bufp == NULL)
 		return -1;
 
 	if (len > (I2C_MAX_LEN))
 		return -1;
 
-	mtk_os_hal_i2c_write_read(*(int*)handle, LSM6DSO_ADDRESS,
-		&reg, i2c_rx_buf, 1, len);
+	// The register address goes out of SYSRAM as well
+	i2c_tx_buf[0] = reg;
+
+	if (IN_SYSRAM(bufp, len)) {
+		result = mtk_os_hal_i2c_write_read(*(int*)handle, LSM6DSO_ADDRESS,
+			i2c_tx_buf, bufp, 1, len);
+	}
+	else {
+		result = mtk_os_hal_i2c_write_read(*(int*)handle, LSM6DSO_ADDRESS,
+			i2c_tx_buf, i2c_rx_buf, 1, len);
 
-	memcpy(bufp, i2c_rx_buf, len);
+		memcpy(bufp, i2c_rx_buf, len);
+	}
+
+	if (result != 0) {
+		imuBusOk = false;
+	}
 
 	return 0;
 }
@@ -217,6 +258,19 @@ static void platform_init(void)
 }
 
 
+static void imu_bus_lock(void)
+{
+	i2c_bus_lock(&imuBus);
+	imuBusOk = true;
+}
+
+
+static void imu_bus_unlock(void)
+{
+	i2c_bus_unlock(&imuBus, imuBusOk);
+}
+
+
 //static void read_imu(void)
 //{
 //	uint8_t reg;
@@ -272,6 +326,8 @@ AccelerationMilligForce lp_get_acceleration(void)
 		return accelerationMilligForce;
 	}
 
+	imu_bus_lock();
+
 	/* Read output only if new xl value is available */
 	lsm6dso_xl_flag_data_ready_get(&dev_ctx, &reg);
 	if (reg)
@@ -294,6 +350,8 @@ AccelerationMilligForce lp_get_acceleration(void)
 		//Log_Debug("x %f, y %f, z %f\n", accelerationMilligForce.x, accelerationMilligForce.y, accelerationMilligForce.z);
 	}
 
+	imu_bus_unlock();
+
 	return accelerationMilligForce;
 }
 
@@ -308,6 +366,8 @@ AngularRateDegreesPerSecond lp_get_angular_rate(void)
 		return angularRateDps;
 	}
 
+	imu_bus_lock();
+
 	lsm6dso_gy_flag_data_ready_get(&dev_ctx, &reg);
 	if (reg)
 	{
@@ -322,6 +382,8 @@ AngularRateDegreesPerSecond lp_get_angular_rate(void)
 		//Log_Debug("x %f, y %f, z %f\n", angularRateDps.x, angularRateDps.y, angularRateDps.z);
 	}
 
+	imu_bus_unlock();
+
 	return angularRateDps;
 }
 
@@ -337,10 +399,19 @@ float lp_get_temperature_lps22h(void)	// get_temperature() from lsm6dso is faste
 		return NAN;
 	}
 
+	// The sensor hub is busy reading the LPS22HH continuously and the pressure read thread owns the bus,
+	// return the latest sample that thread picked up without touching the I2C bus
+	if (pressureContinuous)
+	{
+		return continuousTemperature_degC;
+	}
+
 	if (lps22hhDetected)
 	{
 		i16bit = 0;
 
+		imu_bus_lock();
+
 		lps22hh_read_reg(&pressure_ctx, LPS22HH_STATUS, (uint8_t*)&lps22hhReg, 1);
 
 		//Read output only if new value is available
@@ -350,6 +421,8 @@ float lp_get_temperature_lps22h(void)	// get_temperature() from lsm6dso is faste
 			lps22hh_temperature_raw_get(&pressure_ctx, &i16bit);
 			lps22hhTemperature_degC = lps22hh_from_lsb_to_celsius(i16bit);
 		}
+
+		imu_bus_unlock();
 		return lps22hhTemperature_degC;
 	}
 	return NAN;
@@ -361,22 +434,27 @@ float lp_get_temperature(void)
 {
 	uint8_t reg;
 	axis1bit16_t data_raw_temperature;
+	float temperature_degC = NAN;
 
 	if (!initialized)
 	{
 		return NAN;
 	}
 
+	imu_bus_lock();
+
 	lsm6dso_temp_flag_data_ready_get(&dev_ctx, &reg);
 	if (reg)
 	{
 		/* Read temperature data */
 		memset(data_raw_temperature.u8bit, 0x00, sizeof(int16_t));
 		lsm6dso_temperature_raw_get(&dev_ctx, data_raw_temperature.u8bit);
-		return lsm6dso_from_lsb_to_celsius(data_raw_temperature.i16bit);
+		temperature_degC = lsm6dso_from_lsb_to_celsius(data_raw_temperature.i16bit);
 	}
 
-	return NAN;
+	imu_bus_unlock();
+
+	return temperature_degC;
 }
 
 
@@ -391,10 +469,19 @@ float lp_get_pressure(void)
 		return NAN;
 	}
 
+	// The sensor hub is busy reading the LPS22HH continuously and the pressure read thread owns the bus,
+	// return the latest sample that thread picked up without touching the I2C bus
+	if (pressureContinuous)
+	{
+		return continuousPressure_hPa;
+	}
+
 	if (lps22hhDetected)
 	{
 		ui32bit = 0;
 
+		imu_bus_lock();
+
 		lps22hh_read_reg(&pressure_ctx, LPS22HH_STATUS, (uint8_t*)&lps22hhReg, 1);
 
 		//Read output only if new value is available
@@ -404,12 +491,175 @@ float lp_get_pressure(void)
 			lps22hh_pressure_raw_get(&pressure_ctx, &ui32bit);
 			pressure_hPa = lps22hh_from_lsb_to_hpa(ui32bit);
 		}
+
+		imu_bus_unlock();
 		return pressure_hPa;
 	}
 	return NAN;
 }
 
 
+// LPS22HH output data rates available in low noise mode and the sensor hub rate used to poll each
+// of them.  The hub is polled at least twice as fast as the LPS22HH produces samples, so every
+// sample shows up in the SENSOR_HUB registers before it is overwritten.
+typedef struct
+{
+	uint32_t rateHz;
+	lps22hh_odr_t odr;
+	lsm6dso_shub_odr_t hubOdr;
+} PressureRate;
+
+static const PressureRate pressure_rates[] = {
+	{1, LPS22HH_1_Hz_LOW_NOISE, LSM6DSO_SH_ODR_13Hz},
+	{10, LPS22HH_10_Hz_LOW_NOISE, LSM6DSO_SH_ODR_26Hz},
+	{25, LPS22HH_25_Hz_LOW_NOISE, LSM6DSO_SH_ODR_52Hz},
+	{50, LPS22HH_50_Hz_LOW_NOISE, LSM6DSO_SH_ODR_104Hz},
+};
+
+// STATUS, PRESS_OUT_XL/L/H and TEMP_OUT_L/H are contiguous in the LPS22HH
+#define PRESSURE_HUB_READ_LEN 6
+
+// The previous hub copy read by lp_pressure_continuous_read().  It is kept across a restart, the hub registers
+// still hold the last sample read before the stop.
+static uint8_t continuousLastHub[PRESSURE_HUB_READ_LEN];
+
+// Let the LSM6DSO sensor hub read the LPS22HH on its own.  Once started, the hub reads the LPS22HH
+// output registers on every hub cycle (triggered by the accelerometer data ready) and stores them
+// in its SENSOR_HUB registers, so reading a sample is a single LSM6DSO register read instead of a
+// full sensor hub transaction with 20ms polling delays.  Returns the LPS22HH output data rate used,
+// the slowest supported rate that is at least sampleRateHz, or 0 if the LPS22HH is not available.
+uint32_t lp_pressure_continuous_start(uint32_t sampleRateHz)
+{
+	lsm6dso_sh_cfg_read_t sh_cfg_read;
+	uint8_t rate = 0;
+
+	if (!initialized || !lps22hhDetected)
+	{
+		return 0;
+	}
+
+	imu_bus_lock();
+
+	// Reconfigure from a stopped hub, the LPS22HH rate is written with a one shot hub transaction
+	pressure_continuous_stop();
+
+	while ((rate < (sizeof(pressure_rates) / sizeof(pressure_rates[0])) - 1) && (pressure_rates[rate].rateHz < sampleRateHz))
+	{
+		rate++;
+	}
+
+	lps22hh_data_rate_set(&pressure_ctx, pressure_rates[rate].odr);
+
+	// Read STATUS through TEMP_OUT_H from slave 0 on every hub cycle
+	sh_cfg_read.slv_add = (LPS22HH_I2C_ADD_L & 0xFEU) >> 1; /* 7bit I2C address */
+	sh_cfg_read.slv_subadd = LPS22HH_STATUS;
+	sh_cfg_read.slv_len = PRESSURE_HUB_READ_LEN;
+	lsm6dso_sh_slv0_cfg_read(&dev_ctx, &sh_cfg_read);
+	lsm6dso_sh_slave_connected_set(&dev_ctx, LSM6DSO_SLV_0);
+	lsm6dso_sh_syncro_mode_set(&dev_ctx, LSM6DSO_XL_GY_DRDY);
+	lsm6dso_sh_data_rate_set(&dev_ctx, pressure_rates[rate].hubOdr);
+
+	// The hub cycles at the accelerometer ODR divided down to the hub ODR, so run the accelerometer
+	// at least as fast as the hub
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_104Hz);
+	lsm6dso_sh_master_set(&dev_ctx, PROPERTY_ENABLE);
+
+	pressureContinuous = true;
+
+	imu_bus_unlock();
+
+	return pressure_rates[rate].rateHz;
+}
+
+void lp_pressure_continuous_stop(void)
+{
+	if (!initialized)
+	{
+		return;
+	}
+
+	imu_bus_lock();
+	pressure_continuous_stop();
+	imu_bus_unlock();
+}
+
+// lp_pressure_continuous_stop() with the bus locked
+static void pressure_continuous_stop(void)
+{
+	if (!pressureContinuous)
+	{
+		return;
+	}
+
+	lsm6dso_sh_master_set(&dev_ctx, PROPERTY_DISABLE);
+	pressureContinuous = false;
+}
+
+// Read the latest LPS22HH sample copied by the sensor hub.  Returns true, and the new sample through either
+// pointer that is not NULL, only when the hub holds a conversion this function hasn't returned before.  Returns
+// false if there is no new conversion, continuous mode is not running or the LSM6DSO could not be read.
+//
+// The hub reads STATUS through TEMP_OUT_H on every hub cycle, twice per LPS22HH conversion.  Reading PRESS_OUT_H
+// clears P_DA, so P_DA is set in the hub copy of STATUS only on the first hub cycle after a conversion, the
+// following cycles copy the same sample with P_DA clear.  A hub copy is a new conversion when
+//   - P_DA is set and the previous copy read here had it clear, or
+//   - the output bytes changed, which covers the copy with P_DA set having been overwritten before this function
+//     got to it and a conversion that completed between the hub's STATUS and PRESS_OUT_H reads.
+// The same copy read twice, P_DA set or not, is not new.
+bool lp_pressure_continuous_read(float* pressure_hPa, float* temperature_degC)
+{
+	uint8_t hub[PRESSURE_HUB_READ_LEN];
+	lps22hh_status_t status;
+	lps22hh_status_t lastStatus;
+	uint32_t rawPressure;
+	int16_t rawTemperature;
+	bool changed;
+	bool read;
+
+	if (!initialized || !pressureContinuous)
+	{
+		return false;
+	}
+
+	imu_bus_lock();
+	read = (lsm6dso_sh_read_data_raw_get(&dev_ctx, hub, PRESSURE_HUB_READ_LEN) == 0) && imuBusOk;
+	imu_bus_unlock();
+
+	if (!read)
+	{
+		return false;
+	}
+
+	memcpy(&status, &hub[0], 1);
+	memcpy(&lastStatus, &continuousLastHub[0], 1);
+	changed = memcmp(&hub[1], &continuousLastHub[1], PRESSURE_HUB_READ_LEN - 1) != 0;
+	memcpy(continuousLastHub, hub, PRESSURE_HUB_READ_LEN);
+
+	if (!changed && !(status.p_da && !lastStatus.p_da))
+	{
+		return false;
+	}
+
+	// Same left aligned layout as lps22hh_pressure_raw_get(), so the driver conversion applies
+	rawPressure = ((uint32_t)hub[3] << 24) | ((uint32_t)hub[2] << 16) | ((uint32_t)hub[1] << 8);
+	rawTemperature = (int16_t)(((uint16_t)hub[5] << 8) | hub[4]);
+
+	continuousPressure_hPa = lps22hh_from_lsb_to_hpa(rawPressure);
+	continuousTemperature_degC = lps22hh_from_lsb_to_celsius(rawTemperature);
+
+	if (pressure_hPa != NULL)
+	{
+		*pressure_hPa = continuousPressure_hPa;
+	}
+	if (temperature_degC != NULL)
+	{
+		*temperature_degC = continuousTemperature_degC;
+	}
+
+	return true;
+}
+
+
 void lp_calibrate_angular_rate(void)
 {
 	if (!initialized)
@@ -425,6 +675,8 @@ void lp_calibrate_angular_rate(void)
 	// Log_Debug("LSM6DSO: Calibrating angular rate . . .\n");
 	// Log_Debug("LSM6DSO: Please make sure the device is stationary.\n");
 
+	imu_bus_lock();
+
 	do
 	{
 
@@ -467,6 +719,8 @@ void lp_calibrate_angular_rate(void)
 		// If the angular values after applying the offset are not all 0.0s, then do it again!
 	} while ((angularRateDps.x != 0.0) || (angularRateDps.y != 0.0) || (angularRateDps.z != 0.0));
 
+	imu_bus_unlock();
+
 	// Log_Debug("LSM6DSO: Calibrating angular rate complete!\n");
 }
 
@@ -539,14 +793,18 @@ bool lp_imu_initialize(void)
 
 	/* Init test platform */
 	platform_init();
+	i2c_bus_device_init(&imuBus, "LSM6DSO", i2cHandle);
 
 	/* Wait sensor boot time */
 	platform_delay(20);
 
+	imu_bus_lock();
+
 	/* Check device ID */
 	lsm6dso_device_id_get(&dev_ctx, &whoamI);
 	if (whoamI != LSM6DSO_ID)
 	{
+		imu_bus_unlock();
 		initialized = false;
 		return false;
 	}
@@ -583,6 +841,8 @@ bool lp_imu_initialize(void)
 
 	detect_lps22hh();
 
+	imu_bus_unlock();
+
 	initialized = true;
 
 	return true;
@@ -602,6 +862,12 @@ void lp_imu_close(void)
 }
 
 
+void lp_imu_get_i2c_stats(i2c_bus_stats_t* stats, bool reset)
+{
+	i2c_bus_get_stats(&imuBus, stats, reset);
+}
+
+
 /*
  * @brief  Write lsm2mdl device register (used by configuration functions)
  *
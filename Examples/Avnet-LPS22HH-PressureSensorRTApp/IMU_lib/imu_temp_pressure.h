@@ -11,6 +11,7 @@
 #include <unistd.h>
 #include "tx_api.h"
 #include "os_hal_i2c.h"
+#include "i2c_bus.h"
 
 #define LSM6DSO_ADDRESS	   0x6A	  // I2C Address
 static const uint8_t i2c_speed = I2C_SCL_1000kHz;
@@ -37,3 +38,7 @@ float lp_get_temperature_lps22h(void);	// get_temperature() from lsm6dso is fast
 void lp_calibrate_angular_rate(void);
 AngularRateDegreesPerSecond lp_get_angular_rate(void);
 AccelerationMilligForce lp_get_acceleration(void);
+uint32_t lp_pressure_continuous_start(uint32_t sampleRateHz);
+void lp_pressure_continuous_stop(void);
+bool lp_pressure_continuous_read(float* pressure_hPa, float* temperature_degC);
+void lp_imu_get_i2c_stats(i2c_bus_stats_t* stats, bool reset);
@@ -10,4 +10,10 @@
 // CLICK Socket Selection
 // Use this section to define which CLICK socket the sensor hardware is using
 
-/* This application does not use the CLICK sockets /*
+/* This application does not use the CLICK sockets */
+
+// I2C Bus Statistics
+// The LSM6DSO and the LPS22HH on its sensor hub go through the I2C bus manager (i2c_bus.h).  Define
+// I2C_BUS_PRINT_STATS to print how much of the time since the previous telemetry message the driver held the bus,
+// its transactions and errors on the debug UART with every telemetry message.
+//#define I2C_BUS_PRINT_STATS
@@ -0,0 +1,162 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include <string.h>
+#include "printf.h"
+#include "cycle_counter.h"
+#include "i2c_bus.h"
+
+typedef struct
+{
+    TX_MUTEX mutex;
+    uint32_t lockCycles;                // Cycle counter when the current owner locked the bus
+} i2c_bus_t;
+
+static i2c_bus_t buses[I2C_BUS_COUNT];
+
+static CHAR* const busNames[I2C_BUS_COUNT] = {
+    "ISU0 i2c bus", "ISU1 i2c bus", "ISU2 i2c bus", "ISU3 i2c bus", "ISU4 i2c bus"
+};
+
+// Queued transactions, the queue holds pointers
+static TX_QUEUE busQueue;
+static ULONG busQueueArea[I2C_BUS_QUEUE_LEN];
+
+static TX_THREAD busThread;
+static ULONG busThreadStack[I2C_BUS_STACK_SIZE / sizeof(ULONG)];
+
+// Runs the queued transactions one after another
+static void i2c_bus_thread_entry(ULONG thread_input)
+{
+    ULONG message;
+    i2c_bus_transaction_t* transaction;
+
+    (void)thread_input;
+
+    while (true) {
+
+        if (tx_queue_receive(&busQueue, &message, TX_WAIT_FOREVER) != TX_SUCCESS) {
+            continue;
+        }
+
+        transaction = (i2c_bus_transaction_t*)message;
+        i2c_bus_transfer(transaction);
+
+        if (transaction->done != NULL) {
+            transaction->done(transaction);
+        }
+    }
+}
+
+UINT i2c_bus_init(void)
+{
+    UINT status;
+
+    for (int isu = 0; isu < I2C_BUS_COUNT; isu++) {
+        status = tx_mutex_create(&buses[isu].mutex, busNames[isu], TX_INHERIT);
+        if (status != TX_SUCCESS) {
+            printf("failed to create the %s mutex\r\n", busNames[isu]);
+            return status;
+        }
+    }
+
+    status = tx_queue_create(&busQueue, "i2c bus queue", TX_1_ULONG, busQueueArea, sizeof(busQueueArea));
+    if (status != TX_SUCCESS) {
+        printf("failed to create the i2c bus queue\r\n");
+        return status;
+    }
+
+    status = tx_thread_create(&busThread, "i2c bus thread", i2c_bus_thread_entry, 0, busThreadStack,
+                              sizeof(busThreadStack), I2C_BUS_THREAD_PRIORITY, I2C_BUS_THREAD_PRIORITY,
+                              TX_NO_TIME_SLICE, TX_AUTO_START);
+    if (status != TX_SUCCESS) {
+        printf("failed to create the i2c bus thread\r\n");
+    }
+    return status;
+}
+
+void i2c_bus_device_init(i2c_bus_device_t* device, const char* name, uint8_t isu)
+{
+    memset(device, 0, sizeof(*device));
+    device->name = name;
+    device->isu = (isu < I2C_BUS_COUNT) ? isu : 0;
+}
+
+void i2c_bus_lock(i2c_bus_device_t* device)
+{
+    i2c_bus_t* bus = &buses[device->isu];
+
+    tx_mutex_get(&bus->mutex, TX_WAIT_FOREVER);
+    bus->lockCycles = cycle_counter_get();
+}
+
+void i2c_bus_unlock(i2c_bus_device_t* device, bool ok)
+{
+    i2c_bus_t* bus = &buses[device->isu];
+    uint32_t cycles = cycle_counter_get() - bus->lockCycles;
+
+    device->transactions++;
+    device->busyCycles += cycles;
+    if (cycles > device->maxCycles) {
+        device->maxCycles = cycles;
+    }
+    if (!ok) {
+        device->errors++;
+    }
+
+    tx_mutex_put(&bus->mutex);
+}
+
+int i2c_bus_transfer(i2c_bus_transaction_t* transaction)
+{
+    i2c_bus_device_t* device = transaction->device;
+    int result;
+
+    i2c_bus_lock(device);
+
+    if (transaction->txLen && transaction->rxLen) {
+        result = mtk_os_hal_i2c_write_read((i2c_num)device->isu, transaction->address, (uint8_t*)transaction->tx,
+                                           transaction->rx, transaction->txLen, transaction->rxLen);
+    }
+    else if (transaction->txLen) {
+        result = mtk_os_hal_i2c_write((i2c_num)device->isu, transaction->address, (uint8_t*)transaction->tx,
+                                      transaction->txLen);
+    }
+    else {
+        result = mtk_os_hal_i2c_read((i2c_num)device->isu, transaction->address, transaction->rx, transaction->rxLen);
+    }
+
+    i2c_bus_unlock(device, result == 0);
+
+    transaction->result = result;
+    return result;
+}
+
+bool i2c_bus_submit(i2c_bus_transaction_t* transaction)
+{
+    ULONG message = (ULONG)transaction;
+
+    return tx_queue_send(&busQueue, &message, TX_NO_WAIT) == TX_SUCCESS;
+}
+
+void i2c_bus_get_stats(i2c_bus_device_t* device, i2c_bus_stats_t* stats, bool reset)
+{
+    i2c_bus_t* bus = &buses[device->isu];
+
+    // Not counted as a transaction, the counters only change with the bus locked
+    tx_mutex_get(&bus->mutex, TX_WAIT_FOREVER);
+
+    stats->transactions = device->transactions;
+    stats->errors = device->errors;
+    stats->busyCycles = device->busyCycles;
+    stats->maxCycles = device->maxCycles;
+
+    if (reset) {
+        device->transactions = 0;
+        device->errors = 0;
+        device->busyCycles = 0;
+        device->maxCycles = 0;
+    }
+
+    tx_mutex_put(&bus->mutex);
+}
@@ -0,0 +1,92 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "tx_api.h"
+#include "os_hal_i2c.h"
+
+// I2C bus manager, the smart shelf application's i2c_bus module on the OS_HAL I2C API.
+//
+// The IMU driver talks to the OS_HAL I2C controller directly, nothing stops two threads from talking to devices on
+// the same ISU at the same time.  The bus manager keeps a priority inheriting mutex per ISU, a thread locks the bus for
+// one device, runs its transfers and unlocks it again.  The time the bus was held, the number of transactions and
+// the errors are counted per device, so it shows which device uses the bus.
+//
+// Short transfers (a handful of bytes) can be queued instead with i2c_bus_submit(), the bus thread runs them in
+// order and calls the completion callback, the submitting thread carries on in the meantime.
+//
+// i2c_bus_init() has to run in tx_application_define(), before any thread uses a bus.
+
+// ISUs on the MT3620 (OS_HAL_I2C_ISU0 - OS_HAL_I2C_ISU4)
+#define I2C_BUS_COUNT           5
+
+// Queued transactions and the bus thread, it runs above the sensor threads so a queued transfer doesn't wait
+// behind their processing
+#define I2C_BUS_QUEUE_LEN       8
+#define I2C_BUS_STACK_SIZE      1024
+#define I2C_BUS_THREAD_PRIORITY 5
+
+typedef struct
+{
+    const char* name;
+    uint8_t isu;                        // OS_HAL_I2C_ISU0 - OS_HAL_I2C_ISU4
+
+    // Updated with the bus locked
+    uint32_t transactions;              // Bus locks
+    uint32_t errors;                    // Transactions that failed
+    uint64_t busyCycles;                // M4 cycles the bus was held, see cycle_counter.h
+    uint32_t maxCycles;                 // Longest transaction
+} i2c_bus_device_t;
+
+typedef struct i2c_bus_transaction i2c_bus_transaction_t;
+
+// Called by the bus thread once a queued transaction is done, result holds the outcome
+typedef void (*i2c_bus_done_t)(i2c_bus_transaction_t* transaction);
+
+struct i2c_bus_transaction
+{
+    i2c_bus_device_t* device;
+    uint8_t address;                    // 7 bit device address
+    const uint8_t* tx;                  // Written first, txLen 0 for a plain read.  Transfers longer than the 8 byte
+    uint16_t txLen;                     // FIFO go by DMA, the buffers have to be in SYSRAM then.
+    uint8_t* rx;                        // Read after the write with a repeated start, rxLen 0 for a plain write
+    uint16_t rxLen;
+    i2c_bus_done_t done;                // NULL if nobody waits for it
+    void* arg;                          // For the caller
+    int result;                         // 0 or the negative OS_HAL error
+};
+
+// Per device counters, see i2c_bus_device_t
+typedef struct
+{
+    uint32_t transactions;
+    uint32_t errors;
+    uint64_t busyCycles;
+    uint32_t maxCycles;
+} i2c_bus_stats_t;
+
+// Creates the per ISU mutexes, the transaction queue and the bus thread
+UINT i2c_bus_init(void);
+
+// Sets up the accounting of a device on an ISU
+void i2c_bus_device_init(i2c_bus_device_t* device, const char* name, uint8_t isu);
+
+// Locks the device's ISU, waits for any other device on it
+void i2c_bus_lock(i2c_bus_device_t* device);
+
+// Unlocks the device's ISU, ok false counts an error
+void i2c_bus_unlock(i2c_bus_device_t* device, bool ok);
+
+// Runs a transaction with the bus locked and returns its result
+int i2c_bus_transfer(i2c_bus_transaction_t* transaction);
+
+// Queues a transaction for the bus thread, the transaction has to stay valid until done is called.  Returns false
+// if the queue is full.
+bool i2c_bus_submit(i2c_bus_transaction_t* transaction);
+
+// Copies the counters of a device, reset starts them over
+void i2c_bus_get_stats(i2c_bus_device_t* device, i2c_bus_stats_t* stats, bool reset);
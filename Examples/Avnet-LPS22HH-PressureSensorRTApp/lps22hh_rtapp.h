@@ -17,6 +17,9 @@ typedef enum __attribute__((packed))
 	// Don't change the enums above or the generic RTApp implementation will break //
 	/////////////////////////////////////////////////////////////////////////////////
 	IC_LPS22HH_READ_SENSOR, 
+	IC_LPS22HH_SET_PRESSURE_CONFIG,
+	IC_LPS22HH_SET_ALTITUDE_CONFIG,
+	IC_LPS22HH_READ_ALTITUDE,
 
 } INTER_CORE_CMD_LPS22HH;
 
@@ -28,6 +31,10 @@ typedef struct  __attribute__((packed))
 	////////////////////////////////////////////////////////////////////////////////////////
 	// Don't change the declarations above or the generic RTApp implementation will break //
 	////////////////////////////////////////////////////////////////////////////////////////
+    uint32_t pressureSampleRate;    // LPS22HH output data rate (Hz), 0 keeps the current rate
+    uint16_t pressureAverageWindow; // Samples in the moving average (1 - 64), 0 keeps the current window
+    float seaLevelPressure;         // hPa, sea level reference for the altitude (QNH), 0 keeps the current reference
+    float altitudeFilterSeconds;    // Pressure filter time constant, 0 keeps the current time constant
 } IC_COMMAND_BLOCK_LPS22HH_HL_TO_RT;
 
 // Define the data structure that the real time app sends
@@ -39,5 +46,18 @@ typedef struct  __attribute__((packed))
 	////////////////////////////////////////////////////////////////////////////////////////
 	// Don't change the declarations above or the generic RTApp implementation will break //
 	////////////////////////////////////////////////////////////////////////////////////////
-    float pressure;
+    float pressure;                 // hPa, latest sample
+    float pressureAverage;          // hPa, moving average over pressureAverageWindow samples
+    float temperature;              // degrees C, LPS22HH temperature
+    uint32_t pressureSampleRate;
+    uint16_t pressureAverageWindow;
+    uint32_t pressureSampleCount;   // Samples since sampling was (re)configured
+    uint32_t pressureAgeMs;         // Time since the latest sample
+    float seaLevelPressure;         // hPa
+    float altitudeFilterSeconds;
+    float filteredPressure;         // hPa, low pass filtered pressure the altitude is computed from
+    float altitude;                 // m above the sea level reference
+    float verticalSpeed;            // m/s, positive when climbing
+    float pressureTendency;         // hPa change over pressureTendencyMinutes, positive when rising
+    uint16_t pressureTendencyMinutes; // 180 once three hours of samples are available
 } IC_COMMAND_BLOCK_LPS22HH_RT_TO_HL;
@@ -44,16 +44,22 @@
 #include "os_hal_mbox_shared_mem.h"
 #include "lps22hh_rtapp.h"
 #include "./IMU_lib/imu_temp_pressure.h"
-
-// 1 tick = 10ms. It is configurable.
-#define MS_TO_TICK(ms)  ((ms) * (TX_TIMER_TICKS_PER_SECOND) / 1000)
-
-// Define global variables
-static float pressure = 0.0F;
+#include "i2c_bus.h"
+#include "cycle_counter.h"
+#include "buildOptions.h"
+#include "pressure_cache.h"
+#include "pressure_trend.h"
 
 // Add MT3620 constant
 #define MT3620_TIMER_TICKS_PER_SECOND ((ULONG) 100*10)
 
+// 1 tick = 1ms.  SysTick runs at 1kHz (tx_initialize_low_level.S), TX_TIMER_TICKS_PER_SECOND is still the ThreadX
+// default of 100 and can't be used to convert.
+#define MS_TO_TICK(ms)  ((ms) * MT3620_TIMER_TICKS_PER_SECOND / 1000)
+
+// M4 core clock (197.6MHz) in cycles per microsecond, converts DWT cycle counts
+#define MT3620_M4_CYCLES_PER_US 197
+
 // Application configuration details
 #define APP_STACK_SIZE      1024
 #define DEMO_BYTE_POOL_SIZE 9120
@@ -100,6 +106,21 @@ static UINT send_telemetry_thread_period = 0;
 // Variable to track if the harware has been initialized
 static volatile bool hardwareInitOK = false;
 
+// Continuous pressure sampling configuration.  The pressure read thread samples the LPS22HH at
+// pressure_sample_rate and keeps the latest sample and a moving average over pressure_average_window
+// samples in the pressure cache.  Telemetry and IC_LPS22HH_READ_SENSOR read the cache.
+#define PRESSURE_DEFAULT_SAMPLE_RATE 10
+#define PRESSURE_DEFAULT_AVERAGE_WINDOW 10
+static uint32_t pressure_sample_rate = PRESSURE_DEFAULT_SAMPLE_RATE;
+static uint16_t pressure_average_window = PRESSURE_DEFAULT_AVERAGE_WINDOW;
+static volatile bool pressureConfigChanged = true;
+
+// Altitude configuration requested by the high level application, applied by the pressure read thread which
+// owns the pressure trend engine.  Zero keeps a setting.
+static float altitude_sea_level_pressure = 0.0f;
+static float altitude_filter_seconds = 0.0f;
+static volatile bool altitudeConfigChanged = false;
+
 // Define the bits used for the telemetry event flag construct
 enum triggers {
     HIGH_LEVEL_MESSAGE = 0,
@@ -116,6 +137,7 @@ volatile UCHAR  blockFifoSema;
 // Threads
 TX_THREAD               thread_mbox;
 TX_THREAD               thread_set_telemetry_flag;
+TX_THREAD               thread_pressure_read;
 TX_THREAD               tx_hardware_init_thread;
 
 // Application memory pool
@@ -129,6 +151,7 @@ TX_EVENT_FLAGS_GROUP    hardware_event_flags_0;
 /* Define thread prototypes.  */
 void tx_thread_mbox_entry(ULONG thread_input);
 void set_telemetry_flag_thread_entry(ULONG thread_input);
+void pressure_read_thread_entry(ULONG thread_input);
 void hardware_init_thread(ULONG thread_input);
 
 /* Function prototypes */
@@ -137,10 +160,15 @@ void mbox_swint_cb(struct mtk_os_hal_mbox_cb_data *data);
 void mbox_print(UCHAR *mbox_buf, UINT mbox_data_len);
 bool initialize_hardware(void);
 void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void readPressure(IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing);
+void printI2cStats(void);
 
 /* Define main entry point.  */
 void tx_main(void)
 {
+    /* Enable the DWT cycle counter used to time the I2C bus */
+    cycle_counter_init();
+
     /* Enter the ThreadX kernel.  */
     tx_kernel_enter();
 }
@@ -173,6 +201,14 @@ void tx_application_define(void *first_unused_memory)
         printf("failed to create send_telemetry_event_flags\r\n");
     }
 
+    // The hardware init thread and then the pressure read thread talk to the IMU on ISU2, the IMU driver locks the
+    // bus for every access so any other thread can call it as well
+    status = i2c_bus_init();
+    if (status != TX_SUCCESS)
+    {
+        printf("failed to create the i2c bus manager\r\n");
+    }
+
     // -------------------------------- Threads --------------------------------
 
     /* Allocate the stack for thread_mbox.  */
@@ -189,6 +225,13 @@ void tx_application_define(void *first_unused_memory)
     tx_thread_create(&thread_set_telemetry_flag, "set telemetry flag thread", set_telemetry_flag_thread_entry, 0,
             pointer, APP_STACK_SIZE, 7, 7, TX_NO_TIME_SLICE, TX_AUTO_START);
 
+    /* Allocate the stack for the pressure read thread  */
+    tx_byte_allocate(&byte_pool_0, (VOID **) &pointer, APP_STACK_SIZE, TX_NO_WAIT);
+
+    /* Create the pressure read thread.  */
+    tx_thread_create(&thread_pressure_read, "pressure read thread", pressure_read_thread_entry, 0,
+            pointer, APP_STACK_SIZE, 7, 7, TX_NO_TIME_SLICE, TX_AUTO_START);
+
     /* Allocate the stack for the hardware_init_thread  */
     tx_byte_allocate(&byte_pool_0, (VOID**) &pointer, APP_STACK_SIZE, TX_NO_WAIT);
     
@@ -333,8 +376,8 @@ void tx_thread_mbox_entry(ULONG thread_input)
 
                         if(hardwareInitOK){
 
-                            // Read the pressure sensor and copy it into the response buffer
-                            payloadPtrOutgoing->payload.pressure = lp_get_pressure();
+                            // Copy the latest sample from the pressure cache into the response buffer
+                            readPressure(payloadPtrOutgoing);
                             printf("RealTime App sending sensor reading %.2f\n", payloadPtrOutgoing->payload.pressure);
 
                             // Write to A7, enqueue to mailbox, we're just echoing back the Read Sensor command with the additional data
@@ -343,6 +386,70 @@ void tx_thread_mbox_entry(ULONG thread_input)
 
                         break;
 
+                    // The high level application is configuring continuous pressure sampling.  Zero leaves a
+                    // setting unchanged.
+                    case IC_LPS22HH_SET_PRESSURE_CONFIG:
+
+                        printf("Set pressure sampling to %lu Hz, average of %u samples\n", payloadPtrIncomming->payload.pressureSampleRate,
+                                                                                           payloadPtrIncomming->payload.pressureAverageWindow);
+
+                        if(payloadPtrIncomming->payload.pressureSampleRate > 0){
+                            pressure_sample_rate = payloadPtrIncomming->payload.pressureSampleRate;
+                        }
+                        if(payloadPtrIncomming->payload.pressureAverageWindow > 0){
+                            pressure_average_window = payloadPtrIncomming->payload.pressureAverageWindow;
+                            if(pressure_average_window > PRESSURE_CACHE_MAX_WINDOW){
+                                pressure_average_window = PRESSURE_CACHE_MAX_WINDOW;
+                            }
+                        }
+
+                        // The pressure read thread owns the I2C bus, let it reconfigure the sensor
+                        pressureConfigChanged = true;
+                        tx_thread_wait_abort(&thread_pressure_read);
+
+                        // Respond with the configuration that will be used, the sensor rounds the rate up to the next ODR
+                        payloadPtrOutgoing->payload.pressureSampleRate = pressure_sample_rate;
+                        payloadPtrOutgoing->payload.pressureAverageWindow = pressure_average_window;
+
+                        // Write to A7, enqueue to mailbox
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
+                    // The high level application is setting the sea level reference pressure (QNH) and the altitude
+                    // filter time constant.  Zero leaves a setting unchanged.
+                    case IC_LPS22HH_SET_ALTITUDE_CONFIG:
+
+                        printf("Set the sea level pressure to %.2f hPa, altitude filter %.2f s\n", payloadPtrIncomming->payload.seaLevelPressure,
+                                                                                                 payloadPtrIncomming->payload.altitudeFilterSeconds);
+
+                        altitude_sea_level_pressure = payloadPtrIncomming->payload.seaLevelPressure;
+                        altitude_filter_seconds = payloadPtrIncomming->payload.altitudeFilterSeconds;
+
+                        // Let the pressure read thread apply the configuration between samples
+                        altitudeConfigChanged = true;
+                        tx_thread_wait_abort(&thread_pressure_read);
+
+                        // Respond with the configuration that will be used
+                        payloadPtrOutgoing->payload.seaLevelPressure = (altitude_sea_level_pressure > 0.0f) ? altitude_sea_level_pressure : pressure_trend_get_sea_level();
+                        payloadPtrOutgoing->payload.altitudeFilterSeconds = (altitude_filter_seconds > 0.0f) ? altitude_filter_seconds : pressure_trend_get_filter_seconds();
+
+                        // Write to A7, enqueue to mailbox
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
+                    // The high level application is requesting the derived measurements
+                    case IC_LPS22HH_READ_ALTITUDE:
+
+                        readPressure(payloadPtrOutgoing);
+                        printf("RealTime App sending altitude %.1f m, vertical speed %.2f m/s, tendency %.2f hPa/%u min\n", payloadPtrOutgoing->payload.altitude,
+                                                                                                                          payloadPtrOutgoing->payload.verticalSpeed,
+                                                                                                                          payloadPtrOutgoing->payload.pressureTendency,
+                                                                                                                          payloadPtrOutgoing->payload.pressureTendencyMinutes);
+
+                        // Write to A7, enqueue to mailbox
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
                     case IC_LPS22HH_HEARTBEAT:
                         printf("Realtime app processing heartbeat command\n");
 
@@ -400,6 +507,60 @@ void set_telemetry_flag_thread_entry(ULONG thread_input)
     }
 }
 
+// This thread samples the LPS22HH.  The LSM6DSO sensor hub reads the LPS22HH continuously, this thread copies
+// each new conversion from the hub into the pressure cache.  It is the only thread that touches the I2C bus once
+// the hardware is initialized.  The hub is polled at twice the LPS22HH rate so no conversion is overwritten before
+// it is picked up, lp_pressure_continuous_read() only returns a conversion once and the sample is stamped with the
+// poll that found it, at most half a sample period late.
+void pressure_read_thread_entry(ULONG thread_input)
+{
+    ULONG poll_ticks = MT3620_TIMER_TICKS_PER_SECOND / (2 * PRESSURE_DEFAULT_SAMPLE_RATE);
+    float pressure_hPa;
+    float temperature_degC;
+    PressureTrend trend;
+
+    printf("Pressure Read Task Started\n");
+
+    while (true){
+
+        if(hardwareInitOK && pressureConfigChanged){
+
+            pressureConfigChanged = false;
+
+            pressure_sample_rate = lp_pressure_continuous_start(pressure_sample_rate);
+            pressure_average_window = pressure_cache_reset(pressure_average_window);
+
+            if(pressure_sample_rate > 0){
+                poll_ticks = MT3620_TIMER_TICKS_PER_SECOND / (2 * pressure_sample_rate);
+                printf("Continuous pressure sampling at %lu Hz, average of %u samples\n", pressure_sample_rate, pressure_average_window);
+            }
+            else{
+                printf("LPS22HH not available, continuous pressure sampling disabled\n");
+            }
+        }
+
+        if(altitudeConfigChanged){
+
+            altitudeConfigChanged = false;
+            pressure_trend_configure(altitude_sea_level_pressure, altitude_filter_seconds);
+        }
+
+        if(hardwareInitOK && (pressure_sample_rate > 0)){
+
+            if(lp_pressure_continuous_read(&pressure_hPa, &temperature_degC)){
+
+                // Run the sample through the altitude and tendency filters, then publish both.  One tick is 1ms.
+                ULONG now = tx_time_get();
+                pressure_trend_push(pressure_hPa, now * (1000 / MT3620_TIMER_TICKS_PER_SECOND), &trend);
+                pressure_cache_push(pressure_hPa, temperature_degC, now, &trend);
+            }
+        }
+
+        // Sleep until the next sample
+        tx_thread_sleep(poll_ticks);
+    }
+}
+
 // only purpose in life is to initialize the hardware.
 void hardware_init_thread(ULONG thread_input)
 {
@@ -494,10 +655,13 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
     // Set the response message ID
     payloadPtrOutgoing->payload.cmd = IC_LPS22HH_READ_SENSOR_RESPOND_WITH_TELEMETRY;
 
-    if(hardwareInitOK){
+    PressureSnapshot snapshot;
+
+    if(hardwareInitOK && pressure_cache_get(&snapshot)){
 
-        // Construct the telemetry response
-        snprintf(payloadPtrOutgoing->payload.telemetryJSON, 128,  "{\"pressure_hPa\": %.2f}",pressure);
+        // Construct the telemetry response from the pressure cache
+        snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE,  "{\"pressure_hPa\": %.2f, \"pressureAvg_hPa\": %.2f}",
+                 snapshot.pressure_hPa, snapshot.averagePressure_hPa);
        
     }
     else{
@@ -508,10 +672,35 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
 
     printf("\n\nSending to A7: %s\n",payloadPtrOutgoing->payload.telemetryJSON);
 
+#ifdef I2C_BUS_PRINT_STATS
+    printI2cStats();
+#endif
+
     /* Write to the high level application, enqueue to mailbox */
     EnqueueData(inbound, outbound, mbox_shared_buf_size, payloadPtrOutgoing, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
 }
 
+#ifdef I2C_BUS_PRINT_STATS
+// Prints the IMU's use of ISU2 since the previous call, the counters start over
+void printI2cStats(void){
+
+    static ULONG statsStart;
+    ULONG now = tx_time_get();
+    uint64_t windowUs = (uint64_t)(now - statsStart) * (1000000 / MT3620_TIMER_TICKS_PER_SECOND);
+    uint32_t busyPermille;
+    i2c_bus_stats_t stats;
+
+    statsStart = now;
+    lp_imu_get_i2c_stats(&stats, true);
+    busyPermille = windowUs ? (uint32_t)((stats.busyCycles / MT3620_M4_CYCLES_PER_US * 1000 + windowUs / 2) / windowUs) : 0;
+
+    printf("I2C LSM6DSO: %lu.%lu%% busy over %lu ms, %lu transactions, %lu errors, longest %lu us\n",
+           (unsigned long)(busyPermille / 10), (unsigned long)(busyPermille % 10), (unsigned long)(windowUs / 1000),
+           (unsigned long)stats.transactions, (unsigned long)stats.errors,
+           (unsigned long)(stats.maxCycles / MT3620_M4_CYCLES_PER_US));
+}
+#endif
+
 // Update this routine to initialize any hardware interfaces required by your implementation
 bool initialize_hardware(void) {
 
@@ -527,9 +716,39 @@ bool initialize_hardware(void) {
 			}
 			tx_thread_sleep(MS_TO_TICK(100));
 		}
-        pressure = lp_get_pressure();
 
 	}
 
     return status;
 }
+
+// Copy the latest pressure sample and moving average from the pressure cache into an outgoing message.  This
+// thread never touches the I2C bus, it only reads the cache.  The cache is lock free: the pressure read thread
+// (priority 7) is its only writer and never waits on a reader, the mbox thread (priority 8) retries a copy the
+// writer updated underneath it.
+void readPressure(IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing){
+
+    PressureSnapshot snapshot;
+
+    if(!pressure_cache_get(&snapshot)){
+        payloadPtrOutgoing->payload.pressure = NAN;
+        payloadPtrOutgoing->payload.pressureAverage = NAN;
+        payloadPtrOutgoing->payload.temperature = NAN;
+        return;
+    }
+
+    payloadPtrOutgoing->payload.pressure = snapshot.pressure_hPa;
+    payloadPtrOutgoing->payload.pressureAverage = snapshot.averagePressure_hPa;
+    payloadPtrOutgoing->payload.temperature = snapshot.temperature_degC;
+    payloadPtrOutgoing->payload.pressureSampleRate = pressure_sample_rate;
+    payloadPtrOutgoing->payload.pressureAverageWindow = snapshot.averageCount;
+    payloadPtrOutgoing->payload.pressureSampleCount = snapshot.sampleCount;
+    payloadPtrOutgoing->payload.pressureAgeMs = (tx_time_get() - snapshot.timestamp) * (1000 / MT3620_TIMER_TICKS_PER_SECOND);
+    payloadPtrOutgoing->payload.seaLevelPressure = pressure_trend_get_sea_level();
+    payloadPtrOutgoing->payload.altitudeFilterSeconds = pressure_trend_get_filter_seconds();
+    payloadPtrOutgoing->payload.filteredPressure = snapshot.trend.filteredPressure_hPa;
+    payloadPtrOutgoing->payload.altitude = snapshot.trend.altitude_m;
+    payloadPtrOutgoing->payload.verticalSpeed = snapshot.trend.verticalSpeed_mps;
+    payloadPtrOutgoing->payload.pressureTendency = snapshot.trend.tendency_hPa;
+    payloadPtrOutgoing->payload.pressureTendencyMinutes = snapshot.trend.tendencySpanMinutes;
+}
@@ -0,0 +1,91 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "pressure_cache.h"
+
+// Keep the compiler from moving the snapshot accesses across the sequence count updates.  The M4 is
+// the only core touching the cache, so a compiler barrier is all the ordering that's needed.
+#define CACHE_BARRIER() __asm__ volatile("" ::: "memory")
+
+// Writer state, only touched by the thread calling pressure_cache_push()
+static float window[PRESSURE_CACHE_MAX_WINDOW];
+static uint16_t windowSize = 1;
+static uint16_t windowFill = 0;
+static uint16_t windowNext = 0;
+static double windowSum = 0.0;
+
+// Published state
+static volatile uint32_t sequence = 0;
+static PressureSnapshot published;
+
+static void publish_begin(void)
+{
+    sequence++;
+    CACHE_BARRIER();
+}
+
+static void publish_end(void)
+{
+    CACHE_BARRIER();
+    sequence++;
+}
+
+uint16_t pressure_cache_reset(uint16_t size)
+{
+    if (size == 0) {
+        size = 1;
+    }
+    if (size > PRESSURE_CACHE_MAX_WINDOW) {
+        size = PRESSURE_CACHE_MAX_WINDOW;
+    }
+
+    windowSize = size;
+    windowFill = 0;
+    windowNext = 0;
+    windowSum = 0.0;
+
+    publish_begin();
+    published.averageCount = 0;
+    published.sampleCount = 0;
+    publish_end();
+
+    return size;
+}
+
+void pressure_cache_push(float pressure_hPa, float temperature_degC, uint32_t timestamp, const PressureTrend* trend)
+{
+    // Running sum over the ring, in double so the sum does not drift over millions of samples
+    if (windowFill == windowSize) {
+        windowSum -= window[windowNext];
+    }
+    else {
+        windowFill++;
+    }
+    window[windowNext] = pressure_hPa;
+    windowSum += pressure_hPa;
+    windowNext = (windowNext + 1) % windowSize;
+
+    publish_begin();
+    published.pressure_hPa = pressure_hPa;
+    published.averagePressure_hPa = (float)(windowSum / windowFill);
+    published.temperature_degC = temperature_degC;
+    published.averageCount = windowFill;
+    published.sampleCount++;
+    published.timestamp = timestamp;
+    published.trend = *trend;
+    publish_end();
+}
+
+bool pressure_cache_get(PressureSnapshot* snapshot)
+{
+    uint32_t start;
+
+    do {
+        start = sequence;
+        CACHE_BARRIER();
+        *snapshot = published;
+        CACHE_BARRIER();
+    } while ((start & 1) || (start != sequence));
+
+    return (snapshot->sampleCount > 0);
+}
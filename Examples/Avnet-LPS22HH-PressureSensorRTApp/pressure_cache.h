@@ -0,0 +1,35 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pressure_trend.h"
+
+// Latest pressure sample plus a moving average, written by the pressure read thread and read by the
+// mbox thread without a semaphore.  The writer publishes each update under a sequence count (odd
+// while an update is in progress), readers copy the snapshot and retry if the count changed.  Reads
+// are a copy of a few words, so IC_LPS22HH_READ_SENSOR and telemetry never wait on the sensor.
+
+#define PRESSURE_CACHE_MAX_WINDOW 64
+
+typedef struct
+{
+    float pressure_hPa;         // Latest sample
+    float averagePressure_hPa;  // Mean of the last averageCount samples
+    float temperature_degC;     // LPS22HH temperature from the latest sample
+    uint16_t averageCount;      // Samples in the average, less than the window until it fills
+    uint32_t sampleCount;       // Samples since the cache was reset
+    uint32_t timestamp;         // ThreadX tick of the latest sample
+    PressureTrend trend;        // Altitude, vertical speed and tendency including the latest sample
+} PressureSnapshot;
+
+// Set the moving average length (1 - PRESSURE_CACHE_MAX_WINDOW) and discard all samples.  Writer side.
+uint16_t pressure_cache_reset(uint16_t window);
+
+// Add a sample.  Writer side, only one thread may call this.
+void pressure_cache_push(float pressure_hPa, float temperature_degC, uint32_t timestamp, const PressureTrend* trend);
+
+// Copy the latest snapshot.  Returns false if no sample has been pushed yet.
+bool pressure_cache_get(PressureSnapshot* snapshot);
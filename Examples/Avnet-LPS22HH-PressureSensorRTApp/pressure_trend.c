@@ -0,0 +1,135 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include <math.h>
+#include "pressure_trend.h"
+
+// International standard atmosphere, valid in the troposphere
+#define ISA_ALTITUDE_SCALE_M 44330.0f
+#define ISA_EXPONENT 0.190295f
+
+// The vertical speed filter is slower than the pressure filter, differentiating amplifies the noise
+#define VERTICAL_SPEED_FILTER_RATIO 2.0f
+
+// Intervals in the tendency ring, one more than the span so both ends of the 3 hours are kept
+#define TENDENCY_SLOTS ((PRESSURE_TREND_SPAN_MINUTES * 60UL * 1000UL) / PRESSURE_TREND_INTERVAL_MS + 1)
+
+static float seaLevelPressure = PRESSURE_TREND_STANDARD_SEA_LEVEL_HPA;
+static float filterSeconds = PRESSURE_TREND_DEFAULT_FILTER_SECONDS;
+
+// Filter state
+static bool filterPrimed = false;
+static uint32_t lastTimeMs;
+static float filteredPressure;
+static float lastAltitude;
+static float verticalSpeed;
+
+// Tendency state, the average of the current interval is accumulated until the interval ends
+static float tendencyRing[TENDENCY_SLOTS];
+static uint16_t tendencyNext = 0;
+static uint16_t tendencyFill = 0;
+static bool intervalStarted = false;
+static uint32_t intervalStartMs;
+static double intervalSum;
+static uint32_t intervalCount;
+
+void pressure_trend_configure(float seaLevel_hPa, float seconds)
+{
+    if (seaLevel_hPa > 0.0f) {
+        seaLevelPressure = seaLevel_hPa;
+    }
+    if (seconds > 0.0f) {
+        filterSeconds = seconds;
+    }
+
+    filterPrimed = false;
+}
+
+float pressure_trend_get_sea_level(void)
+{
+    return seaLevelPressure;
+}
+
+float pressure_trend_get_filter_seconds(void)
+{
+    return filterSeconds;
+}
+
+static float altitude_from_pressure(float pressure_hPa)
+{
+    return ISA_ALTITUDE_SCALE_M * (1.0f - powf(pressure_hPa / seaLevelPressure, ISA_EXPONENT));
+}
+
+static void update_tendency(uint32_t timeMs, PressureTrend* trend)
+{
+    if (!intervalStarted) {
+        intervalStarted = true;
+        intervalStartMs = timeMs;
+        intervalSum = 0.0;
+        intervalCount = 0;
+    }
+
+    intervalSum += filteredPressure;
+    intervalCount++;
+
+    // Close the interval, the unsigned difference handles the millisecond count wrapping
+    if ((timeMs - intervalStartMs) >= PRESSURE_TREND_INTERVAL_MS) {
+
+        tendencyRing[tendencyNext] = (float)(intervalSum / intervalCount);
+        tendencyNext = (tendencyNext + 1) % TENDENCY_SLOTS;
+        if (tendencyFill < TENDENCY_SLOTS) {
+            tendencyFill++;
+        }
+
+        intervalStartMs += PRESSURE_TREND_INTERVAL_MS;
+        intervalSum = 0.0;
+        intervalCount = 0;
+    }
+
+    // Newest completed interval minus the oldest one still in the ring
+    if (tendencyFill >= 2) {
+        uint16_t newest = (tendencyNext + TENDENCY_SLOTS - 1) % TENDENCY_SLOTS;
+        uint16_t oldest = (tendencyNext + TENDENCY_SLOTS - tendencyFill) % TENDENCY_SLOTS;
+
+        trend->tendency_hPa = tendencyRing[newest] - tendencyRing[oldest];
+        trend->tendencySpanMinutes = (uint16_t)((tendencyFill - 1) * (PRESSURE_TREND_INTERVAL_MS / 60000UL));
+    }
+    else {
+        trend->tendency_hPa = 0.0f;
+        trend->tendencySpanMinutes = 0;
+    }
+}
+
+void pressure_trend_push(float pressure_hPa, uint32_t timeMs, PressureTrend* trend)
+{
+    if (!filterPrimed) {
+
+        filterPrimed = true;
+        filteredPressure = pressure_hPa;
+        lastAltitude = altitude_from_pressure(pressure_hPa);
+        verticalSpeed = 0.0f;
+    }
+    else {
+
+        float dt = (timeMs - lastTimeMs) / 1000.0f;
+
+        if (dt > 0.0f) {
+
+            // First order low pass, alpha = dt / (tau + dt) keeps the time constant independent of the ODR
+            filteredPressure += (dt / (filterSeconds + dt)) * (pressure_hPa - filteredPressure);
+
+            float altitude = altitude_from_pressure(filteredPressure);
+            float speedTau = filterSeconds * VERTICAL_SPEED_FILTER_RATIO;
+
+            verticalSpeed += (dt / (speedTau + dt)) * ((altitude - lastAltitude) / dt - verticalSpeed);
+            lastAltitude = altitude;
+        }
+    }
+    lastTimeMs = timeMs;
+
+    trend->filteredPressure_hPa = filteredPressure;
+    trend->altitude_m = lastAltitude;
+    trend->verticalSpeed_mps = verticalSpeed;
+
+    update_tendency(timeMs, trend);
+}
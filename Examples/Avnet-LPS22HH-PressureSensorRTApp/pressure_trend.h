@@ -0,0 +1,36 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Measurements derived from the pressure samples on the M4: barometric altitude, vertical speed and
+// the 3 hour pressure tendency.  Every sample goes through a first order IIR low pass filter before
+// the altitude is computed, the vertical speed is the filtered derivative of the altitude.  For the
+// tendency the filtered pressure is averaged over 5 minute intervals and kept in a small ring that
+// covers 3 hours, statically allocated in TCM with the rest of .bss.
+
+#define PRESSURE_TREND_STANDARD_SEA_LEVEL_HPA 1013.25f
+#define PRESSURE_TREND_DEFAULT_FILTER_SECONDS 1.0f
+#define PRESSURE_TREND_INTERVAL_MS (5UL * 60UL * 1000UL)
+#define PRESSURE_TREND_SPAN_MINUTES 180
+
+typedef struct
+{
+    float filteredPressure_hPa;
+    float altitude_m;           // Above the sea level reference
+    float verticalSpeed_mps;    // Positive when climbing
+    float tendency_hPa;         // Pressure change over tendencySpanMinutes, positive when rising
+    uint16_t tendencySpanMinutes; // 180 once 3 hours of data are available, less before that
+} PressureTrend;
+
+// Set the sea level reference pressure and the filter time constant, zero keeps a setting.  The
+// filters restart with the next sample, the tendency history is kept.
+void pressure_trend_configure(float seaLevel_hPa, float filterSeconds);
+float pressure_trend_get_sea_level(void);
+float pressure_trend_get_filter_seconds(void);
+
+// Add a sample taken at timeMs (a free running millisecond count) and update trend
+void pressure_trend_push(float pressure_hPa, uint32_t timeMs, PressureTrend* trend);
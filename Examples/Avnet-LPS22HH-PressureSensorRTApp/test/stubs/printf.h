@@ -0,0 +1,8 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// The application prints on the debug UART, the host tests print on stdout
+
+#include <stdio.h>
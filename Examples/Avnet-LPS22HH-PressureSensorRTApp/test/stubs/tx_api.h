@@ -0,0 +1,51 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Just enough of the ThreadX API for the host tests to build the IMU driver and the I2C bus manager,
+// tx_thread_sleep() and the mutex, queue and thread calls are provided by the test.
+
+#include <stdint.h>
+
+typedef unsigned long ULONG;
+typedef unsigned int UINT;
+typedef unsigned char UCHAR;
+typedef char CHAR;
+typedef void VOID;
+
+#define TX_TIMER_TICKS_PER_SECOND 100
+
+#define TX_SUCCESS          0x00
+#define TX_INHERIT          1
+#define TX_WAIT_FOREVER     ((ULONG)0xFFFFFFFFUL)
+#define TX_NO_WAIT          ((ULONG)0)
+#define TX_1_ULONG          ((UINT)1)
+#define TX_NO_TIME_SLICE    ((ULONG)0)
+#define TX_AUTO_START       ((UINT)1)
+
+typedef struct
+{
+    int owned;                      // Nesting count, ThreadX mutexes can be got again by their owner
+} TX_MUTEX;
+
+typedef struct
+{
+    int unused;
+} TX_QUEUE;
+
+typedef struct
+{
+    int unused;
+} TX_THREAD;
+
+void tx_thread_sleep(ULONG ticks);
+UINT tx_mutex_create(TX_MUTEX* mutex_ptr, CHAR* name_ptr, UINT inherit);
+UINT tx_mutex_get(TX_MUTEX* mutex_ptr, ULONG wait_option);
+UINT tx_mutex_put(TX_MUTEX* mutex_ptr);
+UINT tx_queue_create(TX_QUEUE* queue_ptr, CHAR* name_ptr, UINT message_size, VOID* queue_start, ULONG queue_size);
+UINT tx_queue_send(TX_QUEUE* queue_ptr, VOID* source_ptr, ULONG wait_option);
+UINT tx_queue_receive(TX_QUEUE* queue_ptr, VOID* destination_ptr, ULONG wait_option);
+UINT tx_thread_create(TX_THREAD* thread_ptr, CHAR* name_ptr, VOID (*entry_function)(ULONG), ULONG entry_input,
+                      VOID* stack_start, ULONG stack_size, UINT priority, UINT preempt_threshold,
+                      ULONG time_slice, UINT auto_start);
@@ -0,0 +1,374 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for the continuous pressure read path of the IMU driver.  The driver is built against a simulated
+// I2C bus holding the LSM6DSO register banks; the simulated sensor hub copies the LPS22HH STATUS and output
+// registers into SENSOR_HUB_1..6 on every hub cycle and clears P_DA the way reading PRESS_OUT_H does on the part.
+// The driver's own source is included so the tests can start continuous mode without the sensor hub bring up.  The
+// driver goes through the I2C bus manager (../i2c_bus.c), every transfer has to be made with the bus locked.
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "../IMU_lib/imu_temp_pressure.c"
+
+// ---------------------------------------------------------------------------------------------------------------
+// Simulated bus
+
+typedef struct
+{
+    uint8_t user[256];
+    uint8_t sensorHub[256];
+    uint8_t lpsStatus;              // the LPS22HH registers the hub reads
+    uint8_t lpsOutput[5];           // PRESS_OUT_XL/L/H, TEMP_OUT_L/H
+    uint32_t transfers;             // I2C transactions the driver started
+    bool fail;                      // Every transfer NACKs
+    TX_MUTEX* mutex;                // The ISU2 mutex, the only one the driver uses
+} SimulatedBus;
+
+static SimulatedBus bus;
+
+// Transfers made without the bus locked, over all the tests
+static uint32_t unlockedTransfers;
+
+static uint8_t* bus_register(uint8_t reg)
+{
+    lsm6dso_func_cfg_access_t access;
+
+    // FUNC_CFG_ACCESS is mapped in every bank
+    memcpy(&access, &bus.user[LSM6DSO_FUNC_CFG_ACCESS], 1);
+    if (reg == LSM6DSO_FUNC_CFG_ACCESS || access.reg_access != LSM6DSO_SENSOR_HUB_BANK) {
+        return &bus.user[reg];
+    }
+    return &bus.sensorHub[reg];
+}
+
+int mtk_os_hal_i2c_ctrl_init(i2c_num bus_num)
+{
+    return 0;
+}
+
+int mtk_os_hal_i2c_speed_init(i2c_num bus_num, int speed)
+{
+    return 0;
+}
+
+// Counts the transfer, false if it NACKs
+static bool bus_transfer(void)
+{
+    bus.transfers++;
+    if ((bus.mutex == NULL) || (bus.mutex->owned == 0)) {
+        unlockedTransfers++;
+    }
+    return !bus.fail;
+}
+
+int mtk_os_hal_i2c_write(i2c_num bus_num, uint8_t device_addr, uint8_t* buffer, uint16_t len)
+{
+    if (!bus_transfer()) {
+        return -1;
+    }
+    for (uint16_t i = 1; i < len; i++) {
+        *bus_register((uint8_t)(buffer[0] + i - 1)) = buffer[i];
+    }
+    return 0;
+}
+
+int mtk_os_hal_i2c_write_read(i2c_num bus_num, uint8_t device_addr, uint8_t* wr_buf, uint8_t* rd_buf,
+                              uint16_t wr_len, uint16_t rd_len)
+{
+    if (!bus_transfer()) {
+        return -1;
+    }
+    for (uint16_t i = 0; i < rd_len; i++) {
+        rd_buf[i] = *bus_register((uint8_t)(wr_buf[0] + i));
+    }
+    return 0;
+}
+
+int mtk_os_hal_i2c_read(i2c_num bus_num, uint8_t device_addr, uint8_t* buffer, uint16_t len)
+{
+    return bus_transfer() ? 0 : -1;
+}
+
+void tx_thread_sleep(ULONG ticks)
+{
+}
+
+// One thread, the mutexes only count their nesting
+UINT tx_mutex_create(TX_MUTEX* mutex_ptr, CHAR* name_ptr, UINT inherit)
+{
+    mutex_ptr->owned = 0;
+    return TX_SUCCESS;
+}
+
+UINT tx_mutex_get(TX_MUTEX* mutex_ptr, ULONG wait_option)
+{
+    bus.mutex = mutex_ptr;
+    mutex_ptr->owned++;
+    return TX_SUCCESS;
+}
+
+UINT tx_mutex_put(TX_MUTEX* mutex_ptr)
+{
+    CHECK(mutex_ptr->owned > 0);
+    mutex_ptr->owned--;
+    return TX_SUCCESS;
+}
+
+UINT tx_queue_create(TX_QUEUE* queue_ptr, CHAR* name_ptr, UINT message_size, VOID* queue_start, ULONG queue_size)
+{
+    return TX_SUCCESS;
+}
+
+UINT tx_queue_send(TX_QUEUE* queue_ptr, VOID* source_ptr, ULONG wait_option)
+{
+    return TX_SUCCESS;
+}
+
+UINT tx_queue_receive(TX_QUEUE* queue_ptr, VOID* destination_ptr, ULONG wait_option)
+{
+    return TX_SUCCESS;
+}
+
+UINT tx_thread_create(TX_THREAD* thread_ptr, CHAR* name_ptr, VOID (*entry_function)(ULONG), ULONG entry_input,
+                      VOID* stack_start, ULONG stack_size, UINT priority, UINT preempt_threshold,
+                      ULONG time_slice, UINT auto_start)
+{
+    return TX_SUCCESS;
+}
+
+// The LPS22HH completes a conversion, the raw values are the driver's left aligned 24 bit pressure and
+// 16 bit temperature
+static void lps_convert(uint32_t rawPressure, int16_t rawTemperature)
+{
+    bus.lpsOutput[0] = (uint8_t)(rawPressure >> 8);
+    bus.lpsOutput[1] = (uint8_t)(rawPressure >> 16);
+    bus.lpsOutput[2] = (uint8_t)(rawPressure >> 24);
+    bus.lpsOutput[3] = (uint8_t)rawTemperature;
+    bus.lpsOutput[4] = (uint8_t)((uint16_t)rawTemperature >> 8);
+    bus.lpsStatus = 0x03;           // P_DA | T_DA
+}
+
+// One hub cycle: STATUS then the outputs, reading PRESS_OUT_H clears P_DA and TEMP_OUT_H T_DA
+static void hub_cycle(void)
+{
+    bus.sensorHub[LSM6DSO_SENSOR_HUB_1] = bus.lpsStatus;
+    memcpy(&bus.sensorHub[LSM6DSO_SENSOR_HUB_1 + 1], bus.lpsOutput, sizeof(bus.lpsOutput));
+    bus.lpsStatus = 0;
+}
+
+static void start_continuous(void)
+{
+    i2c_bus_stats_t stats;
+
+    memset(&bus, 0, sizeof(bus));
+    i2c_bus_device_init(&imuBus, "LSM6DSO", i2cHandle);
+    lp_imu_get_i2c_stats(&stats, true);
+    memset(continuousLastHub, 0, sizeof(continuousLastHub));
+    continuousPressure_hPa = NAN;
+    continuousTemperature_degC = NAN;
+
+    dev_ctx.write_reg = platform_write;
+    dev_ctx.read_reg = platform_read;
+    dev_ctx.handle = &i2cHandle;
+    initialized = true;
+    pressureContinuous = true;
+}
+
+// Raw LSB for a pressure in hPa, left aligned like lps22hh_pressure_raw_get()
+static uint32_t raw_pressure(double hPa)
+{
+    return (uint32_t)lround(hPa * 4096.0) << 8;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+
+// Nothing is returned while continuous mode is off or before the first conversion
+static void test_not_running(void)
+{
+    float pressure_hPa, temperature_degC;
+
+    start_continuous();
+    pressureContinuous = false;
+    CHECK(!lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    CHECK(bus.transfers == 0);
+
+    pressureContinuous = true;
+    hub_cycle();
+    CHECK(!lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    CHECK(isnan(lp_get_pressure()));
+}
+
+// Every conversion is returned exactly once, whichever hub copy the read finds it in
+static void test_each_conversion_once(void)
+{
+    float pressure_hPa, temperature_degC;
+
+    start_continuous();
+
+    // Read from the hub cycle that carries P_DA, then again from the same copy and the next copy
+    lps_convert(raw_pressure(1013.25), 2150);
+    hub_cycle();
+    CHECK(lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    CHECK_NEAR(pressure_hPa, 1013.25, 0.001);
+    CHECK_NEAR(temperature_degC, 21.50, 0.001);
+    CHECK(!lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    hub_cycle();
+    CHECK(!lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+
+    // The copy with P_DA set was overwritten before the read, the new output still counts
+    lps_convert(raw_pressure(1013.50), 2150);
+    hub_cycle();
+    hub_cycle();
+    CHECK(lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    CHECK_NEAR(pressure_hPa, 1013.50, 0.001);
+    CHECK(!lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+
+    // A conversion that repeats the last sample is flagged by P_DA alone
+    lps_convert(raw_pressure(1013.50), 2150);
+    hub_cycle();
+    CHECK(lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    CHECK(!lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    hub_cycle();
+    CHECK(!lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+
+    // A conversion that completed between the hub's STATUS and PRESS_OUT_H reads, P_DA never shows up
+    lps_convert(raw_pressure(1012.75), 2140);
+    bus.lpsStatus = 0;
+    hub_cycle();
+    CHECK(lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    CHECK_NEAR(pressure_hPa, 1012.75, 0.001);
+    CHECK_NEAR(temperature_degC, 21.40, 0.001);
+}
+
+// The getters hand out the latest sample without a bus transaction, only the pressure read thread uses the bus
+static void test_getters_cache_only(void)
+{
+    float pressure_hPa, temperature_degC;
+
+    start_continuous();
+    lps_convert(raw_pressure(998.0), -512);
+    hub_cycle();
+    CHECK(lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+
+    uint32_t transfers = bus.transfers;
+    CHECK_NEAR(lp_get_pressure(), 998.0, 0.001);
+    CHECK_NEAR(lp_get_temperature_lps22h(), -5.12, 0.001);
+    CHECK(bus.transfers == transfers);
+
+    // A new conversion the read thread hasn't picked up yet isn't reported
+    lps_convert(raw_pressure(999.0), -500);
+    hub_cycle();
+    CHECK_NEAR(lp_get_pressure(), 998.0, 0.001);
+    CHECK(bus.transfers == transfers);
+}
+
+// A minute of the real timing: the LPS22HH converts at 10Hz from its own oscillator, 1.3% fast, the hub cycles
+// at 26Hz and the pressure read thread polls every 50ms on the 1ms tick with up to 4ms of scheduling delay, as
+// pressure_read_thread_entry() does.  Every conversion comes out once, in order, stamped at most one hub cycle
+// plus one poll after it completed.
+static void test_timing(void)
+{
+    const double conversionPeriod = 0.1 / 1.013;
+    const double hubPeriod = 1.0 / 26.0;
+    double nextConversion = conversionPeriod * 0.37;
+    double nextHub = hubPeriod * 0.81;
+    double conversionTime[700];
+    uint32_t conversions = 0;
+    uint32_t returned = 0;
+    uint32_t outOfOrder = 0;
+    double maxLag = 0.0;
+
+    start_continuous();
+    srand(11);
+
+    for (double now = 0.0; now < 60.0; now += 0.050 + 0.004 * rand() / RAND_MAX) {
+
+        float pressure_hPa, temperature_degC;
+
+        // Run the sensors up to the poll, conversions and hub cycles in the order they happen
+        while (nextConversion <= now || nextHub <= now) {
+
+            if (nextConversion <= nextHub) {
+                conversionTime[conversions] = nextConversion;
+                conversions++;
+                // The conversion number goes out in the pressure
+                lps_convert(raw_pressure(900.0 + 0.25 * conversions), 2000);
+                nextConversion += conversionPeriod;
+            }
+            else {
+                hub_cycle();
+                nextHub += hubPeriod;
+            }
+        }
+
+        if (lp_pressure_continuous_read(&pressure_hPa, &temperature_degC)) {
+
+            uint32_t conversion = (uint32_t)lround((pressure_hPa - 900.0) / 0.25);
+
+            returned++;
+            if (conversion != returned) {
+                outOfOrder++;
+            }
+            else {
+                maxLag = fmax(maxLag, now - conversionTime[conversion - 1]);
+            }
+        }
+    }
+
+    printf("%u conversions, %u returned, %u out of order or repeated, max lag %.1f ms\n", conversions, returned,
+           outOfOrder, maxLag * 1000.0);
+
+    // The last conversion may still be on its way through the hub
+    CHECK(returned + 1 >= conversions);
+    CHECK(returned <= conversions);
+    CHECK(outOfOrder == 0);
+    CHECK(maxLag < hubPeriod + 0.054);
+}
+
+// Every read holds the bus once for all its transfers, a NACK counts as an error and the conversion is picked up
+// by the next read
+static void test_bus_accounting(void)
+{
+    float pressure_hPa, temperature_degC;
+    i2c_bus_stats_t stats;
+
+    start_continuous();
+    lps_convert(raw_pressure(1005.0), 2000);
+    hub_cycle();
+    CHECK(lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    CHECK(!lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+
+    lp_imu_get_i2c_stats(&stats, true);
+    CHECK(stats.transactions == 2);
+    CHECK(stats.errors == 0);
+    CHECK(bus.transfers >= stats.transactions);
+
+    lps_convert(raw_pressure(1004.0), 1990);
+    hub_cycle();
+    bus.fail = true;
+    CHECK(!lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    bus.fail = false;
+
+    lp_imu_get_i2c_stats(&stats, true);
+    CHECK(stats.transactions == 1);
+    CHECK(stats.errors == 1);
+
+    CHECK(lp_pressure_continuous_read(&pressure_hPa, &temperature_degC));
+    CHECK_NEAR(pressure_hPa, 1004.0, 0.001);
+}
+
+int main(void)
+{
+    CHECK(i2c_bus_init() == TX_SUCCESS);
+
+    test_not_running();
+    test_each_conversion_once();
+    test_getters_cache_only();
+    test_timing();
+    test_bus_accounting();
+
+    CHECK(unlockedTransfers == 0);
+
+    return host_test_result("pressure_freshness");
+}
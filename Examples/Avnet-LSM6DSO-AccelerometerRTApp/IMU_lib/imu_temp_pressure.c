@@ -1,4 +1,5 @@
 #include "imu_temp_pressure.h"
+#include "cycle_counter.h"
 
 /*
  ******************************************************************************
@@ -61,12 +62,26 @@ Acknowledgment: Built from ST Micro samples
 
 */
 
-// 1 tick = 10ms. It is configurable.
-#define MS_TO_TICK(ms)  ((ms) * (TX_TIMER_TICKS_PER_SECOND) / 1000)
+// 1 tick = 1ms.  SysTick runs at 1kHz (tx_initialize_low_level.S), TX_TIMER_TICKS_PER_SECOND is still
+// the ThreadX default of 100 and can't be used to convert.
+#define IMU_TICKS_PER_SECOND 1000
+#define MS_TO_TICK(ms)  ((ms) * (IMU_TICKS_PER_SECOND) / 1000)
 
-#define I2C_MAX_LEN 64
-static uint8_t i2c_tx_buf[I2C_MAX_LEN];
-static uint8_t i2c_rx_buf[I2C_MAX_LEN];
+// With OSAI_ENABLE_DMA the I2C driver moves transfers longer than its 8 byte FIFO with DMA.  The DMA
+// engine can't reach TCM, so the transfer buffers live in SYSRAM.  Reads into a caller buffer that
+// is already in SYSRAM (the FIFO bursts) skip the bounce through i2c_rx_buf.
+#define I2C_MAX_LEN 256
+static uint8_t i2c_tx_buf[I2C_MAX_LEN + 1] __attribute__((section(".sysram")));
+static uint8_t i2c_rx_buf[I2C_MAX_LEN] __attribute__((section(".sysram")));
+
+#define SYSRAM_START 0x22000000UL
+#define SYSRAM_END   0x22010000UL
+#define IN_SYSRAM(buf, len) (((uintptr_t)(buf) >= SYSRAM_START) && ((uintptr_t)(buf) + (len) <= SYSRAM_END))
+
+#ifdef IMU_I2C_STATS
+// Transfer timing, see lp_imu_get_i2c_stats()
+static LpImuI2cStats i2cStats;
+#endif
 
 static uint8_t i2cHandle = OS_HAL_I2C_ISU2;
 
@@ -100,6 +115,21 @@ static AngularRateDegreesPerSecond angularRateDps;
 static AngularRateDegreesPerSecond angularRateDps;
 static uint8_t whoamI, rst;
 
+// Accelerometer ODR used when the FIFO is not streaming.  UCF programs can raise it (tap detection
+// needs at least 417Hz), lp_imu_load_ucf() records the rate the program left behind.
+static lsm6dso_odr_xl_t idle_xl_odr = LSM6DSO_XL_ODR_12Hz5;
+
+// Activity mode (INACT_EN) a UCF program set up, saved while samples stream.  With it the sensor drops the
+// accelerometer to 12.5Hz (and idles the gyroscope) once the device is still, the FIFO and fusion streams
+// assume the rate they asked for, so it is switched off from lp_imu_fifo_start()/lp_imu_motion_start() until
+// the stream stops.
+static lsm6dso_inact_en_t stream_inactivity;
+static bool stream_inactivity_saved = false;
+
+// Set by lp_imu_load_ucf() when the programs enabled any FSM, lp_imu_get_events() only reads the FSM
+// status registers then
+static bool fsm_programs_enabled = false;
+
 //static uint8_t tx_buffer[1000];
 
 // static int i2cHandle = -1;
@@ -174,10 +204,39 @@ static int32_t platform_read(void* handle, uint8_t reg, uint8_t* bufp, uint16_t
 	if (len > (I2C_MAX_LEN))
 		return -1;
 
-	mtk_os_hal_i2c_write_read(*(int*)handle, LSM6DSO_ADDRESS,
-		&reg, i2c_rx_buf, 1, len);
+#ifdef IMU_I2C_STATS
+	uint32_t start = cycle_counter_get();
+#endif
+
+	// The register address goes out of SYSRAM as well
+	i2c_tx_buf[0] = reg;
+
+	if (IN_SYSRAM(bufp, len)) {
+		mtk_os_hal_i2c_write_read(*(int*)handle, LSM6DSO_ADDRESS,
+			i2c_tx_buf, bufp, 1, len);
+#ifdef IMU_I2C_STATS
+		i2cStats.directReads++;
+#endif
+	}
+	else {
+		mtk_os_hal_i2c_write_read(*(int*)handle, LSM6DSO_ADDRESS,
+			i2c_tx_buf, i2c_rx_buf, 1, len);
+
+#ifdef IMU_I2C_STATS
+		uint32_t copyStart = cycle_counter_get();
+		memcpy(bufp, i2c_rx_buf, len);
+		i2cStats.copyCycles += cycle_counter_get() - copyStart;
+		i2cStats.copiedBytes += len;
+#else
+		memcpy(bufp, i2c_rx_buf, len);
+#endif
+	}
 
-	memcpy(bufp, i2c_rx_buf, len);
+#ifdef IMU_I2C_STATS
+	i2cStats.reads++;
+	i2cStats.readBytes += len;
+	i2cStats.readCycles += cycle_counter_get() - start;
+#endif
 
 	return 0;
 }
@@ -298,6 +357,746 @@ bool lp_get_acceleration(AccelerationMilligForce* accelerationMilligForce)
 	return false;
 }
 
+// Each FIFO word is a tag byte followed by 6 data bytes.  With IF_INC set the register address
+// rolls back from FIFO_DATA_OUT_Z_H to FIFO_DATA_OUT_TAG, so several words can be read in a
+// single burst as long as the burst fits in the I2C buffer.  The burst buffer is in SYSRAM so the
+// DMA writes the words straight into it.
+#define FIFO_WORD_LEN 7
+#define FIFO_WORDS_PER_BURST (I2C_MAX_LEN / FIFO_WORD_LEN)
+static uint8_t fifo_burst[FIFO_WORDS_PER_BURST * FIFO_WORD_LEN] __attribute__((section(".sysram")));
+
+// Switch the activity mode off for a stream, a restart keeps the mode saved by the first start
+static void stream_activity_mode_off(void)
+{
+	if (!stream_inactivity_saved && (lsm6dso_act_mode_get(&dev_ctx, &stream_inactivity) == 0))
+	{
+		stream_inactivity_saved = true;
+	}
+	lsm6dso_act_mode_set(&dev_ctx, LSM6DSO_XL_AND_GY_NOT_AFFECTED);
+}
+
+static void stream_activity_mode_restore(void)
+{
+	if (stream_inactivity_saved)
+	{
+		lsm6dso_act_mode_set(&dev_ctx, stream_inactivity);
+		stream_inactivity_saved = false;
+	}
+}
+
+// Map a requested sample rate onto the closest LSM6DSO ODR/BDR setting.  The XL ODR and the
+// FIFO XL batch rate enums share the same encoding for 12.5Hz through 6667Hz.
+static const uint32_t fifo_odr_hz[] = {0, 12, 26, 52, 104, 208, 417, 833, 1667, 3333, 6667};
+
+uint32_t lp_imu_fifo_start(uint32_t sampleRateHz, uint16_t watermark)
+{
+	uint8_t odr = LSM6DSO_XL_ODR_12Hz5;
+
+	if (!initialized)
+	{
+		return 0;
+	}
+
+	// Pick the slowest ODR that is at least the requested rate
+	while ((odr < LSM6DSO_XL_ODR_6667Hz) && (fifo_odr_hz[odr] < sampleRateHz))
+	{
+		odr++;
+	}
+
+	// Flush anything left over from a previous run, then stream accelerometer samples only at a fixed rate
+	stream_activity_mode_off();
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_BYPASS_MODE);
+	lsm6dso_fifo_watermark_set(&dev_ctx, watermark);
+	lsm6dso_fifo_gy_batch_set(&dev_ctx, LSM6DSO_GY_NOT_BATCHED);
+	lsm6dso_fifo_xl_batch_set(&dev_ctx, (lsm6dso_bdr_xl_t)odr);
+	lsm6dso_xl_data_rate_set(&dev_ctx, (lsm6dso_odr_xl_t)odr);
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_STREAM_MODE);
+
+	return fifo_odr_hz[odr];
+}
+
+void lp_imu_fifo_stop(void)
+{
+	if (!initialized)
+	{
+		return;
+	}
+
+	// Back to the single sample polling configuration used by lp_get_acceleration()
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_BYPASS_MODE);
+	lsm6dso_fifo_xl_batch_set(&dev_ctx, LSM6DSO_XL_NOT_BATCHED);
+	lsm6dso_xl_data_rate_set(&dev_ctx, idle_xl_odr);
+	stream_activity_mode_restore();
+}
+
+uint16_t lp_imu_fifo_read_acceleration(AccelerationRaw* samples, uint16_t maxSamples)
+{
+	lsm6dso_fifo_data_out_tag_t* tag;
+	uint16_t level = 0;
+	uint16_t count = 0;
+
+	if (!initialized || (samples == NULL))
+	{
+		return 0;
+	}
+
+	lsm6dso_fifo_data_level_get(&dev_ctx, &level);
+
+	while ((level > 0) && (count < maxSamples))
+	{
+		uint16_t words = (level < FIFO_WORDS_PER_BURST) ? level : FIFO_WORDS_PER_BURST;
+
+		// Don't pull more words out of the FIFO than there is room for, they would be lost
+		if (words > maxSamples - count)
+		{
+			words = maxSamples - count;
+		}
+
+#ifdef IMU_I2C_STATS
+		uint32_t start = cycle_counter_get();
+#endif
+
+		if (platform_read(dev_ctx.handle, LSM6DSO_FIFO_DATA_OUT_TAG, fifo_burst, words * FIFO_WORD_LEN) != 0)
+		{
+			break;
+		}
+		level -= words;
+
+#ifdef IMU_I2C_STATS
+		i2cStats.fifoBursts++;
+		i2cStats.fifoBytes += words * FIFO_WORD_LEN;
+		i2cStats.fifoCycles += cycle_counter_get() - start;
+#endif
+
+		for (uint16_t i = 0; (i < words) && (count < maxSamples); i++)
+		{
+			uint8_t* word = &fifo_burst[i * FIFO_WORD_LEN];
+			tag = (lsm6dso_fifo_data_out_tag_t*)word;
+
+			// Only accelerometer words are batched, but skip anything else (config change, etc.)
+			if (tag->tag_sensor != LSM6DSO_XL_NC_TAG)
+			{
+				continue;
+			}
+
+			samples[count].x = (int16_t)((uint16_t)word[2] << 8 | word[1]);
+			samples[count].y = (int16_t)((uint16_t)word[4] << 8 | word[3]);
+			samples[count].z = (int16_t)((uint16_t)word[6] << 8 | word[5]);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+#ifdef IMU_I2C_STATS
+void lp_imu_get_i2c_stats(LpImuI2cStats* stats, bool reset)
+{
+	*stats = i2cStats;
+
+	if (reset)
+	{
+		memset(&i2cStats, 0, sizeof(i2cStats));
+	}
+}
+#endif
+
+// Apply a UCF register program.  Programs switch register banks themselves (FUNC_CFG_ACCESS), the
+// user bank is selected again when the program ends so a truncated program can't leave the
+// embedded functions bank open.
+bool lp_imu_load_ucf(const ucf_line_t* program, uint32_t lines)
+{
+	lsm6dso_emb_fsm_enable_t fsm;
+	uint8_t fsmEnable[2];
+	bool status = true;
+
+	if (!initialized || (program == NULL))
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < lines; i++)
+	{
+		uint8_t data = program[i].data;
+
+		if (platform_write(dev_ctx.handle, program[i].address, &data, 1) != 0)
+		{
+			status = false;
+			break;
+		}
+	}
+
+	lsm6dso_mem_bank_set(&dev_ctx, LSM6DSO_USER_BANK);
+	lsm6dso_xl_data_rate_get(&dev_ctx, &idle_xl_odr);
+
+	if (lsm6dso_fsm_enable_get(&dev_ctx, &fsm) == 0)
+	{
+		memcpy(fsmEnable, &fsm, sizeof(fsmEnable));
+		fsm_programs_enabled = (fsmEnable[0] != 0) || (fsmEnable[1] != 0);
+	}
+
+	return status;
+}
+
+// Route every event source the loaded programs enabled to INT1.  Interrupts are latched and active
+// high, INT1 stays high until lp_imu_get_events() reads the sources.  Detectors that are not
+// configured are left off INT1, an unconfigured wake-up threshold of zero would fire continuously.
+bool lp_imu_route_events_int1(void)
+{
+	lsm6dso_pin_int1_route_t route;
+	lsm6dso_emb_fsm_enable_t fsm;
+	lsm6dso_int_mode_t mode;
+	lsm6dso_inact_en_t inactivity;
+	lsm6dso_single_double_tap_t tapMode;
+	uint8_t wakeThreshold;
+	uint8_t freeFallDuration;
+	uint8_t tapX, tapY, tapZ;
+
+	if (!initialized)
+	{
+		return false;
+	}
+
+	memset(&route, 0x00, sizeof(route));
+
+	lsm6dso_wkup_threshold_get(&dev_ctx, &wakeThreshold);
+	lsm6dso_ff_dur_get(&dev_ctx, &freeFallDuration);
+	lsm6dso_tap_detection_on_x_get(&dev_ctx, &tapX);
+	lsm6dso_tap_detection_on_y_get(&dev_ctx, &tapY);
+	lsm6dso_tap_detection_on_z_get(&dev_ctx, &tapZ);
+	lsm6dso_tap_mode_get(&dev_ctx, &tapMode);
+	lsm6dso_act_mode_get(&dev_ctx, &inactivity);
+	lsm6dso_fsm_enable_get(&dev_ctx, &fsm);
+
+	route.wake_up = (wakeThreshold != 0);
+	route.free_fall = (freeFallDuration != 0);
+	route.single_tap = (tapX | tapY | tapZ);
+	route.double_tap = route.single_tap && (tapMode == LSM6DSO_BOTH_SINGLE_DOUBLE);
+	route.sleep_change = (inactivity != LSM6DSO_XL_AND_GY_NOT_AFFECTED);
+
+	route.fsm1 = fsm.fsm_enable_a.fsm1_en;
+	route.fsm2 = fsm.fsm_enable_a.fsm2_en;
+	route.fsm3 = fsm.fsm_enable_a.fsm3_en;
+	route.fsm4 = fsm.fsm_enable_a.fsm4_en;
+	route.fsm5 = fsm.fsm_enable_a.fsm5_en;
+	route.fsm6 = fsm.fsm_enable_a.fsm6_en;
+	route.fsm7 = fsm.fsm_enable_a.fsm7_en;
+	route.fsm8 = fsm.fsm_enable_a.fsm8_en;
+	route.fsm9 = fsm.fsm_enable_b.fsm9_en;
+	route.fsm10 = fsm.fsm_enable_b.fsm10_en;
+	route.fsm11 = fsm.fsm_enable_b.fsm11_en;
+	route.fsm12 = fsm.fsm_enable_b.fsm12_en;
+	route.fsm13 = fsm.fsm_enable_b.fsm13_en;
+	route.fsm14 = fsm.fsm_enable_b.fsm14_en;
+	route.fsm15 = fsm.fsm_enable_b.fsm15_en;
+	route.fsm16 = fsm.fsm_enable_b.fsm16_en;
+
+	mode.active_low = PROPERTY_DISABLE;
+	mode.base_latched = PROPERTY_ENABLE;
+	mode.emb_latched = PROPERTY_ENABLE;
+
+	if (lsm6dso_interrupt_mode_set(&dev_ctx, mode) != 0)
+	{
+		return false;
+	}
+
+	return (lsm6dso_pin_int1_route_set(&dev_ctx, route) == 0);
+}
+
+// Read (and by reading, clear) the latched event sources.  This runs on every pass of the sensor thread
+// when INT1 is not connected, so only the registers that hold the events are read: WAKE_UP_SRC and
+// TAP_SRC in one two byte transfer, and the FSM status mirrors in the user bank when programs use the
+// FSM.  lsm6dso_all_sources_get() would read and write CTRL5_C and burst 12 registers each time.
+bool lp_imu_get_events(LpImuEvents* events)
+{
+	uint8_t src[2];
+	uint8_t fsmSrc[2] = {0, 0};
+	lsm6dso_wake_up_src_t* wakeUp = (lsm6dso_wake_up_src_t*)&src[0];
+	lsm6dso_tap_src_t* tap = (lsm6dso_tap_src_t*)&src[1];
+	lsm6dso_fsm_out_t fsmOutputs;
+
+	if (events == NULL)
+	{
+		return false;
+	}
+
+	memset(events, 0x00, sizeof(LpImuEvents));
+
+	if (!initialized || (lsm6dso_read_reg(&dev_ctx, LSM6DSO_WAKE_UP_SRC, src, sizeof(src)) != 0))
+	{
+		return false;
+	}
+
+	if (fsm_programs_enabled && (lsm6dso_read_reg(&dev_ctx, LSM6DSO_FSM_STATUS_A_MAINPAGE, fsmSrc, sizeof(fsmSrc)) != 0))
+	{
+		return false;
+	}
+
+	events->freeFall = wakeUp->ff_ia;
+	events->wakeUp = wakeUp->wu_ia;
+	events->singleTap = tap->single_tap;
+	events->doubleTap = tap->double_tap;
+	events->tapAxis = (tap->x_tap << 0) | (tap->y_tap << 1) | (tap->z_tap << 2);
+	events->tapNegative = tap->tap_sign;
+	events->activityChange = wakeUp->sleep_change_ia;
+	events->inactive = wakeUp->sleep_state;
+
+	// FSM_STATUS_A_MAINPAGE holds FSM1 - FSM8 in bits 0 - 7, FSM_STATUS_B_MAINPAGE FSM9 - FSM16
+	events->fsmStatus = (uint16_t)fsmSrc[0] | ((uint16_t)fsmSrc[1] << 8);
+
+	if (events->fsmStatus != 0)
+	{
+		lsm6dso_fsm_out_get(&dev_ctx, &fsmOutputs);
+		memcpy(events->fsmOutputs, &fsmOutputs, sizeof(events->fsmOutputs));
+	}
+
+	return events->freeFall || events->wakeUp || events->singleTap || events->doubleTap ||
+		events->activityChange || (events->fsmStatus != 0);
+}
+
+// Self test limits from the LSM6DSO datasheet
+#define SELF_TEST_XL_MIN_MG 50.0f
+#define SELF_TEST_XL_MAX_MG 1700.0f
+#define SELF_TEST_GY_MIN_DPS 150.0f
+#define SELF_TEST_GY_MAX_DPS 700.0f
+#define SELF_TEST_SAMPLES 5
+
+// Sensitivities for the self test and calibration full scales
+#define XL_FS4_MG_PER_LSB 0.122f
+#define XL_FS2_MG_PER_LSB 0.061f
+#define GY_FS2000_DPS_PER_LSB 0.070f
+
+// Wait for the next accelerometer or gyroscope sample and read it, give up after about 100ms
+static bool read_raw_sample(bool gyro, int16_t raw[3])
+{
+	axis3bit16_t data;
+	uint8_t ready = 0;
+
+	for (int retry = 0; (retry < 100) && !ready; retry++)
+	{
+		if (gyro)
+		{
+			lsm6dso_gy_flag_data_ready_get(&dev_ctx, &ready);
+		}
+		else
+		{
+			lsm6dso_xl_flag_data_ready_get(&dev_ctx, &ready);
+		}
+
+		if (!ready)
+		{
+			platform_delay(1);
+		}
+	}
+
+	if (!ready)
+	{
+		return false;
+	}
+
+	if (gyro)
+	{
+		lsm6dso_angular_rate_raw_get(&dev_ctx, data.u8bit);
+	}
+	else
+	{
+		lsm6dso_acceleration_raw_get(&dev_ctx, data.u8bit);
+	}
+
+	raw[0] = data.i16bit[0];
+	raw[1] = data.i16bit[1];
+	raw[2] = data.i16bit[2];
+
+	return true;
+}
+
+// Average a number of samples in LSB.  The first sample after a configuration change is discarded.
+static bool average_raw_samples(bool gyro, uint16_t samples, float average[3])
+{
+	int16_t raw[3];
+	int32_t sum[3] = {0, 0, 0};
+
+	if ((samples == 0) || !read_raw_sample(gyro, raw))
+	{
+		return false;
+	}
+
+	for (uint16_t i = 0; i < samples; i++)
+	{
+		if (!read_raw_sample(gyro, raw))
+		{
+			return false;
+		}
+
+		sum[0] += raw[0];
+		sum[1] += raw[1];
+		sum[2] += raw[2];
+	}
+
+	average[0] = (float)sum[0] / samples;
+	average[1] = (float)sum[1] / samples;
+	average[2] = (float)sum[2] / samples;
+
+	return true;
+}
+
+// Run the accelerometer and gyroscope self tests following the procedure in the LSM6DSO application
+// note.  The output data rates and full scales in CTRL1_XL/CTRL2_G are restored afterwards.  A UCF
+// program may have enabled INACT_EN, the sensor would then drop to 12.5Hz (and idle the gyroscope) as
+// soon as the stationary device is seen as inactive, so the activity mode is switched off for the test
+// and restored with the rest.  A sensor that stops delivering samples fails the test.
+bool lp_imu_self_test(LpImuSelfTest* result)
+{
+	uint8_t ctrl[2];
+	lsm6dso_inact_en_t inactivity;
+	float normal[3];
+	float selfTest[3];
+	bool status;
+
+	if (!initialized || (result == NULL))
+	{
+		return false;
+	}
+
+	memset(result, 0x00, sizeof(LpImuSelfTest));
+
+	// Save CTRL1_XL, CTRL2_G and the activity mode
+	if ((lsm6dso_read_reg(&dev_ctx, LSM6DSO_CTRL1_XL, ctrl, 2) != 0) ||
+		(lsm6dso_act_mode_get(&dev_ctx, &inactivity) != 0))
+	{
+		return false;
+	}
+
+	lsm6dso_act_mode_set(&dev_ctx, LSM6DSO_XL_AND_GY_NOT_AFFECTED);
+
+	// Accelerometer, 4g at 52Hz with the gyroscope off
+	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_OFF);
+	lsm6dso_xl_full_scale_set(&dev_ctx, LSM6DSO_4g);
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_52Hz);
+	platform_delay(100);
+	status = average_raw_samples(false, SELF_TEST_SAMPLES, normal);
+
+	lsm6dso_xl_self_test_set(&dev_ctx, LSM6DSO_XL_ST_POSITIVE);
+	platform_delay(100);
+	status = status && average_raw_samples(false, SELF_TEST_SAMPLES, selfTest);
+	lsm6dso_xl_self_test_set(&dev_ctx, LSM6DSO_XL_ST_DISABLE);
+
+	// The deltas are only meaningful when both averages were taken
+	result->accelPass = status;
+	for (int axis = 0; status && (axis < 3); axis++)
+	{
+		result->accelDeltaMg[axis] = fabsf(selfTest[axis] - normal[axis]) * XL_FS4_MG_PER_LSB;
+		if ((result->accelDeltaMg[axis] < SELF_TEST_XL_MIN_MG) || (result->accelDeltaMg[axis] > SELF_TEST_XL_MAX_MG))
+		{
+			result->accelPass = false;
+		}
+	}
+
+	// Gyroscope, 2000dps at 208Hz with the accelerometer off
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_OFF);
+	lsm6dso_gy_full_scale_set(&dev_ctx, LSM6DSO_2000dps);
+	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_208Hz);
+	platform_delay(100);
+	status = average_raw_samples(true, SELF_TEST_SAMPLES, normal);
+
+	lsm6dso_gy_self_test_set(&dev_ctx, LSM6DSO_GY_ST_POSITIVE);
+	platform_delay(100);
+	status = status && average_raw_samples(true, SELF_TEST_SAMPLES, selfTest);
+	lsm6dso_gy_self_test_set(&dev_ctx, LSM6DSO_GY_ST_DISABLE);
+
+	result->gyroPass = status;
+	for (int axis = 0; status && (axis < 3); axis++)
+	{
+		result->gyroDeltaDps[axis] = fabsf(selfTest[axis] - normal[axis]) * GY_FS2000_DPS_PER_LSB;
+		if ((result->gyroDeltaDps[axis] < SELF_TEST_GY_MIN_DPS) || (result->gyroDeltaDps[axis] > SELF_TEST_GY_MAX_DPS))
+		{
+			result->gyroPass = false;
+		}
+	}
+
+	// Restore the previous configuration and let the filters settle
+	lsm6dso_write_reg(&dev_ctx, LSM6DSO_CTRL1_XL, ctrl, 2);
+	lsm6dso_act_mode_set(&dev_ctx, inactivity);
+	platform_delay(100);
+
+	return true;
+}
+
+// Measure the accelerometer offsets and gyroscope bias.  The device must be stationary with one axis
+// vertical; the axis reading closest to +/-1g is taken as the gravity axis.  The result is applied
+// to the sensor before returning.
+bool lp_imu_calibrate(LpImuCalibration* calibration, uint16_t samples)
+{
+	uint8_t ctrl[2];
+	lsm6dso_inact_en_t inactivity;
+	float accel[3];
+	float gyro[3];
+	float offsetMg[3];
+	float maxOffsetMg = 0.0f;
+	int gravityAxis = 0;
+	bool status;
+
+	if (!initialized || (calibration == NULL) || (samples == 0))
+	{
+		return false;
+	}
+
+	if ((lsm6dso_read_reg(&dev_ctx, LSM6DSO_CTRL1_XL, ctrl, 2) != 0) ||
+		(lsm6dso_act_mode_get(&dev_ctx, &inactivity) != 0))
+	{
+		return false;
+	}
+
+	// Measure without the current corrections, at 104Hz for both sensors.  The activity mode is off like
+	// in lp_imu_self_test(), the device is expected to be stationary.
+	lsm6dso_xl_usr_offset_set(&dev_ctx, PROPERTY_DISABLE);
+	lsm6dso_act_mode_set(&dev_ctx, LSM6DSO_XL_AND_GY_NOT_AFFECTED);
+
+	lsm6dso_xl_full_scale_set(&dev_ctx, LSM6DSO_2g);
+	lsm6dso_xl_data_rate_set(&dev_ctx, LSM6DSO_XL_ODR_104Hz);
+	lsm6dso_gy_full_scale_set(&dev_ctx, LSM6DSO_2000dps);
+	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_104Hz);
+	platform_delay(100);
+
+	status = average_raw_samples(false, samples, accel) && average_raw_samples(true, samples, gyro);
+
+	lsm6dso_write_reg(&dev_ctx, LSM6DSO_CTRL1_XL, ctrl, 2);
+	lsm6dso_act_mode_set(&dev_ctx, inactivity);
+
+	if (!status)
+	{
+		// Put the previous correction back
+		lsm6dso_xl_usr_offset_set(&dev_ctx, PROPERTY_ENABLE);
+		return false;
+	}
+
+	for (int axis = 1; axis < 3; axis++)
+	{
+		if (fabsf(accel[axis]) > fabsf(accel[gravityAxis]))
+		{
+			gravityAxis = axis;
+		}
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		offsetMg[axis] = accel[axis] * XL_FS2_MG_PER_LSB;
+		if (axis == gravityAxis)
+		{
+			offsetMg[axis] -= (accel[axis] > 0.0f) ? 1000.0f : -1000.0f;
+		}
+
+		if (fabsf(offsetMg[axis]) > maxOffsetMg)
+		{
+			maxOffsetMg = fabsf(offsetMg[axis]);
+		}
+
+		calibration->gyroBias[axis] = (int16_t)lroundf(gyro[axis]);
+	}
+
+	// Use the fine 2^-10 g/LSB weight unless an offset is out of its +/-124mg range
+	calibration->accelOffsetHighWeight = (maxOffsetMg > 127.0f * 1000.0f / 1024.0f);
+	float mgPerLsb = calibration->accelOffsetHighWeight ? (1000.0f / 64.0f) : (1000.0f / 1024.0f);
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		long value = lroundf(offsetMg[axis] / mgPerLsb);
+		calibration->accelOffset[axis] = (int8_t)((value > 127) ? 127 : ((value < -127) ? -127 : value));
+	}
+
+	return lp_imu_apply_calibration(calibration);
+}
+
+bool lp_imu_apply_calibration(const LpImuCalibration* calibration)
+{
+	uint8_t offset;
+
+	if (!initialized || (calibration == NULL))
+	{
+		return false;
+	}
+
+	raw_angular_rate_calibration.i16bit[0] = calibration->gyroBias[0];
+	raw_angular_rate_calibration.i16bit[1] = calibration->gyroBias[1];
+	raw_angular_rate_calibration.i16bit[2] = calibration->gyroBias[2];
+
+	// The sensor subtracts the offsets from the output registers and the FIFO data
+	if (lsm6dso_xl_offset_weight_set(&dev_ctx, calibration->accelOffsetHighWeight ? LSM6DSO_LSb_16mg : LSM6DSO_LSb_1mg) != 0)
+	{
+		return false;
+	}
+
+	offset = (uint8_t)calibration->accelOffset[0];
+	lsm6dso_xl_usr_offset_x_set(&dev_ctx, &offset);
+	offset = (uint8_t)calibration->accelOffset[1];
+	lsm6dso_xl_usr_offset_y_set(&dev_ctx, &offset);
+	offset = (uint8_t)calibration->accelOffset[2];
+	lsm6dso_xl_usr_offset_z_set(&dev_ctx, &offset);
+
+	return (lsm6dso_xl_usr_offset_set(&dev_ctx, PROPERTY_ENABLE) == 0);
+}
+
+// The LSM6DSO output data rates run off an internal oscillator, nominally 6667Hz / ODR_Coeff.
+// INTERNAL_FREQ_FINE holds the deviation of this part in 0.15% steps, lp_imu_motion_start() reads it
+// so the orientation filter integrates over the real sample period.
+#define MOTION_ODR_BASE_HZ 6667.0f
+#define MOTION_FREQ_FINE_STEP 0.0015f
+
+static float motion_sample_period = 0.0f;
+
+// lp_imu_read_motion() pairs the gyroscope and accelerometer words as they come out of the FIFO, a
+// pair can be split across two reads
+static int16_t motion_gyro[3];
+static int16_t motion_accel[3];
+static bool motion_gyro_pending;
+static bool motion_accel_pending;
+
+// Run the accelerometer and gyroscope together at the slowest ODR that is at least the requested
+// rate and batch both in the FIFO, for callers that need every sample pair (orientation fusion).
+// The FIFO keeps the pairs in step with the sensor's own clock however late the thread reads them.
+// The XL and GY ODR and batch rate enums share the fifo_odr_hz[] encoding.  Returns the nominal
+// output data rate.
+uint32_t lp_imu_motion_start(uint32_t sampleRateHz)
+{
+	uint8_t odr = LSM6DSO_XL_ODR_12Hz5;
+	uint8_t freqFine = 0;
+
+	if (!initialized)
+	{
+		return 0;
+	}
+
+	while ((odr < LSM6DSO_XL_ODR_6667Hz) && (fifo_odr_hz[odr] < sampleRateHz))
+	{
+		odr++;
+	}
+
+	// ODR_Coeff is 1 at 6667Hz and doubles with every lower rate
+	lsm6dso_odr_cal_reg_get(&dev_ctx, &freqFine);
+	motion_sample_period = (float)(1U << (LSM6DSO_XL_ODR_6667Hz - odr)) /
+		(MOTION_ODR_BASE_HZ * (1.0f + MOTION_FREQ_FINE_STEP * (int8_t)freqFine));
+	motion_gyro_pending = false;
+	motion_accel_pending = false;
+
+	stream_activity_mode_off();
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_BYPASS_MODE);
+	lsm6dso_fifo_xl_batch_set(&dev_ctx, (lsm6dso_bdr_xl_t)odr);
+	lsm6dso_fifo_gy_batch_set(&dev_ctx, (lsm6dso_bdr_gy_t)odr);
+	lsm6dso_xl_data_rate_set(&dev_ctx, (lsm6dso_odr_xl_t)odr);
+	lsm6dso_gy_data_rate_set(&dev_ctx, (lsm6dso_odr_g_t)odr);
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_STREAM_MODE);
+
+	return fifo_odr_hz[odr];
+}
+
+void lp_imu_motion_stop(void)
+{
+	if (!initialized)
+	{
+		return;
+	}
+
+	// Back to the configuration set up by lp_imu_initialize() / the UCF programs
+	lsm6dso_fifo_mode_set(&dev_ctx, LSM6DSO_BYPASS_MODE);
+	lsm6dso_fifo_xl_batch_set(&dev_ctx, LSM6DSO_XL_NOT_BATCHED);
+	lsm6dso_fifo_gy_batch_set(&dev_ctx, LSM6DSO_GY_NOT_BATCHED);
+	lsm6dso_xl_data_rate_set(&dev_ctx, idle_xl_odr);
+	lsm6dso_gy_data_rate_set(&dev_ctx, LSM6DSO_GY_ODR_12Hz5);
+	stream_activity_mode_restore();
+}
+
+// Real time between two pairs in seconds, corrected for this part's oscillator
+float lp_imu_motion_sample_period(void)
+{
+	return motion_sample_period;
+}
+
+// Read the sample pairs waiting in the FIFO, oldest first.  FIFO_STATUS1/2 give the number of words and
+// the latched overrun flag in one transfer, the words then come out in bursts like the accelerometer
+// stream.  overrun is set when the FIFO filled up since the last read and the oldest pairs were lost.
+uint16_t lp_imu_read_motion(LpImuMotion* pairs, uint16_t maxPairs, bool* overrun)
+{
+	uint8_t status[2];
+	lsm6dso_fifo_status2_t* status2 = (lsm6dso_fifo_status2_t*)&status[1];
+	lsm6dso_fifo_data_out_tag_t* tag;
+	uint16_t level;
+	uint16_t count = 0;
+
+	if (!initialized || (pairs == NULL) || (overrun == NULL))
+	{
+		return 0;
+	}
+
+	if (platform_read(dev_ctx.handle, LSM6DSO_FIFO_STATUS1, status, sizeof(status)) != 0)
+	{
+		return 0;
+	}
+
+	level = (uint16_t)status2->diff_fifo << 8 | status[0];
+	*overrun = status2->over_run_latched;
+
+	while ((level > 0) && (count < maxPairs))
+	{
+		// Two words per pair, and at most the words there is room for
+		uint16_t words = (level < FIFO_WORDS_PER_BURST) ? level : FIFO_WORDS_PER_BURST;
+
+		if (words > 2 * (maxPairs - count))
+		{
+			words = 2 * (maxPairs - count);
+		}
+
+		if (platform_read(dev_ctx.handle, LSM6DSO_FIFO_DATA_OUT_TAG, fifo_burst, words * FIFO_WORD_LEN) != 0)
+		{
+			break;
+		}
+		level -= words;
+
+		for (uint16_t i = 0; i < words; i++)
+		{
+			uint8_t* word = &fifo_burst[i * FIFO_WORD_LEN];
+			int16_t* axes;
+			tag = (lsm6dso_fifo_data_out_tag_t*)word;
+
+			// A second word of the same sensor replaces the first, the other half of that pair was lost
+			if (tag->tag_sensor == LSM6DSO_GYRO_NC_TAG)
+			{
+				axes = motion_gyro;
+				motion_gyro_pending = true;
+			}
+			else if (tag->tag_sensor == LSM6DSO_XL_NC_TAG)
+			{
+				axes = motion_accel;
+				motion_accel_pending = true;
+			}
+			else
+			{
+				continue;
+			}
+
+			axes[0] = (int16_t)((uint16_t)word[2] << 8 | word[1]);
+			axes[1] = (int16_t)((uint16_t)word[4] << 8 | word[3]);
+			axes[2] = (int16_t)((uint16_t)word[6] << 8 | word[5]);
+
+			if (!motion_gyro_pending || !motion_accel_pending)
+			{
+				continue;
+			}
+
+			pairs[count].angularRate.x = (motion_gyro[0] - raw_angular_rate_calibration.i16bit[0]) * GY_FS2000_DPS_PER_LSB;
+			pairs[count].angularRate.y = (motion_gyro[1] - raw_angular_rate_calibration.i16bit[1]) * GY_FS2000_DPS_PER_LSB;
+			pairs[count].angularRate.z = (motion_gyro[2] - raw_angular_rate_calibration.i16bit[2]) * GY_FS2000_DPS_PER_LSB;
+			pairs[count].acceleration.x = motion_accel[0] * XL_FS2_MG_PER_LSB;
+			pairs[count].acceleration.y = motion_accel[1] * XL_FS2_MG_PER_LSB;
+			pairs[count].acceleration.z = motion_accel[2] * XL_FS2_MG_PER_LSB;
+			motion_gyro_pending = false;
+			motion_accel_pending = false;
+			count++;
+		}
+	}
+
+	return count;
+}
+
 AngularRateDegreesPerSecond lp_get_angular_rate(void)
 {
 	uint8_t reg;
@@ -11,6 +11,7 @@
 #include <unistd.h>
 #include "tx_api.h"
 #include "os_hal_i2c.h"
+#include "buildOptions.h"
 
 #define LSM6DSO_ADDRESS	   0x6A	  // I2C Address
 static const uint8_t i2c_speed = I2C_SCL_1000kHz;
@@ -29,6 +30,73 @@ typedef struct
 	float z;
 } AccelerationMilligForce;
 
+typedef struct
+{
+	int16_t x;
+	int16_t y;
+	int16_t z;
+} AccelerationRaw;
+
+// One accelerometer/gyroscope sample pair from lp_imu_read_motion()
+typedef struct
+{
+	AccelerationMilligForce acceleration;
+	AngularRateDegreesPerSecond angularRate;
+} LpImuMotion;
+
+// Accelerometer sensitivity for the +/-2g full scale configured in lp_imu_initialize()
+#define LP_ACCEL_MG_PER_LSB 0.061f
+
+// Events latched by the LSM6DSO embedded functions since the last call to lp_imu_get_events()
+typedef struct
+{
+	bool freeFall;
+	bool wakeUp;
+	bool singleTap;
+	bool doubleTap;
+	uint8_t tapAxis;			// bit 0 = X, bit 1 = Y, bit 2 = Z
+	bool tapNegative;
+	bool activityChange;
+	bool inactive;				// Activity state after an activityChange
+	uint16_t fsmStatus;			// bit n set when FSM program n+1 raised its interrupt
+	uint8_t fsmOutputs[16];		// FSM_OUTS1 - FSM_OUTS16, valid when fsmStatus is non-zero
+} LpImuEvents;
+
+// Sensor calibration.  The accelerometer offsets are written to the LSM6DSO X/Y/Z_OFS_USR registers
+// and subtracted by the sensor itself, the gyroscope has no offset registers so the bias is subtracted
+// by lp_get_angular_rate().
+typedef struct
+{
+	int16_t gyroBias[3];		// Raw LSB at 2000dps
+	int8_t accelOffset[3];		// X/Y/Z_OFS_USR register values
+	bool accelOffsetHighWeight;	// false = 2^-10 g/LSB, true = 2^-6 g/LSB
+} LpImuCalibration;
+
+typedef struct
+{
+	bool accelPass;
+	bool gyroPass;
+	float accelDeltaMg[3];		// Self test output change, 50 - 1700mg is a pass
+	float gyroDeltaDps[3];		// Self test output change, 150 - 700dps is a pass
+} LpImuSelfTest;
+
+#ifdef IMU_I2C_STATS
+// I2C transfer timing in M4 cycles (cycle_counter.h).  Reads into SYSRAM buffers go straight to the
+// caller, every other read is copied out of the SYSRAM bounce buffer, copyCycles is what that costs.
+typedef struct
+{
+	uint32_t reads;
+	uint32_t readBytes;
+	uint32_t readCycles;		// Whole platform_read(), bus time included
+	uint32_t directReads;		// Reads without the copy
+	uint32_t copiedBytes;
+	uint32_t copyCycles;
+	uint32_t fifoBursts;		// FIFO data reads, lp_imu_fifo_read_acceleration()
+	uint32_t fifoBytes;
+	uint32_t fifoCycles;
+} LpImuI2cStats;
+#endif // IMU_I2C_STATS
+
 bool lp_imu_initialize(void);
 void lp_imu_close(void);
 float lp_get_temperature(void);
@@ -37,3 +105,19 @@ float lp_get_temperature_lps22h(void);	// get_temperature() from lsm6dso is fast
 void lp_calibrate_angular_rate(void);
 AngularRateDegreesPerSecond lp_get_angular_rate(void);
 bool lp_get_acceleration(AccelerationMilligForce*);
+uint32_t lp_imu_fifo_start(uint32_t sampleRateHz, uint16_t watermark);
+void lp_imu_fifo_stop(void);
+uint16_t lp_imu_fifo_read_acceleration(AccelerationRaw* samples, uint16_t maxSamples);
+#ifdef IMU_I2C_STATS
+void lp_imu_get_i2c_stats(LpImuI2cStats* stats, bool reset);
+#endif
+bool lp_imu_load_ucf(const ucf_line_t* program, uint32_t lines);	// ucf_line_t comes from lsm6dso_reg.h
+bool lp_imu_route_events_int1(void);
+bool lp_imu_get_events(LpImuEvents* events);
+bool lp_imu_self_test(LpImuSelfTest* result);
+bool lp_imu_calibrate(LpImuCalibration* calibration, uint16_t samples);
+bool lp_imu_apply_calibration(const LpImuCalibration* calibration);
+uint32_t lp_imu_motion_start(uint32_t sampleRateHz);
+void lp_imu_motion_stop(void);
+float lp_imu_motion_sample_period(void);
+uint16_t lp_imu_read_motion(LpImuMotion* pairs, uint16_t maxPairs, bool* overrun);
@@ -10,4 +10,25 @@
 // CLICK Socket Selection
 // Use this section to define which CLICK socket the sensor hardware is using
 
-/* This application does not use the CLICK sockets /*
+/* This application does not use the CLICK sockets */
+
+// LSM6DSO Interrupt Selection
+// The LSM6DSO event detectors and FSM programs signal events on the INT1 pin.  If INT1 is wired to an
+// MT3620 GPIO that supports external interrupts (GPIO0 - GPIO23), define LSM6DSO_INT1_GPIO as that GPIO
+// number and add it to the "Gpio" capability in app_manifest.json.  The application then only reads the
+// event sources when INT1 fires.  Otherwise the read sensor thread polls the event sources.
+//#define LSM6DSO_INT1_GPIO 2     // Click socket #1 INT pin
+
+// LSM6DSO I2C Transfer Timing
+// Define IMU_I2C_STATS to count the M4 cycles of the LSM6DSO register reads and FIFO bursts (and of the copies
+// out of the SYSRAM bounce buffer) and print them on the debug UART every 10 seconds while samples stream.
+// Leave it undefined in production builds, the counting reads the cycle counter on every register read.
+//#define IMU_I2C_STATS
+
+// Orientation Fusion Trace
+// Define ORIENTATION_PRINT_TRACE to print every accelerometer/gyroscope pair the orientation filter is fed on
+// the debug UART, in the format of test/orientation_trace.h, with the real sample period when fusion starts.
+// Save the lines to a .csv file in test/traces and add the level and heading directives for what the board did
+// while it recorded, the host tests then replay it against them.  At 115200 baud the UART keeps up with about
+// 200 lines a second, record at 104Hz.
+//#define ORIENTATION_PRINT_TRACE
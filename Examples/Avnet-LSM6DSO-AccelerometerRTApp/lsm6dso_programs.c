@@ -0,0 +1,29 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include "lsm6dso_programs.h"
+
+// Built in event detectors: free fall, wake-up, single/double tap and activity/inactivity.
+// The accelerometer runs at 417Hz (the minimum for tap detection) and drops to 12.5Hz while the
+// device is inactive, except while the FIFO or fusion stream runs (the driver switches INACT_EN off
+// then).  Thresholds assume the +/-2g full scale set by lp_imu_initialize().
+static const ucf_line_t event_detectors[] = {
+    {LSM6DSO_FUNC_CFG_ACCESS, 0x00},    // User register bank
+    {LSM6DSO_CTRL1_XL,        0x62},    // ODR 417Hz, 2g, LPF2 enabled
+    {LSM6DSO_TAP_CFG0,        0x4F},    // Clear on read, tap on X/Y/Z, latched
+    {LSM6DSO_TAP_CFG1,        0x08},    // X tap threshold 500mg, X > Y > Z priority
+    {LSM6DSO_TAP_CFG2,        0xA8},    // Interrupts enabled, inactivity sets XL to 12.5Hz, Y tap threshold 500mg
+    {LSM6DSO_TAP_THS_6D,      0x08},    // Z tap threshold 500mg
+    {LSM6DSO_INT_DUR2,        0x76},    // Double tap gap 7, quiet 1, shock 2
+    {LSM6DSO_WAKE_UP_THS,     0x82},    // Single and double tap, wake-up threshold 62.5mg
+    {LSM6DSO_WAKE_UP_DUR,     0x04},    // Wake-up duration 0, inactive after ~5s (4 x 512 / ODR)
+    {LSM6DSO_FREE_FALL,       0x33},    // Free fall for 6 samples below 312mg
+};
+
+// Add FSM programs exported from Unico-GUI/MEMS Studio below.  The exported programs enable the
+// embedded functions and the FSM_ENABLE_A/B bits themselves.
+const Lsm6dsoProgram lsm6dso_programs[] = {
+    {"event detectors", event_detectors, sizeof(event_detectors) / sizeof(event_detectors[0])},
+};
+
+const uint32_t lsm6dso_program_count = sizeof(lsm6dso_programs) / sizeof(lsm6dso_programs[0]);
@@ -0,0 +1,22 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdint.h>
+#include "./IMU_lib/imu_temp_pressure.h"
+
+// Register programs applied to the LSM6DSO at start up, in table order.  Each program is a UCF
+// register list as exported to C by ST's Unico-GUI/MEMS Studio tools, so finite state machine
+// programs can be dropped in without code changes.  lp_imu_route_events_int1() then routes every
+// detector and FSM the programs enabled to INT1.
+
+typedef struct
+{
+    const char* name;
+    const ucf_line_t* lines;
+    uint32_t length;
+} Lsm6dsoProgram;
+
+extern const Lsm6dsoProgram lsm6dso_programs[];
+extern const uint32_t lsm6dso_program_count;
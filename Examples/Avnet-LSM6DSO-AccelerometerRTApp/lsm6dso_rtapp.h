@@ -18,9 +18,62 @@ typedef enum __attribute__((packed))
 	/////////////////////////////////////////////////////////////////////////////////
 	IC_LSM6DSO_READ_SENSOR, 
     IC_LSM6DSO_SET_SENSOR_SAMPLE_RATE,
+	IC_LSM6DSO_SET_FEATURE_WINDOW,
+	IC_LSM6DSO_FEATURE_VECTOR,
+	IC_LSM6DSO_SET_SPECTRUM_CONFIG,
+	IC_LSM6DSO_SPECTRUM,
+	IC_LSM6DSO_EVENT,
+	IC_LSM6DSO_SELF_TEST,
+	IC_LSM6DSO_CALIBRATE,
+	IC_LSM6DSO_SET_CALIBRATION,
+	IC_LSM6DSO_SET_FUSION_CONFIG,
+	IC_LSM6DSO_READ_ORIENTATION,
 
 } INTER_CORE_CMD_LSM6DSO;
 
+// Event bits reported in eventFlags by IC_LSM6DSO_EVENT
+#define IC_LSM6DSO_EVENT_FREE_FALL        0x0001
+#define IC_LSM6DSO_EVENT_WAKE_UP          0x0002
+#define IC_LSM6DSO_EVENT_SINGLE_TAP       0x0004
+#define IC_LSM6DSO_EVENT_DOUBLE_TAP       0x0008
+#define IC_LSM6DSO_EVENT_TAP_X            0x0010
+#define IC_LSM6DSO_EVENT_TAP_Y            0x0020
+#define IC_LSM6DSO_EVENT_TAP_Z            0x0040
+#define IC_LSM6DSO_EVENT_TAP_NEGATIVE     0x0080
+#define IC_LSM6DSO_EVENT_ACTIVITY_CHANGE  0x0100
+#define IC_LSM6DSO_EVENT_INACTIVE         0x0200  // Set while the device is inactive
+#define IC_LSM6DSO_EVENT_FSM              0x0400  // See eventFsmStatus and eventFsmOutputs
+
+// Number of frequency bands and spectral peaks carried by IC_LSM6DSO_SPECTRUM
+#define IC_LSM6DSO_SPECTRUM_BANDS 8
+#define IC_LSM6DSO_SPECTRUM_PEAKS 5
+
+// Vibration statistics for one axis over one feature window
+typedef struct  __attribute__((packed))
+{
+    float mean;         // mg
+    float rms;          // mg, computed about the window mean
+    float peak;         // mg, largest absolute deviation from the window mean
+    float crestFactor;  // peak / rms
+    float kurtosis;     // 3.0 for a gaussian signal, higher for impulsive signals
+} IC_LSM6DSO_AXIS_FEATURES;
+
+// One spectral peak
+typedef struct  __attribute__((packed))
+{
+    float frequencyHz;
+    float amplitude;    // mg
+} IC_LSM6DSO_SPECTRAL_PEAK;
+
+// Sensor calibration, returned by IC_LSM6DSO_CALIBRATE for the high level application to persist and
+// sent back down with IC_LSM6DSO_SET_CALIBRATION when the real time application starts
+typedef struct  __attribute__((packed))
+{
+    int16_t gyroBias[3];            // Raw LSB at 2000dps
+    int8_t accelOffset[3];          // LSM6DSO X/Y/Z_OFS_USR register values
+    uint8_t accelOffsetHighWeight;  // 0 = 2^-10 g/LSB, 1 = 2^-6 g/LSB
+} IC_LSM6DSO_CALIBRATION;
+
 // Define the data structure that the high level app sends
 typedef struct  __attribute__((packed))
 {
@@ -30,6 +83,16 @@ typedef struct  __attribute__((packed))
 	// Don't change the declarations above or the generic RTApp implementation will break //
 	////////////////////////////////////////////////////////////////////////////////////////   
     uint32_t sensorSampleRate;
+    uint32_t featureSampleRate;     // Accelerometer ODR (Hz) used while feature extraction is enabled
+    uint16_t featureWindowSize;     // Samples per feature window, 0 disables feature extraction
+    uint16_t spectrumFftSize;       // 256, 512 or 1024 point FFT, 0 disables the spectrum (uses featureSampleRate)
+    uint8_t spectrumAxis;           // 0 = X, 1 = Y, 2 = Z
+    uint8_t spectrumPeakCount;      // Number of peaks to report, up to IC_LSM6DSO_SPECTRUM_PEAKS
+    uint16_t spectrumBandEdgesHz[IC_LSM6DSO_SPECTRUM_BANDS + 1]; // Ascending band edges, band i is [edge i, edge i+1)
+    uint16_t calibrationSamples;    // Samples averaged by IC_LSM6DSO_CALIBRATE, 0 uses the default
+    IC_LSM6DSO_CALIBRATION calibration; // Calibration applied by IC_LSM6DSO_SET_CALIBRATION
+    uint32_t fusionSampleRate;      // Accelerometer/gyroscope ODR (Hz) for orientation fusion, up to 417, 0 disables fusion
+    float fusionBeta;               // Filter gain, 0 keeps the current gain (default 0.1)
 } IC_COMMAND_BLOCK_LSM6DSO_HL_TO_RT;
 
 // Define the data structure that the real time app sends
@@ -45,6 +108,44 @@ typedef struct  __attribute__((packed))
     float accelX;
     float accelY;
     float accelZ;
+    uint32_t featureSampleRate;
+    uint16_t featureWindowSize;
+    uint32_t featureSequence;
+    uint32_t featureCyclesPerSample;
+    IC_LSM6DSO_AXIS_FEATURES featureX;
+    IC_LSM6DSO_AXIS_FEATURES featureY;
+    IC_LSM6DSO_AXIS_FEATURES featureZ;
+    uint16_t spectrumFftSize;
+    uint8_t spectrumAxis;
+    uint32_t spectrumSequence;
+    uint32_t spectrumTransformCycles;
+    uint32_t spectrumOverruns;
+    float spectrumBinHz;
+    float spectrumBandEnergy[IC_LSM6DSO_SPECTRUM_BANDS];   // Mean square acceleration per band, mg^2
+    IC_LSM6DSO_SPECTRAL_PEAK spectrumPeaks[IC_LSM6DSO_SPECTRUM_PEAKS];
+    uint32_t eventSequence;         // Increments for every interrupt from the LSM6DSO
+    uint32_t eventFlags;            // IC_LSM6DSO_EVENT_* bits seen since the last IC_LSM6DSO_EVENT message
+    uint16_t eventFsmStatus;        // Bit n set when FSM program n+1 fired
+    uint8_t eventFsmOutputs[16];    // FSM_OUTS1 - FSM_OUTS16
+    uint8_t calibrationStatus;      // 1 if the self test or calibration ran, 0 if the sensor could not be read
+    IC_LSM6DSO_CALIBRATION calibration;
+    uint8_t selfTestAccelPass;
+    uint8_t selfTestGyroPass;
+    float selfTestAccelDeltaMg[3];  // Output change with self test enabled, 50 - 1700mg is a pass
+    float selfTestGyroDeltaDps[3];  // Output change with self test enabled, 150 - 700dps is a pass
+    uint32_t fusionSampleRate;      // 0 when orientation fusion is disabled
+    float fusionBeta;
+    float fusionQuatW;              // Orientation of the sensor frame relative to the earth frame
+    float fusionQuatX;
+    float fusionQuatY;
+    float fusionQuatZ;
+    float fusionRoll;               // degrees
+    float fusionPitch;              // degrees
+    float fusionYaw;                // degrees, integrated from the gyroscope and drifts over time
+    float fusionTilt;               // degrees between the sensor Z axis and vertical
+    uint32_t fusionUpdates;         // Samples processed since fusion was (re)started
+    uint32_t fusionCyclesPerUpdate;
+    uint32_t fusionMaxCyclesPerUpdate;
 } IC_COMMAND_BLOCK_LSM6DSO_RT_TO_HL;
 
 
@@ -43,14 +43,25 @@
 #include "os_hal_mbox.h"
 #include "os_hal_mbox_shared_mem.h"
 #include "lsm6dso_rtapp.h"
+#include "buildOptions.h"
 #include "./IMU_lib/imu_temp_pressure.h"
+#include "lsm6dso_programs.h"
+#include "vibration_features.h"
+#include "spectrum.h"
+#include "orientation_filter.h"
+#include "cycle_counter.h"
 
-// 1 tick = 10ms. It is configurable.
-#define MS_TO_TICK(ms)  ((ms) * (TX_TIMER_TICKS_PER_SECOND) / 1000)
+#ifdef LSM6DSO_INT1_GPIO
+#include "os_hal_gpio.h"
+#include "os_hal_eint.h"
+#endif
 
 // Add MT3620 constant
 #define MT3620_TIMER_TICKS_PER_SECOND ((ULONG) 100*10)
 
+// SysTick runs at 1kHz (tx_initialize_low_level.S), TX_TIMER_TICKS_PER_SECOND is still the ThreadX default of 100
+#define MS_TO_TICK(ms)  ((ms) * (MT3620_TIMER_TICKS_PER_SECOND) / 1000)
+
 // Application configuration details
 #define APP_STACK_SIZE      1024
 #define DEMO_BYTE_POOL_SIZE 9120
@@ -104,10 +115,85 @@ static volatile bool hardwareInitOK = false;
 // Variable to hold current acceleration values from LSM6DSO device
 static AccelerationMilligForce acceleration;
 
+// Feature extraction configuration.  When feature_window_size (or spectrum_fft_size) is non-zero the read
+// sensor thread streams accelerometer samples through the LSM6DSO FIFO at feature_sample_rate and sends a
+// feature vector to the high level application for every completed window instead of polling single samples.
+#define FEATURE_FIFO_POLL_MS 50
+#define FEATURE_FIFO_BATCH 64
+// With IMU_I2C_STATS defined the I2C transfer timing is printed every FEATURE_I2C_STATS_MS while streaming
+#define FEATURE_I2C_STATS_MS 10000
+static uint32_t feature_sample_rate = 833;
+static uint16_t feature_window_size = 0;
+static volatile bool streamConfigChanged = false;
+
+// Spectrum configuration, spectrum_fft_size of zero disables the spectrum
+static uint16_t spectrum_fft_size = 0;
+static uint8_t spectrum_axis = 2;
+static uint8_t spectrum_peak_count = 3;
+static uint16_t spectrum_band_edges[IC_LSM6DSO_SPECTRUM_BANDS + 1];
+
+_Static_assert(IC_LSM6DSO_SPECTRUM_BANDS == SPECTRUM_MAX_BANDS, "spectrum band count mismatch");
+_Static_assert(IC_LSM6DSO_SPECTRUM_PEAKS == SPECTRUM_MAX_PEAKS, "spectrum peak count mismatch");
+
+// Buffer for samples drained from the FIFO, the most recent completed feature vector and spectrum
+static AccelerationRaw fifoSamples[FEATURE_FIFO_BATCH];
+static VibrationFeatures vibrationFeatures;
+static SpectrumResult spectrumResult;
+
+// Events reported by the LSM6DSO that have not been sent to the high level application yet.  The flags
+// accumulate until the mbox thread sends them, so back to back interrupts are never lost.
+static volatile bool imuEventPending = false;
+static uint32_t imuEventSequence = 0;
+static uint32_t imuEventFlags = 0;
+static uint16_t imuEventFsmStatus = 0;
+static uint8_t imuEventFsmOutputs[16];
+
+// Self test and calibration requests are run by the read sensor thread, which owns the I2C bus.  The
+// results are sent to the high level application when each request completes.
+#define CALIBRATION_DEFAULT_SAMPLES 100
+#define IMU_REQUEST_SELF_TEST 0x01
+#define IMU_REQUEST_CALIBRATE 0x02
+#define IMU_REQUEST_APPLY_CALIBRATION 0x04
+static uint8_t imuRequests = 0;
+static uint16_t calibration_samples = CALIBRATION_DEFAULT_SAMPLES;
+static LpImuCalibration imuCalibration;
+static bool imuCalibrationStatus = false;
+static LpImuSelfTest imuSelfTest;
+static bool imuSelfTestStatus = false;
+
+// Orientation fusion configuration.  When fusion_sample_rate is non-zero the read sensor thread runs the
+// accelerometer and gyroscope at that ODR, batched in the LSM6DSO FIFO, and feeds every sample pair through
+// the orientation filter.  The FIFO holds each pair one sensor sample period after the previous one, so the
+// filter integrates over the real period whenever the thread gets to read them.  Fusion and FIFO streaming
+// need different sensor configurations and are exclusive.
+#define FUSION_MAX_SAMPLE_RATE 417
+#define FUSION_POLL_MS 20
+#define FUSION_PAIRS_PER_READ 16
+static uint32_t fusion_sample_rate = 0;
+static float fusion_beta = ORIENTATION_DEFAULT_BETA;
+static volatile bool fusionConfigChanged = false;
+static bool fusionActive = false;
+static uint32_t fusionOverruns = 0;
+static LpImuMotion fusionPairs[FUSION_PAIRS_PER_READ];
+
+// Without INT1 the latched event sources are polled, at most every IMU_EVENT_POLL_MS whatever the read
+// sensor thread is doing.  The sources stay latched, polling slower only delays the event.
+#define IMU_EVENT_POLL_MS 50
+static ULONG last_event_poll = 0;
+
+// The filter is only touched by the read sensor thread, the mbox thread reads the snapshot
+static OrientationFilter orientationFilter;
+static OrientationFilter orientationSnapshot;
+
 // Define the bits used for the telemetry event flag construct
 enum triggers {
     HIGH_LEVEL_MESSAGE = 0,
-    PERIODIC_TELEMETRY = 1
+    PERIODIC_TELEMETRY = 1,
+    FEATURE_VECTOR = 2,
+    SPECTRUM_RESULT = 3,
+    IMU_EVENT = 4,
+    SELF_TEST_RESULT = 5,
+    CALIBRATION_RESULT = 6
 };
 
 /* Define Semaphores */
@@ -118,12 +204,19 @@ volatile UCHAR  blockFifoSema;
 // This semaphore is used to protect access to the global sensor variable
 TX_SEMAPHORE  lsm6dsoDataSemaphore;
 
+// This semaphore is signaled by the read sensor thread every time a spectrum capture buffer fills
+TX_SEMAPHORE  spectrumCaptureSemaphore;
+
+// This mutex keeps the spectrum configuration from changing while a transform is running
+TX_MUTEX      spectrumMutex;
+
 /* Define the ThreadX object control blocks...  */
 
 // Threads
 TX_THREAD               thread_mbox;
 TX_THREAD               thread_set_telemetry_flag;
 TX_THREAD               thread_sensor_read;
+TX_THREAD               thread_spectrum;
 TX_THREAD               tx_hardware_init_thread;
 
 // Application memory pool
@@ -138,6 +231,7 @@ TX_EVENT_FLAGS_GROUP    hardware_event_flags_0;
 void tx_thread_mbox_entry(ULONG thread_input);
 void set_telemetry_flag_thread_entry(ULONG thread_input);
 void sensor_read_thread_entry(ULONG thread_input);
+void spectrum_thread_entry(ULONG thread_input);
 void hardware_init_thread(ULONG thread_input);
 
 /* Function prototypes */
@@ -146,10 +240,27 @@ void mbox_swint_cb(struct mtk_os_hal_mbox_cb_data *data);
 void mbox_print(UCHAR *mbox_buf, UINT mbox_data_len);
 bool initialize_hardware(void);
 void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void sendFeatureVector(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void sendSpectrum(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void sendImuEvent(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void sendCalibrationResult(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size, INTER_CORE_CMD_LSM6DSO cmd);
+void readOrientation(IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing);
+static void processFifoSamples(void);
+#ifdef IMU_I2C_STATS
+static void printI2cStats(void);
+#endif
+static void collectImuEvents(void);
+static void requestImuTask(uint8_t request);
+static void processImuRequests(void);
+static void configureFusion(void);
+static void updateOrientation(void);
 
 /* Define main entry point.  */
 void tx_main(void)
 {
+    /* Enable the DWT cycle counter used to benchmark the feature kernels */
+    cycle_counter_init();
+
     /* Enter the ThreadX kernel.  */
     tx_kernel_enter();
 }
@@ -198,6 +309,13 @@ void tx_application_define(void *first_unused_memory)
     tx_thread_create(&thread_sensor_read, "read sensor thread", sensor_read_thread_entry, 0,
             pointer, APP_STACK_SIZE, 7, 7, TX_NO_TIME_SLICE, TX_AUTO_START);
 
+    /* Allocate the stack for the spectrum thread  */
+    tx_byte_allocate(&byte_pool_0, (VOID **) &pointer, APP_STACK_SIZE, TX_NO_WAIT);
+
+    /* Create the spectrum thread, it runs at the lowest priority so transforms never delay draining the FIFO */
+    tx_thread_create(&thread_spectrum, "spectrum thread", spectrum_thread_entry, 0,
+            pointer, APP_STACK_SIZE, 9, 9, TX_NO_TIME_SLICE, TX_AUTO_START);
+
     /* Allocate the stack for the telemetry set flag thread  */
     tx_byte_allocate(&byte_pool_0, (VOID **) &pointer, APP_STACK_SIZE, TX_NO_WAIT);
 
@@ -215,6 +333,10 @@ void tx_application_define(void *first_unused_memory)
     /* Create the semaphore used make sure we always store/use a complete set of accelerometer data */
     tx_semaphore_create(&lsm6dsoDataSemaphore, "LSM6DSO Data semaphore", 1); 
 
+    /* Create the spectrum capture semaphore and configuration mutex */
+    tx_semaphore_create(&spectrumCaptureSemaphore, "Spectrum capture semaphore", 0);
+    tx_mutex_create(&spectrumMutex, "Spectrum mutex", TX_INHERIT);
+
     // -------------------------------- mailbox channels --------------------------------
 
     /* Open the MBOX channel of A7 <-> M4 */
@@ -265,7 +387,8 @@ void tx_thread_mbox_entry(ULONG thread_input)
         // Once the call returns, it will also clear the event flags.  We use the actual_flags variable
         // to determine which flag was set
         ULONG status = tx_event_flags_get(&send_telemetry_event_flags_0, 
-                                          (0x01 << HIGH_LEVEL_MESSAGE) | (0x01 << PERIODIC_TELEMETRY), 
+                                          (0x01 << HIGH_LEVEL_MESSAGE) | (0x01 << PERIODIC_TELEMETRY) | (0x01 << FEATURE_VECTOR) | (0x01 << SPECTRUM_RESULT) |
+                                          (0x01 << IMU_EVENT) | (0x01 << SELF_TEST_RESULT) | (0x01 << CALIBRATION_RESULT), 
                                           TX_OR_CLEAR, &actual_flags, 
                                           TX_WAIT_FOREVER);
         
@@ -275,11 +398,9 @@ void tx_thread_mbox_entry(ULONG thread_input)
         }    
 
         // Check to see if we're here because we received a message from the High Level App (actual_flags bit HIGH_LEVEL_MESSAGE set), 
-        // or we're sending a periodic telemetry message up (actual_flags bit PERIODIC_TELEMETRY set)
-        switch (actual_flags)
-        {
-
-        case(0x01 << HIGH_LEVEL_MESSAGE):
+        // we're sending a periodic telemetry message up (actual_flags bit PERIODIC_TELEMETRY set), or a feature window or
+        // spectrum completed (actual_flags bits FEATURE_VECTOR, SPECTRUM_RESULT).  More than one bit can be set at a time.
+        if (actual_flags & (0x01 << HIGH_LEVEL_MESSAGE)) {
 
             // We just received a message, set the flag to true
             queuedMessages = true;
@@ -363,6 +484,152 @@ void tx_thread_mbox_entry(ULONG thread_input)
                         EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
                         break;
 
+                    // The high level application is configuring on-sensor feature extraction.  A window size of zero
+                    // disables feature extraction and returns to polling single samples.
+                    case IC_LSM6DSO_SET_FEATURE_WINDOW:
+
+                        printf("Set the feature window to %u samples at %lu Hz\n", payloadPtrIncomming->payload.featureWindowSize,
+                                                                                     payloadPtrIncomming->payload.featureSampleRate);
+
+                        if(payloadPtrIncomming->payload.featureSampleRate > 0){
+                            feature_sample_rate = payloadPtrIncomming->payload.featureSampleRate;
+                        }
+
+                        // The window size is validated and rounded by the feature engine, the read sensor thread
+                        // applies it since it is filling the current window
+                        feature_window_size = 0;
+                        if(payloadPtrIncomming->payload.featureWindowSize > 0){
+                            feature_window_size = vf_round_window(payloadPtrIncomming->payload.featureWindowSize);
+                        }
+
+                        // The read sensor thread owns the I2C bus, let it reconfigure the FIFO
+                        streamConfigChanged = true;
+                        tx_thread_wait_abort(&thread_sensor_read);
+
+                        // Respond with the configuration that will be used
+                        payloadPtrOutgoing->payload.featureSampleRate = feature_sample_rate;
+                        payloadPtrOutgoing->payload.featureWindowSize = feature_window_size;
+
+                        // Write to A7, enqueue to mailbox
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
+                    // The high level application is configuring the spectrum.  The FFT runs on samples streamed at
+                    // featureSampleRate, an FFT size of zero disables the spectrum.
+                    case IC_LSM6DSO_SET_SPECTRUM_CONFIG:
+
+                        printf("Set the spectrum to %u points on axis %u at %lu Hz\n", payloadPtrIncomming->payload.spectrumFftSize,
+                                                                                      payloadPtrIncomming->payload.spectrumAxis,
+                                                                                      payloadPtrIncomming->payload.featureSampleRate);
+
+                        if(payloadPtrIncomming->payload.featureSampleRate > 0){
+                            feature_sample_rate = payloadPtrIncomming->payload.featureSampleRate;
+                        }
+
+                        spectrum_fft_size = payloadPtrIncomming->payload.spectrumFftSize;
+                        spectrum_axis = payloadPtrIncomming->payload.spectrumAxis;
+                        spectrum_peak_count = payloadPtrIncomming->payload.spectrumPeakCount;
+                        memcpy(spectrum_band_edges, payloadPtrIncomming->payload.spectrumBandEdgesHz, sizeof(spectrum_band_edges));
+
+                        // The read sensor thread owns the I2C bus, let it reconfigure the FIFO and the spectrum
+                        streamConfigChanged = true;
+                        tx_thread_wait_abort(&thread_sensor_read);
+
+                        // Respond with the configuration that will be used
+                        payloadPtrOutgoing->payload.featureSampleRate = feature_sample_rate;
+                        payloadPtrOutgoing->payload.spectrumFftSize = spectrum_fft_size;
+                        payloadPtrOutgoing->payload.spectrumAxis = spectrum_axis;
+
+                        // Write to A7, enqueue to mailbox
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
+                    // The high level application is requesting the accelerometer and gyroscope self test.  The test takes
+                    // about half a second, the result is sent with the same command ID when it completes.
+                    case IC_LSM6DSO_SELF_TEST:
+
+                        requestImuTask(IMU_REQUEST_SELF_TEST);
+                        break;
+
+                    // The high level application is requesting a calibration, the device must be stationary with one axis
+                    // vertical.  The result is sent with the same command ID when it completes, the high level application
+                    // should persist it and send it back down with IC_LSM6DSO_SET_CALIBRATION after a restart.
+                    case IC_LSM6DSO_CALIBRATE:
+
+                        calibration_samples = payloadPtrIncomming->payload.calibrationSamples;
+                        if(calibration_samples == 0){
+                            calibration_samples = CALIBRATION_DEFAULT_SAMPLES;
+                        }
+
+                        requestImuTask(IMU_REQUEST_CALIBRATE);
+                        break;
+
+                    // The high level application is restoring a persisted calibration
+                    case IC_LSM6DSO_SET_CALIBRATION:
+
+                        tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+                        for(int axis = 0; axis < 3; axis++){
+                            imuCalibration.gyroBias[axis] = payloadPtrIncomming->payload.calibration.gyroBias[axis];
+                            imuCalibration.accelOffset[axis] = payloadPtrIncomming->payload.calibration.accelOffset[axis];
+                        }
+                        imuCalibration.accelOffsetHighWeight = (payloadPtrIncomming->payload.calibration.accelOffsetHighWeight != 0);
+                        tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+                        requestImuTask(IMU_REQUEST_APPLY_CALIBRATION);
+
+                        // Echo the calibration back to confirm it was received
+                        payloadPtrOutgoing->payload.calibration = payloadPtrIncomming->payload.calibration;
+                        payloadPtrOutgoing->payload.calibrationStatus = 1;
+
+                        // Write to A7, enqueue to mailbox
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
+                    // The high level application is configuring orientation fusion, a sample rate of zero disables it.
+                    // Fusion can't run while feature extraction or the spectrum are streaming samples from the FIFO.
+                    case IC_LSM6DSO_SET_FUSION_CONFIG:
+
+                        printf("Set orientation fusion to %lu Hz, beta %f\n", payloadPtrIncomming->payload.fusionSampleRate,
+                                                                            payloadPtrIncomming->payload.fusionBeta);
+
+                        fusion_sample_rate = payloadPtrIncomming->payload.fusionSampleRate;
+                        if(fusion_sample_rate > FUSION_MAX_SAMPLE_RATE){
+                            fusion_sample_rate = FUSION_MAX_SAMPLE_RATE;
+                        }
+                        if((feature_window_size > 0) || (spectrum_fft_size > 0)){
+                            printf("Sample streaming is enabled, orientation fusion disabled\n");
+                            fusion_sample_rate = 0;
+                        }
+                        if(payloadPtrIncomming->payload.fusionBeta > 0.0f){
+                            fusion_beta = payloadPtrIncomming->payload.fusionBeta;
+                        }
+
+                        // The read sensor thread owns the I2C bus, let it reconfigure the sensor and the filter
+                        fusionConfigChanged = true;
+                        tx_thread_wait_abort(&thread_sensor_read);
+
+                        // Respond with the configuration that will be used, the sensor rounds the rate up to the next ODR
+                        payloadPtrOutgoing->payload.fusionSampleRate = fusion_sample_rate;
+                        payloadPtrOutgoing->payload.fusionBeta = fusion_beta;
+
+                        // Write to A7, enqueue to mailbox
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
+                    // The high level application is requesting the latest orientation estimate
+                    case IC_LSM6DSO_READ_ORIENTATION:
+
+                        readOrientation(payloadPtrOutgoing);
+
+                        printf("RealTime App sending orientation roll:%f, pitch:%f, yaw:%f, tilt:%f\n", payloadPtrOutgoing->payload.fusionRoll,
+                                                                                                        payloadPtrOutgoing->payload.fusionPitch,
+                                                                                                        payloadPtrOutgoing->payload.fusionYaw,
+                                                                                                        payloadPtrOutgoing->payload.fusionTilt);
+
+                        // Write to A7, enqueue to mailbox
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
                     // The high level application is requesting raw data from the sensor(s).  In this case, he developer needs to 
                     // understand what the data is and what needs to be done with it at both the high level and real time applcations.
                     case IC_LSM6DSO_READ_SENSOR:
@@ -398,13 +665,41 @@ void tx_thread_mbox_entry(ULONG thread_input)
                         break;
                 }
             }
-            break;
+        }
 
         // The read sensors thread has requested that we read the sensors and send telemetry.
-        case(0x01 << PERIODIC_TELEMETRY):
+        if (actual_flags & (0x01 << PERIODIC_TELEMETRY)) {
 
             readSensorsAndSendTelemetry(outbound, inbound, mbox_shared_buf_size);
-            break;
+        }
+
+        // The read sensors thread completed a feature window, send the feature vector up
+        if (actual_flags & (0x01 << FEATURE_VECTOR)) {
+
+            sendFeatureVector(outbound, inbound, mbox_shared_buf_size);
+        }
+
+        // The spectrum thread completed a transform, send the band energies and peaks up
+        if (actual_flags & (0x01 << SPECTRUM_RESULT)) {
+
+            sendSpectrum(outbound, inbound, mbox_shared_buf_size);
+        }
+
+        // The LSM6DSO reported an event, send it up
+        if (actual_flags & (0x01 << IMU_EVENT)) {
+
+            sendImuEvent(outbound, inbound, mbox_shared_buf_size);
+        }
+
+        // A self test or calibration requested by the high level application completed
+        if (actual_flags & (0x01 << SELF_TEST_RESULT)) {
+
+            sendCalibrationResult(outbound, inbound, mbox_shared_buf_size, IC_LSM6DSO_SELF_TEST);
+        }
+
+        if (actual_flags & (0x01 << CALIBRATION_RESULT)) {
+
+            sendCalibrationResult(outbound, inbound, mbox_shared_buf_size, IC_LSM6DSO_CALIBRATE);
         }
     }
     // Can we exit the application here?  If we exited the thread then there is an issue and we should restart the application
@@ -451,6 +746,96 @@ void sensor_read_thread_entry(ULONG thread_input)
 
     while (true){
 
+        // Run any self test or calibration requested by the high level application
+        if(hardwareInitOK && (imuRequests != 0)){
+            processImuRequests();
+        }
+
+#ifdef LSM6DSO_INT1_GPIO
+        // INT1 fired, read the event sources which also releases INT1
+        if(hardwareInitOK && imuEventPending){
+            imuEventPending = false;
+            collectImuEvents();
+        }
+#else
+        // INT1 is not connected, poll the latched event sources.  Fusion and the FIFO streaming modes wake this
+        // thread far more often than events need, keep the I2C bus free for the sample reads.
+        if(hardwareInitOK && ((tx_time_get() - last_event_poll) >= MS_TO_TICK(IMU_EVENT_POLL_MS))){
+            last_event_poll = tx_time_get();
+            collectImuEvents();
+        }
+#endif
+
+        if(hardwareInitOK && streamConfigChanged){
+
+            streamConfigChanged = false;
+
+            // Start over with an empty window of the new size
+            if(feature_window_size > 0){
+                vf_set_window(feature_window_size);
+            }
+
+            if((feature_window_size > 0) || (spectrum_fft_size > 0)){
+
+                // Streaming takes over the sensor, stop orientation fusion first
+                if(fusionActive){
+                    printf("Sample streaming enabled, orientation fusion disabled\n");
+                    lp_imu_motion_stop();
+                    fusionActive = false;
+                    fusion_sample_rate = 0;
+                }
+
+                // Stream samples through the FIFO, set the watermark to the poll period worth of samples
+                feature_sample_rate = lp_imu_fifo_start(feature_sample_rate, (uint16_t)(feature_sample_rate * FEATURE_FIFO_POLL_MS / 1000));
+                printf("Sample streaming enabled, ODR %lu Hz, feature window %u samples\n", feature_sample_rate, feature_window_size);
+            }
+            else{
+                lp_imu_fifo_stop();
+                printf("Sample streaming disabled\n");
+            }
+
+            if(spectrum_fft_size > 0){
+
+                // Wait for any transform in progress before changing the tables
+                tx_mutex_get(&spectrumMutex, TX_WAIT_FOREVER);
+                if(!spectrum_configure(spectrum_fft_size, spectrum_axis, (float)feature_sample_rate, spectrum_band_edges,
+                                       IC_LSM6DSO_SPECTRUM_BANDS, spectrum_peak_count)){
+                    printf("Invalid spectrum configuration, spectrum disabled\n");
+                    spectrum_fft_size = 0;
+                }
+                tx_mutex_put(&spectrumMutex);
+            }
+
+            // Stopping the FIFO restores the idle accelerometer ODR, restart fusion if it's enabled
+            if(fusion_sample_rate > 0){
+                fusionConfigChanged = true;
+            }
+        }
+
+        if(hardwareInitOK && fusionConfigChanged){
+
+            fusionConfigChanged = false;
+            configureFusion();
+        }
+
+        if(hardwareInitOK && fusionActive){
+
+            updateOrientation();
+
+            // Sleep while the FIFO collects the next pairs
+            tx_thread_sleep(MS_TO_TICK(FUSION_POLL_MS));
+            continue;
+        }
+
+        if(hardwareInitOK && ((feature_window_size > 0) || (spectrum_fft_size > 0))){
+
+            processFifoSamples();
+
+            // Sleep until the FIFO has collected the next batch of samples
+            tx_thread_sleep(MS_TO_TICK(FEATURE_FIFO_POLL_MS));
+            continue;
+        }
+
         if(hardwareInitOK){
 
             // Grab the semaphore before updating the acceleration data structure
@@ -479,6 +864,301 @@ void sensor_read_thread_entry(ULONG thread_input)
     }
 }
 
+// Drain the LSM6DSO FIFO into the feature engine and the spectrum capture buffer.  Every time a window
+// completes the feature vector is captured and the mbox thread is signaled to send it to the high level
+// application.  Full spectrum captures are handed to the spectrum thread.
+static void processFifoSamples(void)
+{
+    uint16_t count;
+
+    do {
+        count = lp_imu_fifo_read_acceleration(fifoSamples, FEATURE_FIFO_BATCH);
+
+        if ((spectrum_fft_size > 0) && spectrum_push(fifoSamples, count)) {
+            tx_semaphore_put(&spectrumCaptureSemaphore);
+        }
+
+        uint16_t consumed = 0;
+        while ((feature_window_size > 0) && (consumed < count)) {
+
+            consumed += vf_push(&fifoSamples[consumed], count - consumed);
+
+            if (vf_window_full()) {
+
+                // Grab the semaphore before updating the feature vector
+                tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+                vf_compute(&vibrationFeatures, LP_ACCEL_MG_PER_LSB);
+                tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+                tx_event_flags_set(&send_telemetry_event_flags_0, 0x01 << FEATURE_VECTOR, TX_OR);
+            }
+        }
+
+        // Keep the latest sample available to IC_LSM6DSO_READ_SENSOR and the telemetry message
+        if (count > 0) {
+            tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+            acceleration.x = fifoSamples[count - 1].x * LP_ACCEL_MG_PER_LSB;
+            acceleration.y = fifoSamples[count - 1].y * LP_ACCEL_MG_PER_LSB;
+            acceleration.z = fifoSamples[count - 1].z * LP_ACCEL_MG_PER_LSB;
+            tx_semaphore_put(&lsm6dsoDataSemaphore);
+        }
+
+    // A full batch means there may be more data waiting in the FIFO
+    } while (count == FEATURE_FIFO_BATCH);
+
+#ifdef IMU_I2C_STATS
+    printI2cStats();
+#endif
+}
+
+#ifdef IMU_I2C_STATS
+// Print the I2C transfer timing on the debug UART, the FIFO bursts are read with DMA straight into SYSRAM.  The
+// copy cycles are what the remaining reads spend copying out of the bounce buffer, per byte that is the cost a
+// burst of the same size avoids.
+static void printI2cStats(void)
+{
+    static uint32_t polls = 0;
+    LpImuI2cStats stats;
+
+    if(++polls < FEATURE_I2C_STATS_MS / FEATURE_FIFO_POLL_MS){
+        return;
+    }
+    polls = 0;
+
+    lp_imu_get_i2c_stats(&stats, true);
+
+    if(stats.fifoBursts > 0){
+        printf("I2C FIFO: %lu bursts, %lu bytes/burst, %lu cycles/burst, no copy\n", stats.fifoBursts,
+               stats.fifoBytes / stats.fifoBursts, stats.fifoCycles / stats.fifoBursts);
+    }
+    if(stats.copiedBytes > 0){
+        printf("I2C reads: %lu, %lu copied (%lu bytes), %lu cycles/read, copy %lu cycles/100 bytes\n", stats.reads,
+               stats.reads - stats.directReads, stats.copiedBytes, stats.readCycles / stats.reads,
+               (uint32_t)((uint64_t)stats.copyCycles * 100 / stats.copiedBytes));
+    }
+}
+#endif // IMU_I2C_STATS
+
+// Read the latched LSM6DSO event sources and merge them into the events waiting to be sent
+static void collectImuEvents(void)
+{
+    LpImuEvents events;
+    uint32_t flags = 0;
+
+    if(!lp_imu_get_events(&events)){
+        return;
+    }
+
+    flags |= events.freeFall ? IC_LSM6DSO_EVENT_FREE_FALL : 0;
+    flags |= events.wakeUp ? IC_LSM6DSO_EVENT_WAKE_UP : 0;
+    flags |= events.singleTap ? IC_LSM6DSO_EVENT_SINGLE_TAP : 0;
+    flags |= events.doubleTap ? IC_LSM6DSO_EVENT_DOUBLE_TAP : 0;
+    if(events.singleTap || events.doubleTap){
+        flags |= (events.tapAxis & 0x01) ? IC_LSM6DSO_EVENT_TAP_X : 0;
+        flags |= (events.tapAxis & 0x02) ? IC_LSM6DSO_EVENT_TAP_Y : 0;
+        flags |= (events.tapAxis & 0x04) ? IC_LSM6DSO_EVENT_TAP_Z : 0;
+        flags |= events.tapNegative ? IC_LSM6DSO_EVENT_TAP_NEGATIVE : 0;
+    }
+    flags |= (events.fsmStatus != 0) ? IC_LSM6DSO_EVENT_FSM : 0;
+
+    // Grab the semaphore before updating the pending events
+    tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+
+    if(events.activityChange){
+        // Only the latest activity state is reported
+        imuEventFlags &= ~IC_LSM6DSO_EVENT_INACTIVE;
+        flags |= IC_LSM6DSO_EVENT_ACTIVITY_CHANGE | (events.inactive ? IC_LSM6DSO_EVENT_INACTIVE : 0);
+    }
+
+    imuEventFlags |= flags;
+    imuEventFsmStatus |= events.fsmStatus;
+    if(events.fsmStatus != 0){
+        memcpy(imuEventFsmOutputs, events.fsmOutputs, sizeof(imuEventFsmOutputs));
+    }
+    imuEventSequence++;
+
+    tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+    tx_event_flags_set(&send_telemetry_event_flags_0, 0x01 << IMU_EVENT, TX_OR);
+}
+
+// Queue a self test or calibration request for the read sensor thread and wake it up
+static void requestImuTask(uint8_t request)
+{
+    tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+    imuRequests |= request;
+    tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+    tx_thread_wait_abort(&thread_sensor_read);
+}
+
+// Run the queued self test and calibration requests.  Both reconfigure the sensor, so the FIFO is
+// restarted afterwards to flush samples taken with the test configuration.
+static void processImuRequests(void)
+{
+    uint8_t requests;
+    LpImuCalibration calibration;
+    LpImuSelfTest selfTest;
+    bool status;
+
+    tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+    requests = imuRequests;
+    imuRequests = 0;
+    calibration = imuCalibration;
+    tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+    if(requests & IMU_REQUEST_APPLY_CALIBRATION){
+        if(!lp_imu_apply_calibration(&calibration)){
+            printf("Failed to apply the LSM6DSO calibration\n");
+        }
+    }
+
+    if(requests & IMU_REQUEST_SELF_TEST){
+
+        printf("Running the LSM6DSO self test\n");
+        status = lp_imu_self_test(&selfTest);
+
+        tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+        imuSelfTest = selfTest;
+        imuSelfTestStatus = status;
+        tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+        tx_event_flags_set(&send_telemetry_event_flags_0, 0x01 << SELF_TEST_RESULT, TX_OR);
+    }
+
+    if(requests & IMU_REQUEST_CALIBRATE){
+
+        printf("Calibrating the LSM6DSO, the device must be stationary\n");
+        status = lp_imu_calibrate(&calibration, calibration_samples);
+
+        tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+        if(status){
+            imuCalibration = calibration;
+        }
+        imuCalibrationStatus = status;
+        tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+        tx_event_flags_set(&send_telemetry_event_flags_0, 0x01 << CALIBRATION_RESULT, TX_OR);
+    }
+
+    if(requests & (IMU_REQUEST_SELF_TEST | IMU_REQUEST_CALIBRATE)){
+        streamConfigChanged = true;
+        fusionConfigChanged = true;
+    }
+}
+
+// Start or stop orientation fusion.  The filter is restarted from the accelerometer every time, the
+// gyroscope integration can't bridge the gap while the sensor was reconfigured.
+static void configureFusion(void)
+{
+    if((fusion_sample_rate > 0) && (feature_window_size == 0) && (spectrum_fft_size == 0)){
+
+        // The filter integrates over the sensor's real sample period, not the nominal ODR
+        fusion_sample_rate = lp_imu_motion_start(fusion_sample_rate);
+        orientation_init(&orientationFilter, 1.0f / lp_imu_motion_sample_period(), fusion_beta);
+        fusionOverruns = 0;
+
+        fusionActive = true;
+        printf("Orientation fusion enabled, ODR %lu Hz, beta %f\n", fusion_sample_rate, fusion_beta);
+#ifdef ORIENTATION_PRINT_TRACE
+        printf("# LSM6DSO trace recorded with ORIENTATION_PRINT_TRACE, ODR %lu Hz\n", fusion_sample_rate);
+        printf("# period %.7f\n", lp_imu_motion_sample_period());
+#endif // ORIENTATION_PRINT_TRACE
+    }
+    else if(fusionActive){
+
+        lp_imu_motion_stop();
+        fusionActive = false;
+        fusion_sample_rate = 0;
+        printf("Orientation fusion disabled\n");
+    }
+
+    tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+    orientationSnapshot = orientationFilter;
+    tx_semaphore_put(&lsm6dsoDataSemaphore);
+}
+
+// Run the accelerometer/gyroscope pairs waiting in the FIFO through the orientation filter, oldest first
+static void updateOrientation(void)
+{
+    uint16_t count;
+    bool overrun;
+    bool updated = false;
+
+    do{
+        count = lp_imu_read_motion(fusionPairs, FUSION_PAIRS_PER_READ, &overrun);
+
+        // The FIFO filled up and lost pairs, the gyroscope integration skips that time
+        if(overrun){
+            fusionOverruns++;
+            printf("Orientation fusion FIFO overrun %lu\n", fusionOverruns);
+#ifdef ORIENTATION_PRINT_TRACE
+            printf("# overrun\n");
+#endif // ORIENTATION_PRINT_TRACE
+        }
+
+        for(uint16_t i = 0; i < count; i++){
+            orientation_update(&orientationFilter, fusionPairs[i].angularRate.x, fusionPairs[i].angularRate.y, fusionPairs[i].angularRate.z,
+                                                   fusionPairs[i].acceleration.x, fusionPairs[i].acceleration.y, fusionPairs[i].acceleration.z);
+#ifdef ORIENTATION_PRINT_TRACE
+            printf("%.2f,%.2f,%.2f,%.1f,%.1f,%.1f\n", fusionPairs[i].angularRate.x, fusionPairs[i].angularRate.y,
+                   fusionPairs[i].angularRate.z, fusionPairs[i].acceleration.x, fusionPairs[i].acceleration.y,
+                   fusionPairs[i].acceleration.z);
+#endif // ORIENTATION_PRINT_TRACE
+            updated = true;
+        }
+    } while(count == FUSION_PAIRS_PER_READ);
+
+    if(!updated){
+        return;
+    }
+
+    // Grab the semaphore before updating the orientation and acceleration
+    tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+    orientationSnapshot = orientationFilter;
+    acceleration = fusionPairs[count > 0 ? count - 1 : FUSION_PAIRS_PER_READ - 1].acceleration;
+    tx_semaphore_put(&lsm6dsoDataSemaphore);
+}
+
+#ifdef LSM6DSO_INT1_GPIO
+// EINT handler for the LSM6DSO INT1 pin.  This runs in interrupt context, so just flag the event and wake
+// the read sensor thread, it owns the I2C bus and reads the event sources.
+static void lsm6dso_int1_handler(void)
+{
+    imuEventPending = true;
+    tx_thread_wait_abort(&thread_sensor_read);
+}
+#endif
+
+// This thread transforms spectrum captures handed over by the read sensor thread.  It runs at a lower priority
+// so the FIFO keeps being drained into the other capture buffer while a transform is in progress.
+void spectrum_thread_entry(ULONG thread_input)
+{
+    SpectrumResult result;
+    bool updated;
+
+    printf("Spectrum Task Started\n");
+
+    while (true){
+
+        tx_semaphore_get(&spectrumCaptureSemaphore, TX_WAIT_FOREVER);
+
+        tx_mutex_get(&spectrumMutex, TX_WAIT_FOREVER);
+        updated = spectrum_process(&result, LP_ACCEL_MG_PER_LSB);
+        tx_mutex_put(&spectrumMutex);
+
+        if(updated){
+
+            // Grab the semaphore before updating the spectrum result
+            tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+            spectrumResult = result;
+            tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+            tx_event_flags_set(&send_telemetry_event_flags_0, 0x01 << SPECTRUM_RESULT, TX_OR);
+        }
+    }
+}
+
 // only purpose in life is to initialize the hardware.
 void hardware_init_thread(ULONG thread_input)
 {
@@ -604,6 +1284,27 @@ bool initialize_hardware(void) {
 	bool status = (lp_imu_initialize());
 	tx_thread_sleep(MS_TO_TICK(100));
 
+	if (status) {
+		// Apply the event detector and FSM programs, then route the events they enable to INT1
+		for (uint32_t i = 0; i < lsm6dso_program_count; i++) {
+			if (!lp_imu_load_ucf(lsm6dso_programs[i].lines, lsm6dso_programs[i].length)) {
+				printf("Failed to load LSM6DSO program \"%s\"\n", lsm6dso_programs[i].name);
+			}
+		}
+
+		if (!lp_imu_route_events_int1()) {
+			printf("Failed to route LSM6DSO events to INT1\n");
+		}
+
+#ifdef LSM6DSO_INT1_GPIO
+		mtk_os_hal_gpio_set_direction((os_hal_gpio_pin)LSM6DSO_INT1_GPIO, OS_HAL_GPIO_DIR_INPUT);
+		mtk_os_hal_eint_register((eint_number)LSM6DSO_INT1_GPIO, HAL_EINT_EDGE_RISING, lsm6dso_int1_handler);
+
+		// INT1 may have latched before the handler was registered, read the sources once to release it
+		imuEventPending = true;
+#endif
+	}
+
 	if (status) {
 		// Prime the sensors.  We have 
 		// observed the first few readings on startup may return NaN
@@ -617,3 +1318,203 @@ bool initialize_hardware(void) {
 
 return status;
 }
+
+void sendFeatureVector(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+    IC_LSM6DSO_AXIS_FEATURES *axisFeatures[VF_AXES];
+
+    // Start from a clean message, then copy the header from the last incomming message
+    memset(mbox_local_buf, 0x00, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+    for(int i = 0; i < COMMAND_BLOCK_OFFSET; i++){
+        payloadPtrOutgoing->highLevelAppComponentID[i] = messageHeader[i];
+    }
+
+    payloadPtrOutgoing->payload.cmd = IC_LSM6DSO_FEATURE_VECTOR;
+    payloadPtrOutgoing->payload.featureSampleRate = feature_sample_rate;
+
+    axisFeatures[0] = &payloadPtrOutgoing->payload.featureX;
+    axisFeatures[1] = &payloadPtrOutgoing->payload.featureY;
+    axisFeatures[2] = &payloadPtrOutgoing->payload.featureZ;
+
+    // Grab the semaphore before reading the feature vector
+    tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+
+    payloadPtrOutgoing->payload.featureWindowSize = vibrationFeatures.windowSamples;
+    payloadPtrOutgoing->payload.featureSequence = vibrationFeatures.sequence;
+    payloadPtrOutgoing->payload.featureCyclesPerSample = vibrationFeatures.cyclesPerSample;
+
+    for(int axis = 0; axis < VF_AXES; axis++){
+        axisFeatures[axis]->mean = vibrationFeatures.axis[axis].mean;
+        axisFeatures[axis]->rms = vibrationFeatures.axis[axis].rms;
+        axisFeatures[axis]->peak = vibrationFeatures.axis[axis].peak;
+        axisFeatures[axis]->crestFactor = vibrationFeatures.axis[axis].crestFactor;
+        axisFeatures[axis]->kurtosis = vibrationFeatures.axis[axis].kurtosis;
+    }
+
+    // Release the semaphore
+    tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+    printf("Sending feature vector %lu (%lu cycles/sample)\n", payloadPtrOutgoing->payload.featureSequence,
+                                                               payloadPtrOutgoing->payload.featureCyclesPerSample);
+
+    /* Write to the high level application, enqueue to mailbox */
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, payloadPtrOutgoing, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
+void sendSpectrum(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+
+    // Start from a clean message, then copy the header from the last incomming message
+    memset(mbox_local_buf, 0x00, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+    for(int i = 0; i < COMMAND_BLOCK_OFFSET; i++){
+        payloadPtrOutgoing->highLevelAppComponentID[i] = messageHeader[i];
+    }
+
+    payloadPtrOutgoing->payload.cmd = IC_LSM6DSO_SPECTRUM;
+    payloadPtrOutgoing->payload.featureSampleRate = feature_sample_rate;
+
+    // Grab the semaphore before reading the spectrum result
+    tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+
+    payloadPtrOutgoing->payload.spectrumFftSize = spectrumResult.fftSize;
+    payloadPtrOutgoing->payload.spectrumAxis = spectrumResult.axis;
+    payloadPtrOutgoing->payload.spectrumSequence = spectrumResult.sequence;
+    payloadPtrOutgoing->payload.spectrumTransformCycles = spectrumResult.transformCycles;
+    payloadPtrOutgoing->payload.spectrumOverruns = spectrumResult.overruns;
+    payloadPtrOutgoing->payload.spectrumBinHz = spectrumResult.binHz;
+
+    for(int band = 0; band < IC_LSM6DSO_SPECTRUM_BANDS; band++){
+        payloadPtrOutgoing->payload.spectrumBandEnergy[band] = spectrumResult.bandEnergy[band];
+    }
+
+    for(int peak = 0; peak < IC_LSM6DSO_SPECTRUM_PEAKS; peak++){
+        payloadPtrOutgoing->payload.spectrumPeaks[peak].frequencyHz = spectrumResult.peaks[peak].frequencyHz;
+        payloadPtrOutgoing->payload.spectrumPeaks[peak].amplitude = spectrumResult.peaks[peak].amplitude;
+    }
+
+    // Release the semaphore
+    tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+    printf("Sending spectrum %lu (%lu cycles/transform)\n", payloadPtrOutgoing->payload.spectrumSequence,
+                                                            payloadPtrOutgoing->payload.spectrumTransformCycles);
+
+    /* Write to the high level application, enqueue to mailbox */
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, payloadPtrOutgoing, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
+void sendImuEvent(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+
+    // Start from a clean message, then copy the header from the last incomming message
+    memset(mbox_local_buf, 0x00, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+    for(int i = 0; i < COMMAND_BLOCK_OFFSET; i++){
+        payloadPtrOutgoing->highLevelAppComponentID[i] = messageHeader[i];
+    }
+
+    payloadPtrOutgoing->payload.cmd = IC_LSM6DSO_EVENT;
+
+    // Grab the semaphore, take the pending events and start collecting new ones
+    tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+
+    payloadPtrOutgoing->payload.eventSequence = imuEventSequence;
+    payloadPtrOutgoing->payload.eventFlags = imuEventFlags;
+    payloadPtrOutgoing->payload.eventFsmStatus = imuEventFsmStatus;
+    memcpy(payloadPtrOutgoing->payload.eventFsmOutputs, imuEventFsmOutputs, sizeof(imuEventFsmOutputs));
+
+    // Keep the activity state, it describes the device rather than an event
+    imuEventFlags &= IC_LSM6DSO_EVENT_INACTIVE;
+    imuEventFsmStatus = 0;
+
+    // Release the semaphore
+    tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+    printf("Sending LSM6DSO event %lu, flags 0x%04lX, FSM 0x%04X\n", payloadPtrOutgoing->payload.eventSequence,
+                                                                    payloadPtrOutgoing->payload.eventFlags,
+                                                                    payloadPtrOutgoing->payload.eventFsmStatus);
+
+    /* Write to the high level application, enqueue to mailbox */
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, payloadPtrOutgoing, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
+void sendCalibrationResult(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size, INTER_CORE_CMD_LSM6DSO cmd){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+
+    // Start from a clean message, then copy the header from the last incomming message
+    memset(mbox_local_buf, 0x00, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+    for(int i = 0; i < COMMAND_BLOCK_OFFSET; i++){
+        payloadPtrOutgoing->highLevelAppComponentID[i] = messageHeader[i];
+    }
+
+    payloadPtrOutgoing->payload.cmd = cmd;
+
+    // Grab the semaphore before reading the results
+    tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+
+    if(cmd == IC_LSM6DSO_SELF_TEST){
+        payloadPtrOutgoing->payload.calibrationStatus = imuSelfTestStatus;
+        payloadPtrOutgoing->payload.selfTestAccelPass = imuSelfTest.accelPass;
+        payloadPtrOutgoing->payload.selfTestGyroPass = imuSelfTest.gyroPass;
+        for(int axis = 0; axis < 3; axis++){
+            payloadPtrOutgoing->payload.selfTestAccelDeltaMg[axis] = imuSelfTest.accelDeltaMg[axis];
+            payloadPtrOutgoing->payload.selfTestGyroDeltaDps[axis] = imuSelfTest.gyroDeltaDps[axis];
+        }
+    }
+    else{
+        payloadPtrOutgoing->payload.calibrationStatus = imuCalibrationStatus;
+    }
+
+    // Always report the calibration in use
+    for(int axis = 0; axis < 3; axis++){
+        payloadPtrOutgoing->payload.calibration.gyroBias[axis] = imuCalibration.gyroBias[axis];
+        payloadPtrOutgoing->payload.calibration.accelOffset[axis] = imuCalibration.accelOffset[axis];
+    }
+    payloadPtrOutgoing->payload.calibration.accelOffsetHighWeight = imuCalibration.accelOffsetHighWeight;
+
+    // Release the semaphore
+    tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+    if(cmd == IC_LSM6DSO_SELF_TEST){
+        printf("LSM6DSO self test: accelerometer %s, gyroscope %s\n", payloadPtrOutgoing->payload.selfTestAccelPass ? "PASS" : "FAIL",
+                                                                     payloadPtrOutgoing->payload.selfTestGyroPass ? "PASS" : "FAIL");
+    }
+    else{
+        printf("LSM6DSO calibration %s\n", payloadPtrOutgoing->payload.calibrationStatus ? "complete" : "failed");
+    }
+
+    /* Write to the high level application, enqueue to mailbox */
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, payloadPtrOutgoing, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
+// Copy the latest orientation estimate into an outgoing message
+void readOrientation(IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing){
+
+    OrientationFilter snapshot;
+    float roll;
+    float pitch;
+    float yaw;
+
+    // Grab the semaphore to get a consistent snapshot, the angles are computed outside of it
+    tx_semaphore_get(&lsm6dsoDataSemaphore, TX_WAIT_FOREVER);
+    snapshot = orientationSnapshot;
+    tx_semaphore_put(&lsm6dsoDataSemaphore);
+
+    orientation_get_euler(&snapshot, &roll, &pitch, &yaw);
+
+    payloadPtrOutgoing->payload.fusionSampleRate = fusion_sample_rate;
+    payloadPtrOutgoing->payload.fusionBeta = fusion_beta;
+    payloadPtrOutgoing->payload.fusionQuatW = snapshot.q.w;
+    payloadPtrOutgoing->payload.fusionQuatX = snapshot.q.x;
+    payloadPtrOutgoing->payload.fusionQuatY = snapshot.q.y;
+    payloadPtrOutgoing->payload.fusionQuatZ = snapshot.q.z;
+    payloadPtrOutgoing->payload.fusionRoll = roll;
+    payloadPtrOutgoing->payload.fusionPitch = pitch;
+    payloadPtrOutgoing->payload.fusionYaw = yaw;
+    payloadPtrOutgoing->payload.fusionTilt = orientation_get_tilt(&snapshot);
+    payloadPtrOutgoing->payload.fusionUpdates = snapshot.updates;
+    payloadPtrOutgoing->payload.fusionCyclesPerUpdate = snapshot.lastCycles;
+    payloadPtrOutgoing->payload.fusionMaxCyclesPerUpdate = snapshot.maxCycles;
+}
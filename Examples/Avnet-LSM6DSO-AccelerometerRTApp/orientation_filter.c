@@ -0,0 +1,155 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include <math.h>
+#include "orientation_filter.h"
+#include "cycle_counter.h"
+
+#define ORIENTATION_DEG_TO_RAD 0.0174532925f
+#define ORIENTATION_RAD_TO_DEG 57.2957795f
+
+void orientation_init(OrientationFilter* filter, float sampleRateHz, float beta)
+{
+    filter->q.w = 1.0f;
+    filter->q.x = 0.0f;
+    filter->q.y = 0.0f;
+    filter->q.z = 0.0f;
+    filter->beta = (beta > 0.0f) ? beta : ORIENTATION_DEFAULT_BETA;
+    filter->samplePeriod = 1.0f / sampleRateHz;
+    filter->initialized = false;
+    filter->updates = 0;
+    filter->lastCycles = 0;
+    filter->maxCycles = 0;
+}
+
+// Start from the roll and pitch given by gravity, so the filter does not have to converge from an
+// arbitrary orientation at the gain beta
+static void orientation_align(OrientationFilter* filter, float ax, float ay, float az)
+{
+    float halfRoll = 0.5f * atan2f(ay, az);
+    float halfPitch = 0.5f * atan2f(-ax, sqrtf(ay * ay + az * az));
+    float cr = cosf(halfRoll);
+    float sr = sinf(halfRoll);
+    float cp = cosf(halfPitch);
+    float sp = sinf(halfPitch);
+
+    filter->q.w = cr * cp;
+    filter->q.x = sr * cp;
+    filter->q.y = cr * sp;
+    filter->q.z = -sr * sp;
+    filter->initialized = true;
+}
+
+void orientation_update(OrientationFilter* filter, float gx, float gy, float gz, float ax, float ay, float az)
+{
+    uint32_t start = cycle_counter_get();
+    float q0 = filter->q.w;
+    float q1 = filter->q.x;
+    float q2 = filter->q.y;
+    float q3 = filter->q.z;
+    float accelNormSquared = ax * ax + ay * ay + az * az;
+
+    if (!filter->initialized && (accelNormSquared > 0.0f)) {
+        orientation_align(filter, ax, ay, az);
+        return;
+    }
+
+    gx *= ORIENTATION_DEG_TO_RAD;
+    gy *= ORIENTATION_DEG_TO_RAD;
+    gz *= ORIENTATION_DEG_TO_RAD;
+
+    // Rate of change of the quaternion from the gyroscope
+    float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    // Gradient descent step towards the orientation where gravity lines up with the accelerometer,
+    // skipped when the accelerometer reads zero (free fall)
+    if (accelNormSquared > 0.0f) {
+
+        float recipNorm = 1.0f / sqrtf(accelNormSquared);
+        ax *= recipNorm;
+        ay *= recipNorm;
+        az *= recipNorm;
+
+        float _2q0 = 2.0f * q0;
+        float _2q1 = 2.0f * q1;
+        float _2q2 = 2.0f * q2;
+        float _2q3 = 2.0f * q3;
+        float _4q0 = 4.0f * q0;
+        float _4q1 = 4.0f * q1;
+        float _4q2 = 4.0f * q2;
+        float _8q1 = 8.0f * q1;
+        float _8q2 = 8.0f * q2;
+        float q0q0 = q0 * q0;
+        float q1q1 = q1 * q1;
+        float q2q2 = q2 * q2;
+        float q3q3 = q3 * q3;
+
+        float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+        float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+        float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+        float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+        float stepNormSquared = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+
+        if (stepNormSquared > 0.0f) {
+            recipNorm = filter->beta / sqrtf(stepNormSquared);
+            qDot0 -= s0 * recipNorm;
+            qDot1 -= s1 * recipNorm;
+            qDot2 -= s2 * recipNorm;
+            qDot3 -= s3 * recipNorm;
+        }
+    }
+
+    q0 += qDot0 * filter->samplePeriod;
+    q1 += qDot1 * filter->samplePeriod;
+    q2 += qDot2 * filter->samplePeriod;
+    q3 += qDot3 * filter->samplePeriod;
+
+    float recipNorm = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    filter->q.w = q0 * recipNorm;
+    filter->q.x = q1 * recipNorm;
+    filter->q.y = q2 * recipNorm;
+    filter->q.z = q3 * recipNorm;
+
+    filter->updates++;
+    filter->lastCycles = cycle_counter_get() - start;
+    if (filter->lastCycles > filter->maxCycles) {
+        filter->maxCycles = filter->lastCycles;
+    }
+}
+
+void orientation_get_euler(const OrientationFilter* filter, float* roll, float* pitch, float* yaw)
+{
+    const Quaternion* q = &filter->q;
+    float sinPitch = 2.0f * (q->w * q->y - q->z * q->x);
+
+    if (sinPitch > 1.0f) {
+        sinPitch = 1.0f;
+    }
+    if (sinPitch < -1.0f) {
+        sinPitch = -1.0f;
+    }
+
+    *roll = atan2f(2.0f * (q->w * q->x + q->y * q->z), 1.0f - 2.0f * (q->x * q->x + q->y * q->y)) * ORIENTATION_RAD_TO_DEG;
+    *pitch = asinf(sinPitch) * ORIENTATION_RAD_TO_DEG;
+    *yaw = atan2f(2.0f * (q->w * q->z + q->x * q->y), 1.0f - 2.0f * (q->y * q->y + q->z * q->z)) * ORIENTATION_RAD_TO_DEG;
+}
+
+float orientation_get_tilt(const OrientationFilter* filter)
+{
+    const Quaternion* q = &filter->q;
+
+    // Z component of the sensor Z axis expressed in the earth frame
+    float cosTilt = 1.0f - 2.0f * (q->x * q->x + q->y * q->y);
+
+    if (cosTilt > 1.0f) {
+        cosTilt = 1.0f;
+    }
+    if (cosTilt < -1.0f) {
+        cosTilt = -1.0f;
+    }
+
+    return acosf(cosTilt) * ORIENTATION_RAD_TO_DEG;
+}
@@ -0,0 +1,44 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Madgwick gradient descent orientation filter for a 6 axis IMU (accelerometer + gyroscope).  One
+// update is about a hundred single precision operations on the M4 FPU, well below the budget for
+// the 417Hz LSM6DSO output data rate.  Yaw is the integrated gyroscope heading, there is no
+// magnetometer to correct its drift.
+
+#define ORIENTATION_DEFAULT_BETA 0.1f
+
+typedef struct
+{
+    float w;
+    float x;
+    float y;
+    float z;
+} Quaternion;
+
+typedef struct
+{
+    Quaternion q;
+    float beta;                 // Accelerometer correction gain, higher converges faster but is noisier
+    float samplePeriod;         // s
+    bool initialized;           // false until the first sample aligned q with gravity
+    uint32_t updates;
+    uint32_t lastCycles;        // DWT cycles spent in the last update
+    uint32_t maxCycles;
+} OrientationFilter;
+
+void orientation_init(OrientationFilter* filter, float sampleRateHz, float beta);
+
+// Gyroscope in degrees/second, accelerometer in any unit (only the direction is used)
+void orientation_update(OrientationFilter* filter, float gx, float gy, float gz, float ax, float ay, float az);
+
+// Roll, pitch and yaw in degrees (aerospace sequence, Z-Y-X)
+void orientation_get_euler(const OrientationFilter* filter, float* roll, float* pitch, float* yaw);
+
+// Angle between the sensor Z axis and vertical, in degrees
+float orientation_get_tilt(const OrientationFilter* filter);
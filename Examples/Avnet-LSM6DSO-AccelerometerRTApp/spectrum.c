@@ -0,0 +1,329 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include <math.h>
+#include "spectrum.h"
+#include "cycle_counter.h"
+
+#define SPECTRUM_PI 3.14159265358979f
+#define SPECTRUM_MAX_BINS (SPECTRUM_MAX_FFT / 2 + 1)
+
+typedef struct
+{
+    float re;
+    float im;
+} complex_f32;
+
+// Ping-pong capture buffers.  The capture side only ever writes captureActive, the processing side
+// only reads captureReady; captureReady is handed back by setting it to -1 once the transform is done.
+static int16_t capture[2][SPECTRUM_MAX_FFT];
+static uint16_t captureFill = 0;
+static uint8_t captureActive = 0;
+static volatile int8_t captureReady = -1;
+static uint32_t captureOverruns = 0;
+
+// Tables and scratch for the current FFT size
+static float hannWindow[SPECTRUM_MAX_FFT];
+static complex_f32 twiddle[SPECTRUM_MAX_FFT / 2];      // e^(-j*2*pi*k/N), k < N/2
+static complex_f32 work[SPECTRUM_MAX_FFT / 2];         // N/2 point complex FFT of the packed real input
+static float power[SPECTRUM_MAX_BINS];                 // one-sided power spectrum, LSB^2
+static float windowCoherentGain;
+static float windowPowerGain;
+
+// Configuration
+static uint16_t fftSize = 0;
+static uint8_t fftLog2Half = 0;
+static uint8_t captureAxis = 0;
+static float binHz = 0.0f;
+static uint8_t bandCount = 0;
+static uint16_t bandStartBin[SPECTRUM_MAX_BANDS];
+static uint16_t bandEndBin[SPECTRUM_MAX_BANDS];
+static uint8_t peakCount = 0;
+static uint32_t resultSequence = 0;
+
+bool spectrum_configure(uint16_t size, uint8_t axis, float sampleRateHz, const uint16_t* bandEdgesHz,
+                        uint8_t bands, uint8_t peaks)
+{
+    float sumWindow = 0.0f;
+    float sumWindowSquared = 0.0f;
+
+    if (((size != 256) && (size != 512) && (size != 1024)) || (axis > 2) || (sampleRateHz <= 0.0f) ||
+        (bands > SPECTRUM_MAX_BANDS) || (peaks > SPECTRUM_MAX_PEAKS)) {
+        return false;
+    }
+
+    fftSize = size;
+    captureAxis = axis;
+    binHz = sampleRateHz / size;
+    peakCount = peaks;
+
+    fftLog2Half = 0;
+    while ((1U << fftLog2Half) < (size / 2U)) {
+        fftLog2Half++;
+    }
+
+    // Hann window and the gains used to scale the spectrum back to signal units
+    for (uint16_t n = 0; n < size; n++) {
+        hannWindow[n] = 0.5f - 0.5f * cosf(2.0f * SPECTRUM_PI * n / size);
+        sumWindow += hannWindow[n];
+        sumWindowSquared += hannWindow[n] * hannWindow[n];
+    }
+    windowCoherentGain = sumWindow / size;
+    windowPowerGain = sumWindowSquared / size;
+
+    for (uint16_t k = 0; k < size / 2; k++) {
+        twiddle[k].re = cosf(2.0f * SPECTRUM_PI * k / size);
+        twiddle[k].im = -sinf(2.0f * SPECTRUM_PI * k / size);
+    }
+
+    // Convert band edges to bin ranges, bin k covers frequency k * binHz
+    bandCount = 0;
+    for (uint8_t i = 0; (bandEdgesHz != NULL) && (i < bands); i++) {
+        if (bandEdgesHz[i + 1] <= bandEdgesHz[i]) {
+            break;
+        }
+
+        uint32_t start = (uint32_t)ceilf(bandEdgesHz[i] / binHz);
+        uint32_t end = (uint32_t)ceilf(bandEdgesHz[i + 1] / binHz);
+        bandStartBin[i] = (start < size / 2U + 1U) ? start : size / 2U + 1U;
+        bandEndBin[i] = (end < size / 2U + 1U) ? end : size / 2U + 1U;
+        bandCount++;
+    }
+
+    // Restart capturing with the new size
+    captureFill = 0;
+    captureReady = -1;
+    captureOverruns = 0;
+
+    return true;
+}
+
+uint16_t spectrum_get_fft_size(void)
+{
+    return fftSize;
+}
+
+bool spectrum_push(const AccelerationRaw* samples, uint16_t count)
+{
+    bool handedOver = false;
+
+    if (fftSize == 0) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+
+        capture[captureActive][captureFill++] = ((const int16_t*)&samples[i])[captureAxis];
+
+        if (captureFill == fftSize) {
+            captureFill = 0;
+
+            // Hand the full buffer over if the previous one was consumed, otherwise drop this capture
+            // and refill the same buffer
+            if (captureReady < 0) {
+                captureReady = (int8_t)captureActive;
+                captureActive ^= 1;
+                handedOver = true;
+            }
+            else {
+                captureOverruns++;
+            }
+        }
+    }
+
+    return handedOver;
+}
+
+static uint16_t bit_reverse(uint16_t value, uint8_t bits)
+{
+    uint16_t reversed = 0;
+
+    for (uint8_t i = 0; i < bits; i++) {
+        reversed = (reversed << 1) | (value & 1);
+        value >>= 1;
+    }
+
+    return reversed;
+}
+
+// Remove the mean, apply the window and pack even/odd samples into the real/imaginary parts of an
+// N/2 point complex sequence, stored in bit reversed order for the in-place FFT.
+static void window_and_pack(const int16_t* x)
+{
+    int32_t sum = 0;
+
+    for (uint16_t n = 0; n < fftSize; n++) {
+        sum += x[n];
+    }
+    float mean = (float)sum / fftSize;
+
+    for (uint16_t m = 0; m < fftSize / 2; m++) {
+        complex_f32* dst = &work[bit_reverse(m, fftLog2Half)];
+        dst->re = ((float)x[2 * m] - mean) * hannWindow[2 * m];
+        dst->im = ((float)x[2 * m + 1] - mean) * hannWindow[2 * m + 1];
+    }
+}
+
+// Iterative radix-2 decimation in time FFT of N/2 points
+static void complex_fft(void)
+{
+    uint16_t points = fftSize / 2;
+
+    for (uint16_t size = 2; size <= points; size <<= 1) {
+
+        uint16_t half = size / 2;
+
+        // W_(size)^k == W_N^(k * N / size), taken from the N point table
+        uint16_t stride = fftSize / size;
+
+        for (uint16_t k = 0; k < half; k++) {
+
+            complex_f32 w = twiddle[k * stride];
+
+            for (uint16_t start = 0; start < points; start += size) {
+                complex_f32* a = &work[start + k];
+                complex_f32* b = &work[start + k + half];
+                float tre = b->re * w.re - b->im * w.im;
+                float tim = b->re * w.im + b->im * w.re;
+
+                b->re = a->re - tre;
+                b->im = a->im - tim;
+                a->re += tre;
+                a->im += tim;
+            }
+        }
+    }
+}
+
+// Split the N/2 point complex FFT into the N point real FFT and produce the one-sided power spectrum,
+// normalized so that the sum of all bins equals the mean square of the windowed signal.
+static void real_power_spectrum(void)
+{
+    uint16_t points = fftSize / 2;
+    float norm = 1.0f / ((float)fftSize * (float)fftSize);
+
+    for (uint16_t k = 0; k <= points; k++) {
+
+        complex_f32 zk = work[k % points];
+        complex_f32 zc = work[(points - k) % points];
+
+        // Even part E = (Z[k] + conj(Z[N/2-k])) / 2, odd part O = -j (Z[k] - conj(Z[N/2-k])) / 2
+        float ere = 0.5f * (zk.re + zc.re);
+        float eim = 0.5f * (zk.im - zc.im);
+        float ore = 0.5f * (zk.im + zc.im);
+        float oim = -0.5f * (zk.re - zc.re);
+
+        // X[k] = E + W_N^k * O, with W_N^(N/2) == -1
+        float wre = (k < points) ? twiddle[k].re : -1.0f;
+        float wim = (k < points) ? twiddle[k].im : 0.0f;
+        float xre = ere + wre * ore - wim * oim;
+        float xim = eim + wre * oim + wim * ore;
+
+        float scale = ((k == 0) || (k == points)) ? norm : 2.0f * norm;
+        power[k] = (xre * xre + xim * xim) * scale;
+    }
+}
+
+static void find_peaks(SpectrumResult* result, float mgPerLsb)
+{
+    uint16_t points = fftSize / 2;
+    uint16_t peakBin[SPECTRUM_MAX_PEAKS];
+    uint8_t found = 0;
+
+    // Keep the largest local maxima, sorted largest first
+    for (uint16_t k = 1; k < points; k++) {
+
+        if ((power[k] <= power[k - 1]) || (power[k] < power[k + 1])) {
+            continue;
+        }
+
+        uint8_t slot = found;
+        while ((slot > 0) && (power[peakBin[slot - 1]] < power[k])) {
+            if (slot < peakCount) {
+                peakBin[slot] = peakBin[slot - 1];
+            }
+            slot--;
+        }
+        if (slot < peakCount) {
+            peakBin[slot] = k;
+            if (found < peakCount) {
+                found++;
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < found; i++) {
+
+        // Interpolation for the Hann window (Grandke): with r the ratio of the larger neighbour to the
+        // peak bin magnitude, the tone sits (2r - 1) / (r + 1) bins towards that neighbour, where the
+        // main lobe has dropped to sinc(delta) / (1 - delta^2) of its height.  Exact for a single tone.
+        uint16_t k = peakBin[i];
+        float a = sqrtf(power[k - 1]);
+        float b = sqrtf(power[k]);
+        float c = sqrtf(power[k + 1]);
+        float ratio = (b > 0.0f) ? ((c > a) ? c : a) / b : 0.0f;
+        float delta = (2.0f * ratio - 1.0f) / (ratio + 1.0f);
+        if (delta < 0.0f) {
+            delta = 0.0f;
+        }
+        float gain = (delta > 1e-4f) ? sinf(SPECTRUM_PI * delta) / (SPECTRUM_PI * delta) / (1.0f - delta * delta) : 1.0f;
+        float magnitude = b / gain;
+        if (c < a) {
+            delta = -delta;
+        }
+
+        // A one-sided bin holds (A * CG)^2 / 2 for a sinusoid of amplitude A
+        result->peaks[i].frequencyHz = (k + delta) * binHz;
+        result->peaks[i].amplitude = sqrtf(2.0f) * magnitude / windowCoherentGain * mgPerLsb;
+    }
+    for (uint8_t i = found; i < SPECTRUM_MAX_PEAKS; i++) {
+        result->peaks[i].frequencyHz = 0.0f;
+        result->peaks[i].amplitude = 0.0f;
+    }
+
+    result->peakCount = found;
+}
+
+bool spectrum_process(SpectrumResult* result, float mgPerLsb)
+{
+    int8_t ready = captureReady;
+
+    if ((ready < 0) || (fftSize == 0)) {
+        return false;
+    }
+
+    uint32_t start = cycle_counter_get();
+
+    window_and_pack(capture[ready]);
+
+    // The capture buffer is free again as soon as it has been packed into the FFT work area
+    captureReady = -1;
+
+    complex_fft();
+    real_power_spectrum();
+
+    result->transformCycles = cycle_counter_get() - start;
+
+    for (uint8_t band = 0; band < SPECTRUM_MAX_BANDS; band++) {
+
+        float energy = 0.0f;
+
+        for (uint16_t k = (band < bandCount) ? bandStartBin[band] : 0; (band < bandCount) && (k < bandEndBin[band]); k++) {
+            energy += power[k];
+        }
+
+        // Undo the window power loss so the band energy is the mean square of the signal in that band
+        result->bandEnergy[band] = energy / windowPowerGain * mgPerLsb * mgPerLsb;
+    }
+
+    find_peaks(result, mgPerLsb);
+
+    result->sequence = ++resultSequence;
+    result->fftSize = fftSize;
+    result->axis = captureAxis;
+    result->bandCount = bandCount;
+    result->binHz = binHz;
+    result->overruns = captureOverruns;
+
+    return true;
+}
@@ -0,0 +1,53 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "./IMU_lib/imu_temp_pressure.h"
+
+// Spectral analysis of one accelerometer axis on the M4.  Samples are captured into one half of a
+// ping-pong buffer while the other half is windowed (Hann) and transformed with a single precision
+// real FFT on the M4 FPU.  The result is reduced to the energy in a set of frequency bands and the
+// largest spectral peaks.  All buffers and tables are statically allocated and land in TCM with the
+// rest of .bss (see linker.ld), which keeps the FFT butterflies at zero wait states.
+
+#define SPECTRUM_MIN_FFT 256
+#define SPECTRUM_MAX_FFT 1024
+#define SPECTRUM_MAX_BANDS 8
+#define SPECTRUM_MAX_PEAKS 5
+
+typedef struct
+{
+    float frequencyHz;  // Peak frequency, refined with parabolic interpolation
+    float amplitude;    // Amplitude of the sinusoid at the peak, mg
+} SpectrumPeak;
+
+typedef struct
+{
+    uint32_t sequence;                          // increments for every transform
+    uint16_t fftSize;
+    uint8_t axis;
+    uint8_t bandCount;
+    uint8_t peakCount;
+    float binHz;
+    uint32_t transformCycles;                   // DWT cycles for window + FFT + power spectrum
+    uint32_t overruns;                          // captures dropped because the previous one was still in use
+    float bandEnergy[SPECTRUM_MAX_BANDS];       // mean square acceleration in each band, mg^2
+    SpectrumPeak peaks[SPECTRUM_MAX_PEAKS];     // largest peaks first
+} SpectrumResult;
+
+// Configure the analysis.  fftSize must be 256, 512 or 1024; bandEdgesHz holds bandCount + 1
+// ascending edges, band i covers [bandEdgesHz[i], bandEdgesHz[i + 1]).  Returns false if the
+// configuration is rejected.  Any capture in progress is discarded.
+bool spectrum_configure(uint16_t fftSize, uint8_t axis, float sampleRateHz, const uint16_t* bandEdgesHz,
+                        uint8_t bandCount, uint8_t peakCount);
+uint16_t spectrum_get_fft_size(void);
+
+// Capture side: append samples to the active capture buffer.  Returns true when a capture
+// completed and was handed over for processing.
+bool spectrum_push(const AccelerationRaw* samples, uint16_t count);
+
+// Processing side: transform the captured buffer, if any.  Returns true when result was updated.
+bool spectrum_process(SpectrumResult* result, float mgPerLsb);
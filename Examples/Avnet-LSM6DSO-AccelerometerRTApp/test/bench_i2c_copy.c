@@ -0,0 +1,92 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host benchmark for the copy the FIFO bursts no longer make.  Before the I2C buffers moved to SYSRAM every
+// read went into i2c_rx_buf (I2C_MAX_LEN 64) and was copied to the caller, a burst was at most 9 words (63
+// bytes) in a stack buffer.  Now the DMA writes up to 36 words (252 bytes) straight into fifo_burst and
+// nothing is copied, the register reads into other buffers still bounce.
+//
+// 36 words are copied with the old bursts (4 x 63 bytes) and in one 252 byte bounce, with the host memcpy()
+// and with a byte loop like the size optimized memcpy() of newlib-nano, which the M4 build links
+// (-specs=nano.specs).  These are host times, not M4 cycles: with IMU_I2C_STATS defined the application
+// reports the cycles the M4 spends in the bounce copies.
+//
+//   ./out/bench_i2c_copy
+
+#include <stdint.h>
+#include <string.h>
+#include "host_test.h"
+
+#define PASSES 2000000
+
+#define FIFO_WORD_LEN 7                             // As in imu_temp_pressure.c
+#define OLD_WORDS_PER_BURST (64 / FIFO_WORD_LEN)    // I2C_MAX_LEN was 64
+#define NEW_WORDS_PER_BURST (256 / FIFO_WORD_LEN)
+
+static uint8_t bounce[256];
+static uint8_t samples[256];
+
+// newlib-nano's memcpy() when it is built for size, the bench is built without vectorizing so it stays a byte
+// loop
+static void* byte_copy(void* dst, const void* src, size_t len)
+{
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+
+    while (len--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
+
+static void* (*volatile copy_fn)(void*, const void*, size_t);
+
+// ns to copy NEW_WORDS_PER_BURST words in bursts of words, the best of a few runs
+static double time_copy(void* (*fn)(void*, const void*, size_t), int words)
+{
+    int bursts = NEW_WORDS_PER_BURST / words;
+    double best = 1e30;
+
+    copy_fn = fn;
+    for (int run = 0; run < 5; run++) {
+        double start = host_time_ns();
+        for (int pass = 0; pass < PASSES; pass++) {
+            for (int burst = 0; burst < bursts; burst++) {
+                copy_fn(&samples[burst * words * FIFO_WORD_LEN], bounce, words * FIFO_WORD_LEN);
+            }
+        }
+        double ns = (host_time_ns() - start) / PASSES;
+        best = (ns < best) ? ns : best;
+    }
+    return best;
+}
+
+int main(void)
+{
+    static const struct
+    {
+        const char* name;
+        void* (*fn)(void*, const void*, size_t);
+    } copies[] = {
+        {"memcpy", memcpy},
+        {"byte loop", byte_copy},
+    };
+    const int bytes = NEW_WORDS_PER_BURST * FIFO_WORD_LEN;
+
+    for (int i = 0; i < (int)sizeof(bounce); i++) {
+        bounce[i] = (uint8_t)i;
+    }
+
+    printf("Copy of %d FIFO words (%d bytes), host ns\n\n", NEW_WORDS_PER_BURST, bytes);
+    printf("%-10s %24s %24s %13s\n", "", "old: 4 x 63 byte bursts", "one 252 byte bounce", "direct (now)");
+    for (size_t i = 0; i < sizeof(copies) / sizeof(copies[0]); i++) {
+        double oldNs = time_copy(copies[i].fn, OLD_WORDS_PER_BURST);
+        double bounceNs = time_copy(copies[i].fn, NEW_WORDS_PER_BURST);
+
+        printf("%-10s %11.1f (%6.3f/byte) %11.1f (%6.3f/byte) %13.1f\n", copies[i].name, oldNs, oldNs / bytes,
+               bounceNs, bounceNs / bytes, 0.0);
+        CHECK(memcmp(samples, bounce, bytes) == 0);
+    }
+
+    return host_test_result("bench_i2c_copy");
+}
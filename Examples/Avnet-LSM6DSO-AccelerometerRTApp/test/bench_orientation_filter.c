@@ -0,0 +1,40 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host replay and benchmark for the orientation filter.  Without arguments it replays a synthetic 417Hz trace,
+// with arguments it replays a recorded one:
+//
+//   bench_orientation_filter trace.csv <ODR Hz> <INTERNAL_FREQ_FINE>
+//
+// (CSV format in orientation_trace.h) and prints the error against the reference columns, if there are any,
+// and the time per update.  On the M4 the cycles of every update are sent in fusionCyclesPerUpdate.
+
+#include "orientation_trace.h"
+
+int main(int argc, char* argv[])
+{
+    Trace trace;
+
+    if (argc == 4) {
+
+        double period = 1.0 / (atof(argv[2]) * (1.0 + TRACE_FREQ_FINE_STEP * atoi(argv[3])));
+
+        if (!trace_load(argv[1], period, &trace)) {
+            printf("Can't read a trace from %s\n", argv[1]);
+            return 1;
+        }
+    }
+    else {
+
+        trace = trace_synthesize(60.0, 16, -20, 1, 0.0, 0.0, 0.0, 0.0);
+    }
+
+    ReplayResult result = trace_replay(&trace, ORIENTATION_DEFAULT_BETA, trace.samplePeriod, 2.0);
+
+    printf("%d pairs at %.1fHz\n", trace.count, 1.0 / trace.samplePeriod);
+    printf("tilt rms %.3f max %.3f deg, yaw max %.3f deg, %.1f ns/update\n",
+           result.rmsTilt, result.maxTilt, result.maxYaw, result.nsPerUpdate);
+
+    free(trace.records);
+    return 0;
+}
@@ -0,0 +1,45 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host benchmark for the spectrum kernel, the same window, FFT and band reduction that runs on the M4.
+// On the M4 the cycles of every transform are sent in spectrumTransformCycles.
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "spectrum.h"
+
+#define ITERATIONS 2000
+
+static AccelerationRaw samples[SPECTRUM_MAX_FFT];
+
+int main(void)
+{
+    const uint16_t sizes[] = {256, 512, 1024};
+    const uint16_t edges[] = {0, 10, 50, 100, 200, 400};
+    SpectrumResult result;
+
+    srand(1);
+    for (int i = 0; i < SPECTRUM_MAX_FFT; i++) {
+        samples[i].z = (int16_t)(16384 + rand() % 8000 - 4000);
+    }
+
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+
+        uint16_t n = sizes[s];
+        double elapsed = 0.0;
+
+        spectrum_configure(n, 2, 833.0f, edges, 5, 3);
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            spectrum_push(samples, n);
+
+            double start = host_time_ns();
+            spectrum_process(&result, LP_ACCEL_MG_PER_LSB);
+            elapsed += host_time_ns() - start;
+        }
+
+        printf("fft %4u: %.2f us/transform (window, FFT, power spectrum, bands and peaks)\n", n, elapsed / ITERATIONS / 1000.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host benchmark for the vibration feature kernels.  It runs the same source as the M4, reduced windows of
+// every size and prints the time per sample.  On the M4 the cycles per sample of every window are sent in
+// featureCyclesPerSample.
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "vibration_features.h"
+
+#define ITERATIONS 2000
+
+static AccelerationRaw samples[VF_MAX_WINDOW];
+
+int main(void)
+{
+    const uint16_t sizes[] = {64, 256, 1024};
+    VibrationFeatures features;
+
+    srand(1);
+    for (int i = 0; i < VF_MAX_WINDOW; i++) {
+        samples[i].x = (int16_t)(rand() % 8000 - 4000);
+        samples[i].y = (int16_t)(rand() % 8000 - 4000);
+        samples[i].z = (int16_t)(16384 + rand() % 8000 - 4000);
+    }
+
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+
+        uint16_t n = vf_set_window(sizes[s]);
+        double start = host_time_ns();
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            vf_push(samples, n);
+            vf_compute(&features, LP_ACCEL_MG_PER_LSB);
+        }
+
+        double elapsed = host_time_ns() - start;
+        printf("window %4u: %.2f ns/sample (push and reduce, 3 axes)\n", n, elapsed / ((double)ITERATIONS * n));
+    }
+
+    return 0;
+}
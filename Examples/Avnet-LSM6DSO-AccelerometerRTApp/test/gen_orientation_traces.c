@@ -0,0 +1,164 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Writes the modelled trace in test/traces, in the format the application prints with ORIENTATION_PRINT_TRACE.
+// It is not a recording: a board on a desk tilted and turned by hand is modelled with the LSM6DSO's resolution
+// at +-2g and +-2000dps, a gyroscope bias and an accelerometer offset in the range the datasheet gives
+// untrimmed parts, white noise, and an ODR 9 INTERNAL_FREQ_FINE steps off nominal.  It stands in for recordings
+// until traces of real boards are added next to it:
+//
+//   ./out/gen_orientation_traces traces
+
+#include "orientation_trace.h"
+
+#define GEN_COEFF_104HZ 64
+#define GEN_FREQ_FINE 9
+#define GEN_SECONDS 25.0
+#define GEN_RAMP 1.5                        // s a hand takes to tilt or turn the board
+
+#define GYRO_LSB 0.07                       // dps, 70mdps/LSB at +-2000dps
+#define GYRO_NOISE 0.03                     // dps rms
+#define ACCEL_LSB 0.061                     // mg, at +-2g
+#define ACCEL_NOISE 0.6                     // mg rms
+
+static const double gyroBias[3] = {0.35, -0.25, 0.15};
+static const double accelOffset[3] = {12.0, -8.0, 18.0};
+
+// Where the board is moved to, in degrees, it rests there until the next step
+typedef struct
+{
+    double start;                           // s
+    double roll;
+    double pitch;
+    double yaw;
+} Step;
+
+static const Step steps[] = {
+    {3.0, 30.0, 0.0, 0.0},                  // Tilt to the right and hold
+    {8.0, 0.0, 0.0, 0.0},                   // Back flat
+    {12.0, 0.0, -20.0, 0.0},                // Nose down and hold
+    {17.0, 0.0, 0.0, 0.0},                  // Back flat
+    {20.0, 0.0, 0.0, 90.0},                 // Turn a quarter on the desk
+};
+
+// The directives the replay checks, the level windows start once the filter has caught up with a step
+static const char* const directives[] = {
+    "# level 0.5 3 0 0 2",
+    "# heading 0.5 3 1",
+    "# level 6 8 30 0 2",
+    "# heading 6 8 1",
+    "# level 11 12 0 0 2",
+    "# level 15 17 0 -20 2",
+    "# heading 15 17 1",
+    "# level 20 22 0 0 2",
+    "# level 23.5 25 0 0 2",
+    "# heading 23.5 25 1",
+};
+
+// Euler angles at time t in radians, each step is a smooth ramp from the last
+static void gen_motion(double t, double* roll, double* pitch, double* yaw)
+{
+    double from[3] = {0.0, 0.0, 0.0};
+    double to[3] = {0.0, 0.0, 0.0};
+    double a = 0.0;
+
+    for (unsigned i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        if (t < steps[i].start) {
+            break;
+        }
+        from[0] = to[0];
+        from[1] = to[1];
+        from[2] = to[2];
+        to[0] = steps[i].roll;
+        to[1] = steps[i].pitch;
+        to[2] = steps[i].yaw;
+        a = fmin((t - steps[i].start) / GEN_RAMP, 1.0);
+        a = 0.5 - 0.5 * cos(TRACE_PI * a);
+        if (a >= 1.0) {
+            from[0] = to[0];
+            from[1] = to[1];
+            from[2] = to[2];
+        }
+    }
+
+    *roll = (from[0] + (to[0] - from[0]) * a) * TRACE_DEG;
+    *pitch = (from[1] + (to[1] - from[1]) * a) * TRACE_DEG;
+    *yaw = (from[2] + (to[2] - from[2]) * a) * TRACE_DEG;
+}
+
+static TraceQuaternion gen_attitude(double t)
+{
+    double roll, pitch, yaw;
+
+    gen_motion(t, &roll, &pitch, &yaw);
+
+    TraceQuaternion qz = {cos(yaw / 2), 0.0, 0.0, sin(yaw / 2)};
+    TraceQuaternion qy = {cos(pitch / 2), 0.0, sin(pitch / 2), 0.0};
+    TraceQuaternion qx = {cos(roll / 2), sin(roll / 2), 0.0, 0.0};
+    return trace_q_mul(trace_q_mul(qz, qy), qx);
+}
+
+static double gen_noise(double rms)
+{
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return rms * sqrt(-2.0 * log(u1)) * cos(2.0 * TRACE_PI * u2);
+}
+
+static double gen_quantize(double value, double lsb)
+{
+    return round(value / lsb) * lsb;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* dir = (argc > 1) ? argv[1] : ".";
+    double period = GEN_COEFF_104HZ / (TRACE_ODR_BASE_HZ * (1.0 + TRACE_FREQ_FINE_STEP * GEN_FREQ_FINE));
+    const double h = 1e-5;
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/modelled_desk_tilts.csv", dir);
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    fprintf(file, "# LSM6DSO trace, modelled by gen_orientation_traces, not a recording: a board on a desk tilted 30 "
+                  "degrees right, 20 degrees nose down and turned 90 degrees, ODR 104Hz with INTERNAL_FREQ_FINE %d\n",
+            GEN_FREQ_FINE);
+    fprintf(file, "# period %.7f\n", period);
+    for (unsigned i = 0; i < sizeof(directives) / sizeof(directives[0]); i++) {
+        fprintf(file, "%s\n", directives[i]);
+    }
+
+    srand(30);
+
+    for (long sample = 0; sample * period < GEN_SECONDS; sample++) {
+
+        double t = sample * period;
+        TraceQuaternion q = gen_attitude(t);
+        TraceQuaternion q1 = gen_attitude(t + h);
+        TraceQuaternion q0 = gen_attitude(t - h);
+        TraceQuaternion dq = {(q1.w - q0.w) / (2 * h), (q1.x - q0.x) / (2 * h), (q1.y - q0.y) / (2 * h),
+                              (q1.z - q0.z) / (2 * h)};
+        TraceQuaternion w = trace_q_mul(trace_q_conj(q), dq);
+        TraceQuaternion up = {0.0, 0.0, 0.0, 1000.0};
+        TraceQuaternion g = trace_q_mul(trace_q_mul(trace_q_conj(q), up), q);
+        double gyro[3] = {2.0 * w.x / TRACE_DEG, 2.0 * w.y / TRACE_DEG, 2.0 * w.z / TRACE_DEG};
+        double accel[3] = {g.x, g.y, g.z};
+
+        for (int axis = 0; axis < 3; axis++) {
+            gyro[axis] = gen_quantize(gyro[axis] + gyroBias[axis] + gen_noise(GYRO_NOISE), GYRO_LSB);
+            accel[axis] = gen_quantize(accel[axis] + accelOffset[axis] + gen_noise(ACCEL_NOISE), ACCEL_LSB);
+        }
+
+        // As updateOrientation() prints the pairs
+        fprintf(file, "%.2f,%.2f,%.2f,%.1f,%.1f,%.1f\n", gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2]);
+    }
+
+    fclose(file);
+    printf("%s\n", path);
+    return 0;
+}
@@ -0,0 +1,396 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// IMU traces for the orientation filter tests.  A trace is the sequence of accelerometer/gyroscope pairs the
+// read sensor thread picked up and, for synthetic traces, the true orientation when the sensor took each
+// sample.
+//
+// trace_synthesize() samples a known motion at the real ODR of a part whose oscillator is off nominal and
+// models two ways of picking the pairs up: out of the FIFO, every pair in order, or by polling the output
+// registers like the application did before it batched the pairs, at twice the ODR on the 1ms tick with
+// some scheduling jitter and the thread now and then held off long enough for samples to be overwritten.
+// trace_load() reads a trace from a CSV file, one pair per line:
+//
+//   gx,gy,gz,ax,ay,az[,roll,pitch,yaw]
+//
+// in dps, mg and the optional reference orientation in degrees.  Lines that start with '#' are skipped.
+// trace_replay() runs a trace through the filter the way updateOrientation() does and reports the error
+// against the reference and the time per update.
+//
+// The application prints the pairs in this format with ORIENTATION_PRINT_TRACE defined in buildOptions.h.  A
+// trace file in test/traces has no reference columns, the comment lines hold directives instead:
+//
+//   # period 0.0094738         real sample period in s, the application prints it when fusion starts
+//   # level 4.5 8 30 0 2       from 4.5s to 8s roll and pitch stay within 2 degrees of 30 and 0
+//   # heading 17 20 1          from 17s to 20s the yaw moves by no more than 1 degree
+//   # overrun                  the FIFO lost pairs here, printed by the application
+//
+// trace_load_file() reads a trace file and its directives, trace_check_file() replays it and checks them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+#include "orientation_filter.h"
+
+#define TRACE_PI 3.14159265358979323846
+#define TRACE_DEG (TRACE_PI / 180.0)
+#define TRACE_ODR_BASE_HZ 6667.0
+#define TRACE_FREQ_FINE_STEP 0.0015
+
+typedef struct
+{
+    double time;                    // s, when the pair was sampled
+    float gyro[3];                  // dps
+    float accel[3];                 // mg
+    double roll;                    // reference orientation when the pair was sampled, degrees
+    double pitch;
+    double yaw;
+    int hasReference;
+} TraceRecord;
+
+typedef struct
+{
+    TraceRecord* records;
+    int count;
+    double samplePeriod;            // s, as lp_imu_motion_sample_period() would report it
+} Trace;
+
+typedef struct
+{
+    double rmsTilt;                 // roll and pitch error, degrees
+    double maxTilt;
+    double maxYaw;                  // integrated heading error, degrees
+    double finalYaw;
+    uint32_t updates;
+    double nsPerUpdate;
+} ReplayResult;
+
+typedef struct
+{
+    double w, x, y, z;
+} TraceQuaternion;
+
+static inline TraceQuaternion trace_q_mul(TraceQuaternion a, TraceQuaternion b)
+{
+    TraceQuaternion r = {
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w
+    };
+    return r;
+}
+
+static inline TraceQuaternion trace_q_conj(TraceQuaternion q)
+{
+    TraceQuaternion r = {q.w, -q.x, -q.y, -q.z};
+    return r;
+}
+
+// The test motion: roll, pitch and yaw swinging at different rates, in radians
+static inline void trace_motion(double t, double* roll, double* pitch, double* yaw)
+{
+    *roll = 35.0 * TRACE_DEG * sin(2.0 * TRACE_PI * 0.45 * t);
+    *pitch = 25.0 * TRACE_DEG * sin(2.0 * TRACE_PI * 0.3 * t + 1.0) - 25.0 * TRACE_DEG * sin(1.0);
+    *yaw = 90.0 * TRACE_DEG * sin(2.0 * TRACE_PI * 0.2 * t) + 20.0 * TRACE_DEG * t;
+}
+
+// Z-Y-X (aerospace) sequence, the same convention as orientation_get_euler()
+static inline TraceQuaternion trace_attitude(double t)
+{
+    double roll, pitch, yaw;
+
+    trace_motion(t, &roll, &pitch, &yaw);
+
+    TraceQuaternion qz = {cos(yaw / 2), 0.0, 0.0, sin(yaw / 2)};
+    TraceQuaternion qy = {cos(pitch / 2), 0.0, sin(pitch / 2), 0.0};
+    TraceQuaternion qx = {cos(roll / 2), sin(roll / 2), 0.0, 0.0};
+    return trace_q_mul(trace_q_mul(qz, qy), qx);
+}
+
+// What an ideal sensor reads at time t: the body rate from the attitude derivative, w = 2 q* dq/dt, and
+// gravity rotated into the sensor frame
+static inline void trace_sense(double t, float gyro[3], float accel[3])
+{
+    const double h = 1e-5;
+    TraceQuaternion q = trace_attitude(t);
+    TraceQuaternion q1 = trace_attitude(t + h);
+    TraceQuaternion q0 = trace_attitude(t - h);
+    TraceQuaternion dq = {(q1.w - q0.w) / (2 * h), (q1.x - q0.x) / (2 * h), (q1.y - q0.y) / (2 * h), (q1.z - q0.z) / (2 * h)};
+    TraceQuaternion w = trace_q_mul(trace_q_conj(q), dq);
+    TraceQuaternion up = {0.0, 0.0, 0.0, 1000.0};
+    TraceQuaternion g = trace_q_mul(trace_q_mul(trace_q_conj(q), up), q);
+
+    gyro[0] = (float)(2.0 * w.x / TRACE_DEG);
+    gyro[1] = (float)(2.0 * w.y / TRACE_DEG);
+    gyro[2] = (float)(2.0 * w.z / TRACE_DEG);
+    accel[0] = (float)g.x;
+    accel[1] = (float)g.y;
+    accel[2] = (float)g.z;
+}
+
+// Sample the motion for the given time at the real ODR 6667Hz / coefficient of a part whose oscillator is
+// freqFine steps off.  With fifo set every sample is kept, otherwise the registers are polled every
+// pollPeriod seconds plus up to jitter and the thread is held off for stallPeriod with probability
+// stallChance on each poll.
+static inline Trace trace_synthesize(double seconds, int coefficient, int freqFine, int fifo, double pollPeriod, double jitter,
+                                     double stallChance, double stallPeriod)
+{
+    double period = coefficient / (TRACE_ODR_BASE_HZ * (1.0 + TRACE_FREQ_FINE_STEP * freqFine));
+    Trace trace;
+    long lastSample = -1;
+    double t = 0.0;
+
+    trace.samplePeriod = period;
+    trace.count = 0;
+    trace.records = malloc(sizeof(TraceRecord) * (size_t)(seconds / period + 2));
+
+    srand(7);
+
+    while (t < seconds) {
+
+        // From the FIFO every sample comes out, otherwise the latest one at the time of the poll
+        long sample = fifo ? lastSample + 1 : (long)floor(t / period);
+
+        if (sample > lastSample) {
+
+            TraceRecord* r = &trace.records[trace.count++];
+            double sampleTime = sample * period;
+            double roll, pitch, yaw;
+
+            r->time = sampleTime;
+            trace_sense(sampleTime, r->gyro, r->accel);
+            trace_motion(sampleTime, &roll, &pitch, &yaw);
+            r->roll = roll / TRACE_DEG;
+            r->pitch = pitch / TRACE_DEG;
+            r->yaw = yaw / TRACE_DEG;
+            r->hasReference = 1;
+            lastSample = sample;
+        }
+
+        if (fifo) {
+            t = (sample + 1) * period;
+            continue;
+        }
+
+        t += pollPeriod + jitter * rand() / RAND_MAX;
+        if (rand() < stallChance * RAND_MAX) {
+            t += stallPeriod;
+        }
+    }
+
+    return trace;
+}
+
+// Load a CSV trace, samplePeriod comes from the ODR and INTERNAL_FREQ_FINE of the part that recorded it
+static inline int trace_load(const char* path, double samplePeriod, Trace* trace)
+{
+    FILE* file = fopen(path, "r");
+    char line[256];
+    int capacity = 1024;
+
+    if (file == NULL) {
+        return 0;
+    }
+
+    trace->samplePeriod = samplePeriod;
+    trace->count = 0;
+    trace->records = malloc(sizeof(TraceRecord) * capacity);
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+
+        TraceRecord r;
+
+        if (line[0] == '#') {
+            continue;
+        }
+
+        int fields = sscanf(line, "%f,%f,%f,%f,%f,%f,%lf,%lf,%lf", &r.gyro[0], &r.gyro[1], &r.gyro[2],
+                            &r.accel[0], &r.accel[1], &r.accel[2], &r.roll, &r.pitch, &r.yaw);
+        if (fields < 6) {
+            continue;
+        }
+
+        r.time = trace->count * samplePeriod;
+        r.hasReference = (fields == 9);
+
+        if (trace->count == capacity) {
+            capacity *= 2;
+            trace->records = realloc(trace->records, sizeof(TraceRecord) * capacity);
+        }
+        trace->records[trace->count++] = r;
+    }
+
+    fclose(file);
+    return trace->count > 0;
+}
+
+static inline double trace_wrap(double degrees)
+{
+    while (degrees > 180.0) {
+        degrees -= 360.0;
+    }
+    while (degrees < -180.0) {
+        degrees += 360.0;
+    }
+    return degrees;
+}
+
+// Replay a trace the way updateOrientation() does, every pair integrated over period.  The error is taken once
+// the filter had settleSeconds to converge from the first sample.
+static inline ReplayResult trace_replay(const Trace* trace, float beta, double period, double settleSeconds)
+{
+    OrientationFilter filter;
+    ReplayResult result;
+    double sumTilt = 0.0;
+    int errors = 0;
+    double start;
+
+    memset(&result, 0, sizeof(result));
+    orientation_init(&filter, (float)(1.0 / period), beta);
+
+    start = host_time_ns();
+    for (int i = 0; i < trace->count; i++) {
+
+        const TraceRecord* r = &trace->records[i];
+        float roll, pitch, yaw;
+
+        orientation_update(&filter, r->gyro[0], r->gyro[1], r->gyro[2], r->accel[0], r->accel[1], r->accel[2]);
+
+        if (!r->hasReference || (r->time < settleSeconds)) {
+            continue;
+        }
+
+        orientation_get_euler(&filter, &roll, &pitch, &yaw);
+
+        double rollError = fabs(trace_wrap(roll - r->roll));
+        double pitchError = fabs(trace_wrap(pitch - r->pitch));
+        double yawError = fabs(trace_wrap(yaw - r->yaw));
+
+        sumTilt += rollError * rollError + pitchError * pitchError;
+        errors += 2;
+        result.maxTilt = fmax(result.maxTilt, fmax(rollError, pitchError));
+        result.maxYaw = fmax(result.maxYaw, yawError);
+        result.finalYaw = yawError;
+    }
+
+    result.rmsTilt = errors ? sqrt(sumTilt / errors) : 0.0;
+    result.updates = filter.updates;
+    result.nsPerUpdate = trace->count ? (host_time_ns() - start) / trace->count : 0.0;
+    return result;
+}
+
+#define TRACE_FILE_MAX_CHECKS 16
+
+typedef struct
+{
+    double from;                    // s
+    double to;
+    double roll;                    // level: roll, pitch and the tolerance in degrees
+    double pitch;
+    double tolerance;               // heading: the yaw change allowed in degrees
+    double worst;                   // Largest error seen in the window, set by trace_check_file()
+    int samples;
+} TraceCheck;
+
+typedef struct
+{
+    Trace trace;
+    TraceCheck levels[TRACE_FILE_MAX_CHECKS];
+    int levelCount;
+    TraceCheck headings[TRACE_FILE_MAX_CHECKS];
+    int headingCount;
+    int overruns;
+} TraceFile;
+
+// Read a trace file with its directives, it needs a period
+static inline int trace_load_file(const char* path, TraceFile* file)
+{
+    FILE* in = fopen(path, "r");
+    char line[256];
+    double period = 0.0;
+
+    if (in == NULL) {
+        return 0;
+    }
+
+    memset(file, 0, sizeof(*file));
+    while (fgets(line, sizeof(line), in) != NULL) {
+
+        TraceCheck c;
+
+        memset(&c, 0, sizeof(c));
+        if (sscanf(line, "# period %lf", &period) == 1) {
+            continue;
+        }
+        if ((sscanf(line, "# level %lf %lf %lf %lf %lf", &c.from, &c.to, &c.roll, &c.pitch, &c.tolerance) == 5) &&
+            (file->levelCount < TRACE_FILE_MAX_CHECKS)) {
+            file->levels[file->levelCount++] = c;
+        }
+        else if ((sscanf(line, "# heading %lf %lf %lf", &c.from, &c.to, &c.tolerance) == 3) &&
+                 (file->headingCount < TRACE_FILE_MAX_CHECKS)) {
+            file->headings[file->headingCount++] = c;
+        }
+        else if (strncmp(line, "# overrun", 9) == 0) {
+            file->overruns++;
+        }
+    }
+    fclose(in);
+
+    return (period > 0.0) && trace_load(path, period, &file->trace);
+}
+
+// Replay a trace file the way updateOrientation() does and fill in the worst error of every check.  Returns
+// the number of checks that failed, a check without any samples in its window fails.
+static inline int trace_check_file(TraceFile* file, float beta)
+{
+    OrientationFilter filter;
+    double headingStart[TRACE_FILE_MAX_CHECKS];
+    int failed = 0;
+
+    orientation_init(&filter, (float)(1.0 / file->trace.samplePeriod), beta);
+
+    for (int i = 0; i < file->trace.count; i++) {
+
+        const TraceRecord* r = &file->trace.records[i];
+        float roll, pitch, yaw;
+
+        orientation_update(&filter, r->gyro[0], r->gyro[1], r->gyro[2], r->accel[0], r->accel[1], r->accel[2]);
+        orientation_get_euler(&filter, &roll, &pitch, &yaw);
+
+        for (int c = 0; c < file->levelCount; c++) {
+
+            TraceCheck* level = &file->levels[c];
+
+            if ((r->time >= level->from) && (r->time <= level->to)) {
+                double error = fmax(fabs(trace_wrap(roll - level->roll)), fabs(trace_wrap(pitch - level->pitch)));
+
+                level->worst = fmax(level->worst, error);
+                level->samples++;
+            }
+        }
+
+        for (int c = 0; c < file->headingCount; c++) {
+
+            TraceCheck* heading = &file->headings[c];
+
+            if ((r->time >= heading->from) && (r->time <= heading->to)) {
+                if (heading->samples++ == 0) {
+                    headingStart[c] = yaw;
+                }
+                heading->worst = fmax(heading->worst, fabs(trace_wrap(yaw - headingStart[c])));
+            }
+        }
+    }
+
+    for (int c = 0; c < file->levelCount; c++) {
+        failed += (file->levels[c].samples == 0) || (file->levels[c].worst > file->levels[c].tolerance);
+    }
+    for (int c = 0; c < file->headingCount; c++) {
+        failed += (file->headings[c].samples == 0) || (file->headings[c].worst > file->headings[c].tolerance);
+    }
+    return failed;
+}
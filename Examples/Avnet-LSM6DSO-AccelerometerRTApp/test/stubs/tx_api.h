@@ -0,0 +1,19 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Just enough of the ThreadX API for the host tests to include the IMU driver header.  The signal
+// processing modules don't call into ThreadX, the IMU driver test provides tx_thread_sleep().
+
+#include <stdint.h>
+
+typedef unsigned long ULONG;
+typedef unsigned int UINT;
+typedef unsigned char UCHAR;
+typedef char CHAR;
+typedef void VOID;
+
+#define TX_TIMER_TICKS_PER_SECOND 100
+
+void tx_thread_sleep(ULONG ticks);
@@ -0,0 +1,225 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for the register sequences the IMU driver writes to start and stop the FIFO accelerometer stream
+// (feature extraction, spectrum) and the accelerometer/gyroscope stream (orientation fusion).  The driver is
+// built against a simulated I2C bus holding the LSM6DSO user register bank and every register write is logged.
+// The event detector program enables INACT_EN, the sensor would then drop to 12.5Hz once the device is still:
+// the activity mode has to be off before a stream is started and come back when it stops.  The driver's own
+// source is included so the tests can set up the driver state without the sensor bring up.
+
+#include "host_test.h"
+#include "../IMU_lib/imu_temp_pressure.c"
+
+// ---------------------------------------------------------------------------------------------------------------
+// Simulated bus
+
+#define MAX_WRITES 256
+
+typedef struct
+{
+    uint8_t reg;
+    uint8_t value;
+} RegisterWrite;
+
+typedef struct
+{
+    uint8_t user[256];
+    RegisterWrite writes[MAX_WRITES];
+    int writeCount;
+} SimulatedBus;
+
+static SimulatedBus bus;
+
+int mtk_os_hal_i2c_ctrl_init(i2c_num bus_num)
+{
+    return 0;
+}
+
+int mtk_os_hal_i2c_speed_init(i2c_num bus_num, int speed)
+{
+    return 0;
+}
+
+int mtk_os_hal_i2c_write(i2c_num bus_num, uint8_t device_addr, uint8_t* buffer, uint16_t len)
+{
+    for (uint16_t i = 1; i < len; i++) {
+        uint8_t reg = (uint8_t)(buffer[0] + i - 1);
+        bus.user[reg] = buffer[i];
+        if (bus.writeCount < MAX_WRITES) {
+            bus.writes[bus.writeCount].reg = reg;
+            bus.writes[bus.writeCount].value = buffer[i];
+            bus.writeCount++;
+        }
+    }
+    return 0;
+}
+
+int mtk_os_hal_i2c_write_read(i2c_num bus_num, uint8_t device_addr, uint8_t* wr_buf, uint8_t* rd_buf,
+                              uint16_t wr_len, uint16_t rd_len)
+{
+    for (uint16_t i = 0; i < rd_len; i++) {
+        rd_buf[i] = bus.user[(uint8_t)(wr_buf[0] + i)];
+    }
+    return 0;
+}
+
+void tx_thread_sleep(ULONG ticks)
+{
+}
+
+// Index of the first or last logged write to reg, -1 if there is none
+static int first_write(uint8_t reg)
+{
+    for (int i = 0; i < bus.writeCount; i++) {
+        if (bus.writes[i].reg == reg) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int last_write(uint8_t reg)
+{
+    for (int i = bus.writeCount - 1; i >= 0; i--) {
+        if (bus.writes[i].reg == reg) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// The sensor the way lp_imu_initialize() and the event detector program leave it, tapCfg2 holds the activity mode
+static void setup(uint8_t tapCfg2)
+{
+    memset(&bus, 0, sizeof(bus));
+    bus.user[LSM6DSO_WHO_AM_I] = LSM6DSO_ID;
+    bus.user[LSM6DSO_CTRL1_XL] = 0x62;          // 417Hz, 2g, LPF2
+    bus.user[LSM6DSO_CTRL2_G] = 0x1C;           // 12.5Hz, 2000dps
+    bus.user[LSM6DSO_TAP_CFG2] = tapCfg2;
+
+    dev_ctx.write_reg = platform_write;
+    dev_ctx.read_reg = platform_read;
+    dev_ctx.handle = &i2cHandle;
+    idle_xl_odr = LSM6DSO_XL_ODR_417Hz;
+    stream_inactivity_saved = false;
+    initialized = true;
+}
+
+static uint8_t inact_en(void)
+{
+    return (bus.user[LSM6DSO_TAP_CFG2] >> 5) & 0x03;
+}
+
+static uint8_t xl_odr(void)
+{
+    return bus.user[LSM6DSO_CTRL1_XL] >> 4;
+}
+
+static uint8_t gy_odr(void)
+{
+    return bus.user[LSM6DSO_CTRL2_G] >> 4;
+}
+
+static uint8_t fifo_mode(void)
+{
+    return bus.user[LSM6DSO_FIFO_CTRL4] & 0x07;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+
+// INACT_EN is cleared before the ODR and stream mode are set, the rest of TAP_CFG2 is kept
+static void check_stream_started(void)
+{
+    int activity = last_write(LSM6DSO_TAP_CFG2);
+
+    CHECK(inact_en() == 0);
+    CHECK((bus.user[LSM6DSO_TAP_CFG2] & ~0x60) == (0xA8 & ~0x60));
+    CHECK(activity >= 0);
+    CHECK(activity < first_write(LSM6DSO_CTRL1_XL));
+    CHECK(activity < last_write(LSM6DSO_FIFO_CTRL4));
+    CHECK(fifo_mode() == LSM6DSO_STREAM_MODE);
+}
+
+// Feature extraction and spectrum: accelerometer only at the requested rate
+static void test_fifo_stream(void)
+{
+    setup(0xA8);
+
+    CHECK(lp_imu_fifo_start(833, 41) == 833);
+    check_stream_started();
+    CHECK(xl_odr() == LSM6DSO_XL_ODR_833Hz);
+    CHECK((bus.user[LSM6DSO_FIFO_CTRL3] & 0x0F) == LSM6DSO_XL_BATCHED_AT_833Hz);
+
+    // A window size or rate change restarts the stream without stopping it
+    bus.writeCount = 0;
+    CHECK(lp_imu_fifo_start(208, 10) == 208);
+    check_stream_started();
+    CHECK(xl_odr() == LSM6DSO_XL_ODR_208Hz);
+
+    bus.writeCount = 0;
+    lp_imu_fifo_stop();
+    CHECK(bus.user[LSM6DSO_TAP_CFG2] == 0xA8);
+    CHECK(last_write(LSM6DSO_TAP_CFG2) > last_write(LSM6DSO_CTRL1_XL));
+    CHECK(xl_odr() == LSM6DSO_XL_ODR_417Hz);
+    CHECK(fifo_mode() == LSM6DSO_BYPASS_MODE);
+}
+
+// Orientation fusion: accelerometer and gyroscope pairs
+static void test_motion_stream(void)
+{
+    setup(0xA8);
+
+    CHECK(lp_imu_motion_start(104) == 104);
+    check_stream_started();
+    CHECK(last_write(LSM6DSO_TAP_CFG2) < first_write(LSM6DSO_CTRL2_G));
+    CHECK(xl_odr() == LSM6DSO_XL_ODR_104Hz);
+    CHECK(gy_odr() == LSM6DSO_GY_ODR_104Hz);
+    CHECK(bus.user[LSM6DSO_FIFO_CTRL3] == ((LSM6DSO_GY_BATCHED_AT_104Hz << 4) | LSM6DSO_XL_BATCHED_AT_104Hz));
+
+    bus.writeCount = 0;
+    lp_imu_motion_stop();
+    CHECK(bus.user[LSM6DSO_TAP_CFG2] == 0xA8);
+    CHECK(xl_odr() == LSM6DSO_XL_ODR_417Hz);
+    CHECK(gy_odr() == LSM6DSO_GY_ODR_12Hz5);
+    CHECK(fifo_mode() == LSM6DSO_BYPASS_MODE);
+}
+
+// Switching from fusion to feature extraction hands over the saved mode, it comes back after the last stop
+static void test_stream_handover(void)
+{
+    setup(0xC8);                                // Inactivity with the gyroscope powered down
+
+    lp_imu_motion_start(104);
+    lp_imu_motion_stop();
+    lp_imu_fifo_start(833, 41);
+    CHECK(inact_en() == 0);
+    lp_imu_fifo_stop();
+    CHECK(bus.user[LSM6DSO_TAP_CFG2] == 0xC8);
+
+    // Stopping twice doesn't restore a stale mode
+    bus.user[LSM6DSO_TAP_CFG2] = 0x88;
+    lp_imu_fifo_stop();
+    CHECK(bus.user[LSM6DSO_TAP_CFG2] == 0x88);
+}
+
+// Without an activity mode the streams leave TAP_CFG2 as it was
+static void test_no_activity_mode(void)
+{
+    setup(0x88);
+
+    lp_imu_fifo_start(833, 41);
+    CHECK(bus.user[LSM6DSO_TAP_CFG2] == 0x88);
+    lp_imu_fifo_stop();
+    CHECK(bus.user[LSM6DSO_TAP_CFG2] == 0x88);
+}
+
+int main(void)
+{
+    test_fifo_stream();
+    test_motion_stream();
+    test_stream_handover();
+    test_no_activity_mode();
+
+    return host_test_result("imu_streaming");
+}
@@ -0,0 +1,76 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for orientation_filter.c.  Synthetic traces of a known motion (orientation_trace.h) are replayed
+// through the filter the way the read sensor thread feeds it: every pair out of the FIFO, integrated over the
+// real sample period of a part whose ODR is off nominal.  The same motion picked up by polling the output
+// registers at the nominal period, as the application did before, is replayed for comparison.
+
+#include "orientation_trace.h"
+
+// 416.7Hz is the 417Hz setting, ODR_Coeff 16
+#define COEFF_417HZ 16
+#define COEFF_104HZ 64
+
+// The first sample aligns the filter with gravity, a tilted sensor at rest stays put
+static void test_static(void)
+{
+    OrientationFilter filter;
+    float roll, pitch, yaw;
+
+    orientation_init(&filter, 104.0f, 0.0f);
+    CHECK_NEAR(filter.beta, ORIENTATION_DEFAULT_BETA, 1e-9);
+
+    orientation_update(&filter, 0.0f, 0.0f, 0.0f, 0.0f, -500.0f, 866.0f);
+    CHECK(filter.initialized);
+    CHECK(filter.updates == 0);
+
+    for (int i = 0; i < 1000; i++) {
+        orientation_update(&filter, 0.0f, 0.0f, 0.0f, 0.0f, -500.0f, 866.0f);
+    }
+
+    orientation_get_euler(&filter, &roll, &pitch, &yaw);
+    CHECK(filter.updates == 1000);
+    CHECK_NEAR(roll, -30.0, 0.05);
+    CHECK_NEAR(pitch, 0.0, 0.05);
+    CHECK_NEAR(yaw, 0.0, 0.05);
+    CHECK_NEAR(orientation_get_tilt(&filter), 30.0, 0.05);
+}
+
+// A minute of motion on a part freqFine steps off nominal.  yawLimit is the heading error integrated over the
+// minute from the FIFO, which is down to the filter's own integration error at that rate.
+static void test_trace(int coefficient, int freqFine, double yawLimit)
+{
+    Trace fifo = trace_synthesize(60.0, coefficient, freqFine, 1, 0.0, 0.0, 0.0, 0.0);
+    Trace polled = trace_synthesize(60.0, coefficient, freqFine, 0, 0.001, 0.0002, 0.01, 0.006);
+    double nominalPeriod = coefficient / TRACE_ODR_BASE_HZ;
+
+    ReplayResult timed = trace_replay(&fifo, ORIENTATION_DEFAULT_BETA, fifo.samplePeriod, 2.0);
+    ReplayResult nominal = trace_replay(&fifo, ORIENTATION_DEFAULT_BETA, nominalPeriod, 2.0);
+    ReplayResult before = trace_replay(&polled, ORIENTATION_DEFAULT_BETA, nominalPeriod, 2.0);
+
+    printf("%.1fHz, freq fine %d: FIFO tilt rms %.3f max %.3f yaw %.3f, nominal period yaw %.3f, polled %d of %d pairs yaw %.3f\n",
+           1.0 / fifo.samplePeriod, freqFine, timed.rmsTilt, timed.maxTilt, timed.maxYaw, nominal.maxYaw,
+           polled.count, fifo.count, before.maxYaw);
+
+    CHECK(timed.updates == (uint32_t)fifo.count - 1);
+    CHECK(timed.rmsTilt < 0.6);
+    CHECK(timed.maxTilt < 1.5);
+    CHECK(timed.maxYaw < yawLimit);
+
+    // The nominal period alone, and polling on top of it, drift off by far more
+    CHECK(nominal.maxYaw > 5.0 * timed.maxYaw);
+    CHECK(before.maxYaw > 5.0 * timed.maxYaw);
+
+    free(fifo.records);
+    free(polled.records);
+}
+
+int main(void)
+{
+    test_static();
+    test_trace(COEFF_417HZ, -20, 0.5);
+    test_trace(COEFF_104HZ, 15, 2.0);
+
+    return host_test_result("orientation_filter");
+}
@@ -0,0 +1,52 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Replays the trace files in test/traces through orientation_filter.c with the default beta and checks the
+// error bounds their directives state: roll and pitch within the tolerance of the level windows and the yaw
+// change within the heading windows (format in orientation_trace.h).  The application prints traces with
+// ORIENTATION_PRINT_TRACE defined in buildOptions.h.
+//
+//   ./out/test_orientation_recording traces/*.csv
+
+#include "orientation_trace.h"
+
+static void check_trace(const char* path)
+{
+    TraceFile file;
+
+    if (!trace_load_file(path, &file)) {
+        printf("%s: can't read it or it has no period\n", path);
+        CHECK(0);
+        return;
+    }
+
+    int failed = trace_check_file(&file, ORIENTATION_DEFAULT_BETA);
+
+    printf("%s: %d pairs at %.2fHz, %d overruns\n", path, file.trace.count, 1.0 / file.trace.samplePeriod,
+           file.overruns);
+    for (int i = 0; i < file.levelCount; i++) {
+        const TraceCheck* c = &file.levels[i];
+        printf("  level   %6.2fs to %6.2fs roll %6.1f pitch %6.1f: worst %.2f of %.2f degrees\n", c->from, c->to,
+               c->roll, c->pitch, c->worst, c->tolerance);
+    }
+    for (int i = 0; i < file.headingCount; i++) {
+        const TraceCheck* c = &file.headings[i];
+        printf("  heading %6.2fs to %6.2fs: yaw moved %.2f of %.2f degrees\n", c->from, c->to, c->worst,
+               c->tolerance);
+    }
+
+    // A trace without a level window checks nothing
+    CHECK(file.levelCount > 0);
+    CHECK(failed == 0);
+    free(file.trace.records);
+}
+
+int main(int argc, char* argv[])
+{
+    CHECK(argc > 1);
+    for (int i = 1; i < argc; i++) {
+        check_trace(argv[i]);
+    }
+
+    return host_test_result("orientation_recording");
+}
@@ -0,0 +1,144 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for spectrum.c, sinusoids of known frequency and amplitude are pushed through the capture
+// buffers and the band energies and peaks are compared with their analytic values.
+
+#include <string.h>
+#include "host_test.h"
+#include "spectrum.h"
+
+#define PI 3.14159265358979323846
+#define SAMPLE_RATE 1000.0f
+
+static AccelerationRaw samples[SPECTRUM_MAX_FFT];
+
+typedef struct
+{
+    double frequencyHz;
+    double amplitude;       // LSB
+} Tone;
+
+static void make_tones(uint16_t n, uint8_t axis, const Tone* tones, int count, double offset)
+{
+    memset(samples, 0, sizeof(samples));
+
+    for (int i = 0; i < n; i++) {
+        double x = offset;
+        for (int t = 0; t < count; t++) {
+            x += tones[t].amplitude * sin(2.0 * PI * tones[t].frequencyHz * i / SAMPLE_RATE + t);
+        }
+        ((int16_t*)&samples[i])[axis] = (int16_t)lround(x);
+    }
+}
+
+static void test_configuration(void)
+{
+    const uint16_t edges[] = {0, 100, 200};
+
+    CHECK(!spectrum_configure(128, 0, SAMPLE_RATE, edges, 2, 1));
+    CHECK(!spectrum_configure(300, 0, SAMPLE_RATE, edges, 2, 1));
+    CHECK(!spectrum_configure(256, 3, SAMPLE_RATE, edges, 2, 1));
+    CHECK(!spectrum_configure(256, 0, 0.0f, edges, 2, 1));
+    CHECK(!spectrum_configure(256, 0, SAMPLE_RATE, edges, SPECTRUM_MAX_BANDS + 1, 1));
+    CHECK(!spectrum_configure(256, 0, SAMPLE_RATE, edges, 2, SPECTRUM_MAX_PEAKS + 1));
+    CHECK(spectrum_configure(256, 0, SAMPLE_RATE, edges, 2, 1));
+    CHECK(spectrum_get_fft_size() == 256);
+}
+
+// A tone between two bins at every FFT size: the interpolated peak lands within a twentieth of a bin and the
+// amplitude within 1%, the band around the tone holds A^2 / 2 and the other band next to nothing
+static void test_single_tone(void)
+{
+    const uint16_t sizes[] = {256, 512, 1024};
+    const uint16_t edges[] = {50, 100, 400};
+    const Tone tone = {75.3, 2000.0};
+    SpectrumResult result;
+
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+
+        uint16_t n = sizes[s];
+        double binHz = SAMPLE_RATE / n;
+
+        CHECK(spectrum_configure(n, 2, SAMPLE_RATE, edges, 2, 3));
+        make_tones(n, 2, &tone, 1, 16384.0);
+
+        CHECK(spectrum_push(samples, n));
+        CHECK(spectrum_process(&result, 1.0f));
+
+        CHECK(result.fftSize == n);
+        CHECK(result.axis == 2);
+        CHECK_NEAR(result.binHz, binHz, 1e-4);
+        CHECK(result.peakCount >= 1);
+        CHECK_NEAR(result.peaks[0].frequencyHz, tone.frequencyHz, 0.05 * binHz);
+        CHECK_NEAR(result.peaks[0].amplitude, tone.amplitude, 0.01 * tone.amplitude);
+
+        double energy = tone.amplitude * tone.amplitude / 2.0;
+        CHECK(result.bandCount == 2);
+        CHECK_NEAR(result.bandEnergy[0], energy, 0.02 * energy);
+        CHECK(result.bandEnergy[1] < 0.01 * energy);
+
+        // Nothing more to transform
+        CHECK(!spectrum_process(&result, 1.0f));
+    }
+}
+
+// Two tones, the peaks are reported largest first and scaled by mgPerLsb
+static void test_two_tones(void)
+{
+    const Tone tones[] = {{62.5, 500.0}, {250.0, 3000.0}};
+    const uint16_t edges[] = {0, 100, 500};
+    SpectrumResult result;
+
+    CHECK(spectrum_configure(1024, 0, SAMPLE_RATE, edges, 2, 2));
+    make_tones(1024, 0, tones, 2, 0.0);
+
+    CHECK(spectrum_push(samples, 1024));
+    CHECK(spectrum_process(&result, 0.061f));
+
+    CHECK(result.peakCount == 2);
+    CHECK_NEAR(result.peaks[0].frequencyHz, 250.0, 0.1);
+    CHECK_NEAR(result.peaks[0].amplitude, 3000.0 * 0.061, 0.02 * 3000.0 * 0.061);
+    CHECK_NEAR(result.peaks[1].frequencyHz, 62.5, 0.1);
+    CHECK_NEAR(result.peaks[1].amplitude, 500.0 * 0.061, 0.02 * 500.0 * 0.061);
+    CHECK_NEAR(result.bandEnergy[0], 500.0 * 500.0 / 2.0 * 0.061 * 0.061, 0.02 * 500.0 * 500.0 / 2.0 * 0.061 * 0.061);
+    CHECK_NEAR(result.bandEnergy[1], 3000.0 * 3000.0 / 2.0 * 0.061 * 0.061, 0.02 * 3000.0 * 3000.0 / 2.0 * 0.061 * 0.061);
+    CHECK_NEAR(result.peaks[2].amplitude, 0.0, 1e-9);
+}
+
+// Captures are handed over in pairs, a third one while the first is still waiting is dropped
+static void test_ping_pong(void)
+{
+    const uint16_t edges[] = {0, 500};
+    SpectrumResult result;
+    uint32_t sequence;
+
+    CHECK(spectrum_configure(256, 1, SAMPLE_RATE, edges, 1, 1));
+    memset(samples, 0, sizeof(samples));
+
+    // Partial captures are not handed over
+    CHECK(!spectrum_push(samples, 100));
+    CHECK(spectrum_push(samples, 156));
+
+    // The second buffer fills while the first is waiting, the third capture has no buffer to go to
+    CHECK(!spectrum_push(samples, 256));
+    CHECK(!spectrum_push(samples, 256));
+
+    CHECK(spectrum_process(&result, 1.0f));
+    CHECK(result.overruns == 2);
+    sequence = result.sequence;
+
+    CHECK(spectrum_push(samples, 256));
+    CHECK(spectrum_process(&result, 1.0f));
+    CHECK(result.sequence == sequence + 1);
+}
+
+int main(void)
+{
+    test_configuration();
+    test_single_tone();
+    test_two_tones();
+    test_ping_pong();
+
+    return host_test_result("spectrum");
+}
@@ -0,0 +1,205 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for vibration_features.c.  The windows are checked against signals with known statistics
+// (square wave, sine) and against a straightforward double precision reference, the same two pass
+// computation as numpy's mean(), sqrt(mean(d**2)), max(abs(d)) and mean(d**4) / mean(d**2)**2.
+
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+#include "vibration_features.h"
+
+#define PI 3.14159265358979323846
+
+static AccelerationRaw samples[VF_MAX_WINDOW];
+
+typedef struct
+{
+    double mean;
+    double rms;
+    double peak;
+    double crest;
+    double kurtosis;
+} Reference;
+
+static Reference reference(const int16_t* x, int n)
+{
+    Reference ref;
+    double m2 = 0.0;
+    double m4 = 0.0;
+
+    ref.mean = 0.0;
+    for (int i = 0; i < n; i++) {
+        ref.mean += x[i];
+    }
+    ref.mean /= n;
+
+    ref.peak = 0.0;
+    for (int i = 0; i < n; i++) {
+        double d = x[i] - ref.mean;
+        m2 += d * d;
+        m4 += d * d * d * d;
+        if (fabs(d) > ref.peak) {
+            ref.peak = fabs(d);
+        }
+    }
+    m2 /= n;
+    m4 /= n;
+
+    ref.rms = sqrt(m2);
+    ref.crest = ref.peak / ref.rms;
+    ref.kurtosis = m4 / (m2 * m2);
+    return ref;
+}
+
+// Compare one axis against the reference, the mean and peak to 0.01 LSB and the rest to relTol.  The kurtosis
+// is finalized in single precision from moments that may have been shifted, it gets 10x the tolerance.
+static void check_axis(const VibrationAxisFeatures* got, const Reference* ref, double mgPerLsb, double relTol)
+{
+    CHECK_NEAR(got->mean, ref->mean * mgPerLsb, 0.01 * mgPerLsb + fabs(ref->mean * mgPerLsb) * 1e-6);
+    CHECK_NEAR(got->peak, ref->peak * mgPerLsb, 0.01 * mgPerLsb + ref->peak * mgPerLsb * 1e-6);
+    CHECK_NEAR(got->rms, ref->rms * mgPerLsb, ref->rms * mgPerLsb * relTol);
+    CHECK_NEAR(got->crestFactor, ref->crest, ref->crest * relTol);
+    CHECK_NEAR(got->kurtosis, ref->kurtosis, ref->kurtosis * relTol * 10);
+}
+
+static void fill_window(uint16_t n, VibrationFeatures* features, float mgPerLsb)
+{
+    CHECK(vf_set_window(n) == n);
+    CHECK(vf_push(samples, n) == n);
+    CHECK(vf_window_full());
+    vf_compute(features, mgPerLsb);
+}
+
+static void test_window_size(void)
+{
+    CHECK(vf_round_window(0) == VF_MIN_WINDOW);
+    CHECK(vf_round_window(17) == 18);
+    CHECK(vf_round_window(256) == 256);
+    CHECK(vf_round_window(5000) == VF_MAX_WINDOW);
+
+    // Rounding alone doesn't change the window in use
+    CHECK(vf_set_window(64) == 64);
+    vf_round_window(100);
+    CHECK(vf_get_window() == 64);
+
+    // Pushing stops at the end of the window
+    memset(samples, 0, sizeof(samples));
+    CHECK(vf_push(samples, 40) == 40);
+    CHECK(!vf_window_full());
+    CHECK(vf_push(samples, 40) == 24);
+    CHECK(vf_window_full());
+    CHECK(vf_push(samples, 40) == 0);
+
+    // A new window size drops the partial window
+    CHECK(vf_set_window(33) == 34);
+    CHECK(!vf_window_full());
+    CHECK(vf_push(samples, 100) == 34);
+}
+
+// Square wave: every sample is mean +/- A, so rms = peak = A, crest factor 1 and kurtosis 1
+static void test_square_wave(void)
+{
+    VibrationFeatures features;
+
+    for (int i = 0; i < 256; i++) {
+        int16_t d = (i & 1) ? 1000 : -1000;
+        samples[i].x = 512 + d;
+        samples[i].y = -16384 + d;
+        samples[i].z = 16384 + 2 * d;
+    }
+
+    fill_window(256, &features, 1.0f);
+
+    CHECK(features.windowSamples == 256);
+    CHECK_NEAR(features.axis[0].mean, 512.0, 1e-3);
+    CHECK_NEAR(features.axis[0].rms, 1000.0, 1e-2);
+    CHECK_NEAR(features.axis[0].peak, 1000.0, 1e-3);
+    CHECK_NEAR(features.axis[0].crestFactor, 1.0, 1e-5);
+    CHECK_NEAR(features.axis[0].kurtosis, 1.0, 1e-5);
+    CHECK_NEAR(features.axis[1].mean, -16384.0, 1e-3);
+    CHECK_NEAR(features.axis[1].rms, 1000.0, 1e-2);
+    CHECK_NEAR(features.axis[2].rms, 2000.0, 2e-2);
+    CHECK_NEAR(features.axis[2].kurtosis, 1.0, 1e-5);
+}
+
+// Sine over whole periods: crest factor sqrt(2) and kurtosis 1.5, up to the rounding to integers
+static void test_sine(void)
+{
+    VibrationFeatures features;
+    const double amplitude = 4000.0;
+
+    for (int i = 0; i < 512; i++) {
+        samples[i].x = (int16_t)lround(amplitude * sin(2.0 * PI * 8 * i / 512));
+        samples[i].y = (int16_t)lround(1000.0 + amplitude * cos(2.0 * PI * 5 * i / 512));
+        samples[i].z = 16384;
+    }
+
+    fill_window(512, &features, (float)0.061);
+
+    CHECK_NEAR(features.axis[0].mean, 0.0, 1e-3);
+    CHECK_NEAR(features.axis[0].rms, 0.061 * amplitude / sqrt(2.0), 0.061 * amplitude * 1e-4);
+    CHECK_NEAR(features.axis[0].crestFactor, sqrt(2.0), 1e-3);
+    CHECK_NEAR(features.axis[0].kurtosis, 1.5, 1e-3);
+    CHECK_NEAR(features.axis[1].mean, 0.061 * 1000.0, 1e-3);
+    CHECK_NEAR(features.axis[1].kurtosis, 1.5, 1e-3);
+
+    // A constant axis has no variation, the ratios are reported as zero rather than NaN
+    CHECK_NEAR(features.axis[2].rms, 0.0, 1e-6);
+    CHECK_NEAR(features.axis[2].crestFactor, 0.0, 1e-6);
+    CHECK_NEAR(features.axis[2].kurtosis, 0.0, 1e-6);
+}
+
+// Noise with impulses over the full 16-bit range, this takes the shifted kernel path
+static void test_reference_vectors(void)
+{
+    static int16_t axis[VF_AXES][VF_MAX_WINDOW];
+    VibrationFeatures features;
+    const uint16_t sizes[] = {16, 100, 256, 1024};
+
+    srand(1);
+
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+
+        uint16_t n = sizes[s];
+
+        for (int i = 0; i < n; i++) {
+            double x = 16384.0 + 3000.0 * sin(i * 0.3) + (rand() % 2000 - 1000) + ((i == n / 3) ? 9000.0 : 0.0);
+            axis[0][i] = samples[i].x = (int16_t)x;
+            axis[1][i] = samples[i].y = (int16_t)(rand() % 65535 - 32767);
+            axis[2][i] = samples[i].z = (int16_t)(-x * 1.1);
+        }
+
+        fill_window(n, &features, 1.0f);
+
+        for (int a = 0; a < VF_AXES; a++) {
+            Reference ref = reference(axis[a], n);
+            check_axis(&features.axis[a], &ref, 1.0, 1e-4);
+        }
+    }
+}
+
+static void test_sequence(void)
+{
+    VibrationFeatures first;
+    VibrationFeatures second;
+
+    memset(samples, 0, sizeof(samples));
+    fill_window(16, &first, 1.0f);
+    fill_window(16, &second, 1.0f);
+
+    CHECK(second.sequence == first.sequence + 1);
+    CHECK(!vf_window_full());
+}
+
+int main(void)
+{
+    test_window_size();
+    test_square_wave();
+    test_sine();
+    test_reference_vectors();
+    test_sequence();
+
+    return host_test_result("vibration_features");
+}
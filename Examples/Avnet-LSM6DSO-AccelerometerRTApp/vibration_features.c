@@ -0,0 +1,194 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include <math.h>
+#include "vibration_features.h"
+#include "cycle_counter.h"
+
+// Largest centered sample magnitude (after shifting) that lets sum(d^4) over VF_MAX_WINDOW
+// samples fit in 64 bits: (2^13)^4 * 2^10 = 2^62
+#define VF_MAX_CENTERED_MAGNITUDE 8191
+
+// The window lives in TCM as one contiguous, word aligned array per axis so the reduction
+// kernels can load two samples per 32-bit access and use the M4 dual 16-bit instructions.
+static int16_t window[VF_AXES][VF_MAX_WINDOW] __attribute__((aligned(4)));
+static uint16_t windowSize = 256;
+static uint16_t windowFill = 0;
+static uint32_t windowSequence = 0;
+
+uint16_t vf_round_window(uint16_t samples)
+{
+    if (samples < VF_MIN_WINDOW) {
+        samples = VF_MIN_WINDOW;
+    }
+    if (samples > VF_MAX_WINDOW) {
+        samples = VF_MAX_WINDOW;
+    }
+
+    // The paired kernels consume two samples at a time
+    return (samples + 1) & ~1U;
+}
+
+uint16_t vf_set_window(uint16_t samples)
+{
+    windowSize = vf_round_window(samples);
+    windowFill = 0;
+
+    return windowSize;
+}
+
+uint16_t vf_get_window(void)
+{
+    return windowSize;
+}
+
+uint16_t vf_push(const AccelerationRaw* samples, uint16_t count)
+{
+    uint16_t space = windowSize - windowFill;
+    uint16_t n = (count < space) ? count : space;
+
+    for (uint16_t i = 0; i < n; i++) {
+        window[0][windowFill + i] = samples[i].x;
+        window[1][windowFill + i] = samples[i].y;
+        window[2][windowFill + i] = samples[i].z;
+    }
+    windowFill += n;
+
+    return n;
+}
+
+bool vf_window_full(void)
+{
+    return windowFill == windowSize;
+}
+
+// Pass 1: sum, minimum and maximum of one axis.  n must be even.
+static void axis_sum_min_max(const int16_t* x, uint16_t n, int32_t* sum, int16_t* min, int16_t* max)
+{
+#if defined(__ARM_FEATURE_DSP)
+    const uint32_t* pairs = (const uint32_t*)x;
+    uint32_t vmin = 0x7FFF7FFF;
+    uint32_t vmax = 0x80008000;
+    int32_t acc = 0;
+
+    for (uint16_t i = 0; i < n / 2; i++) {
+        uint32_t v = pairs[i];
+
+        // Dual 16-bit multiply-accumulate by one sums both lanes in a single instruction
+        acc = __SMLAD(v, 0x00010001, acc);
+
+        // SSUB16 sets the per-lane GE flags that SEL uses to pick the larger/smaller lane
+        __SSUB16(v, vmax);
+        vmax = __SEL(v, vmax);
+        __SSUB16(vmin, v);
+        vmin = __SEL(v, vmin);
+    }
+
+    *sum = acc;
+    *min = ((int16_t)vmin < (int16_t)(vmin >> 16)) ? (int16_t)vmin : (int16_t)(vmin >> 16);
+    *max = ((int16_t)vmax > (int16_t)(vmax >> 16)) ? (int16_t)vmax : (int16_t)(vmax >> 16);
+#else
+    int32_t acc = 0;
+    int16_t lo = INT16_MAX;
+    int16_t hi = INT16_MIN;
+
+    for (uint16_t i = 0; i < n; i++) {
+        acc += x[i];
+        if (x[i] < lo) {
+            lo = x[i];
+        }
+        if (x[i] > hi) {
+            hi = x[i];
+        }
+    }
+
+    *sum = acc;
+    *min = lo;
+    *max = hi;
+#endif
+}
+
+// Pass 2: raw moments of (x - center) >> shift.  The shift keeps every power inside its
+// accumulator; the kurtosis ratio is scale invariant and the RMS is scaled back by the caller.
+static void axis_moments(const int16_t* x, uint16_t n, int32_t center, uint8_t shift,
+                         int64_t* s1, uint64_t* s2, int64_t* s3, uint64_t* s4)
+{
+    int32_t round = (shift > 0) ? (1 << (shift - 1)) : 0;
+    int64_t a1 = 0;
+    uint64_t a2 = 0;
+    int64_t a3 = 0;
+    uint64_t a4 = 0;
+
+    for (uint16_t i = 0; i < n; i++) {
+        int32_t d = ((int32_t)x[i] - center + round) >> shift;
+        uint32_t d2 = (uint32_t)(d * d);
+
+        a1 += d;
+        a2 += d2;
+        a3 += (int64_t)d2 * d;
+        a4 += (uint64_t)d2 * d2;
+    }
+
+    *s1 = a1;
+    *s2 = a2;
+    *s3 = a3;
+    *s4 = a4;
+}
+
+static void axis_features(const int16_t* x, uint16_t n, float mgPerLsb, VibrationAxisFeatures* out)
+{
+    int32_t sum;
+    int16_t min;
+    int16_t max;
+    int64_t s1;
+    uint64_t s2;
+    int64_t s3;
+    uint64_t s4;
+    uint8_t shift = 0;
+
+    axis_sum_min_max(x, n, &sum, &min, &max);
+
+    // Center on the rounded integer mean, then pick the smallest shift that bounds |d|
+    int32_t center = (sum >= 0) ? (sum + n / 2) / n : (sum - n / 2) / n;
+    int32_t maxDeviation = ((max - center) > (center - min)) ? (max - center) : (center - min);
+    while ((maxDeviation >> shift) > VF_MAX_CENTERED_MAGNITUDE) {
+        shift++;
+    }
+
+    axis_moments(x, n, center, shift, &s1, &s2, &s3, &s4);
+
+    // Per window finalization: convert the moments about the integer center into central
+    // moments about the true mean (r is the sub-LSB offset between the two)
+    float scale = (float)(1 << shift);
+    float r = (float)s1 / n;
+    float m2 = (float)s2 / n;
+    float m3 = (float)s3 / n;
+    float m4 = (float)s4 / n;
+    float variance = m2 - r * r;
+    float fourth = m4 - 4.0f * r * m3 + 6.0f * r * r * m2 - 3.0f * r * r * r * r;
+
+    float mean = (float)sum / n;
+    float rms = (variance > 0.0f) ? sqrtf(variance) * scale : 0.0f;
+    float peak = ((max - mean) > (mean - min)) ? (max - mean) : (mean - min);
+
+    out->mean = mean * mgPerLsb;
+    out->rms = rms * mgPerLsb;
+    out->peak = peak * mgPerLsb;
+    out->crestFactor = (rms > 0.0f) ? peak / rms : 0.0f;
+    out->kurtosis = (variance > 0.0f) ? fourth / (variance * variance) : 0.0f;
+}
+
+void vf_compute(VibrationFeatures* features, float mgPerLsb)
+{
+    uint32_t start = cycle_counter_get();
+
+    for (int axis = 0; axis < VF_AXES; axis++) {
+        axis_features(window[axis], windowFill, mgPerLsb, &features->axis[axis]);
+    }
+
+    features->cyclesPerSample = (cycle_counter_get() - start) / windowFill;
+    features->windowSamples = windowFill;
+    features->sequence = ++windowSequence;
+
+    windowFill = 0;
+}
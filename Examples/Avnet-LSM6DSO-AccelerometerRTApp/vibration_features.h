@@ -0,0 +1,51 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "./IMU_lib/imu_temp_pressure.h"
+
+// Windowed vibration statistics computed on the M4 from FIFO batched accelerometer samples.
+// Samples are buffered as raw 16-bit values, one contiguous array per axis, and reduced with
+// integer kernels when the window fills.  Only the resulting feature vector is sent to the
+// high level application.
+
+#define VF_AXES 3
+#define VF_MIN_WINDOW 16
+#define VF_MAX_WINDOW 1024
+
+typedef struct
+{
+    float mean;         // mg
+    float rms;          // mg, computed about the window mean
+    float peak;         // mg, largest absolute deviation from the window mean
+    float crestFactor;  // peak / rms
+    float kurtosis;     // normalized 4th central moment (3.0 for a gaussian signal)
+} VibrationAxisFeatures;
+
+typedef struct
+{
+    uint32_t sequence;          // increments for every completed window
+    uint16_t windowSamples;
+    uint32_t cyclesPerSample;   // DWT cycles spent reducing the window, per sample
+    VibrationAxisFeatures axis[VF_AXES];
+} VibrationFeatures;
+
+// The window size vf_set_window() will use for a requested number of samples: rounded up to an
+// even number of samples and clamped to [VF_MIN_WINDOW, VF_MAX_WINDOW].  Doesn't touch the window.
+uint16_t vf_round_window(uint16_t samples);
+
+// Set the number of samples per window and discard any partially filled window.  Call it from the
+// thread that pushes the samples.
+uint16_t vf_set_window(uint16_t samples);
+uint16_t vf_get_window(void);
+
+// Copy samples into the current window.  Returns the number of samples consumed, which is less
+// than count when the window fills up.  Call vf_compute() once vf_window_full() returns true.
+uint16_t vf_push(const AccelerationRaw* samples, uint16_t count);
+bool vf_window_full(void);
+
+// Reduce the full window into a feature vector (scaled by mgPerLsb) and start a new window
+void vf_compute(VibrationFeatures* features, float mgPerLsb);
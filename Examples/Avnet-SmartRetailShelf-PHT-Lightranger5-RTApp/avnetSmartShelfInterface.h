@@ -14,10 +14,151 @@ typedef enum
 	IC_SMART_SHELF_READ_SENSOR_RESPOND_WITH_TELEMETRY, 
 	IC_SMART_SHELF_SET_AUTO_TELEMETRY_RATE,
 	IC_SMART_SHELF_READ_SENSOR,
-	IC_SMART_SHELF_SIMULATE_DATA
+	IC_SMART_SHELF_SIMULATE_DATA,
+	IC_SMART_SHELF_GET_RANGER_CALIBRATION,
+	IC_SMART_SHELF_SET_RANGER_CALIBRATION,
+	IC_SMART_SHELF_GET_RANGER_CONFIG,
+	IC_SMART_SHELF_SET_RANGER_CONFIG,
+	IC_SMART_SHELF_SET_RANGER_HISTOGRAM,
+	IC_SMART_SHELF_GET_RANGER_TARGETS,
+	IC_SMART_SHELF_SET_SHELF_ANALYTICS,
+	IC_SMART_SHELF_GET_SHELF_ANALYTICS,
+	IC_SMART_SHELF_SHELF_EVENT,
+	IC_SMART_SHELF_GET_I2C_STATS
 } INTER_CORE_CMD_SMART_SHELF;
 typedef uint8_t cmdType;
 
+// Index of each LightRanger5 in rangerCalibration[], rangerStartMode[], rangerConfig[], rangerResult[],
+// rangerHistogram[] and rangerTargets[]
+#define IC_SMART_SHELF_RANGER_SHELF1  0
+#define IC_SMART_SHELF_RANGER_SHELF2  1
+#define IC_SMART_SHELF_RANGER_PEOPLE  2
+
+// Additional shelf sensors (SHELF_EXTRA_RANGERS in buildOptions.h) follow the people detect sensor, SHELF3 up to
+// SHELF8 for 8 shelf sensors in all.  Unused entries report no result.
+#define IC_SMART_SHELF_RANGER_SHELF3  3
+#define IC_SMART_SHELF_RANGER_COUNT   9
+
+// How each LightRanger5 was started, matches lightranger5_start_t in lightranger5.h
+#define IC_SMART_SHELF_START_COLD          0   // Firmware downloaded
+#define IC_SMART_SHELF_START_IMAGE_LOADED  1   // Firmware was still loaded, measurement restarted
+#define IC_SMART_SHELF_START_WARM          2   // Firmware was still loaded and measuring
+
+// TMF8801 factory calibration and the version of the firmware image it was taken with.  Returned by
+// IC_SMART_SHELF_GET_RANGER_CALIBRATION for the high level application to persist and sent back down
+// with IC_SMART_SHELF_SET_RANGER_CALIBRATION when the real time application starts.  A valid entry
+// replaces the factory calibration after a firmware download and its appVersion is the image version
+// the warm start check expects the sensor to be running.
+typedef struct
+{
+	uint8_t valid;
+	uint8_t appVersion[3];      // Major, minor, patch
+	uint8_t factoryCalib[14];
+} IC_SMART_SHELF_RANGER_CALIBRATION;
+
+// TMF8801 measurement settings.  IC_SMART_SHELF_SET_RANGER_CONFIG applies the entries with valid set, a sensor
+// that is measuring is restarted with the new settings.  More iterations give a better accuracy and range at
+// the cost of a longer measurement, the TMF8801 stretches the period if the iterations don't fit in it.
+typedef struct
+{
+	uint8_t valid;
+	uint8_t periodMs;           // Repetition period 1 - 255ms, default 100
+	uint16_t kiloIterations;    // Iterations per result in thousands, default 0xFFFF (TMF8801 default)
+	uint8_t algorithm;          // TMF8801 algorithm setting (CMD_DATA6), default 0x23
+	uint8_t minConfidence;      // Results below this confidence (0 - 63) report no object, default 0
+} IC_SMART_SHELF_RANGER_CONFIG;
+
+// Latest result of each LightRanger5
+typedef struct
+{
+	int distance_mm;            // -1 if there is no recent result or it is below minConfidence
+	uint8_t confidence;         // 0 - 63, 0 means no object was detected
+	uint8_t resultNumber;       // Increments with every result
+	int8_t temperature;         // TMF8801 die temperature in degrees C
+	uint16_t ageMs;             // Time since the result was read, 0xFFFF if there is none (or it is older)
+} IC_SMART_SHELF_RANGER_RESULT;
+
+// Histogram mode settings.  IC_SMART_SHELF_SET_RANGER_HISTOGRAM applies the entries with valid set, turning the
+// mode on or off restarts the sensor.  In histogram mode the TMF8801 dumps its distance histograms after every
+// measurement and the real time application looks for several targets in them, for example the product at the
+// front of a partially filled shelf and the back wall behind it.
+typedef struct
+{
+	uint8_t valid;
+	uint8_t enable;             // Histogram mode on
+	uint8_t captureXtalk;       // Take the next histogram as the crosstalk reference, nothing may be in front of the sensor
+	uint8_t maxTargets;         // 1 - IC_SMART_SHELF_MAX_TARGETS
+	uint16_t minStrength;       // Smallest peak reported, counts above the ambient level, default 0
+	uint16_t binWidthUm;        // Distance per histogram bin in micrometers, default 20000
+	int16_t offsetMm;           // Distance of bin 0, default 0
+} IC_SMART_SHELF_RANGER_HISTOGRAM;
+
+#define IC_SMART_SHELF_MAX_TARGETS  4
+
+typedef struct
+{
+	int16_t distance_mm;
+	uint16_t strength;          // Peak height above the ambient level in counts
+} IC_SMART_SHELF_RANGER_TARGET;
+
+// Targets found in the latest histogram of a sensor in histogram mode
+typedef struct
+{
+	uint8_t valid;              // Histogram mode is on and the latest histogram is recent
+	uint8_t xtalkValid;         // A crosstalk reference was captured and is subtracted
+	uint8_t count;              // Entries in targets[], nearest first
+	uint8_t sequence;           // Increments with every histogram
+	IC_SMART_SHELF_RANGER_TARGET targets[IC_SMART_SHELF_MAX_TARGETS];
+	uint32_t ambient;           // Ambient counts per bin
+	uint32_t readUs;            // I2C transfer time of the histogram dump
+	uint32_t kernelCycles;      // M4 cycles spent finding the targets
+} IC_SMART_SHELF_RANGER_TARGETS;
+
+// Stock level and presence settings per LightRanger5.  IC_SMART_SHELF_SET_SHELF_ANALYTICS applies the entries with
+// valid set.  The shelf sensors report a fill level in percent, the people detect sensor reports presence.  Both
+// median filter the ranges and only send an IC_SMART_SHELF_SHELF_EVENT message when the level changes.
+typedef struct
+{
+	uint8_t valid;
+	uint8_t enable;             // Track the level and send events for this sensor
+	uint8_t hysteresisPct;      // Shelf: smallest fill level change reported (empty and full always are), default 10
+	uint8_t presenceOnCount;    // People: results in a row that set presence, default 3
+	uint16_t emptyMm;           // Shelf: range with the shelf empty (back wall), larger than fullMm
+	uint16_t fullMm;            // Shelf: range with the shelf full (first product)
+	uint16_t presenceMm;        // People: someone nearer than this is in front of the shelf, default 1000
+	uint8_t presenceOffCount;   // People: results in a row that clear presence, default 10
+} IC_SMART_SHELF_SHELF_ANALYTICS;
+
+// Level in shelfLevel[] and IC_SMART_SHELF_EVENT before the first report
+#define IC_SMART_SHELF_LEVEL_UNKNOWN      0xFF
+
+#define IC_SMART_SHELF_EVENT_STOCK_LEVEL  1
+#define IC_SMART_SHELF_EVENT_PRESENCE     2
+
+// Sent by the real time application without a request (cmd IC_SMART_SHELF_SHELF_EVENT) once the high level
+// application sent IC_SMART_SHELF_SET_SHELF_ANALYTICS, one message per event
+typedef struct
+{
+	uint8_t type;               // IC_SMART_SHELF_EVENT_STOCK_LEVEL or IC_SMART_SHELF_EVENT_PRESENCE
+	uint8_t ranger;             // rangerResult[] index of the sensor
+	uint8_t level;              // Fill level in percent, or 1 if someone is in front of the shelf
+	uint8_t previous;           // Level before, IC_SMART_SHELF_LEVEL_UNKNOWN for the first event of a sensor
+	int16_t range_mm;           // Median range, -1 if there is no object
+	uint16_t dropped;           // Events lost before this one because the queue was full
+	uint32_t timestampMs;       // Real time application uptime, wraps after 49.7 days
+} IC_SMART_SHELF_EVENT;
+
+// I2C bus use per device since the previous IC_SMART_SHELF_GET_I2C_STATS, indexed like rangerResult[] with the PHT
+// click in the last entry.  Kept small, the sensor response is close to the 1KB intercore message limit.
+#define IC_SMART_SHELF_I2C_DEVICE_PHT    IC_SMART_SHELF_RANGER_COUNT
+#define IC_SMART_SHELF_I2C_DEVICE_COUNT  (IC_SMART_SHELF_RANGER_COUNT + 1)
+
+typedef struct
+{
+	uint16_t busyPermille;      // Share of the time the device held the bus in 0.1%
+	uint16_t errors;            // Failed transactions, saturates at 0xFFFF
+} IC_SMART_SHELF_I2C_STATS;
+
 // Define the expected data structure. 
 typedef struct // __attribute__((packed))
 {
@@ -27,6 +168,10 @@ typedef struct // __attribute__((packed))
 	// Don't change the declarations above or the generic RTApp implementation will break //
 	////////////////////////////////////////////////////////////////////////////////////////
 	bool simulateShelfData;
+	IC_SMART_SHELF_RANGER_CALIBRATION rangerCalibration[IC_SMART_SHELF_RANGER_COUNT];
+	IC_SMART_SHELF_RANGER_CONFIG rangerConfig[IC_SMART_SHELF_RANGER_COUNT];
+	IC_SMART_SHELF_RANGER_HISTOGRAM rangerHistogram[IC_SMART_SHELF_RANGER_COUNT];
+	IC_SMART_SHELF_SHELF_ANALYTICS shelfAnalytics[IC_SMART_SHELF_RANGER_COUNT];
 } IC_COMMAND_BLOCK_SMART_SHELF_HL_TO_RT;
 
 typedef struct // __attribute__((packed))
@@ -44,4 +189,16 @@ typedef struct // __attribute__((packed))
 	int rangeShelf1_mm;
 	int rangeShelf2_mm;
 	bool simulateShelfData;
+	IC_SMART_SHELF_RANGER_CALIBRATION rangerCalibration[IC_SMART_SHELF_RANGER_COUNT];
+	uint8_t rangerStartMode[IC_SMART_SHELF_RANGER_COUNT];
+	uint32_t hardwareInitMs;    // Hardware init thread start to all sensors measuring
+	IC_SMART_SHELF_RANGER_CONFIG rangerConfig[IC_SMART_SHELF_RANGER_COUNT];
+	IC_SMART_SHELF_RANGER_RESULT rangerResult[IC_SMART_SHELF_RANGER_COUNT];
+	IC_SMART_SHELF_RANGER_HISTOGRAM rangerHistogram[IC_SMART_SHELF_RANGER_COUNT];
+	IC_SMART_SHELF_RANGER_TARGETS rangerTargets[IC_SMART_SHELF_RANGER_COUNT];
+	uint16_t rangerMask;        // Bit per rangerResult[] entry of the sensors that are measuring
+	uint8_t shelfLevel[IC_SMART_SHELF_RANGER_COUNT];    // Reported fill level or presence per sensor
+	IC_SMART_SHELF_SHELF_ANALYTICS shelfAnalytics[IC_SMART_SHELF_RANGER_COUNT];
+	IC_SMART_SHELF_EVENT shelfEvent;
+	IC_SMART_SHELF_I2C_STATS i2cStats[IC_SMART_SHELF_I2C_DEVICE_COUNT];
 } IC_COMMAND_BLOCK_SMART_SHELF_RT_TO_HL;
\ No newline at end of file
@@ -14,3 +14,39 @@
 //#define INCLUDE_PEOPLE_DETECT_SENSOR
 #define SHELF_USES_8801
 //#define SHELF2_8801
+
+// The people detect sensor uses the Click site #2 EN pin and the default address 0x41, same as the second shelf sensor
+#if defined(INCLUDE_PEOPLE_DETECT_SENSOR) && defined(SHELF_USES_8801)
+#error "Invalid configuration, INCLUDE_PEOPLE_DETECT_SENSOR and SHELF_USES_8801 both use Click site #2!"
+#endif
+
+// Additional shelf LightRanger5s, up to 6 for 8 shelf sensors in all.  They share ISU2 with the click sockets and
+// are listed as { EN GPIO, I2C address } entries, reported as IC_SMART_SHELF_RANGER_SHELF3, SHELF4, ...  Every
+// sensor needs its own EN GPIO (add it to the "Gpio" capability in app_manifest.json) and a unique address other
+// than 0x41 (shelf 2) and 0x51 (shelf 1), all of them come out of reset at 0x41 and are moved before shelf 2 is
+// released.  Requires SHELF_USES_8801.
+//#define SHELF_EXTRA_RANGERS { { 0, 0x52 }, { 1, 0x53 } }
+
+#if defined(SHELF_EXTRA_RANGERS) && !defined(SHELF_USES_8801)
+#error "Invalid configuration, SHELF_EXTRA_RANGERS requires SHELF_USES_8801!"
+#endif
+
+// I2C speed used while the TMF8801 firmware images are downloaded.  The MS8607 on the PHT click shares the
+// bus and only supports Fast-mode (400KHz), use I2C_MASTER_SPEED_FAST (Fast-mode Plus, 1MHz) only when
+// every device on the ISU supports it
+#define LIGHTRANGER5_DOWNLOAD_I2C_SPEED I2C_MASTER_SPEED_FULL
+
+// LightRanger5 Interrupt Selection
+// The TMF8801 drives its INT pin low when a new distance result is ready (open drain, so the INT pins of several
+// sensors can share one line).  If INT is wired to an MT3620 GPIO that supports external interrupts (GPIO0 -
+// GPIO23), define LIGHTRANGER5_INT_GPIO as that GPIO number and add it to the "Gpio" capability in
+// app_manifest.json.  The ranging thread then only reads the sensors when INT falls.  Otherwise the ranging
+// thread polls the sensors every 20ms.  On the Rev1 board both click sockets use GPIO2, on the Rev2 board only
+// click socket #1 (GPIO5) can be used, click socket #2 (GPIO34) does not support external interrupts.
+//#define LIGHTRANGER5_INT_GPIO 5     // Click socket #1 INT pin (Rev2 board)
+
+// Print every histogram dump read in histogram mode (IC_SMART_SHELF_SET_RANGER_HISTOGRAM) on the debug port, one
+// TDC of 128 bins per line.  Save the lines of one dump to a file in test/histograms with an expect line to run
+// the host tests on it, see test/histogram_dump.h.  Printing a dump takes longer than a measurement, use it to
+// record dumps only.
+//#define RANGER_HISTOGRAM_PRINT_DUMPS
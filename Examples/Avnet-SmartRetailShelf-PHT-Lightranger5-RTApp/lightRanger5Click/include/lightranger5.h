@@ -140,6 +140,7 @@ extern "C"{
 #define LIGHTRANGER5_CMD_FACTORY_CALIB                                  0x0A
 #define LIGHTRANGER5_CMD_DL_CALIB_AND_STATE                             0x0B
 #define LIGHTRANGER5_CMD_RESULT                                         0x55
+#define LIGHTRANGER5_CMD_STOP_MEASUREMENT                               0xFF
 
 /**
  * @brief LightRanger 5 device app mode setting.
@@ -153,6 +154,104 @@ extern "C"{
 #define LIGHTRANGER5_SERIAL_NUMBER                                      0x47
 #define LIGHTRANGER5_BIT_CPU_RDY                                        0x40
 #define LIGHTRANGER5_ENABLE_RESET                                       0x80
+#define LIGHTRANGER5_BIT_PON                                            0x01
+#define LIGHTRANGER5_FACTORY_CALIB_SIZE                                 14
+#define LIGHTRANGER5_ALGO_STATE_SIZE                                    11
+#define LIGHTRANGER5_CMD_DATA_SIZE                                      9
+#define LIGHTRANGER5_APP_VERSION_SIZE                                   3
+
+/**
+ * @brief LightRanger 5 write frame setting.
+ * @details A write frame is the register address followed by the data.  Frames
+ * longer than the MT3620 I2C FIFO are sent by DMA and have to be in SYSRAM.
+ */
+#define LIGHTRANGER5_I2C_FIFO_SIZE                                      8
+#define LIGHTRANGER5_FRAME_SIZE( data_size )                            ( 1 + ( data_size ) )
+
+/**
+ * @brief LightRanger 5 result interrupt setting.
+ * @details INT_ENAB and INT_STATUS bit for a new measurement result.  With
+ * the bit set in INT_ENAB the INT pin goes low until the bit is cleared in
+ * INT_STATUS (write 1 to clear).  The result block is REGISTER_CONTENTS up
+ * to OBJECT_HITS_3, read in one transfer.
+ */
+#define LIGHTRANGER5_INT_RESULT                                         0x01
+/**
+ * @brief LightRanger 5 measurement command settings.
+ * @details Settings for lightranger5_measure_cfg_t.  The defaults are the
+ * measurement command the click example uses: factory calibration and
+ * algorithm state provided, algorithm 0x23, 100ms period and 0xFFFF
+ * kilo-iterations (device default).
+ */
+#define LIGHTRANGER5_MEASURE_CALIB_FACTORY                              0x01
+#define LIGHTRANGER5_MEASURE_CALIB_ALGO_STATE                           0x02
+#define LIGHTRANGER5_MEASURE_ALGO_PROXIMITY                             0x01
+#define LIGHTRANGER5_MEASURE_ALGO_DISTANCE                              0x02
+#define LIGHTRANGER5_MEASURE_ALGO_DEFAULT                               0x23
+#define LIGHTRANGER5_MEASURE_PERIOD_DEFAULT_MS                          100
+#define LIGHTRANGER5_MEASURE_KILO_ITERATIONS_DEFAULT                    0xFFFF
+
+/**
+ * @brief LightRanger 5 histogram dump setting.
+ * @details LIGHTRANGER5_CMD_HISTOGRAM_CONFIG with a LIGHTRANGER5_HIST_TYPE_*
+ * mask in CMD_DATA0 selects the histograms the TMF8801 dumps, 0 turns the
+ * dump off.  Send it while no measurement runs.  Once the histograms of a
+ * measurement are ready the TMF8801 sets LIGHTRANGER5_INT_HISTOGRAM in
+ * INT_STATUS and holds the next measurement until they were read.  A dump
+ * is 5 TDCs of 128 16-bit bins, read as 10 blocks of 128 bytes: COMMAND is
+ * set to LIGHTRANGER5_CMD_READ_HISTOGRAM + block and once REGISTER_CONTENTS
+ * reads back the command the block is at LIGHTRANGER5_REG_HIST_DATA.
+ * Block 2n holds the LSBs of TDC n, block 2n + 1 its MSBs.
+ */
+#define LIGHTRANGER5_CMD_HISTOGRAM_CONFIG                               0x30
+#define LIGHTRANGER5_CMD_READ_HISTOGRAM                                 0x80
+#define LIGHTRANGER5_INT_HISTOGRAM                                      0x02
+#define LIGHTRANGER5_REG_HIST_DATA                                      0x20
+#define LIGHTRANGER5_HIST_TYPE_EC                                       0x01
+#define LIGHTRANGER5_HIST_TYPE_PROXIMITY                                0x02
+#define LIGHTRANGER5_HIST_TYPE_DISTANCE                                 0x04
+#define LIGHTRANGER5_HIST_TDC_COUNT                                     5
+#define LIGHTRANGER5_HIST_BIN_COUNT                                     128
+#define LIGHTRANGER5_HIST_BLOCK_SIZE                                    128
+#define LIGHTRANGER5_HIST_BLOCK_COUNT                                   ( 2 * LIGHTRANGER5_HIST_TDC_COUNT )
+#define LIGHTRANGER5_HIST_TIMEOUT_MS                                    20
+
+#define LIGHTRANGER5_RESULT_BLOCK_SIZE                                  ( LIGHTRANGER5_REG_OBJECT_HITS_3 - \
+                                                                          LIGHTRANGER5_REG_REGISTER_CONTENTS + 1 )
+
+/**
+ * @brief LightRanger 5 bootloader setting.
+ * @details Bootloader commands, status codes and limits used by
+ * lightranger5_update_firmware() and lightranger5_download_and_start().  A command frame is written to
+ * CMD_DATA7 as cmd, size, data[size], checksum where the checksum is the
+ * ones complement of the sum of the other bytes.  CMD_DATA7 reads back the
+ * command while the bootloader is busy and a status below 0x10 once done.
+ */
+#define LIGHTRANGER5_BL_CMD_RAMREMAP_RESET                              0x11
+#define LIGHTRANGER5_BL_CMD_DOWNLOAD_INIT                               0x14
+#define LIGHTRANGER5_BL_CMD_R_RAM                                       0x40
+#define LIGHTRANGER5_BL_CMD_W_RAM                                       0x41
+#define LIGHTRANGER5_BL_CMD_ADDR_RAM                                    0x43
+#define LIGHTRANGER5_BL_DOWNLOAD_INIT_SEED                              0x29
+#define LIGHTRANGER5_BL_STATUS_READY                                    0x00
+#define LIGHTRANGER5_BL_STATUS_BUSY                                     0x10
+#define LIGHTRANGER5_BL_MAX_DATA_SIZE                                   128
+
+/**
+ * @brief LightRanger 5 download timing setting.
+ * @details Timeouts in milliseconds (ticks) for the bounded polls used by
+ * lightranger5_update_firmware() and lightranger5_change_12c_address().
+ * The first LIGHTRANGER5_POLL_SPIN_COUNT polls are back to back, after
+ * that the thread sleeps 1, 2, 4 and then 8 ticks between polls.
+ */
+#define LIGHTRANGER5_BL_COMMAND_TIMEOUT_MS                              100
+#define LIGHTRANGER5_BOOT_TIMEOUT_MS                                    500
+#define LIGHTRANGER5_POLL_SPIN_COUNT                                    4
+
+// Define to read the image back with R_RAM and compare it before the bootloader starts it.  Every W_RAM
+// record is already checked against its checksum by the bootloader, this doubles the bus time of the
+// download so it's meant for bring up of new boards or images.
+//#define LIGHTRANGER5_VERIFY_DOWNLOAD
 
 /**
  * @brief LightRanger 5 device address setting.
@@ -285,6 +384,76 @@ typedef enum
 
 } lightranger5_return_data_ready_t;
 
+/**
+ * @brief LightRanger 5 Click start state.
+ * @details Returned by lightranger5_check_warm_start().
+ */
+typedef enum
+{
+   LIGHTRANGER5_START_COLD = 0,          /**< Image not loaded, download it. */
+   LIGHTRANGER5_START_IMAGE_LOADED = 1,  /**< Image running, measurement not started. */
+   LIGHTRANGER5_START_WARM = 2           /**< Image running and measuring. */
+
+} lightranger5_start_t;
+
+/**
+ * @brief LightRanger 5 Click firmware download statistics.
+ * @details Filled in by lightranger5_update_firmware().
+ */
+typedef struct
+{
+    uint32_t total_ms;        /**< EN high to the measurement app running. */
+    uint32_t download_ms;     /**< DOWNLOAD_INIT to the last W_RAM record. */
+    uint16_t records;         /**< W_RAM records sent. */
+    uint16_t busy_polls;      /**< Polls that found the device busy. */
+    bool     verified;        /**< Image read back and matched (LIGHTRANGER5_VERIFY_DOWNLOAD). */
+    uint8_t  app_version[ LIGHTRANGER5_APP_VERSION_SIZE ]; /**< Version the image reports once running. */
+
+} lightranger5_download_stats_t;
+
+/**
+ * @brief LightRanger 5 Click measurement result.
+ * @details Filled in by lightranger5_read_result().
+ */
+typedef struct
+{
+    uint8_t  result_number;   /**< Increments with every result, use it to spot missed results. */
+    uint8_t  confidence;      /**< Reliability 0 - 63, 0 means no object was detected. */
+    uint8_t  status;          /**< Measurement status, RESULT_INFO bits 7:6. */
+    uint16_t distance_mm;     /**< Distance of the peak in millimeters. */
+    uint32_t sys_clock;       /**< Device time stamp in 0.2us units, bit 0 set if it is valid. */
+    int8_t   temperature;     /**< Die temperature in degrees C. */
+    uint32_t reference_hits;  /**< Photon count of the reference SPADs. */
+    uint32_t object_hits;     /**< Photon count of the object SPADs. */
+
+} lightranger5_result_t;
+
+/**
+ * @brief LightRanger 5 Click measurement configuration.
+ * @details Measurement command parameters, CMD_DATA7 to CMD_DATA0.  Set
+ * up with lightranger5_measure_cfg_setup() and started with
+ * lightranger5_start_measurement().
+ */
+typedef struct
+{
+    uint8_t  calibration;       /**< CMD_DATA7, LIGHTRANGER5_MEASURE_CALIB_* data loaded before the command. */
+    uint8_t  algorithm;         /**< CMD_DATA6, algorithm setting, LIGHTRANGER5_MEASURE_ALGO_*. */
+    uint8_t  period_ms;         /**< CMD_DATA2, repetition period in milliseconds. */
+    uint16_t kilo_iterations;   /**< CMD_DATA1 (LSB) and CMD_DATA0, iterations per result in thousands. */
+
+} lightranger5_measure_cfg_t;
+
+/**
+ * @brief LightRanger 5 Click histogram dump.
+ * @details Filled in by lightranger5_read_histogram().  Keep it static, at
+ * 1280 bytes it doesn't fit on a thread stack.
+ */
+typedef struct
+{
+    uint16_t bins[ LIGHTRANGER5_HIST_TDC_COUNT ][ LIGHTRANGER5_HIST_BIN_COUNT ];  /**< Counts per TDC and bin. */
+
+} lightranger5_histogram_t;
+
 /*!
  * @addtogroup lightranger5 LightRanger 5 Click Driver
  * @brief API for configuring and manipulating LightRanger 5 Click driver.
@@ -352,12 +521,33 @@ err_t lightranger5_default_cfg ( lightranger5_t *ctx );
  *         @li @c -1 - Error.
  *
  * See #err_t definition for detailed explanation.
- * @note None.
+ * @note The frame is built on the stack, the register address and data have to fit
+ * the I2C FIFO (LIGHTRANGER5_I2C_FIFO_SIZE), longer writes fail.  Send those with
+ * lightranger5_write_frame().
  *
  * @endcode
  */
 err_t lightranger5_generic_write ( lightranger5_t *ctx, uint8_t reg, uint8_t *tx_buf, uint8_t tx_len );
 
+/**
+ * @brief LightRanger 5 I2C frame writing function.
+ * @details This function writes a frame that holds the start register address
+ * followed by the data, without copying it.
+ * @param[in] ctx : Click context object.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[in] frame : Start register address and the data to be written.
+ * @param[in] len : Frame length, LIGHTRANGER5_FRAME_SIZE( data bytes ).
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note Frames longer than LIGHTRANGER5_I2C_FIFO_SIZE have to be in SYSRAM
+ * ( __attribute__( ( section( ".sysram" ) ) ) ), they are sent by DMA.
+ *
+ * @endcode
+ */
+err_t lightranger5_write_frame ( lightranger5_t *ctx, uint8_t *frame, uint8_t len );
+
 /**
  * @brief LightRanger 5 I2C reading function.
  * @details This function reads a desired number of data bytes starting from
@@ -555,7 +745,8 @@ err_t lightranger5_set_command ( lightranger5_t *ctx, uint8_t cmd );
  * TMF8801, Time-of-Flight Sensor on the LightRanger 5 click board™.
  * @param[in] ctx : Click context object.
  * See #lightranger5_t object definition for detailed explanation.
- * @param[in] factory_calib_data : Pointer to the memory location where factory calibration data be stored.
+ * @param[in] factory_calib_frame : LIGHTRANGER5_FRAME_SIZE( LIGHTRANGER5_FACTORY_CALIB_SIZE ) byte
+ * frame in SYSRAM, the factory calibration data from byte 1 on.  Byte 0 is set to the register address.
  * @return @li @c  0 - Success,
  *         @li @c -1 - Error.
  *
@@ -565,7 +756,7 @@ err_t lightranger5_set_command ( lightranger5_t *ctx, uint8_t cmd );
  *
  * @endcode
  */
-err_t lightranger5_set_factory_calib_data ( lightranger5_t *ctx, uint8_t *factory_calib_data );
+err_t lightranger5_set_factory_calib_data ( lightranger5_t *ctx, uint8_t *factory_calib_frame );
 
 /**
  * @brief LightRanger 5 get factory calib data function.
@@ -591,7 +782,8 @@ err_t lightranger5_get_factory_calib_data ( lightranger5_t *ctx, uint8_t *factor
  * TMF8801, Time-of-Flight Sensor on the LightRanger 5 click board™.
  * @param[in] ctx : Click context object.
  * See #lightranger5_t object definition for detailed explanation.
- * @param[in] alg_state_data : Pointer to the memory location where factory algorithm state data be stored.
+ * @param[in] alg_state_frame : LIGHTRANGER5_FRAME_SIZE( LIGHTRANGER5_ALGO_STATE_SIZE ) byte frame
+ * in SYSRAM, the algorithm state data from byte 1 on.  Byte 0 is set to the register address.
  * @return @li @c  0 - Success,
  *         @li @c -1 - Error.
  *
@@ -602,7 +794,7 @@ err_t lightranger5_get_factory_calib_data ( lightranger5_t *ctx, uint8_t *factor
  *
  * @endcode
  */
-err_t lightranger5_set_algorithm_state_data ( lightranger5_t *ctx, uint8_t *alg_state_data );
+err_t lightranger5_set_algorithm_state_data ( lightranger5_t *ctx, uint8_t *alg_state_frame );
 
 /**
  * @brief LightRanger 5 set command data function.
@@ -610,7 +802,8 @@ err_t lightranger5_set_algorithm_state_data ( lightranger5_t *ctx, uint8_t *alg_
  * TMF8801, Time-of-Flight Sensor on the LightRanger 5 click board™.
  * @param[in] ctx : Click context object.
  * See #lightranger5_t object definition for detailed explanation.
- * @param[in] cmd_data : Pointer to the memory location where command data be stored.
+ * @param[in] cmd_frame : LIGHTRANGER5_FRAME_SIZE( LIGHTRANGER5_CMD_DATA_SIZE ) byte frame in
+ * SYSRAM, CMD_DATA7 to CMD_DATA0 and COMMAND from byte 1 on.  Byte 0 is set to the register address.
  * @return @li @c  0 - Success,
  *         @li @c -1 - Error.
  *
@@ -619,7 +812,7 @@ err_t lightranger5_set_algorithm_state_data ( lightranger5_t *ctx, uint8_t *alg_
  *
  * @endcode
  */
-err_t lightranger5_set_command_data ( lightranger5_t *ctx, uint8_t *cmd_data );
+err_t lightranger5_set_command_data ( lightranger5_t *ctx, uint8_t *cmd_frame );
 
 /**
  * @brief LightRanger 5 check previous command function.
@@ -707,10 +900,268 @@ uint16_t lightranger5_measure_distance ( lightranger5_t *ctx );
  */
 uint8_t lightranger5_check_int ( lightranger5_t *ctx );
 
-err_t lightranger5_update_firmware ( i2c_num isu, pin_name_t en, uint8_t new_i2c_address);
+/**
+ * @brief LightRanger 5 firmware download function.
+ * @details This function power cycles the TMF8801 with the EN pin, downloads
+ * tof_bin_image to the bootloader and starts it.  The image is sent in
+ * LIGHTRANGER5_BL_MAX_DATA_SIZE byte W_RAM records with the bus switched to
+ * @b download_speed, the bus is set back to the standard speed afterwards.
+ * @param[in] isu : I2C ISU the device is connected to.
+ * @param[in] en : EN pin of the device.
+ * @param[in] new_i2c_address : New 7-bit I2C address, 0x00 keeps 0x41.
+ * @param[in] download_speed : I2C_MASTER_SPEED_* used for the download, only
+ * use I2C_MASTER_SPEED_FAST (Fast-mode Plus) when every device on the ISU
+ * supports it.
+ * @param[out] stats : Download statistics, can be NULL.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note Every poll is bounded, see LIGHTRANGER5_BL_COMMAND_TIMEOUT_MS and
+ * LIGHTRANGER5_BOOT_TIMEOUT_MS.
+ *
+ * @endcode
+ */
+err_t lightranger5_update_firmware ( i2c_num isu, pin_name_t en, uint8_t new_i2c_address,
+                                     uint32_t download_speed, lightranger5_download_stats_t *stats );
+
+/**
+ * @brief LightRanger 5 bootloader start function.
+ * @details This function resets a device that answers at
+ * @b ctx->slave_address into the bootloader, powers on the oscillator and
+ * checks the bootloader application ID.  First step of
+ * lightranger5_update_firmware(), for callers that bring up several devices
+ * at the same time.
+ * @param[in] ctx : Click context object.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[out] stats : Download statistics, can be NULL.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note Polls for at most LIGHTRANGER5_BOOT_TIMEOUT_MS per step.
+ *
+ * @endcode
+ */
+err_t lightranger5_bootloader_start ( lightranger5_t *ctx, lightranger5_download_stats_t *stats );
+
+/**
+ * @brief LightRanger 5 download and start function.
+ * @details This function downloads tof_bin_image to a device running the
+ * bootloader (see lightranger5_bootloader_start()) with the bus switched to
+ * @b download_speed and sends RAMREMAP_RESET.  The bus goes back to the
+ * speed of the context afterwards.  Returns as soon as the device restarts,
+ * the image is up once ENABLE reads back CPU_RDY | PON.
+ * @param[in] ctx : Click context object.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[in] download_speed : I2C_MASTER_SPEED_* used for the download.
+ * @param[out] stats : Download statistics, can be NULL.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note None.
+ *
+ * @endcode
+ */
+err_t lightranger5_download_and_start ( lightranger5_t *ctx, uint32_t download_speed,
+                                        lightranger5_download_stats_t *stats );
 
+/**
+ * @brief LightRanger 5 get application version function.
+ * @details This function reads the running application ID and its major,
+ * minor and patch version.
+ * @param[in] ctx : Click context object.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[out] appid : Application ID.
+ * @param[out] version : LIGHTRANGER5_APP_VERSION_SIZE bytes, major, minor, patch.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note None.
+ *
+ * @endcode
+ */
+err_t lightranger5_get_app_version ( lightranger5_t *ctx, uint8_t *appid, uint8_t *version );
+
+/**
+ * @brief LightRanger 5 warm start check function.
+ * @details This function checks a device that was not reset, for example
+ * when only the real time application restarted.  The device is treated as
+ * cold unless it runs the measurement application, this driver only ever
+ * starts it from the downloaded image.
+ * @param[in] ctx : Click context object, initialized without resets.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[in] expected_version : Version the image reported when it was
+ * downloaded, NULL accepts any version.
+ * @return See #lightranger5_start_t.
+ * @note None.
+ *
+ * @endcode
+ */
+lightranger5_start_t lightranger5_check_warm_start ( lightranger5_t *ctx, const uint8_t *expected_version );
+
+/**
+ * @brief LightRanger 5 change I2C address function.
+ * @details This function moves the device to a new 7-bit I2C address and
+ * polls the ENABLE register at the new address until it answers.
+ * @param[in] ctx : Click context object, switched to the new address.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[in] new_i2c_address : New 7-bit I2C address.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note None.
+ *
+ * @endcode
+ */
 err_t lightranger5_change_12c_address ( lightranger5_t* ctx, uint8_t new_i2c_address );
 
+/**
+ * @brief LightRanger 5 request I2C address function.
+ * @details This function sends the address change command and switches the
+ * context to the new 7-bit address without waiting for the device, poll
+ * the ENABLE register for CPU_RDY | PON before using it.
+ * @param[in] ctx : Click context object, switched to the new address.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[in] new_i2c_address : New 7-bit I2C address.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note None.
+ *
+ * @endcode
+ */
+err_t lightranger5_request_i2c_address ( lightranger5_t* ctx, uint8_t new_i2c_address );
+
+/**
+ * @brief LightRanger 5 result interrupt function.
+ * @details This function enables or disables the result interrupt on the
+ * INT pin and clears a pending one.
+ * @param[in] ctx : Click context object.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[in] enable : Drive INT low while a new result is pending.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note The INT pin is open drain, several devices can share one line.
+ *
+ * @endcode
+ */
+err_t lightranger5_enable_result_interrupt ( lightranger5_t *ctx, bool enable );
+
+/**
+ * @brief LightRanger 5 read result function.
+ * @details This function checks INT_STATUS for a new result, clears it and
+ * reads the whole result block in one transfer.
+ * @param[in] ctx : Click context object.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[out] result : Result, only written if there was a new one.
+ * @return @li @c  1 - New result,
+ *         @li @c  0 - No new result,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note The interrupt is cleared before the block is read, a result that
+ * comes in meanwhile raises it again.
+ *
+ * @endcode
+ */
+err_t lightranger5_read_result ( lightranger5_t *ctx, lightranger5_result_t *result );
+
+/**
+ * @brief LightRanger 5 measurement configuration object setup function.
+ * @details This function initializes the measurement configuration
+ * structure to the default measurement command.
+ * @param[out] cfg : Measurement configuration object.
+ * See #lightranger5_measure_cfg_t object definition for detailed explanation.
+ * @return Nothing.
+ *
+ * @endcode
+ */
+void lightranger5_measure_cfg_setup ( lightranger5_measure_cfg_t *cfg );
+
+/**
+ * @brief LightRanger 5 start measurement function.
+ * @details This function writes the measurement command with its
+ * parameters, the TMF8801 then measures every period_ms.
+ * @param[in] ctx : Click context object.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[in] cfg : Measurement configuration object.
+ * See #lightranger5_measure_cfg_t object definition for detailed explanation.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note The factory calibration and algorithm state flagged in
+ * cfg->calibration have to be written first, see
+ * lightranger5_set_factory_calib_data().  Stop a running measurement
+ * with lightranger5_stop_measurement() before starting a new one.
+ *
+ * @endcode
+ */
+err_t lightranger5_start_measurement ( lightranger5_t *ctx, const lightranger5_measure_cfg_t *cfg );
+
+/**
+ * @brief LightRanger 5 stop measurement function.
+ * @details This function stops the periodic measurement and waits until
+ * the TMF8801 reports the stop command as executed.
+ * @param[in] ctx : Click context object.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note Polls for at most LIGHTRANGER5_BOOT_TIMEOUT_MS.
+ *
+ * @endcode
+ */
+err_t lightranger5_stop_measurement ( lightranger5_t *ctx );
+
+/**
+ * @brief LightRanger 5 histogram configuration function.
+ * @details This function selects the histograms the TMF8801 dumps after
+ * every measurement and sets or clears LIGHTRANGER5_INT_HISTOGRAM in
+ * INT_ENAB, the result interrupt setting is kept.
+ * @param[in] ctx : Click context object.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[in] types : LIGHTRANGER5_HIST_TYPE_* mask, 0 turns the dump off.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note Stop the measurement first, the setting applies to the next
+ * lightranger5_start_measurement().  Polls for at most
+ * LIGHTRANGER5_BOOT_TIMEOUT_MS.
+ *
+ * @endcode
+ */
+err_t lightranger5_configure_histograms ( lightranger5_t *ctx, uint8_t types );
+
+/**
+ * @brief LightRanger 5 read histogram function.
+ * @details This function checks INT_STATUS for a histogram dump, clears
+ * the interrupt bit and reads the 10 histogram blocks.
+ * @param[in] ctx : Click context object.
+ * See #lightranger5_t object definition for detailed explanation.
+ * @param[out] histogram : Histogram dump.
+ * See #lightranger5_histogram_t object definition for detailed explanation.
+ * @return @li @c  1 - A histogram was read,
+ *         @li @c  0 - No histogram is ready,
+ *         @li @c -1 - Error.
+ *
+ * See #err_t definition for detailed explanation.
+ * @note Each block is polled for at most LIGHTRANGER5_HIST_TIMEOUT_MS.
+ * The dump is about 1.3kB, keep the bus at 400kHz or faster.
+ *
+ * @endcode
+ */
+err_t lightranger5_read_histogram ( lightranger5_t *ctx, lightranger5_histogram_t *histogram );
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,13 +30,26 @@
 #include "os_hal_mbox_shared_mem.h"
 #include "avnetSmartShelfInterface.h"
 #include "lightranger5.h"
+#include "ranger_bringup.h"
+#include "ranger_histogram.h"
+#include "shelf_analytics.h"
+#include "i2c_bus.h"
+#include "cycle_counter.h"
 #include "avnet_starter_kit_hw.h"
 #include "pht.h"
 #include "drv.h"
 
+#ifdef LIGHTRANGER5_INT_GPIO
+#include "os_hal_gpio.h"
+#include "os_hal_eint.h"
+#endif
+
 // Add MT3620 constant
 #define MT3620_TIMER_TICKS_PER_SECOND ((ULONG) 100*10)
 
+// M4 core clock (197.6MHz) in cycles per microsecond, converts DWT cycle counts
+#define MT3620_M4_CYCLES_PER_US 197
+
 /* Configurations */
 #define APP_STACK_SIZE      1024
 #define DEMO_BYTE_POOL_SIZE 9120
@@ -47,6 +60,30 @@
 #define COMPONENT_ID_LEN_IN_SHARED_MEMORY 16
 #define COMMAND_BLOCK_OFFSET 20
 
+// The ranging thread checks the LightRanger5s for new results this often when LIGHTRANGER5_INT_GPIO is not
+// defined.  The sensors measure every 100ms and only hold the latest result, polling faster doesn't miss one.
+#define RANGING_POLL_MS 20
+
+// With LIGHTRANGER5_INT_GPIO defined the ranging thread still checks the sensors this often, in case an edge
+// was missed or a sensor's INT pin is not wired to the EINT GPIO
+#define RANGING_INT_TIMEOUT_MS 250
+
+// Telemetry only reports results younger than this, an older one means the sensor stopped measuring
+#define RANGER_RESULT_MAX_AGE_MS 1000
+
+// The histogram kernel works on the TMF8801 dump as it is read
+#if (RANGER_HISTOGRAM_TDC_COUNT != LIGHTRANGER5_HIST_TDC_COUNT) || (RANGER_HISTOGRAM_BINS != LIGHTRANGER5_HIST_BIN_COUNT) || \
+    (RANGER_HISTOGRAM_MAX_TARGETS != IC_SMART_SHELF_MAX_TARGETS)
+#error "ranger_histogram.h does not match the LightRanger5 histogram dump"
+#endif
+
+// Stock level and presence events waiting for the mbox thread, events are rare so a few are plenty
+#define SHELF_EVENT_QUEUE_LEN 16
+
+#if (SHELF_ANALYTICS_LEVEL_UNKNOWN != IC_SMART_SHELF_LEVEL_UNKNOWN)
+#error "shelf_analytics.h does not match avnetSmartShelfInterface.h"
+#endif
+
 // Define the memory layout of the incomming and outgoing message buffer
 typedef struct __attribute__((packed))
 {
@@ -83,7 +120,9 @@ static volatile bool hardwareInitOK = false;
 // Define the bits used for the telemetry event flag construct
 enum triggers {
     HIGH_LEVEL_MESSAGE = 0,
-    PERIODIC_TELEMETRY = 1
+    PERIODIC_TELEMETRY = 1,
+    RANGER_RESULT = 2,
+    SHELF_EVENT = 3
 };
 
 /* Define Semaphores */
@@ -97,6 +136,7 @@ volatile UCHAR  blockFifoSema;
 TX_THREAD               thread_mbox;
 TX_THREAD               thread_set_telemetry_flag;
 TX_THREAD               tx_hardware_init_thread;
+TX_THREAD               thread_ranging;
 
 // Application memory pool
 TX_BYTE_POOL            byte_pool_0;
@@ -104,18 +144,47 @@ UCHAR                   memory_area[DEMO_BYTE_POOL_SIZE];
 
 // Application flags
 TX_EVENT_FLAGS_GROUP    event_flags;
+
+// Protects rangerCalibration[] and rangerConfig[], written by the mbox thread and read by the hardware init and
+// ranging threads
+TX_MUTEX                calibration_mutex;
+
+// Protects rangerResults[], rangerTargets[], shelfLevel[] and the shelf event queue, written by the ranging thread
+// and read by the mbox thread
+TX_MUTEX                results_mutex;
+
 //TX_EVENT_FLAGS_GROUP    send_telemetry_event_flags_0;
 
 /* Define thread prototypes.  */
 void tx_thread_mbox_entry(ULONG thread_input);
 void set_telemetry_flag_thread_entry(ULONG thread_input);
 void hardware_init_thread(ULONG thread_input);
+void ranging_thread_entry(ULONG thread_input);
 
 /* Function prototypes */
 void mbox_fifo_cb(struct mtk_os_hal_mbox_cb_data *data);
 void mbox_swint_cb(struct mtk_os_hal_mbox_cb_data *data);
 bool initialize_hardware(void);
+bool initialize_lightranger5(lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5, int ranger, lightranger5_start_t start);
+lightranger5_start_t check_lightranger5(lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5, int ranger);
+void start_lightranger5(lightranger5_t* lightranger5, int ranger, uint8_t* factoryCalib);
+void restart_lightranger5(int ranger);
+void setup_ranger_bringup(ranger_bringup_t* bringup, lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5,
+                          int ranger, lightranger5_start_t start);
+void finish_ranger_bringup(ranger_bringup_t* bringup, int ranger);
+void enable_ranger_results(lightranger5_t* lightranger5, int ranger);
+void sendRangerCalibration(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void sendRangerConfig(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+bool setRangerConfig(int ranger, IC_SMART_SHELF_RANGER_CONFIG* config);
+void sendRangerHistogram(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+bool setRangerHistogram(int ranger, IC_SMART_SHELF_RANGER_HISTOGRAM* histogram);
+void sendRangerTargets(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+bool setShelfAnalytics(int ranger, IC_SMART_SHELF_SHELF_ANALYTICS* analytics);
+void sendShelfAnalytics(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void sendShelfEvents(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void sendI2cStats(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
 void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void copyRangerResults(IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing);
 void display_status_no_error (void);
 void display_status_error (void);
 
@@ -123,17 +192,112 @@ void display_status_error (void);
 static bool simulateShelfData = false;
 
 // LightRanger5 
-int getRange(lightranger5_t* lightranger5);
+int getSimulatedRange(int ranger, int range_mm);
+void snapshotRangerResults(IC_SMART_SHELF_RANGER_RESULT* rangerResult, uint16_t* rangerMask);
+void getRangerTargets(int ranger, IC_SMART_SHELF_RANGER_TARGETS* targets);
 static lightranger5_t lightranger5_Shelf1;
 static lightranger5_t lightranger5_Shelf2;
 static lightranger5_t lightranger5_peopleDetect;
+
+#ifdef SHELF_EXTRA_RANGERS
+
+// Additional shelf sensors from buildOptions.h, entry n is IC_SMART_SHELF_RANGER_SHELF3 + n
+typedef struct
+{
+    int en;                         // EN GPIO
+    uint8_t i2c_address;
+} shelf_extra_ranger_t;
+
+static const shelf_extra_ranger_t shelfExtraRangers[] = SHELF_EXTRA_RANGERS;
+#define SHELF_EXTRA_RANGER_COUNT (sizeof(shelfExtraRangers) / sizeof(shelfExtraRangers[0]))
+static lightranger5_t lightranger5_ShelfExtra[SHELF_EXTRA_RANGER_COUNT];
+
+#else
+#define SHELF_EXTRA_RANGER_COUNT 0
+#endif
 static uint8_t status_old = 255;
 static uint8_t status;
-static uint8_t factory_calib_data[ 14 ];
-static uint8_t tmf8801_algo_state[ 11 ] = { 0xB1, 0xA9, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-static uint8_t command_data[ 9 ] = { 0x03, 0x23, 0x00, 0x00, 0x00, 0x64, 0xFF, 0xFF, 0x02 };
+static uint8_t tmf8801_algo_state[ LIGHTRANGER5_ALGO_STATE_SIZE ] = { 0xB1, 0xA9, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+// Calibration download write frames, longer than the I2C FIFO so they are sent by DMA out of SYSRAM.  One pair
+// per ranger, rangers on different ISUs are started at the same time.
+static uint8_t factoryCalibFrame[IC_SMART_SHELF_RANGER_COUNT][LIGHTRANGER5_FRAME_SIZE(LIGHTRANGER5_FACTORY_CALIB_SIZE)] __attribute__((section(".sysram")));
+static uint8_t algoStateFrame[IC_SMART_SHELF_RANGER_COUNT][LIGHTRANGER5_FRAME_SIZE(LIGHTRANGER5_ALGO_STATE_SIZE)] __attribute__((section(".sysram")));
 static uint8_t appid_data;
 
+// Factory calibration per LightRanger5, either taken by this application after a firmware download or cached
+// by the high level application (IC_SMART_SHELF_SET_RANGER_CALIBRATION).  A cached calibration lets a cold
+// start skip the factory calibration and its appVersion lets a warm start skip the firmware download.
+static IC_SMART_SHELF_RANGER_CALIBRATION rangerCalibration[IC_SMART_SHELF_RANGER_COUNT];
+static uint8_t rangerStartMode[IC_SMART_SHELF_RANGER_COUNT];
+static uint32_t hardwareInitMs = 0;
+
+// Measurement settings per LightRanger5, set by the high level application (IC_SMART_SHELF_SET_RANGER_CONFIG).
+// A sensor is started with its entry, rangerConfigChanged has a bit per sensor the ranging thread restarts.
+static IC_SMART_SHELF_RANGER_CONFIG rangerConfig[IC_SMART_SHELF_RANGER_COUNT];
+static uint32_t rangerConfigChanged = 0;
+
+// Latest result per LightRanger5, collected by the ranging thread.  rangerContexts[] holds the sensors that are
+// measuring, it is filled in by the hardware init thread before hardwareInitOK is set.
+typedef struct
+{
+    bool valid;
+    ULONG timestamp;                // Tick the result was read
+    lightranger5_result_t result;
+} ranger_result_cache_t;
+
+static lightranger5_t* rangerContexts[IC_SMART_SHELF_RANGER_COUNT];
+static ranger_result_cache_t rangerResults[IC_SMART_SHELF_RANGER_COUNT];
+
+// Histogram mode per LightRanger5, set by the high level application (IC_SMART_SHELF_SET_RANGER_HISTOGRAM) and
+// protected by calibration_mutex.  Turning it on or off sets the sensor's rangerConfigChanged bit, the ranging
+// thread sets up the histogram dump when it restarts the sensor.
+static IC_SMART_SHELF_RANGER_HISTOGRAM rangerHistogram[IC_SMART_SHELF_RANGER_COUNT];
+
+// Histogram dump and crosstalk references, only used by the ranging thread.  rangerHistogramActive has a bit per
+// sensor that may be dumping histograms, the hardware init thread sets it for warm started sensors.
+static lightranger5_histogram_t rangerHistogramDump;
+static uint32_t rangerXtalk[IC_SMART_SHELF_RANGER_COUNT][RANGER_HISTOGRAM_BINS];
+static uint32_t rangerXtalkValid = 0;
+static uint32_t rangerHistogramActive = 0;
+
+// Targets found in the latest histogram per LightRanger5, protected by results_mutex
+typedef struct
+{
+    ULONG timestamp;                // Tick the histogram was read
+    IC_SMART_SHELF_RANGER_TARGETS targets;
+} ranger_targets_cache_t;
+
+static ranger_targets_cache_t rangerTargets[IC_SMART_SHELF_RANGER_COUNT];
+
+// Stock level and presence settings per LightRanger5, set by the high level application
+// (IC_SMART_SHELF_SET_SHELF_ANALYTICS) and protected by calibration_mutex.  shelfAnalyticsChanged has a bit per
+// sensor the ranging thread sets up again.
+static IC_SMART_SHELF_SHELF_ANALYTICS shelfAnalytics[IC_SMART_SHELF_RANGER_COUNT];
+static uint32_t shelfAnalyticsChanged = 0;
+
+// Median filter and debounce state, only used by the ranging thread
+static shelf_analytics_t shelfAnalyticsState[IC_SMART_SHELF_RANGER_COUNT];
+
+// Reported level per LightRanger5 and the events the mbox thread sends, protected by results_mutex.  Events are
+// only queued once the high level application set up the analytics, messageHeader holds its component ID then.
+static uint8_t shelfLevel[IC_SMART_SHELF_RANGER_COUNT];
+static IC_SMART_SHELF_EVENT shelfEvents[SHELF_EVENT_QUEUE_LEN];
+static uint8_t shelfEventFirst = 0;
+static uint8_t shelfEventCount = 0;
+static uint16_t shelfEventsDropped = 0;
+static volatile bool shelfEventsEnabled = false;
+
+// I2C bus accounting per LightRanger5 and for the PHT click, i2cStatsStart is the tick the counters started over
+static i2c_bus_device_t rangerBus[IC_SMART_SHELF_RANGER_COUNT];
+static i2c_bus_device_t phtBus;
+static ULONG i2cStatsStart;
+
+static const char* const rangerBusNames[IC_SMART_SHELF_RANGER_COUNT] = {
+    "LightRanger5 shelf1", "LightRanger5 shelf2", "LightRanger5 people", "LightRanger5 shelf3",
+    "LightRanger5 shelf4", "LightRanger5 shelf5", "LightRanger5 shelf6", "LightRanger5 shelf7",
+    "LightRanger5 shelf8"
+};
+
 // PHT Click
 static pht_t pht;
 static float pressure;
@@ -143,6 +307,9 @@ static float temperature;
 /* Define main entry point.  */
 void tx_main(void)
 {
+    /* Enable the DWT cycle counter used to time the histogram kernel */
+    cycle_counter_init();
+
     /* Enter the ThreadX kernel.  */
     tx_kernel_enter();
 }
@@ -175,6 +342,71 @@ void tx_application_define(void *first_unused_memory)
         printf("failed to create event_flags\r\n");
     }
 
+    status = tx_mutex_create(&calibration_mutex, "calibration mutex", TX_NO_INHERIT);
+    if (status != TX_SUCCESS)
+    {
+        printf("failed to create calibration_mutex\r\n");
+    }
+
+    status = tx_mutex_create(&results_mutex, "results mutex", TX_NO_INHERIT);
+    if (status != TX_SUCCESS)
+    {
+        printf("failed to create results_mutex\r\n");
+    }
+
+    // All the clicks share ISU2, the ranging thread reads the LightRanger5s while the mbox thread reads the PHT click
+    status = i2c_bus_init();
+    if (status != TX_SUCCESS)
+    {
+        printf("failed to create the i2c bus manager\r\n");
+    }
+
+    for (int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++) {
+        i2c_bus_device_init(&rangerBus[i], rangerBusNames[i], MIKROBUS_CLICK1_SDA);
+    }
+    i2c_bus_device_init(&phtBus, "PHT", MIKROBUS_CLICK1_SDA);
+    i2cStatsStart = tx_time_get();
+
+    // Every LightRanger5 starts with the default measurement command and histogram mode off
+    for (int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++) {
+
+        lightranger5_measure_cfg_t measureCfg;
+        ranger_histogram_cfg_t histogramCfg;
+        lightranger5_measure_cfg_setup(&measureCfg);
+        ranger_histogram_cfg_setup(&histogramCfg);
+
+        rangerConfig[i].valid = 1;
+        rangerConfig[i].periodMs = measureCfg.period_ms;
+        rangerConfig[i].kiloIterations = measureCfg.kilo_iterations;
+        rangerConfig[i].algorithm = measureCfg.algorithm;
+        rangerConfig[i].minConfidence = 0;
+
+        rangerHistogram[i].valid = 1;
+        rangerHistogram[i].enable = 0;
+        rangerHistogram[i].captureXtalk = 0;
+        rangerHistogram[i].maxTargets = histogramCfg.maxTargets;
+        rangerHistogram[i].minStrength = histogramCfg.minStrength;
+        rangerHistogram[i].binWidthUm = histogramCfg.binWidthUm;
+        rangerHistogram[i].offsetMm = histogramCfg.offsetMm;
+
+        // The people detect sensor reports presence, the others a fill level.  The shelf sensors need their
+        // empty and full ranges before they can be enabled.
+        shelf_analytics_cfg_t analyticsCfg;
+        shelf_analytics_cfg_setup(&analyticsCfg, (i == IC_SMART_SHELF_RANGER_PEOPLE) ? SHELF_ANALYTICS_PRESENCE :
+                                                                                      SHELF_ANALYTICS_STOCK);
+        shelf_analytics_setup(&shelfAnalyticsState[i], &analyticsCfg);
+
+        shelfAnalytics[i].valid = 1;
+        shelfAnalytics[i].enable = 0;
+        shelfAnalytics[i].hysteresisPct = analyticsCfg.hysteresisPct;
+        shelfAnalytics[i].presenceOnCount = analyticsCfg.presenceOnCount;
+        shelfAnalytics[i].emptyMm = analyticsCfg.emptyMm;
+        shelfAnalytics[i].fullMm = analyticsCfg.fullMm;
+        shelfAnalytics[i].presenceMm = analyticsCfg.presenceMm;
+        shelfAnalytics[i].presenceOffCount = analyticsCfg.presenceOffCount;
+        shelfLevel[i] = IC_SMART_SHELF_LEVEL_UNKNOWN;
+    }
+
     // -------------------------------- Threads --------------------------------
 
     /* Allocate the stack for thread_mbox.  */
@@ -198,6 +430,13 @@ void tx_application_define(void *first_unused_memory)
     tx_thread_create(&tx_hardware_init_thread, "hardware init thread", hardware_init_thread, 0,
         pointer, APP_STACK_SIZE, 6, 6, TX_NO_TIME_SLICE, TX_AUTO_START);
 
+    /* Allocate the stack for the ranging thread  */
+    tx_byte_allocate(&byte_pool_0, (VOID**) &pointer, APP_STACK_SIZE, TX_NO_WAIT);
+
+    // Create the ranging thread, it runs above the mbox thread so a result is read before the next one overwrites it
+    tx_thread_create(&thread_ranging, "ranging thread", ranging_thread_entry, 0,
+        pointer, APP_STACK_SIZE, 7, 7, TX_NO_TIME_SLICE, TX_AUTO_START);
+
     // -------------------------------- mailbox channels --------------------------------
 
     /* Open the MBOX channel of A7 <-> M4 */
@@ -217,6 +456,7 @@ void tx_thread_mbox_entry(ULONG thread_input)
     INT result;
     ULONG actual_flags;
     bool queuedMessages = true;
+    err_t err;
 
     printf("MBOX Task Started\n");
 
@@ -248,7 +488,7 @@ void tx_thread_mbox_entry(ULONG thread_input)
         // Once the call returns, it will also clear the event flags.  We use the actual_flags variable
         // to determine which flag was set
         ULONG status = tx_event_flags_get(&event_flags, 
-                                          (0x01 << HIGH_LEVEL_MESSAGE) | (0x01 << PERIODIC_TELEMETRY), 
+                                          (0x01 << HIGH_LEVEL_MESSAGE) | (0x01 << PERIODIC_TELEMETRY) | (0x01 << SHELF_EVENT), 
                                           TX_OR_CLEAR, &actual_flags, 
                                           TX_WAIT_FOREVER);
         
@@ -257,6 +497,12 @@ void tx_thread_mbox_entry(ULONG thread_input)
             break; 
         }    
 
+        // The ranging thread queued stock level or presence events, they can come along with any other flag
+        if (actual_flags & (0x01 << SHELF_EVENT)) {
+            sendShelfEvents(outbound, inbound, mbox_shared_buf_size);
+            actual_flags &= ~(0x01 << SHELF_EVENT);
+        }
+
         // Check to see if we're here because we received a message from the High Level App (actual_flags bit HIGH_LEVEL_MESSAGE set), 
         // or we're sending a periodic telemetry message up (actual_flags bit PERIODIC_TELEMETRY set)
         switch (actual_flags)
@@ -338,15 +584,14 @@ void tx_thread_mbox_entry(ULONG thread_input)
                         if(hardwareInitOK){
 
                             // Read the sensor data
-                            pht_get_temperature_pressure ( &pht, &temperature, &pressure);
-                            pht_get_relative_humidity ( &pht, &humidity);
+                            i2c_bus_lock(&phtBus);
+                            err = pht_get_measurement(&pht, &temperature, &pressure, &humidity);
+                            i2c_bus_unlock(&phtBus, err == PHT_OK);
 
                             payloadPtrOutgoing->payload.temp = temperature;
                             payloadPtrOutgoing->payload.pressure = pressure;
                             payloadPtrOutgoing->payload.hum = humidity;
-                            payloadPtrOutgoing->payload.rangePeople_mm = getRange(&lightranger5_peopleDetect);
-                            payloadPtrOutgoing->payload.rangeShelf1_mm = getRange(&lightranger5_Shelf1);
-                            payloadPtrOutgoing->payload.rangeShelf2_mm = getRange(&lightranger5_Shelf2);
+                            copyRangerResults(payloadPtrOutgoing);
 
                             printf("tempC: %.2fC, pressure: %.2f mbar, humidity: %.2f%%, peopleRange: %dmm, rangeShelf1: %dmm, rangeShelf2: %dmm\n\r", 
                                 payloadPtrOutgoing->payload.temp,
@@ -371,6 +616,98 @@ void tx_thread_mbox_entry(ULONG thread_input)
 
                         break;
 
+                    // The high level application sends the calibration it persisted from an earlier
+                    // IC_SMART_SHELF_GET_RANGER_CALIBRATION response.  Send this as soon as the real time
+                    // application starts, a cold start waits a couple of seconds before it downloads the
+                    // firmware and looks for a cached calibration after the download.
+                    case IC_SMART_SHELF_SET_RANGER_CALIBRATION:
+
+                        tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+                        for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+                            rangerCalibration[i] = payloadPtrIncomming->payload.rangerCalibration[i];
+                        }
+                        tx_mutex_put(&calibration_mutex);
+
+                        // Echo back the calibration along with how the sensors were started
+                        sendRangerCalibration(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    // The high level application is requesting the current calibration to persist it
+                    case IC_SMART_SHELF_GET_RANGER_CALIBRATION:
+
+                        sendRangerCalibration(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    // The high level application sends new measurement settings, entries with valid set are applied
+                    case IC_SMART_SHELF_SET_RANGER_CONFIG:
+
+                        for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+                            IC_SMART_SHELF_RANGER_CONFIG config = payloadPtrIncomming->payload.rangerConfig[i];
+                            if(config.valid && !setRangerConfig(i, &config)){
+                                printf("Invalid LightRanger5 %d config\n", i);
+                            }
+                        }
+
+                        // The ranging thread restarts the sensors, wake it if it waits for the INT pin.  Echo back the
+                        // settings in use.
+                        tx_event_flags_set(&event_flags, 0x01 << RANGER_RESULT, TX_OR);
+                        sendRangerConfig(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    case IC_SMART_SHELF_GET_RANGER_CONFIG:
+
+                        sendRangerConfig(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    // The high level application turns histogram mode on or off or asks for a crosstalk reference,
+                    // entries with valid set are applied
+                    case IC_SMART_SHELF_SET_RANGER_HISTOGRAM:
+
+                        for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+                            IC_SMART_SHELF_RANGER_HISTOGRAM histogram = payloadPtrIncomming->payload.rangerHistogram[i];
+                            if(histogram.valid && !setRangerHistogram(i, &histogram)){
+                                printf("Invalid LightRanger5 %d histogram settings\n", i);
+                            }
+                        }
+
+                        // The ranging thread restarts the sensors, wake it if it waits for the INT pin.  Echo back the
+                        // settings in use.
+                        tx_event_flags_set(&event_flags, 0x01 << RANGER_RESULT, TX_OR);
+                        sendRangerHistogram(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    case IC_SMART_SHELF_GET_RANGER_TARGETS:
+
+                        sendRangerTargets(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    // The high level application sets up the stock level and presence tracking, entries with valid
+                    // set are applied.  From now on the application sends IC_SMART_SHELF_SHELF_EVENT messages.
+                    case IC_SMART_SHELF_SET_SHELF_ANALYTICS:
+
+                        for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+                            IC_SMART_SHELF_SHELF_ANALYTICS analytics = payloadPtrIncomming->payload.shelfAnalytics[i];
+                            if(analytics.valid && !setShelfAnalytics(i, &analytics)){
+                                printf("Invalid LightRanger5 %d analytics settings\n", i);
+                            }
+                        }
+                        shelfEventsEnabled = true;
+
+                        // Echo back the settings in use
+                        sendShelfAnalytics(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    case IC_SMART_SHELF_GET_SHELF_ANALYTICS:
+
+                        sendShelfAnalytics(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    // The high level application asks which devices use the I2C bus
+                    case IC_SMART_SHELF_GET_I2C_STATS:
+
+                        sendI2cStats(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
                     case IC_SMART_SHELF_HEARTBEAT:
                         printf("Realtime app processing heartbeat command\n");
 
@@ -431,13 +768,297 @@ void set_telemetry_flag_thread_entry(ULONG thread_input)
 // only purpose in life is to initialize the hardware.
 void hardware_init_thread(ULONG thread_input)
 {
+    ULONG startTime = tx_time_get();
+
     // Initialize the hardware
     if (initialize_hardware())
     {
         hardwareInitOK = true;
     }
 
-    printf("Hardware Init - %s\r\n", hardwareInitOK ? "OK" : "FAIL");
+    hardwareInitMs = (uint32_t)(tx_time_get() - startTime) * 1000 / MT3620_TIMER_TICKS_PER_SECOND;
+    printf("Hardware Init - %s in %lu ms\r\n", hardwareInitOK ? "OK" : "FAIL", hardwareInitMs);
+}
+
+#ifdef LIGHTRANGER5_INT_GPIO
+// EINT handler for the LightRanger5 INT pin.  This runs in interrupt context, so just set the flag and let the
+// ranging thread read the results.
+static void lightranger5_int_handler(void)
+{
+    tx_event_flags_set(&event_flags, 0x01 << RANGER_RESULT, TX_OR);
+}
+#endif
+
+// Keeps a new result, a jump in the result number means a result was overwritten before it was read
+static void store_ranger_result(int ranger, lightranger5_result_t* result)
+{
+    ranger_result_cache_t* cache = &rangerResults[ranger];
+    uint8_t missed = 0;
+
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    if (cache->valid) {
+        missed = (uint8_t)(result->result_number - cache->result.result_number - 1);
+    }
+    cache->result = *result;
+    cache->timestamp = tx_time_get();
+    cache->valid = true;
+    tx_mutex_put(&results_mutex);
+
+    if (missed) {
+        printf("LightRanger5 %d: missed %u results\n", ranger, missed);
+    }
+}
+
+#ifdef RANGER_HISTOGRAM_PRINT_DUMPS
+
+// Prints a histogram dump in the format the host tests read, see test/histogram_dump.h
+static void print_ranger_histogram(int ranger, const lightranger5_histogram_t* histogram)
+{
+    printf("# LightRanger5 %d histogram dump at %lu ms\n", ranger, (unsigned long)tx_time_get());
+
+    for (int tdc = 0; tdc < LIGHTRANGER5_HIST_TDC_COUNT; tdc++) {
+        for (int bin = 0; bin < LIGHTRANGER5_HIST_BIN_COUNT; bin++) {
+            printf("%u%s", histogram->bins[tdc][bin], (bin < LIGHTRANGER5_HIST_BIN_COUNT - 1) ? "," : "\n");
+        }
+    }
+}
+
+#endif
+
+// Reads the histogram dump of a sensor in histogram mode and finds the targets in it.  Returns true if there was a
+// dump, it has to be read before the sensor takes its next measurement.
+static bool collect_ranger_histogram(int ranger)
+{
+    IC_SMART_SHELF_RANGER_HISTOGRAM settings;
+    ranger_histogram_cfg_t cfg;
+    ranger_histogram_targets_t found;
+    ranger_targets_cache_t* cache = &rangerTargets[ranger];
+    uint32_t readCycles;
+    uint32_t kernelCycles;
+    bool calibrated;
+    err_t err;
+
+    i2c_bus_lock(&rangerBus[ranger]);
+    readCycles = cycle_counter_get();
+    err = lightranger5_read_histogram(rangerContexts[ranger], &rangerHistogramDump);
+    readCycles = cycle_counter_get() - readCycles;
+    i2c_bus_unlock(&rangerBus[ranger], err >= 0);
+
+    if (err <= 0) {
+        return false;
+    }
+
+#ifdef RANGER_HISTOGRAM_PRINT_DUMPS
+    print_ranger_histogram(ranger, &rangerHistogramDump);
+#endif
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    settings = rangerHistogram[ranger];
+    rangerHistogram[ranger].captureXtalk = 0;
+    calibrated = rangerCalibration[ranger].valid;
+    tx_mutex_put(&calibration_mutex);
+
+    if (!settings.enable) {
+
+        // Left on from before the real time application restarted, restart the sensor with the dump off.  The
+        // restart needs the factory calibration, without one the dumps are just read.
+        if (calibrated) {
+            tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+            rangerConfigChanged |= 1UL << ranger;
+            tx_mutex_put(&calibration_mutex);
+        }
+        return true;
+    }
+
+    if (settings.captureXtalk) {
+        ranger_histogram_make_xtalk(rangerHistogramDump.bins, rangerXtalk[ranger]);
+        rangerXtalkValid |= 1UL << ranger;
+        printf("LightRanger5 %d: crosstalk reference captured\n", ranger);
+    }
+
+    ranger_histogram_cfg_setup(&cfg);
+    cfg.maxTargets = settings.maxTargets;
+    cfg.minStrength = settings.minStrength;
+    cfg.binWidthUm = settings.binWidthUm;
+    cfg.offsetMm = settings.offsetMm;
+
+    kernelCycles = cycle_counter_get();
+    ranger_histogram_find_targets(rangerHistogramDump.bins,
+                                  (rangerXtalkValid & (1UL << ranger)) ? rangerXtalk[ranger] : NULL, &cfg, &found);
+    kernelCycles = cycle_counter_get() - kernelCycles;
+
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    cache->timestamp = tx_time_get();
+    cache->targets.valid = 1;
+    cache->targets.xtalkValid = (rangerXtalkValid & (1UL << ranger)) ? 1 : 0;
+    cache->targets.count = found.count;
+    cache->targets.sequence++;
+    for (int i = 0; i < found.count; i++) {
+        cache->targets.targets[i].distance_mm = found.targets[i].distance_mm;
+        cache->targets.targets[i].strength = found.targets[i].strength;
+    }
+    cache->targets.ambient = found.ambient;
+    cache->targets.readUs = readCycles / MT3620_M4_CYCLES_PER_US;
+    cache->targets.kernelCycles = kernelCycles;
+    tx_mutex_put(&results_mutex);
+
+    return true;
+}
+
+// Starts the stock level or presence tracking of a sensor over with its shelfAnalytics[] entry
+static void setup_shelf_analytics(int ranger)
+{
+    IC_SMART_SHELF_SHELF_ANALYTICS settings;
+    shelf_analytics_cfg_t cfg;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    settings = shelfAnalytics[ranger];
+    tx_mutex_put(&calibration_mutex);
+
+    shelf_analytics_cfg_setup(&cfg, (ranger == IC_SMART_SHELF_RANGER_PEOPLE) ? SHELF_ANALYTICS_PRESENCE :
+                                                                              SHELF_ANALYTICS_STOCK);
+    cfg.emptyMm = settings.emptyMm;
+    cfg.fullMm = settings.fullMm;
+    cfg.hysteresisPct = settings.hysteresisPct;
+    cfg.presenceMm = settings.presenceMm;
+    cfg.presenceOnCount = settings.presenceOnCount;
+    cfg.presenceOffCount = settings.presenceOffCount;
+    shelf_analytics_setup(&shelfAnalyticsState[ranger], &cfg);
+
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    shelfLevel[ranger] = IC_SMART_SHELF_LEVEL_UNKNOWN;
+    tx_mutex_put(&results_mutex);
+}
+
+// Runs a new result through the stock level or presence tracking and queues an event for the mbox thread when the
+// level changes.  A result below minConfidence counts as no object, like in the telemetry.
+static void update_shelf_analytics(int ranger, lightranger5_result_t* result)
+{
+    shelf_analytics_t* analytics = &shelfAnalyticsState[ranger];
+    uint8_t minConfidence;
+    uint8_t previous;
+    bool enable;
+    int range_mm;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    minConfidence = rangerConfig[ranger].minConfidence;
+    enable = shelfAnalytics[ranger].enable;
+    tx_mutex_put(&calibration_mutex);
+
+    if (!enable) {
+        return;
+    }
+
+    range_mm = (result->distance_mm && (result->confidence >= minConfidence)) ? result->distance_mm : -1;
+    if (!shelf_analytics_update(analytics, range_mm, &previous)) {
+        return;
+    }
+
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    shelfLevel[ranger] = analytics->level;
+
+    if (shelfEventCount < SHELF_EVENT_QUEUE_LEN) {
+
+        IC_SMART_SHELF_EVENT* event = &shelfEvents[(shelfEventFirst + shelfEventCount) % SHELF_EVENT_QUEUE_LEN];
+
+        event->type = (analytics->cfg.mode == SHELF_ANALYTICS_PRESENCE) ? IC_SMART_SHELF_EVENT_PRESENCE :
+                                                                          IC_SMART_SHELF_EVENT_STOCK_LEVEL;
+        event->ranger = (uint8_t)ranger;
+        event->level = analytics->level;
+        event->previous = previous;
+        event->range_mm = analytics->median_mm;
+        event->dropped = shelfEventsDropped;
+        event->timestampMs = tx_time_get() * (1000 / MT3620_TIMER_TICKS_PER_SECOND);
+        shelfEventCount++;
+        shelfEventsDropped = 0;
+    }
+    else if (shelfEventsDropped < 0xFFFF) {
+        shelfEventsDropped++;
+    }
+    tx_mutex_put(&results_mutex);
+
+    tx_event_flags_set(&event_flags, 0x01 << SHELF_EVENT, TX_OR);
+}
+
+// The ranging thread reads every LightRanger5 result into rangerResults[] as it comes in, so telemetry only
+// copies the latest one.  The TMF8801 drives its INT pin low when a result is ready, with LIGHTRANGER5_INT_GPIO
+// defined the EINT wakes this thread, otherwise it polls INT_STATUS.
+void ranging_thread_entry(ULONG thread_input)
+{
+    lightranger5_result_t result;
+    bool collected;
+    uint32_t changed;
+    uint32_t analyticsChanged;
+    err_t err;
+
+#ifdef LIGHTRANGER5_INT_GPIO
+    ULONG actual_flags;
+#endif
+
+    printf("Ranging Task Started\n");
+
+    // The hardware init thread registers the sensors
+    while (!hardwareInitOK) {
+        tx_thread_sleep(RANGING_POLL_MS * MT3620_TIMER_TICKS_PER_SECOND / 1000);
+    }
+
+    while (true) {
+
+        // Restart the sensors the high level application sent new settings for
+        tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+        changed = rangerConfigChanged;
+        rangerConfigChanged = 0;
+        analyticsChanged = shelfAnalyticsChanged;
+        shelfAnalyticsChanged = 0;
+        tx_mutex_put(&calibration_mutex);
+
+        for (int ranger = 0; ranger < IC_SMART_SHELF_RANGER_COUNT; ranger++) {
+            if (analyticsChanged & (1UL << ranger)) {
+                setup_shelf_analytics(ranger);
+            }
+        }
+
+        for (int ranger = 0; ranger < IC_SMART_SHELF_RANGER_COUNT; ranger++) {
+            if ((changed & (1UL << ranger)) && (rangerContexts[ranger] != NULL)) {
+                restart_lightranger5(ranger);
+            }
+        }
+
+        // The INT pins are open drain and may share a line, it only falls again once every sensor's result
+        // was read.  Keep going until a pass finds nothing new.
+        do {
+            collected = false;
+
+            for (int ranger = 0; ranger < IC_SMART_SHELF_RANGER_COUNT; ranger++) {
+
+                if (rangerContexts[ranger] == NULL) {
+                    continue;
+                }
+
+                i2c_bus_lock(&rangerBus[ranger]);
+                err = lightranger5_read_result(rangerContexts[ranger], &result);
+                i2c_bus_unlock(&rangerBus[ranger], err >= 0);
+
+                if (err > 0) {
+                    store_ranger_result(ranger, &result);
+                    update_shelf_analytics(ranger, &result);
+                    collected = true;
+                }
+
+                // A sensor in histogram mode holds its next measurement until the dump was read
+                if ((rangerHistogramActive & (1UL << ranger)) && collect_ranger_histogram(ranger)) {
+                    collected = true;
+                }
+            }
+        } while (collected);
+
+#ifdef LIGHTRANGER5_INT_GPIO
+        tx_event_flags_get(&event_flags, 0x01 << RANGER_RESULT, TX_OR_CLEAR, &actual_flags,
+                           RANGING_INT_TIMEOUT_MS * MT3620_TIMER_TICKS_PER_SECOND / 1000);
+#else
+        tx_thread_sleep(RANGING_POLL_MS * MT3620_TIMER_TICKS_PER_SECOND / 1000);
+#endif
+    }
 }
 
 /* Mailbox Fifo Interrupt handler.
@@ -480,6 +1101,8 @@ void mbox_swint_cb(struct mtk_os_hal_mbox_cb_data *data)
 
 void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
     
+    err_t err;
+
     // Init a pointer to the outgoing message, cast it so we can index into the structure.
     IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
 
@@ -494,16 +1117,15 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
     if(hardwareInitOK){
         
         // Read the sensor data
-        pht_get_temperature_pressure(&pht, &temperature, &pressure);
-        pht_get_relative_humidity(&pht, &humidity);
+        i2c_bus_lock(&phtBus);
+        err = pht_get_measurement(&pht, &temperature, &pressure, &humidity);
+        i2c_bus_unlock(&phtBus, err == PHT_OK);
         
         // Copy the sensor data into the outgoing payload structure
         payloadPtrOutgoing->payload.temp = temperature;
         payloadPtrOutgoing->payload.pressure = pressure;
         payloadPtrOutgoing->payload.hum = humidity;
-        payloadPtrOutgoing->payload.rangePeople_mm = getRange(&lightranger5_peopleDetect);
-        payloadPtrOutgoing->payload.rangeShelf1_mm = getRange(&lightranger5_Shelf1);
-        payloadPtrOutgoing->payload.rangeShelf2_mm = getRange(&lightranger5_Shelf2);
+        copyRangerResults(payloadPtrOutgoing);
 
         // Construct the telemetry response
         snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE,  
@@ -526,63 +1148,195 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
     EnqueueData(inbound, outbound, mbox_shared_buf_size, payloadPtrOutgoing, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
 }
 
-bool initialize_lightranger5(lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5, bool includeResets){
-   
+// Fills in the LightRanger5 results of a sensor data response from the cache the ranging thread keeps, none of
+// the sensors is read here so the time this takes doesn't depend on how many of them are measuring
+void copyRangerResults(IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing){
+
+    IC_SMART_SHELF_RANGER_RESULT rangerResult[IC_SMART_SHELF_RANGER_COUNT];
+    uint16_t rangerMask;
+
+    snapshotRangerResults(rangerResult, &rangerMask);
+
+    payloadPtrOutgoing->payload.rangePeople_mm = rangerResult[IC_SMART_SHELF_RANGER_PEOPLE].distance_mm;
+    payloadPtrOutgoing->payload.rangeShelf1_mm = getSimulatedRange(IC_SMART_SHELF_RANGER_SHELF1,
+                                                                   rangerResult[IC_SMART_SHELF_RANGER_SHELF1].distance_mm);
+    payloadPtrOutgoing->payload.rangeShelf2_mm = getSimulatedRange(IC_SMART_SHELF_RANGER_SHELF2,
+                                                                   rangerResult[IC_SMART_SHELF_RANGER_SHELF2].distance_mm);
+
+    for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+        payloadPtrOutgoing->payload.rangerResult[i] = rangerResult[i];
+    }
+    payloadPtrOutgoing->payload.rangerMask = rangerMask;
+
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+        payloadPtrOutgoing->payload.shelfLevel[i] = shelfLevel[i];
+    }
+    tx_mutex_put(&results_mutex);
+}
+
+// Sends the LightRanger5 calibration and how each sensor was started to the high level application, the
+// incomming message in mbox_local_buf has been processed already
+void sendRangerCalibration(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+        payloadPtrOutgoing->payload.rangerCalibration[i] = rangerCalibration[i];
+        payloadPtrOutgoing->payload.rangerStartMode[i] = rangerStartMode[i];
+    }
+    tx_mutex_put(&calibration_mutex);
+
+    payloadPtrOutgoing->payload.hardwareInitMs = hardwareInitMs;
+
+    // Write to A7, enqueue to mailbox, the cmd byte already contains the command we're responding to
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
+// Sets up the context for a LightRanger5 that has not been reset and checks if it still runs the firmware image
+// from before the real time application restarted.  The image version has to match the cached calibration, until
+// the high level application sends one any running measurement app is accepted since only this application
+// starts it.
+lightranger5_start_t check_lightranger5(lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5, int ranger){
+
+    IC_SMART_SHELF_RANGER_CALIBRATION calibration;
+
+    if ( lightranger5_init( lightranger5, lightranger_cfg, false ) == I2C_MASTER_ERROR ) {
+        return LIGHTRANGER5_START_COLD;
+    }
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    calibration = rangerCalibration[ranger];
+    tx_mutex_put(&calibration_mutex);
+
+    return lightranger5_check_warm_start( lightranger5, calibration.valid ? calibration.appVersion : NULL );
+}
+
+// Starts the periodic distance measurement on a LightRanger5.  A warm started sensor is already measuring, after
+// a firmware download (cold) or if only the measurement was stopped (image loaded) the cached factory calibration
+// is used if it was taken with the same image version, otherwise the factory calibration is run.
+bool initialize_lightranger5(lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5, int ranger, lightranger5_start_t start){
+
+    IC_SMART_SHELF_RANGER_CALIBRATION calibration;
+    uint8_t appVersion[LIGHTRANGER5_APP_VERSION_SIZE];
+
     int err_count = 128;
 
-    err_t init_flag = lightranger5_init( lightranger5, lightranger_cfg, includeResets );
-    if ( init_flag == I2C_MASTER_ERROR ) {
-        printf(" Application Init Error. " );
-        printf(" Please, run program again... " );
-        return false;
+    rangerStartMode[ranger] = start;
+
+    if ( start == LIGHTRANGER5_START_WARM ) {
+        printf(" Measurement app already running, warm start.\r\n" );
+        enable_ranger_results( lightranger5, ranger );
+        return true;
     }
-    
-    lightranger5_default_cfg( lightranger5 );
-    printf(" Application Task " );
-    Delay_ms( 100 );
-    
-    if ( !lightranger5_check_factory_calibration( lightranger5 ) ) {
-        printf(" Factory calibration success." );
-    } else {
-        printf(" Factory calibration FAILED.\n" );
-        printf(" Please, run program again...\n" );
+
+    if ( start == LIGHTRANGER5_START_COLD ) {
+
+        err_t init_flag = lightranger5_init( lightranger5, lightranger_cfg, false );
+        if ( init_flag == I2C_MASTER_ERROR ) {
+            printf(" Application Init Error. " );
+            printf(" Please, run program again... " );
+            return false;
+        }
+        
+        lightranger5_default_cfg( lightranger5 );
+        printf(" Application Task " );
+        Delay_ms( 100 );
+    }
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    calibration = rangerCalibration[ranger];
+    tx_mutex_put(&calibration_mutex);
+
+    // Make sure the measurement app is running, then check the cached calibration belongs to this image
+    lightranger5_get_currently_run_app( lightranger5, &appid_data );
+    if ( appid_data != LIGHTRANGER5_APPID_MEASUREMENT ) {
+        lightranger5_load_app( lightranger5 );
+    }
+    if ( lightranger5_get_app_version( lightranger5, &appid_data, appVersion ) ||
+         ( appid_data != LIGHTRANGER5_APPID_MEASUREMENT ) ) {
+        printf(" Measurement app FAILED to start.\n" );
         return false;
     }
 
-    do {
-        lightranger5_get_status( lightranger5, &status );
+    if ( calibration.valid && !memcmp( calibration.appVersion, appVersion, LIGHTRANGER5_APP_VERSION_SIZE ) ) {
+        printf(" Using cached factory calibration.\r\n" );
+    }
+    else {
 
-        if ( status_old != status ) {
-            if ( status < LIGHTRANGER5_STATUS_OK ) {
-                display_status_no_error( );    
-            } else {
-                display_status_error( );   
-            }  
-            status_old = status;
-        }
-        Delay_ms( 250 );
-        if(--err_count <= 0){
+        if ( !lightranger5_check_factory_calibration( lightranger5 ) ) {
+            printf(" Factory calibration success." );
+        } else {
+            printf(" Factory calibration FAILED.\n" );
+            printf(" Please, run program again...\n" );
             return false;
         }
-    } while ( status );
-    
 
-    lightranger5_get_factory_calib_data( lightranger5, factory_calib_data );
-    
+        do {
+            lightranger5_get_status( lightranger5, &status );
+
+            if ( status_old != status ) {
+                if ( status < LIGHTRANGER5_STATUS_OK ) {
+                    display_status_no_error( );    
+                } else {
+                    display_status_error( );   
+                }  
+                status_old = status;
+            }
+            Delay_ms( 250 );
+            if(--err_count <= 0){
+                return false;
+            }
+        } while ( status );
+
+        lightranger5_get_factory_calib_data( lightranger5, calibration.factoryCalib );
+        memcpy( calibration.appVersion, appVersion, LIGHTRANGER5_APP_VERSION_SIZE );
+        calibration.valid = 1;
+
+        // Keep it for the high level application to read with IC_SMART_SHELF_GET_RANGER_CALIBRATION
+        tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+        rangerCalibration[ranger] = calibration;
+        tx_mutex_put(&calibration_mutex);
+    }
+
+    start_lightranger5( lightranger5, ranger, calibration.factoryCalib );
+    enable_ranger_results( lightranger5, ranger );
+    return true;
+}
+
+// Downloads the factory calibration, the algorithm state and the measurement command, this starts the periodic
+// distance measurement
+void start_lightranger5(lightranger5_t* lightranger5, int ranger, uint8_t* factoryCalib){
+
+    IC_SMART_SHELF_RANGER_CONFIG config;
+    lightranger5_measure_cfg_t measureCfg;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    config = rangerConfig[ranger];
+    tx_mutex_put(&calibration_mutex);
+
+    lightranger5_measure_cfg_setup( &measureCfg );
+    measureCfg.period_ms = config.periodMs;
+    measureCfg.kilo_iterations = config.kiloIterations;
+    measureCfg.algorithm = config.algorithm;
+
     printf("------------------------------\r\n" );
     printf(" factory_calib_data[ 14 ] =\r\n { " );
     
     for ( uint8_t n_cnt = 0 ; n_cnt < 14 ; n_cnt++ ) {
-        printf("0x%.2X, ", factory_calib_data[ n_cnt ] );
+        printf("0x%.2X, ", factoryCalib[ n_cnt ] );
     }
 
     printf("};\r\n" );
     printf("------------------------------\r\n" );
     
     lightranger5_set_command( lightranger5, LIGHTRANGER5_CMD_DL_CALIB_AND_STATE );
-    lightranger5_set_factory_calib_data( lightranger5, factory_calib_data );
-    lightranger5_set_algorithm_state_data( lightranger5, tmf8801_algo_state );
-    lightranger5_set_command_data( lightranger5, command_data );
+    memcpy( &factoryCalibFrame[ranger][1], factoryCalib, LIGHTRANGER5_FACTORY_CALIB_SIZE );
+    memcpy( &algoStateFrame[ranger][1], tmf8801_algo_state, LIGHTRANGER5_ALGO_STATE_SIZE );
+    lightranger5_set_factory_calib_data( lightranger5, factoryCalibFrame[ranger] );
+    lightranger5_set_algorithm_state_data( lightranger5, algoStateFrame[ranger] );
+    lightranger5_start_measurement( lightranger5, &measureCfg );
     lightranger5_get_status( lightranger5, &status );
         
     if ( status_old != status ) {
@@ -604,85 +1358,474 @@ bool initialize_lightranger5(lightranger5_cfg_t* lightranger_cfg, lightranger5_t
     } else {
         printf(" Result: 0x%X\r\n", appid_data );    
     }
+}
+
+// Fills in the parallel bring up of one shelf sensor, the cached calibration is taken after the startup sleep so
+// the high level application had the chance to send it (IC_SMART_SHELF_SET_RANGER_CALIBRATION)
+void setup_ranger_bringup(ranger_bringup_t* bringup, lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5,
+                          int ranger, lightranger5_start_t start){
+
+    IC_SMART_SHELF_RANGER_CALIBRATION calibration;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    calibration = rangerCalibration[ranger];
+    tx_mutex_put(&calibration_mutex);
+
+    memset(bringup, 0, sizeof(*bringup));
+    bringup->ctx = lightranger5;
+    bringup->cfg = *lightranger_cfg;
+    bringup->start = start;
+    bringup->calibrationValid = calibration.valid;
+    memcpy(bringup->appVersion, calibration.appVersion, LIGHTRANGER5_APP_VERSION_SIZE);
+    memcpy(bringup->factoryCalib, calibration.factoryCalib, LIGHTRANGER5_FACTORY_CALIB_SIZE);
+
+    rangerStartMode[ranger] = start;
+}
+
+// Keeps a calibration taken during the bring up for the high level application and starts the measurement
+void finish_ranger_bringup(ranger_bringup_t* bringup, int ranger){
+
+    if ( bringup->calibrated ) {
+
+        tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+        rangerCalibration[ranger].valid = 1;
+        memcpy(rangerCalibration[ranger].appVersion, bringup->appVersion, LIGHTRANGER5_APP_VERSION_SIZE);
+        memcpy(rangerCalibration[ranger].factoryCalib, bringup->factoryCalib, LIGHTRANGER5_FACTORY_CALIB_SIZE);
+        tx_mutex_put(&calibration_mutex);
+    }
+
+    if ( bringup->start != LIGHTRANGER5_START_WARM ) {
+        start_lightranger5( bringup->ctx, ranger, bringup->factoryCalib );
+    }
+    enable_ranger_results( bringup->ctx, ranger );
+}
+
+// Raises the result interrupt of a measuring LightRanger5 and hands it to the ranging thread.  A warm started
+// sensor may still have a result pending from before the restart, it is cleared here.
+void enable_ranger_results(lightranger5_t* lightranger5, int ranger){
+
+    if ( lightranger5_enable_result_interrupt( lightranger5, true ) != LIGHTRANGER5_OK ) {
+        printf(" Result interrupt FAILED to enable.\n" );
+    }
+    rangerContexts[ranger] = lightranger5;
+
+    // A warm started sensor may still dump histograms, the ranging thread checks
+    if ( rangerStartMode[ranger] == LIGHTRANGER5_START_WARM ) {
+        rangerHistogramActive |= 1UL << ranger;
+    }
+}
+
+// Restarts the measurement of a running LightRanger5 with its rangerConfig[] entry, called by the ranging thread.
+// The measurement command needs the factory calibration, without one the settings are used at the next start.
+void restart_lightranger5(int ranger){
+
+    IC_SMART_SHELF_RANGER_CALIBRATION calibration;
+    lightranger5_t* lightranger5 = rangerContexts[ranger];
+    bool restarted = false;
+    bool histogram;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    calibration = rangerCalibration[ranger];
+    histogram = rangerHistogram[ranger].enable;
+    tx_mutex_put(&calibration_mutex);
+
+    if ( !calibration.valid ) {
+        printf("LightRanger5 %d: no factory calibration, new settings are used at the next start\n", ranger );
+        return;
+    }
+
+    i2c_bus_lock(&rangerBus[ranger]);
+    if ( lightranger5_stop_measurement( lightranger5 ) == LIGHTRANGER5_OK ) {
+
+        // The histogram dump is set up while the measurement is stopped
+        if ( lightranger5_configure_histograms( lightranger5, histogram ? LIGHTRANGER5_HIST_TYPE_DISTANCE : 0 ) ==
+             LIGHTRANGER5_OK ) {
+            if ( histogram ) {
+                rangerHistogramActive |= 1UL << ranger;
+            } else {
+                rangerHistogramActive &= ~( 1UL << ranger );
+            }
+        }
+        start_lightranger5( lightranger5, ranger, calibration.factoryCalib );
+        restarted = ( lightranger5_enable_result_interrupt( lightranger5, true ) == LIGHTRANGER5_OK );
+    }
+    i2c_bus_unlock(&rangerBus[ranger], restarted);
+
+    // The result numbers start over
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    rangerResults[ranger].valid = false;
+    rangerTargets[ranger].targets.valid = 0;
+    tx_mutex_put(&results_mutex);
+
+    printf("LightRanger5 %d: restart %s%s\n", ranger, restarted ? "OK" : "FAILED",
+           ( rangerHistogramActive & ( 1UL << ranger ) ) ? ", histogram mode" : "" );
+}
+
+// Checks and keeps new measurement settings for a LightRanger5 and flags it for the ranging thread to restart
+bool setRangerConfig(int ranger, IC_SMART_SHELF_RANGER_CONFIG* config){
+
+    if ( ( config->periodMs == 0 ) || ( config->kiloIterations == 0 ) || ( config->algorithm == 0 ) ||
+         ( config->minConfidence > 63 ) ) {
+        return false;
+    }
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    rangerConfig[ranger] = *config;
+    rangerConfig[ranger].valid = 1;
+    rangerConfigChanged |= 1UL << ranger;
+    tx_mutex_put(&calibration_mutex);
 
     return true;
 }
 
+void sendRangerConfig(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+        payloadPtrOutgoing->payload.rangerConfig[i] = rangerConfig[i];
+    }
+    tx_mutex_put(&calibration_mutex);
+
+    // Write to A7, enqueue to mailbox, the cmd byte already contains the command we're responding to
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
+// Checks and keeps new histogram settings for a LightRanger5, turning histogram mode on or off flags the sensor for
+// the ranging thread to restart
+bool setRangerHistogram(int ranger, IC_SMART_SHELF_RANGER_HISTOGRAM* histogram){
+
+    if ( ( histogram->maxTargets == 0 ) || ( histogram->maxTargets > IC_SMART_SHELF_MAX_TARGETS ) ||
+         ( histogram->binWidthUm == 0 ) ) {
+        return false;
+    }
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    if ( ( histogram->enable != 0 ) != ( rangerHistogram[ranger].enable != 0 ) ) {
+        rangerConfigChanged |= 1UL << ranger;
+    }
+    rangerHistogram[ranger] = *histogram;
+    rangerHistogram[ranger].valid = 1;
+    tx_mutex_put(&calibration_mutex);
+
+    return true;
+}
+
+void sendRangerHistogram(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+        payloadPtrOutgoing->payload.rangerHistogram[i] = rangerHistogram[i];
+    }
+    tx_mutex_put(&calibration_mutex);
+
+    // Write to A7, enqueue to mailbox, the cmd byte already contains the command we're responding to
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
+void sendRangerTargets(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+
+    for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+
+        IC_SMART_SHELF_RANGER_TARGETS targets;
+        getRangerTargets(i, &targets);
+        payloadPtrOutgoing->payload.rangerTargets[i] = targets;
+
+        if(targets.valid){
+            printf("LightRanger5 %d: %u targets, nearest %dmm, histogram read in %luus, targets found in %lu cycles\n",
+                   i, targets.count, targets.count ? targets.targets[0].distance_mm : -1, targets.readUs,
+                   targets.kernelCycles);
+        }
+    }
+
+    // Write to A7, enqueue to mailbox, the cmd byte already contains the command we're responding to
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
+// Checks and keeps new stock level or presence settings for a LightRanger5 and flags it for the ranging thread to
+// start its tracking over.  A shelf sensor needs its empty and full ranges to be enabled.
+bool setShelfAnalytics(int ranger, IC_SMART_SHELF_SHELF_ANALYTICS* analytics){
+
+    shelf_analytics_cfg_t cfg;
+
+    shelf_analytics_cfg_setup( &cfg, ( ranger == IC_SMART_SHELF_RANGER_PEOPLE ) ? SHELF_ANALYTICS_PRESENCE :
+                                                                                SHELF_ANALYTICS_STOCK );
+    cfg.emptyMm = analytics->emptyMm;
+    cfg.fullMm = analytics->fullMm;
+    cfg.hysteresisPct = analytics->hysteresisPct;
+    cfg.presenceMm = analytics->presenceMm;
+    cfg.presenceOnCount = analytics->presenceOnCount;
+    cfg.presenceOffCount = analytics->presenceOffCount;
+
+    if ( analytics->enable && !shelf_analytics_cfg_valid( &cfg ) ) {
+        return false;
+    }
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    shelfAnalytics[ranger] = *analytics;
+    shelfAnalytics[ranger].valid = 1;
+    shelfAnalyticsChanged |= 1UL << ranger;
+    tx_mutex_put(&calibration_mutex);
+
+    return true;
+}
+
+void sendShelfAnalytics(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+        payloadPtrOutgoing->payload.shelfAnalytics[i] = shelfAnalytics[i];
+    }
+    tx_mutex_put(&calibration_mutex);
+
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    for(int i = 0; i < IC_SMART_SHELF_RANGER_COUNT; i++){
+        payloadPtrOutgoing->payload.shelfLevel[i] = shelfLevel[i];
+    }
+    tx_mutex_put(&results_mutex);
+
+    // Write to A7, enqueue to mailbox, the cmd byte already contains the command we're responding to
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
+// Sends the queued stock level and presence events to the high level application, one message each.  The
+// telemetryJSON of an event message can be forwarded as is, {"shelf1Fill": 60} or {"presence": 1}.
+void sendShelfEvents(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+    IC_SMART_SHELF_EVENT event;
+
+    while (true) {
+
+        tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+        if (shelfEventCount == 0) {
+            tx_mutex_put(&results_mutex);
+            break;
+        }
+        event = shelfEvents[shelfEventFirst];
+        shelfEventFirst = (shelfEventFirst + 1) % SHELF_EVENT_QUEUE_LEN;
+        shelfEventCount--;
+        tx_mutex_put(&results_mutex);
+
+        // Only the high level application that set up the analytics gets events, its header is in messageHeader
+        if (!shelfEventsEnabled) {
+            continue;
+        }
+
+        memset(mbox_local_buf, 0, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+        for(int i = 0; i < COMMAND_BLOCK_OFFSET; i++){
+            payloadPtrOutgoing->highLevelAppComponentID[i] = messageHeader[i];
+        }
+        payloadPtrOutgoing->payload.cmd = IC_SMART_SHELF_SHELF_EVENT;
+        payloadPtrOutgoing->payload.shelfEvent = event;
+
+        if (event.type == IC_SMART_SHELF_EVENT_PRESENCE) {
+            snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE, "{\"presence\": %u}", event.level);
+        }
+        else {
+            // Shelf numbers start at 1 and skip the people detect sensor
+            snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE, "{\"shelf%dFill\": %u}",
+                     (event.ranger < IC_SMART_SHELF_RANGER_PEOPLE) ? event.ranger + 1 : event.ranger, event.level);
+        }
+
+        printf("Shelf event: %s (was %u, %dmm)\n", payloadPtrOutgoing->payload.telemetryJSON, event.previous,
+               event.range_mm);
+
+        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+    }
+}
+
+// Sends the I2C bus use of every device since the previous request and starts the counters over.  The details
+// (transactions, longest transaction) go to the debug UART.
+void sendI2cStats(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+    ULONG now = tx_time_get();
+    uint64_t windowUs = (uint64_t)(now - i2cStatsStart) * 1000000 / MT3620_TIMER_TICKS_PER_SECOND;
+
+    i2cStatsStart = now;
+    printf("I2C bus use over the last %lu ms\n", (unsigned long)(windowUs / 1000));
+
+    for(int i = 0; i < IC_SMART_SHELF_I2C_DEVICE_COUNT; i++){
+
+        i2c_bus_device_t* device = (i < IC_SMART_SHELF_RANGER_COUNT) ? &rangerBus[i] : &phtBus;
+        IC_SMART_SHELF_I2C_STATS entry;
+        i2c_bus_stats_t stats;
+        uint64_t busyUs;
+
+        i2c_bus_get_stats(device, &stats, true);
+
+        busyUs = stats.busyCycles / MT3620_M4_CYCLES_PER_US;
+        entry.busyPermille = windowUs ? (uint16_t)((busyUs * 1000 + windowUs / 2) / windowUs) : 0;
+        entry.errors = (stats.errors < 0xFFFF) ? (uint16_t)stats.errors : 0xFFFF;
+        payloadPtrOutgoing->payload.i2cStats[i] = entry;
+
+        if(stats.transactions){
+            printf("  %s: %u.%u%% busy, %lu transactions, %lu errors, longest %lu us\n", device->name,
+                   entry.busyPermille / 10, entry.busyPermille % 10, (unsigned long)stats.transactions,
+                   (unsigned long)stats.errors, (unsigned long)(stats.maxCycles / MT3620_M4_CYCLES_PER_US));
+        }
+    }
+
+    // Write to A7, enqueue to mailbox, the cmd byte already contains the command we're responding to
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
 // Initialize the RelayClick hardware
 bool initialize_hardware(void) {
 
-    // Enable the sleep if you neeed to set a breakpoint at startup...
-    tx_thread_sleep(2000);
-
 #ifdef SHELF_USES_8801
 
-    // This application leverages two LightRanger click boards.  Since they are 
-    // both on the same I2C bus, we need to change the I2C address of one of the
-    // boards.  To do this we need to . . . 
-    //
-    // 1. Drive the EN pin low on both devices
-    // 2. Drive the EN pin high on one device
-    // 3. Update the firmware on the first device, this will improve the range of the 
-    //    device from ~65cm to ~250cm
-    // 4. Change the I2C address of the first device
+    lightranger5_cfg_t shelf1_cfg;
+    lightranger5_cfg_t shelf2_cfg;
+    lightranger5_start_t shelf1Start;
+    lightranger5_start_t shelf2Start = LIGHTRANGER5_START_COLD;
+    bool anyCold;
+    int bringupCount = 0;
+    static ranger_bringup_t bringup[2 + SHELF_EXTRA_RANGER_COUNT];
+    static int bringupRanger[2 + SHELF_EXTRA_RANGER_COUNT];
+
+#ifdef SHELF_EXTRA_RANGERS
+    lightranger5_cfg_t extra_cfg[SHELF_EXTRA_RANGER_COUNT];
+    lightranger5_start_t extraStart[SHELF_EXTRA_RANGER_COUNT];
+
+    if ( SHELF_EXTRA_RANGER_COUNT > ( IC_SMART_SHELF_RANGER_COUNT - IC_SMART_SHELF_RANGER_SHELF3 ) ) {
+        printf("SHELF_EXTRA_RANGERS lists %u sensors, at most %d are supported\n", (unsigned int)SHELF_EXTRA_RANGER_COUNT,
+               IC_SMART_SHELF_RANGER_COUNT - IC_SMART_SHELF_RANGER_SHELF3);
+        return false;
+    }
+#endif
+
+    // Initialize the configuration structures.  The first lightranger5 board is in Click
+    // Socket #1 and is moved to its alternate address 0x51, the second lightranger5 board
+    // is in Click Socket #2 and keeps 0x41
+    lightranger5_cfg_setup( &shelf1_cfg );
+    LIGHTRANGER5_MAP_MIKROBUS( shelf1_cfg, CLICK1 );
+    shelf1_cfg.i2c_address = 0x51;
+    lightranger5_Shelf1.slave_address = 0x51;
 
-    // Open the EN pin for Click site #1
+    lightranger5_cfg_setup( &shelf2_cfg );
+    LIGHTRANGER5_MAP_MIKROBUS( shelf2_cfg, CLICK2 );
+    shelf2_cfg.i2c_address = 0x41;
+    lightranger5_Shelf2.slave_address = 0x41;
+
+    // Open the EN pins for Click sites #1 and #2 and keep them high.  If only the real time
+    // application restarted the devices may still be running the firmware image and measuring
+    mtk_os_hal_gpio_set_output((os_hal_gpio_pin)MIKROBUS_CLICK1_CS, OS_HAL_GPIO_DATA_HIGH);
     if( 0 != mtk_os_hal_gpio_set_direction((os_hal_gpio_pin)MIKROBUS_CLICK1_CS, OS_HAL_GPIO_DIR_OUTPUT)){
         return false;
     }
-    
-    // Drive the Click site #1 EN pin low to hold the device in reset
-    mtk_os_hal_gpio_set_output((os_hal_gpio_pin)MIKROBUS_CLICK1_CS, OS_HAL_GPIO_DATA_LOW);
 
-#endif // SHELF_USES_8801
-
-    // Open the EN pin for Click site #2
+    mtk_os_hal_gpio_set_output((os_hal_gpio_pin)MIKROBUS_CLICK2_CS, OS_HAL_GPIO_DATA_HIGH);
     if( 0 != mtk_os_hal_gpio_set_direction( (os_hal_gpio_pin)MIKROBUS_CLICK2_CS, OS_HAL_GPIO_DIR_OUTPUT)){
         return false;
     }
-    
-    // Drive the Click site #2 EN pin low to hold the device in reset
-    mtk_os_hal_gpio_set_output((os_hal_gpio_pin)MIKROBUS_CLICK2_CS, OS_HAL_GPIO_DATA_LOW);
 
-    // Call the routine that will update the firmwae and change the I2C addres for
-    // the Lightranger5 click board in click socket #1
-    //                             (I2C ISU)  (EN GPIO)  (New I2C address)
-    lightranger5_update_firmware ( MIKROBUS_CLICK1_SDA, MIKROBUS_CLICK1_CS, 0x51);
+    shelf1Start = check_lightranger5(&shelf1_cfg, &lightranger5_Shelf1, IC_SMART_SHELF_RANGER_SHELF1);
+    anyCold = ( shelf1Start == LIGHTRANGER5_START_COLD );
 
-#ifdef SHELF_USES_8801
+#ifdef SHELF_EXTRA_RANGERS
 
-    Delay_ms(1000);
+    // The additional shelf sensors sit on ISU2 like the click sockets, they only need their own EN pins
+    for ( unsigned int i = 0; i < SHELF_EXTRA_RANGER_COUNT; i++ ) {
 
-    // Call the routine that will update the firmwae and don't change the I2C addres for
-    // the Lightranger5 click board in click socket #2
-    //                           (  I2C ISU)   (EN GPIO) (New I2C address)
-    lightranger5_update_firmware ( MIKROBUS_CLICK1_SDA, MIKROBUS_CLICK2_CS, 0x00);
+        lightranger5_cfg_setup( &extra_cfg[i] );
+        LIGHTRANGER5_MAP_MIKROBUS( extra_cfg[i], CLICK1 );
+        extra_cfg[i].en = shelfExtraRangers[i].en;
+        extra_cfg[i].int_pin = HAL_PIN_NC;
+        extra_cfg[i].io0 = HAL_PIN_NC;
+        extra_cfg[i].io1 = HAL_PIN_NC;
+        extra_cfg[i].i2c_address = shelfExtraRangers[i].i2c_address;
+        lightranger5_ShelfExtra[i].slave_address = shelfExtraRangers[i].i2c_address;
 
-    lightranger5_cfg_t lightranger5_cfg;
-    lightranger5_cfg_setup( &lightranger5_cfg );
+        mtk_os_hal_gpio_set_output((os_hal_gpio_pin)shelfExtraRangers[i].en, OS_HAL_GPIO_DATA_HIGH);
+        if( 0 != mtk_os_hal_gpio_set_direction((os_hal_gpio_pin)shelfExtraRangers[i].en, OS_HAL_GPIO_DIR_OUTPUT)){
+            return false;
+        }
 
-    // Initialize the configuration structure.  The first lightranger5
-    // board is in Click Socket #1
-    LIGHTRANGER5_MAP_MIKROBUS( lightranger5_cfg, CLICK1 );
+        extraStart[i] = check_lightranger5(&extra_cfg[i], &lightranger5_ShelfExtra[i], IC_SMART_SHELF_RANGER_SHELF3 + i);
+        anyCold |= ( extraStart[i] == LIGHTRANGER5_START_COLD );
+        printf("LightRanger5 start: shelf%u %d\n", IC_SMART_SHELF_RANGER_SHELF3 + i, extraStart[i]);
+    }
 
-    // Force the first lightranger5 board to use it's alternate address 0x51
-    lightranger5_cfg.i2c_address = 0x51;
-    lightranger5_Shelf1.slave_address = 0x51;
+#endif
+
+    // Only check the device at 0x41 if every other one answers at its own address, otherwise one of
+    // them may be sitting at 0x41 as well
+    if ( !anyCold ) {
+        shelf2Start = check_lightranger5(&shelf2_cfg, &lightranger5_Shelf2, IC_SMART_SHELF_RANGER_SHELF2);
+        anyCold = ( shelf2Start == LIGHTRANGER5_START_COLD );
+    }
+
+    printf("LightRanger5 start: shelf1 %d, shelf2 %d (0 cold, 1 image loaded, 2 warm)\n", shelf1Start, shelf2Start);
+
+    if ( anyCold ) {
 
-    // lightranger5 shelf1 init
-    if(!initialize_lightranger5(&lightranger5_cfg, &lightranger5_Shelf1, false)){
+        // Enable the sleep if you neeed to set a breakpoint at startup...  This also gives the high level
+        // application time to send its cached calibration (IC_SMART_SHELF_SET_RANGER_CALIBRATION)
+        tx_thread_sleep(2000);
+    }
+
+    // This application leverages two LightRanger click boards.  Since they are both on the same I2C
+    // bus, the first board is moved to 0x51 before the second one comes out of reset at 0x41.  The
+    // firmware update improves the range of the devices from ~65cm to ~250cm.
+    //
+    // All the boards are brought up in parallel, see ranger_bringup.h.  The image is downloaded to the
+    // next board while the ones before it run their factory calibration, so a cold start takes about
+    // as long as a single board plus one download per additional board.  The additional shelf sensors
+    // move away from 0x41 like the first board, the second board comes out of reset last.
+    bringupRanger[bringupCount] = IC_SMART_SHELF_RANGER_SHELF1;
+    setup_ranger_bringup(&bringup[bringupCount++], &shelf1_cfg, &lightranger5_Shelf1, IC_SMART_SHELF_RANGER_SHELF1, shelf1Start);
+
+#ifdef SHELF_EXTRA_RANGERS
+    for ( unsigned int i = 0; i < SHELF_EXTRA_RANGER_COUNT; i++ ) {
+        bringupRanger[bringupCount] = IC_SMART_SHELF_RANGER_SHELF3 + i;
+        setup_ranger_bringup(&bringup[bringupCount++], &extra_cfg[i], &lightranger5_ShelfExtra[i],
+                             IC_SMART_SHELF_RANGER_SHELF3 + i, extraStart[i]);
+    }
+#endif
+
+    bringupRanger[bringupCount] = IC_SMART_SHELF_RANGER_SHELF2;
+    setup_ranger_bringup(&bringup[bringupCount++], &shelf2_cfg, &lightranger5_Shelf2, IC_SMART_SHELF_RANGER_SHELF2, shelf2Start);
+
+    bool bringupOK = ranger_bringup_run(bringup, bringupCount, LIGHTRANGER5_DOWNLOAD_I2C_SPEED);
+
+    // Keep the calibration of a board that made it even if another one failed
+    for ( int i = 0; i < bringupCount; i++ ) {
+        if ( bringup[i].state == RANGER_BRINGUP_DONE ) {
+            finish_ranger_bringup(&bringup[i], bringupRanger[i]);
+        }
+    }
+
+    if ( !bringupOK ) {
         return false;
     }
 
-    // Initialize the configuration structure.  The second lightranger5
-    // board is in Click Socket #2
-    LIGHTRANGER5_MAP_MIKROBUS( lightranger5_cfg, CLICK2 );
+#else
 
-    lightranger5_cfg.i2c_address = 0x41;
-    lightranger5_Shelf2.slave_address = 0x41;
+    // Enable the sleep if you neeed to set a breakpoint at startup...
+    tx_thread_sleep(2000);
 
-    // Lightranger shelf2 init
-    if(!initialize_lightranger5(&lightranger5_cfg, &lightranger5_Shelf2, false)){
+    // Open the EN pin for Click site #2
+    if( 0 != mtk_os_hal_gpio_set_direction( (os_hal_gpio_pin)MIKROBUS_CLICK2_CS, OS_HAL_GPIO_DIR_OUTPUT)){
+        return false;
+    }
+    
+    // Drive the Click site #2 EN pin low to hold the device in reset
+    mtk_os_hal_gpio_set_output((os_hal_gpio_pin)MIKROBUS_CLICK2_CS, OS_HAL_GPIO_DATA_LOW);
+
+    // Call the routine that will update the firmwae and change the I2C addres for
+    // the Lightranger5 click board in click socket #1
+    //                             (I2C ISU)  (EN GPIO)  (New I2C address)
+    if ( lightranger5_update_firmware ( MIKROBUS_CLICK1_SDA, MIKROBUS_CLICK1_CS, 0x51,
+                                        LIGHTRANGER5_DOWNLOAD_I2C_SPEED, NULL) != LIGHTRANGER5_OK ) {
         return false;
     }
 
@@ -691,7 +1834,10 @@ bool initialize_hardware(void) {
 #ifdef INCLUDE_PEOPLE_DETECT_SENSOR
 
     //                               (I2C ISU)        (EN GPIO)    (New I2C address)
-    lightranger5_update_firmware ( CLICK2.SCL, CLICK2.CS, 0x00);
+    if ( lightranger5_update_firmware ( CLICK2.SCL, CLICK2.CS, 0x00,
+                                        LIGHTRANGER5_DOWNLOAD_I2C_SPEED, NULL) != LIGHTRANGER5_OK ) {
+        return false;
+    }
 
     lightranger5_cfg_t lightranger5_cfg;
     lightranger5_cfg_setup( &lightranger5_cfg );
@@ -711,8 +1857,8 @@ bool initialize_hardware(void) {
     lightranger5_peopleDetect.io1.pin = HAL_PIN_NC;
     lightranger5_peopleDetect.slave_address = 0x41;
 
-    // Lightranger shelf2 init
-    if(!initialize_lightranger5(&lightranger5_cfg, &lightranger5_peopleDetect, false)){
+    // Lightranger people detect init
+    if(!initialize_lightranger5(&lightranger5_cfg, &lightranger5_peopleDetect, IC_SMART_SHELF_RANGER_PEOPLE, LIGHTRANGER5_START_COLD)){
         return false;
     }
 
@@ -742,6 +1888,15 @@ bool initialize_hardware(void) {
     Delay_ms( 100 );
     printf("---------------------------- \r\n " );
 
+#ifdef LIGHTRANGER5_INT_GPIO
+
+    // The INT pin is active low, a result pending from before the handler was registered is picked up by the
+    // ranging thread's first pass
+    mtk_os_hal_gpio_set_direction((os_hal_gpio_pin)LIGHTRANGER5_INT_GPIO, OS_HAL_GPIO_DIR_INPUT);
+    mtk_os_hal_eint_register((eint_number)LIGHTRANGER5_INT_GPIO, HAL_EINT_EDGE_FALLING, lightranger5_int_handler);
+
+#endif
+
     return true;
 }
 
@@ -826,15 +1981,15 @@ void display_status_error ( void ) {
     }    
 }
 
-int getRange(lightranger5_t* lightranger5){
+// Replaces the range of the first two shelf sensors with demo data while IC_SMART_SHELF_SIMULATE_DATA is enabled
+int getSimulatedRange(int ranger, int range_mm){
 
     #define DATA_SHELF_SIZE 170
     static uint8_t shelf1DummyData = 20;
     static uint8_t shelf2DummyData = 0;
-
     if(simulateShelfData){
 
-        if(lightranger5 == &lightranger5_Shelf1){
+        if(ranger == IC_SMART_SHELF_RANGER_SHELF1){
             shelf1DummyData--;
             if(shelf1DummyData < 0)
                 shelf1DummyData = DATA_SHELF_SIZE;
@@ -842,7 +1997,7 @@ int getRange(lightranger5_t* lightranger5){
             return shelf1DummyData;
         }
 
-        if(lightranger5 == &lightranger5_Shelf2){
+        if(ranger == IC_SMART_SHELF_RANGER_SHELF2){
             shelf2DummyData++;
             if(shelf2DummyData > DATA_SHELF_SIZE)
                 shelf2DummyData = 0;
@@ -851,30 +2006,70 @@ int getRange(lightranger5_t* lightranger5){
         }
     }
 
-    if(lightranger5 == &lightranger5_peopleDetect){
+    return range_mm;
+}
 
-#ifdef INCLUDE_PEOPLE_DETECT_SENSOR
+// Copies the latest result the ranging thread collected for every LightRanger5.  Each mutex is taken once for all
+// the sensors, so the mbox thread never waits for more than one sensor read of the ranging thread.  The distance
+// is -1 if a sensor isn't measuring (no entry in rangerContexts[]), its result is too old or the confidence is
+// below the minimum set with IC_SMART_SHELF_SET_RANGER_CONFIG.  rangerMask gets a bit per measuring sensor.
+void snapshotRangerResults(IC_SMART_SHELF_RANGER_RESULT* rangerResult, uint16_t* rangerMask){
 
-        if ( lightranger5_check_data_ready( lightranger5 ) == LIGHTRANGER5_DATA_IS_READY ) {
-            uint16_t distance_mm = lightranger5_measure_distance( lightranger5 );
-            
-            if ( distance_mm ) {
-                return distance_mm;    
-            }    
-        }
-#else 
-        return -1;
-#endif    
+    uint8_t minConfidence[IC_SMART_SHELF_RANGER_COUNT];
+    ULONG now;
+    ULONG age;
 
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    for (int ranger = 0; ranger < IC_SMART_SHELF_RANGER_COUNT; ranger++) {
+        minConfidence[ranger] = rangerConfig[ranger].minConfidence;
     }
+    tx_mutex_put(&calibration_mutex);
 
-    if ( lightranger5_check_data_ready( lightranger5 ) == LIGHTRANGER5_DATA_IS_READY ) {
-        uint16_t distance_mm = lightranger5_measure_distance( lightranger5 );
-        
-        if ( distance_mm ) {
-            return distance_mm;    
-        }    
+    memset(rangerResult, 0, IC_SMART_SHELF_RANGER_COUNT * sizeof(*rangerResult));
+    *rangerMask = 0;
+
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    now = tx_time_get();
+
+    for (int ranger = 0; ranger < IC_SMART_SHELF_RANGER_COUNT; ranger++) {
+
+        ranger_result_cache_t* cache = &rangerResults[ranger];
+
+        rangerResult[ranger].distance_mm = -1;
+        rangerResult[ranger].ageMs = 0xFFFF;
+
+        if (rangerContexts[ranger] != NULL) {
+            *rangerMask |= 1U << ranger;
+        }
+
+        if (!cache->valid) {
+            continue;
+        }
+
+        age = (now - cache->timestamp) * (1000 / MT3620_TIMER_TICKS_PER_SECOND);
+
+        rangerResult[ranger].confidence = cache->result.confidence;
+        rangerResult[ranger].resultNumber = cache->result.result_number;
+        rangerResult[ranger].temperature = cache->result.temperature;
+        rangerResult[ranger].ageMs = (age < 0xFFFF) ? (uint16_t)age : 0xFFFF;
+
+        if (cache->result.distance_mm && (cache->result.confidence >= minConfidence[ranger]) &&
+            (age <= RANGER_RESULT_MAX_AGE_MS)) {
+            rangerResult[ranger].distance_mm = cache->result.distance_mm;
+        }
     }
+    tx_mutex_put(&results_mutex);
+}
 
-    return -1;
-}
\ No newline at end of file
+// Copies the targets found in the latest histogram of a LightRanger5, valid is cleared if the histogram is too old
+void getRangerTargets(int ranger, IC_SMART_SHELF_RANGER_TARGETS* targets){
+
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    *targets = rangerTargets[ranger].targets;
+    if ( targets->valid && ( ( tx_time_get() - rangerTargets[ranger].timestamp ) >
+                             ( RANGER_RESULT_MAX_AGE_MS * MT3620_TIMER_TICKS_PER_SECOND / 1000 ) ) ) {
+        targets->valid = 0;
+        targets->count = 0;
+    }
+    tx_mutex_put(&results_mutex);
+}
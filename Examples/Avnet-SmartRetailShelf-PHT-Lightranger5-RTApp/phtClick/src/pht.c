@@ -26,30 +26,91 @@
  */
 
 #include "pht.h"
+#include "drv.h"
+#include "tx_api.h"
+
+// 1 tick = 1ms.  SysTick runs at 1kHz (tx_initialize_low_level.S), TX_TIMER_TICKS_PER_SECOND is
+// still the ThreadX default of 100 and can't be used to convert.
+#define PHT_TICKS_PER_SECOND 1000
 
 static uint32_t prom_coeff[ 6 ];
+static pht_prom_const_t prom_const;
 static uint8_t ratio_temp;
 static uint8_t ratio_press;
+static uint8_t rh_conv_time = PHT_RH_CONV_TIME_12BIT_MS;
+
+// Maximum P&T ADC conversion times in ms, indexed by the PHT_PT_CMD_RATIO_* oversampling ratio.  The maxima
+// are rounded up to whole ms, not truncated (9.04ms at OSR 4096 and 18.08ms at OSR 8192): reading the ADC
+// before the conversion is done returns 0.
+static const uint8_t pt_conv_time[ 6 ] = { 1, 2, 3, 5, 10, 19 };
 
 // -------------------------------------------- PRIVATE FUNCTION DECLARATIONS 
 
 /**
- * @brief Send I2C address change delay function
- * @details The function performs the address change delay of 1 ms.
+ * @brief Send Command Delay function
+ * @details The function performs the send command delay of 10 ms.
  */
-static void dev_addr_change_delay( void );
+static void dev_send_cmd_delay ( void );
 
 /**
- * @brief Send hold delay function
- * @details The function performs the hold delay of 20 ms.
+ * @brief Die Write function
+ * @details The function writes to one die of the MS8607. The slave address
+ * is set for every transaction, setting it only selects the address used by the
+ * transfer so no settling delay is needed.
+ * @param[in] ctx : Click context object.
+ * @param[in] slave_addr : PHT_I2C_SLAVE_ADDR_P_AND_T or PHT_I2C_SLAVE_ADDR_RH
+ * @param[in] tx_buf : Data to be written
+ * @param[in] tx_len : Number of bytes to be written
  */
-static void dev_hold_delay( void );
+static err_t dev_write ( pht_t *ctx, uint8_t slave_addr, uint8_t *tx_buf, uint8_t tx_len );
 
 /**
- * @brief Send Command Delay function
- * @details The function performs the send command delay of 10 ms.
+ * @brief Die Read function
+ * @details The function reads from one die of the MS8607.
+ * @param[in] ctx : Click context object.
+ * @param[in] slave_addr : PHT_I2C_SLAVE_ADDR_P_AND_T or PHT_I2C_SLAVE_ADDR_RH
+ * @param[out] rx_buf : Buffer where the data be stored
+ * @param[in] rx_len : Number of bytes to be read
  */
-static void dev_send_cmd_delay ( void );
+static err_t dev_read ( pht_t *ctx, uint8_t slave_addr, uint8_t *rx_buf, uint8_t rx_len );
+
+/**
+ * @brief Conversion Wait function
+ * @details The function sleeps until at least time_ms has passed since start.
+ * @param[in] start : tx_time_get() when the conversion was started
+ * @param[in] time_ms : Conversion time in ms
+ */
+static void dev_wait_conversion ( ULONG start, uint8_t time_ms );
+
+/**
+ * @brief P&T Conversion function
+ * @details The function converts temperature and pressure on the P&T die
+ * and reads both ADC results, waiting the conversion time of the selected ratios.
+ * @param[in] ctx : Click context object.
+ * @param[out] adc_temp : Raw temperature (D2)
+ * @param[out] adc_press : Raw pressure (D1)
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error, one of the transfers failed.
+ */
+static err_t dev_convert_temperature_pressure ( pht_t *ctx, uint32_t *adc_temp, uint32_t *adc_press );
+
+/**
+ * @brief PROM Constants function
+ * @details The function precomputes the compensation constants from the PROM coefficients.
+ */
+static void dev_make_prom_const ( void );
+
+/**
+ * @brief Temperature And Pressure Calculation function
+ * @details The function compensates the raw ADC results with the PROM coefficients.
+ */
+static void dev_calc_temperature_pressure ( uint32_t adc_temp, uint32_t adc_press, float *temperature, float *pressure );
+
+/**
+ * @brief Humidity Calculation function
+ * @details The function converts the raw RH ADC result to percent.
+ */
+static float dev_calc_relative_humidity ( uint16_t adc_rh );
 
 /**
  * @brief Command Send function
@@ -58,8 +119,10 @@ static void dev_send_cmd_delay ( void );
  * @param[out] cfg : Click configuration structure.
  * See #pht_cfg_t object definition for detailed explanation.
  * @param[in] cmd_byte : Command which be performed
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
  */
-static void dev_send_cmd ( pht_t *ctx, uint8_t cmd_byte );
+static err_t dev_send_cmd ( pht_t *ctx, uint8_t cmd_byte );
 
 /**
  * @brief Send Command With Device Response function
@@ -70,8 +133,10 @@ static void dev_send_cmd ( pht_t *ctx, uint8_t cmd_byte );
  * @param[in] num_bytes : Number of bytes which be read
  * @param[in] tx_data : Buffer where data (device response) be stored
  * @param[in] cmd_byte : Command which be performed
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error.
  */
-static void dev_send_cmd_resp ( pht_t *ctx, uint8_t cmd_byte, uint8_t num_bytes, uint32_t *tx_data );
+static err_t dev_send_cmd_resp ( pht_t *ctx, uint8_t cmd_byte, uint8_t num_bytes, uint32_t *tx_data );
 
 /**
  * @brief Conversion Command Make function
@@ -140,15 +205,9 @@ err_t pht_generic_read ( pht_t *ctx, uint8_t reg, uint8_t *rx_buf, uint8_t rx_le
 
 void pht_set_command ( pht_t *ctx, uint8_t sensor_type, uint8_t cmd ) {   
     if ( sensor_type == PHT_SENSOR_TYPE_PT ) {
-        i2c_master_set_slave_address( &ctx->i2c, PHT_I2C_SLAVE_ADDR_P_AND_T );
-        dev_addr_change_delay( );
-        
-        i2c_master_write( &ctx->i2c, &cmd, 1 );
-        
-        i2c_master_set_slave_address( &ctx->i2c, PHT_I2C_SLAVE_ADDR_RH );
-        dev_addr_change_delay( );
+        dev_write( ctx, PHT_I2C_SLAVE_ADDR_P_AND_T, &cmd, 1 );
     } else {
-        i2c_master_write( &ctx->i2c, &cmd, 1 );
+        dev_write( ctx, PHT_I2C_SLAVE_ADDR_RH, &cmd, 1 );
     }
 }
 
@@ -178,7 +237,7 @@ uint8_t pht_set_ratio ( pht_t *ctx, uint8_t temp_ratio, uint8_t press_ratio ) {
         return PHT_ERROR;
     }
 
-    if ( temp_ratio > PHT_PT_CMD_RATIO_8192 ) {
+    if ( press_ratio > PHT_PT_CMD_RATIO_8192 ) {
         return PHT_ERROR;
     }
 
@@ -195,10 +254,13 @@ void pht_reset ( pht_t *ctx ) {
     cmd_data = PHT_PT_CMD_RESET;
 
     dev_send_cmd( ctx, cmd_data );
+    dev_send_cmd_delay( );
 
     for ( n_cnt = 1; n_cnt < 7; n_cnt++ ) {
         pht_get_prom( ctx, n_cnt, &prom_coeff[ n_cnt - 1 ] );
     }
+
+    dev_make_prom_const( );
 }
 
 void pht_write_user_register ( pht_t *ctx, uint8_t tx_data ) {
@@ -207,7 +269,23 @@ void pht_write_user_register ( pht_t *ctx, uint8_t tx_data ) {
     tx_buf[ 0 ] = PHT_RH_CMD_WRITE_USER_REG;
     tx_buf[ 1 ] = tx_data;
 
-    i2c_master_write( &ctx->i2c, tx_buf, 2 );
+    dev_write( ctx, PHT_I2C_SLAVE_ADDR_RH, tx_buf, 2 );
+
+    // The RH conversion time depends on the resolution bits 7 and 0
+    switch ( tx_data & PHT_RH_USER_REG_RESOLUTION_MASK ) {
+        case PHT_RH_USER_REG_RESOLUTION_11BIT:
+            rh_conv_time = PHT_RH_CONV_TIME_11BIT_MS;
+            break;
+        case PHT_RH_USER_REG_RESOLUTION_10BIT:
+            rh_conv_time = PHT_RH_CONV_TIME_10BIT_MS;
+            break;
+        case PHT_RH_USER_REG_RESOLUTION_8BIT:
+            rh_conv_time = PHT_RH_CONV_TIME_8BIT_MS;
+            break;
+        default:
+            rh_conv_time = PHT_RH_CONV_TIME_12BIT_MS;
+            break;
+    }
 }
 
 uint8_t pht_read_user_register ( pht_t *ctx ) {
@@ -216,8 +294,8 @@ uint8_t pht_read_user_register ( pht_t *ctx ) {
 
     tx_buf[ 0 ] = PHT_RH_CMD_READ_USER_REG;
 
-    i2c_master_write( &ctx->i2c, tx_buf, 1 );
-    i2c_master_read( &ctx->i2c, rx_buf, 1 );
+    dev_write( ctx, PHT_I2C_SLAVE_ADDR_RH, tx_buf, 1 );
+    dev_read( ctx, PHT_I2C_SLAVE_ADDR_RH, rx_buf, 1 );
     
     return rx_buf[ 0 ];
 }
@@ -227,10 +305,14 @@ uint8_t pht_measure_rh ( pht_t *ctx, uint16_t *rh_data ) {
     uint8_t rx_buf[ 3 ];
     uint8_t status;
     uint16_t tmp;
+    ULONG start;
 
     tx_buf[ 0 ] = PHT_RH_MEASURE_RH_NO_HOLD;
 
-    i2c_master_write_then_read( &ctx->i2c, tx_buf, 1, rx_buf, 2 );
+    dev_write( ctx, PHT_I2C_SLAVE_ADDR_RH, tx_buf, 1 );
+    start = tx_time_get( );
+    dev_wait_conversion( start, rh_conv_time );
+    dev_read( ctx, PHT_I2C_SLAVE_ADDR_RH, rx_buf, 2 );
     
     tmp = rx_buf[ 0 ];
     tmp <<= 8;
@@ -244,102 +326,155 @@ uint8_t pht_measure_rh ( pht_t *ctx, uint16_t *rh_data ) {
     return status;
 }
 
+void pht_compensate ( const pht_prom_const_t *prom, uint32_t adc_temp, uint32_t adc_press, 
+                      int32_t *temperature, int32_t *pressure ) {
+    int32_t d_t;
+    int32_t temp;
+    int64_t t_2;
+    int64_t off;
+    int64_t sens;
+    int64_t off_2;
+    int64_t sens_2;
+    int64_t delta;
+
+    // First order compensation
+    d_t = ( int32_t ) adc_temp - prom->temp_ref;
+    temp = 2000 + ( int32_t ) ( ( ( int64_t ) d_t * prom->temp_sens ) >> 23 );
+    off = prom->off + ( ( ( int64_t ) prom->tco * d_t ) >> 6 );
+    sens = prom->sens + ( ( ( int64_t ) prom->tcs * d_t ) >> 7 );
+
+    // Second order compensation, mostly matters below 20 degrees Celsius
+    if ( temp < 2000 ) {
+        delta = ( int64_t ) ( temp - 2000 ) * ( temp - 2000 );
+        t_2 = ( 3 * ( ( int64_t ) d_t * d_t ) ) >> 33;
+        off_2 = ( 61 * delta ) >> 4;
+        sens_2 = ( 29 * delta ) >> 4;
+
+        if ( temp < -1500 ) {
+            delta = ( int64_t ) ( temp + 1500 ) * ( temp + 1500 );
+            off_2 += 17 * delta;
+            sens_2 += 9 * delta;
+        }
+    } else {
+        t_2 = ( 5 * ( ( int64_t ) d_t * d_t ) ) >> 38;
+        off_2 = 0;
+        sens_2 = 0;
+    }
+
+    off -= off_2;
+    sens -= sens_2;
+
+    *temperature = temp - ( int32_t ) t_2;
+    *pressure = ( int32_t ) ( ( ( ( adc_press * sens ) >> 21 ) - off ) >> 15 );
+}
+
+const pht_prom_const_t *pht_get_prom_const ( void ) {
+    return &prom_const;
+}
+
 void pht_get_temperature_pressure ( pht_t *ctx, float *temperature, float *pressure ) {
-    uint32_t buff_data[ 2 ];
-    uint8_t temp_cmd;
-    uint8_t press_cmd;
-    float res_data[ 4 ];
-    
-    dev_make_conv_cmd( &temp_cmd, &press_cmd );
-    dev_send_cmd( ctx, temp_cmd );
-    dev_send_cmd_resp( ctx, PHT_PT_CMD_ADC_READ, 3, &buff_data[ 0 ] );
-    dev_send_cmd( ctx, press_cmd );
-    dev_send_cmd_resp( ctx, PHT_PT_CMD_ADC_READ, 3, &buff_data[ 1 ] );
-
-    res_data[ 0 ] = prom_coeff[ 4 ] * 256.0;
-    res_data[ 0 ] = buff_data[ 0 ] - res_data[ 0 ];
-    res_data[ 1 ] = res_data[ 0 ] / 8.0;
-    res_data[ 1 ] = res_data[ 1 ] * ( prom_coeff[ 5 ] / 1048576.0 );
-    res_data[ 1 ] = res_data[ 1 ] + 2000.0;
-    res_data[ 1 ] /= 100.0;
-    *temperature = res_data[ 1 ];
-
-    res_data[ 2 ] = res_data[ 0 ] / 128.0;
-    res_data[ 2 ] = res_data[ 2 ] * ( prom_coeff[ 2 ] / 2097152.0 );
-    res_data[ 2 ] = res_data[ 2 ] + ( prom_coeff[ 0 ] / 32.0 );
-    res_data[ 3 ] = res_data[ 0 ] / 32.0;
-    res_data[ 3 ] = res_data[ 3 ] * ( prom_coeff[ 3 ] / 65536.0 );
-    res_data[ 3 ] = res_data[ 3 ] + ( prom_coeff[ 1 ] * 4.0 );
-    res_data[ 1 ] = buff_data[ 1 ] / 32768.0;
-    res_data[ 1 ] = res_data[ 1 ] * res_data[ 2 ];
-    res_data[ 1 ] = res_data[ 1 ] - res_data[ 3 ];
-    res_data[ 1 ] /= 100.0;
-    *pressure = res_data[ 1 ];
+    uint32_t adc_temp;
+    uint32_t adc_press;
+
+    dev_convert_temperature_pressure( ctx, &adc_temp, &adc_press );
+    dev_calc_temperature_pressure( adc_temp, adc_press, temperature, pressure );
 }
 
 void pht_get_relative_humidity ( pht_t *ctx, float *humidity ) {
-
     uint8_t tx_buf[ 1 ];
     uint8_t rx_buf[ 3 ];
     uint16_t rh_val;
-    float rh;
+    ULONG start;
 
-    tx_buf[ 0 ] = PHT_RH_MEASURE_RH_HOLD;
+    tx_buf[ 0 ] = PHT_RH_MEASURE_RH_NO_HOLD;
 
-    i2c_master_write( &ctx->i2c, tx_buf, 1 );
-    dev_hold_delay( );
-    i2c_master_read( &ctx->i2c, rx_buf, 2 );
+    dev_write( ctx, PHT_I2C_SLAVE_ADDR_RH, tx_buf, 1 );
+    start = tx_time_get( );
+    dev_wait_conversion( start, rh_conv_time );
+    dev_read( ctx, PHT_I2C_SLAVE_ADDR_RH, rx_buf, 3 );
     
     rh_val = rx_buf[ 0 ];
     rh_val <<= 8;
     rh_val |= rx_buf[ 1 ];
 
-    rh = ( float ) rh_val;
-    rh *= 12500.0;
-    rh /= 65536.0;
-    rh -= 600.0;
-    rh /= 100.0;
+    *humidity = dev_calc_relative_humidity( rh_val );
+}
 
-    if(rh < 0.0){
-        rh = 0.0;
-    }
+err_t pht_get_measurement ( pht_t *ctx, float *temperature, float *pressure, float *humidity ) {
+    err_t error_flag = PHT_OK;
+    uint8_t tx_buf[ 1 ];
+    uint8_t rx_buf[ 3 ] = { 0 };
+    uint32_t adc_temp;
+    uint32_t adc_press;
+    uint16_t rh_val;
+    ULONG rh_start;
+
+    // Start the RH conversion first, the RH die converts while the P&T die 
+    // runs its temperature and pressure conversions
+    tx_buf[ 0 ] = PHT_RH_MEASURE_RH_NO_HOLD;
+    error_flag |= dev_write( ctx, PHT_I2C_SLAVE_ADDR_RH, tx_buf, 1 );
+    rh_start = tx_time_get( );
 
-    *humidity = rh;
+    error_flag |= dev_convert_temperature_pressure( ctx, &adc_temp, &adc_press );
+
+    // Usually done by now at the default ratios
+    dev_wait_conversion( rh_start, rh_conv_time );
+    error_flag |= dev_read( ctx, PHT_I2C_SLAVE_ADDR_RH, rx_buf, 3 );
+
+    rh_val = rx_buf[ 0 ];
+    rh_val <<= 8;
+    rh_val |= rx_buf[ 1 ];
+
+    dev_calc_temperature_pressure( adc_temp, adc_press, temperature, pressure );
+    *humidity = dev_calc_relative_humidity( rh_val );
+
+    return ( error_flag == PHT_OK ) ? PHT_OK : PHT_ERROR;
 }
 
 
 // --------------------------------------------- PRIVATE FUNCTION DEFINITIONS 
 
-static void dev_addr_change_delay( void ) {
-    Delay_1ms( );
+static void dev_send_cmd_delay ( void ) {
+    Delay_10ms( );
 }
 
-static void dev_hold_delay( void ) {
-    Delay_10ms( );
-    Delay_10ms( );
+static err_t dev_write ( pht_t *ctx, uint8_t slave_addr, uint8_t *tx_buf, uint8_t tx_len ) {
+    i2c_master_set_slave_address( &ctx->i2c, slave_addr );
+
+    return i2c_master_write( &ctx->i2c, tx_buf, tx_len );
 }
 
-static void dev_send_cmd_delay ( void ) {
-    Delay_10ms( );
+static err_t dev_read ( pht_t *ctx, uint8_t slave_addr, uint8_t *rx_buf, uint8_t rx_len ) {
+    i2c_master_set_slave_address( &ctx->i2c, slave_addr );
+
+    return i2c_master_read( &ctx->i2c, rx_buf, rx_len );
 }
 
-static void dev_send_cmd ( pht_t *ctx, uint8_t cmd_byte ) {
+static void dev_wait_conversion ( ULONG start, uint8_t time_ms ) {
+    ULONG elapsed;
+    ULONG wait;
+
+    // start was read somewhere inside a tick, so one more tick than the 
+    // conversion time guarantees the full conversion time has passed
+    wait = ( ( ULONG ) time_ms * PHT_TICKS_PER_SECOND + 999 ) / 1000 + 1;
+    elapsed = tx_time_get( ) - start;
+
+    if ( elapsed < wait ) {
+        tx_thread_sleep( wait - elapsed );
+    }
+}
+
+static err_t dev_send_cmd ( pht_t *ctx, uint8_t cmd_byte ) {
     uint8_t tx_buf[ 1 ];
     
     tx_buf[ 0 ] = cmd_byte;
     
-    i2c_master_set_slave_address( &ctx->i2c, PHT_I2C_SLAVE_ADDR_P_AND_T );
-    dev_addr_change_delay( );
-    
-    i2c_master_write( &ctx->i2c, tx_buf, 1 );
-    dev_send_cmd_delay( );
-    
-    i2c_master_set_slave_address( &ctx->i2c, PHT_I2C_SLAVE_ADDR_RH );
-    dev_addr_change_delay( );
+    return dev_write( ctx, PHT_I2C_SLAVE_ADDR_P_AND_T, tx_buf, 1 );
 }
 
-static void dev_send_cmd_resp ( pht_t *ctx, uint8_t cmd_byte, uint8_t n_bytes, uint32_t *tx_data ) {
-    uint8_t tmp[ 3 ];
+static err_t dev_send_cmd_resp ( pht_t *ctx, uint8_t cmd_byte, uint8_t n_bytes, uint32_t *tx_data ) {
+    err_t error_flag;
+    uint8_t tmp[ 3 ] = { 0 };
     uint8_t cnt;
     uint32_t pom;
     
@@ -347,14 +482,8 @@ static void dev_send_cmd_resp ( pht_t *ctx, uint8_t cmd_byte, uint8_t n_bytes, u
 
     tmp[ 0 ] = cmd_byte;
 
-    i2c_master_set_slave_address( &ctx->i2c, PHT_I2C_SLAVE_ADDR_P_AND_T );
-    dev_addr_change_delay( );
-    
-    i2c_master_write( &ctx->i2c, tmp, 1 );
-    i2c_master_read( &ctx->i2c, tmp, n_bytes );
-    
-    i2c_master_set_slave_address( &ctx->i2c, PHT_I2C_SLAVE_ADDR_RH );
-    dev_addr_change_delay( );
+    error_flag = dev_write( ctx, PHT_I2C_SLAVE_ADDR_P_AND_T, tmp, 1 );
+    error_flag |= dev_read( ctx, PHT_I2C_SLAVE_ADDR_P_AND_T, tmp, n_bytes );
 
     for ( cnt = 0; cnt < n_bytes; cnt++ ) {
         pom <<= 8;
@@ -362,6 +491,64 @@ static void dev_send_cmd_resp ( pht_t *ctx, uint8_t cmd_byte, uint8_t n_bytes, u
     }
     
     *tx_data = pom;
+
+    return error_flag;
+}
+
+static err_t dev_convert_temperature_pressure ( pht_t *ctx, uint32_t *adc_temp, uint32_t *adc_press ) {
+    err_t error_flag;
+    uint8_t temp_cmd;
+    uint8_t press_cmd;
+    ULONG start;
+
+    dev_make_conv_cmd( &temp_cmd, &press_cmd );
+
+    error_flag = dev_send_cmd( ctx, temp_cmd );
+    start = tx_time_get( );
+    dev_wait_conversion( start, pt_conv_time[ ratio_temp ] );
+    error_flag |= dev_send_cmd_resp( ctx, PHT_PT_CMD_ADC_READ, 3, adc_temp );
+
+    error_flag |= dev_send_cmd( ctx, press_cmd );
+    start = tx_time_get( );
+    dev_wait_conversion( start, pt_conv_time[ ratio_press ] );
+    error_flag |= dev_send_cmd_resp( ctx, PHT_PT_CMD_ADC_READ, 3, adc_press );
+
+    return error_flag;
+}
+
+static void dev_make_prom_const ( void ) {
+    prom_const.sens = ( int64_t ) prom_coeff[ PHT_PT_C1_SENS - 1 ] << 16;
+    prom_const.off = ( int64_t ) prom_coeff[ PHT_PT_C2_OFF - 1 ] << 17;
+    prom_const.tcs = ( int32_t ) prom_coeff[ PHT_PT_C3_TCS - 1 ];
+    prom_const.tco = ( int32_t ) prom_coeff[ PHT_PT_C4_TCO - 1 ];
+    prom_const.temp_ref = ( int32_t ) prom_coeff[ PHT_PT_C5_TREF - 1 ] << 8;
+    prom_const.temp_sens = ( int32_t ) prom_coeff[ PHT_PT_C6_TEMPSENS - 1 ];
+}
+
+static void dev_calc_temperature_pressure ( uint32_t adc_temp, uint32_t adc_press, float *temperature, float *pressure ) {
+    int32_t temp;
+    int32_t press;
+
+    pht_compensate( &prom_const, adc_temp, adc_press, &temp, &press );
+
+    *temperature = temp / 100.0f;
+    *pressure = press / 100.0f;
+}
+
+static float dev_calc_relative_humidity ( uint16_t adc_rh ) {
+    float rh;
+
+    rh = ( float ) adc_rh;
+    rh *= 12500.0;
+    rh /= 65536.0;
+    rh -= 600.0;
+    rh /= 100.0;
+
+    if(rh < 0.0){
+        rh = 0.0;
+    }
+
+    return rh;
 }
 
 static void dev_make_conv_cmd ( uint8_t *cmd_temp, uint8_t *cmd_press ) {
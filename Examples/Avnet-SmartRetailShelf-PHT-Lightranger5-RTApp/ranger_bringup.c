@@ -0,0 +1,326 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include <string.h>
+#include "printf.h"
+#include "ranger_bringup.h"
+
+static const char* const stateNames[] = {
+    "hold", "boot", "app boot", "address", "app", "calibrate", "done", "failed"
+};
+
+static ULONG bringupStart;
+
+// Moves a sensor to a new state, the first step of the new state is due straight away
+static void enter_state(ranger_bringup_t* r, int index, ranger_bringup_state_t state, uint32_t timeout_ms)
+{
+    ULONG now = tx_time_get();
+
+    r->state = state;
+    r->wake = now;
+    r->deadline = now + timeout_ms;
+
+    if (state == RANGER_BRINGUP_DONE) {
+        r->readyMs = now - bringupStart;
+    }
+
+    printf("LightRanger5 %d: %s at %lu ms\n", index, stateNames[state], now - bringupStart);
+}
+
+// Holds a failed sensor in reset so it doesn't block the default address for the others
+static void fail(ranger_bringup_t* r, int index, const char* reason)
+{
+    mtk_os_hal_gpio_set_output((os_hal_gpio_pin)r->cfg.en, OS_HAL_GPIO_DATA_LOW);
+    printf("LightRanger5 %d: %s\n", index, reason);
+    enter_state(r, index, RANGER_BRINGUP_FAILED, 0);
+}
+
+// The condition the current state waits for isn't there yet, poll again after ticks.  The deadline is only
+// checked after a poll so a long download to another sensor doesn't time this one out.
+static void wait_more(ranger_bringup_t* r, int index, ULONG ticks)
+{
+    ULONG now = tx_time_get();
+
+    if ((LONG)(now - r->deadline) >= 0) {
+        fail(r, index, "timeout");
+        return;
+    }
+    r->wake = now + ticks;
+}
+
+// Out of reset and answering at the default address
+static bool holds_default_address(const ranger_bringup_t* r)
+{
+    switch (r->state) {
+    case RANGER_BRINGUP_HOLD:
+    case RANGER_BRINGUP_FAILED:
+        return false;
+    case RANGER_BRINGUP_BOOT:
+    case RANGER_BRINGUP_APP_BOOT:
+        return true;
+    default:
+        return r->cfg.i2c_address == LIGHTRANGER5_SET_DEV_ADDR;
+    }
+}
+
+// A held sensor can come out of reset once no other sensor on its ISU answers at the default address.  A sensor
+// that stays at the default address also waits for the sensors that move away from it, it would block them.
+static bool may_release(const ranger_bringup_t* rangers, int count, int index)
+{
+    const ranger_bringup_t* r = &rangers[index];
+
+    for (int i = 0; i < count; i++) {
+
+        const ranger_bringup_t* other = &rangers[i];
+
+        if ((i == index) || (other->cfg.sda != r->cfg.sda)) {
+            continue;
+        }
+
+        if (holds_default_address(other)) {
+            return false;
+        }
+
+        if ((r->cfg.i2c_address == LIGHTRANGER5_SET_DEV_ADDR) && (other->state == RANGER_BRINGUP_HOLD) &&
+            (other->cfg.i2c_address != LIGHTRANGER5_SET_DEV_ADDR)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Polls a register once, true if ( value & mask ) == expected
+static bool register_is(ranger_bringup_t* r, uint8_t reg, uint8_t mask, uint8_t expected)
+{
+    uint8_t value;
+
+    return (lightranger5_generic_read(r->ctx, reg, &value, 1) == I2C_MASTER_SUCCESS) && ((value & mask) == expected);
+}
+
+// Runs the next step of one sensor.  Every step is a handful of I2C transfers except the download, which keeps
+// the bus busy anyway.
+static void step(ranger_bringup_t* r, int index, uint32_t download_speed)
+{
+    uint8_t appid;
+    uint8_t version[LIGHTRANGER5_APP_VERSION_SIZE];
+    uint8_t status;
+
+    switch (r->state) {
+
+    case RANGER_BRINGUP_BOOT:
+
+        if (!register_is(r, LIGHTRANGER5_REG_DEVICE_ID, 0xFF, LIGHTRANGER5_EXPECTED_ID)) {
+            wait_more(r, index, RANGER_BRINGUP_BOOT_POLL_TICKS);
+            break;
+        }
+
+        if (lightranger5_bootloader_start(r->ctx, &r->stats) ||
+            lightranger5_download_and_start(r->ctx, download_speed, &r->stats)) {
+            fail(r, index, "firmware download failed");
+            break;
+        }
+        enter_state(r, index, RANGER_BRINGUP_APP_BOOT, LIGHTRANGER5_BOOT_TIMEOUT_MS);
+        break;
+
+    case RANGER_BRINGUP_APP_BOOT:
+    case RANGER_BRINGUP_ADDRESS:
+
+        if (!register_is(r, LIGHTRANGER5_REG_ENABLE, 0xFF, LIGHTRANGER5_BIT_CPU_RDY | LIGHTRANGER5_BIT_PON)) {
+            wait_more(r, index, RANGER_BRINGUP_BOOT_POLL_TICKS);
+            break;
+        }
+
+        // Move the sensor off the default address as soon as the image runs, the next sensor on the ISU can
+        // come out of reset once it answers at the new address
+        if ((r->state == RANGER_BRINGUP_APP_BOOT) && (r->cfg.i2c_address != LIGHTRANGER5_SET_DEV_ADDR)) {
+            if (lightranger5_request_i2c_address(r->ctx, r->cfg.i2c_address)) {
+                fail(r, index, "address change failed");
+                break;
+            }
+            enter_state(r, index, RANGER_BRINGUP_ADDRESS, LIGHTRANGER5_BOOT_TIMEOUT_MS);
+            break;
+        }
+        enter_state(r, index, RANGER_BRINGUP_APP, LIGHTRANGER5_BOOT_TIMEOUT_MS);
+        break;
+
+    case RANGER_BRINGUP_APP:
+
+        if (lightranger5_get_app_version(r->ctx, &appid, version) != LIGHTRANGER5_OK) {
+            wait_more(r, index, RANGER_BRINGUP_BOOT_POLL_TICKS);
+            break;
+        }
+
+        if (appid != LIGHTRANGER5_APPID_MEASUREMENT) {
+
+            // Ask for the measurement app and check again, this is what lightranger5_load_app() does without
+            // its fixed 100ms sleep
+            appid = LIGHTRANGER5_APPID_MEASUREMENT;
+            lightranger5_generic_write(r->ctx, LIGHTRANGER5_REG_APPREQID, &appid, 1);
+            wait_more(r, index, RANGER_BRINGUP_BOOT_POLL_TICKS);
+            break;
+        }
+
+        // The cached calibration can be used if it was taken with this image
+        if (r->calibrationValid && !memcmp(r->appVersion, version, LIGHTRANGER5_APP_VERSION_SIZE)) {
+            enter_state(r, index, RANGER_BRINGUP_DONE, 0);
+            break;
+        }
+
+        memcpy(r->appVersion, version, LIGHTRANGER5_APP_VERSION_SIZE);
+        if (lightranger5_start_calib_cmd(r->ctx)) {
+            fail(r, index, "factory calibration failed");
+            break;
+        }
+        enter_state(r, index, RANGER_BRINGUP_CALIBRATE, RANGER_BRINGUP_CALIBRATION_TIMEOUT_MS);
+        r->wake += RANGER_BRINGUP_CALIBRATION_POLL_TICKS;
+        break;
+
+    case RANGER_BRINGUP_CALIBRATE:
+
+        if ((lightranger5_get_status(r->ctx, &status) != I2C_MASTER_SUCCESS) || status) {
+            wait_more(r, index, RANGER_BRINGUP_CALIBRATION_POLL_TICKS);
+            break;
+        }
+
+        if (lightranger5_get_factory_calib_data(r->ctx, r->factoryCalib)) {
+            fail(r, index, "factory calibration failed");
+            break;
+        }
+        r->calibrationValid = true;
+        r->calibrated = true;
+        enter_state(r, index, RANGER_BRINGUP_DONE, 0);
+        break;
+
+    default:
+        break;
+    }
+}
+
+bool ranger_bringup_run(ranger_bringup_t* rangers, int count, uint32_t download_speed)
+{
+    bool ok = true;
+
+    bringupStart = tx_time_get();
+
+    // Every cold sensor comes out of reset at the default address, hold them all in reset first
+    for (int i = 0; i < count; i++) {
+
+        ranger_bringup_t* r = &rangers[i];
+
+        r->calibrated = false;
+        r->readyMs = 0;
+        memset(&r->stats, 0, sizeof(r->stats));
+
+        if (r->start == LIGHTRANGER5_START_COLD) {
+            mtk_os_hal_gpio_set_output((os_hal_gpio_pin)r->cfg.en, OS_HAL_GPIO_DATA_LOW);
+            r->state = RANGER_BRINGUP_HOLD;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+
+        ranger_bringup_t* r = &rangers[i];
+
+        if (r->start == LIGHTRANGER5_START_COLD) {
+
+            // Talk to it at the default address until it is moved
+            lightranger5_cfg_t cfg = r->cfg;
+            cfg.i2c_address = LIGHTRANGER5_SET_DEV_ADDR;
+            if (lightranger5_init(r->ctx, &cfg, false) == I2C_MASTER_ERROR) {
+                fail(r, i, "init failed");
+                continue;
+            }
+
+            // What lightranger5_default_cfg() does, without its fixed sleeps
+            lightranger5_set_pin_state_io0(r->ctx, 1);
+        }
+        else {
+            // A warm sensor is already measuring, an image loaded sensor only needs the app and calibration
+            enter_state(r, i, (r->start == LIGHTRANGER5_START_WARM) ? RANGER_BRINGUP_DONE : RANGER_BRINGUP_APP,
+                        LIGHTRANGER5_BOOT_TIMEOUT_MS);
+        }
+    }
+
+    for (;;) {
+
+        ULONG now = tx_time_get();
+        ULONG next = now;
+        bool pending = false;
+        bool active = false;
+
+        for (int i = 0; i < count; i++) {
+
+            ranger_bringup_t* r = &rangers[i];
+
+            if ((r->state == RANGER_BRINGUP_HOLD) && may_release(rangers, count, i)) {
+                mtk_os_hal_gpio_set_output((os_hal_gpio_pin)r->cfg.en, OS_HAL_GPIO_DATA_HIGH);
+                enter_state(r, i, RANGER_BRINGUP_BOOT, LIGHTRANGER5_BOOT_TIMEOUT_MS);
+            }
+
+            if ((r->state == RANGER_BRINGUP_DONE) || (r->state == RANGER_BRINGUP_FAILED)) {
+                continue;
+            }
+
+            pending = true;
+            if (r->state == RANGER_BRINGUP_HOLD) {
+                continue;
+            }
+
+            if ((LONG)(r->wake - tx_time_get()) <= 0) {
+                step(r, i, download_speed);
+            }
+
+            if ((r->state != RANGER_BRINGUP_DONE) && (r->state != RANGER_BRINGUP_FAILED) &&
+                (r->state != RANGER_BRINGUP_HOLD)) {
+                if (!active || ((LONG)(r->wake - next) < 0)) {
+                    next = r->wake;
+                }
+                active = true;
+            }
+        }
+
+        if (!pending) {
+            break;
+        }
+
+        if (!active) {
+
+            // Nothing is running and the sensors left can't come out of reset, more than one of them has to
+            // stay at the default address on the same ISU
+            bool released = false;
+            for (int i = 0; i < count; i++) {
+                if ((rangers[i].state == RANGER_BRINGUP_HOLD) && may_release(rangers, count, i)) {
+                    released = true;
+                }
+            }
+            if (!released) {
+                for (int i = 0; i < count; i++) {
+                    if (rangers[i].state == RANGER_BRINGUP_HOLD) {
+                        fail(&rangers[i], i, "default address conflict");
+                    }
+                }
+            }
+            continue;
+        }
+
+        now = tx_time_get();
+        if ((LONG)(next - now) > 0) {
+            tx_thread_sleep(next - now);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (rangers[i].state != RANGER_BRINGUP_DONE) {
+            ok = false;
+        }
+        else if (rangers[i].start == LIGHTRANGER5_START_COLD) {
+            printf("LightRanger5 %d: %u records in %lu ms, ready in %lu ms, %u busy polls\n", i,
+                   rangers[i].stats.records, (unsigned long)rangers[i].stats.download_ms,
+                   (unsigned long)rangers[i].readyMs, rangers[i].stats.busy_polls);
+        }
+    }
+
+    printf("LightRanger5 bring up %s in %lu ms\n", ok ? "OK" : "FAILED", tx_time_get() - bringupStart);
+
+    return ok;
+}
@@ -0,0 +1,65 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tx_api.h"
+#include "lightranger5.h"
+
+// Parallel bring up of several LightRanger5 (TMF8801) sensors.
+//
+// Bringing the sensors up one after another mostly waits on the devices: the bootloader coming out of reset,
+// the downloaded image starting, the address change and above all the factory calibration.  ranger_bringup_run()
+// keeps a small state machine per sensor and only talks to a sensor when its next step is due, so the bus is
+// used to download the image to one sensor while another one boots or calibrates.
+//
+// Every TMF8801 comes out of reset at the default address 0x41, so only one sensor per ISU may be out of reset
+// at that address at a time.  A sensor is released from reset once no other sensor on its ISU answers at 0x41,
+// the sensors that move to another address go first.  Every sensor needs its own EN line.
+//
+// The bring up ends once each sensor runs the measurement app and has a factory calibration, either the cached
+// one (same image version) or one taken during the bring up.  Starting the measurement is left to the caller.
+
+// Factory calibration timeout, the TMF8801 normally finishes in about a second
+#define RANGER_BRINGUP_CALIBRATION_TIMEOUT_MS   32000
+
+// Ticks (ms) between polls while a sensor boots, changes address or calibrates
+#define RANGER_BRINGUP_BOOT_POLL_TICKS          1
+#define RANGER_BRINGUP_CALIBRATION_POLL_TICKS   10
+
+typedef enum
+{
+    RANGER_BRINGUP_HOLD = 0,    // Held in reset until the default address is free on the ISU
+    RANGER_BRINGUP_BOOT,        // Out of reset, waiting for the bootloader, then downloads the image
+    RANGER_BRINGUP_APP_BOOT,    // Image started, waiting for CPU_RDY | PON
+    RANGER_BRINGUP_ADDRESS,     // Address change requested, waiting for the device at its new address
+    RANGER_BRINGUP_APP,         // Checking the measurement app and its version
+    RANGER_BRINGUP_CALIBRATE,   // Factory calibration running
+    RANGER_BRINGUP_DONE,
+    RANGER_BRINGUP_FAILED
+} ranger_bringup_state_t;
+
+typedef struct
+{
+    // Set up by the caller
+    lightranger5_t* ctx;
+    lightranger5_cfg_t cfg;             // Pins and the address the sensor ends up at
+    lightranger5_start_t start;         // See lightranger5_check_warm_start(), cold sensors get the image downloaded
+    bool calibrationValid;              // factoryCalib holds a cached calibration taken with appVersion
+    uint8_t appVersion[LIGHTRANGER5_APP_VERSION_SIZE];
+    uint8_t factoryCalib[LIGHTRANGER5_FACTORY_CALIB_SIZE];
+
+    // Bring up state, calibrated is set if factoryCalib and appVersion were updated by the factory calibration
+    ranger_bringup_state_t state;
+    bool calibrated;
+    ULONG wake;                         // Tick the next step is due
+    ULONG deadline;                     // Tick the current state times out
+    uint32_t readyMs;                   // Bring up start to done
+    lightranger5_download_stats_t stats;
+} ranger_bringup_t;
+
+// Brings up count sensors in parallel, download_speed is used while an image is downloaded.  Returns true once
+// every sensor is done, a sensor that fails is held in reset and the others carry on.
+bool ranger_bringup_run(ranger_bringup_t* rangers, int count, uint32_t download_speed);
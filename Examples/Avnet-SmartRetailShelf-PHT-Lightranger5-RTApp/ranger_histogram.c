@@ -0,0 +1,206 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include <string.h>
+#include "ranger_histogram.h"
+
+// TDCs summed per bin, crosstalk removed
+static uint32_t work[RANGER_HISTOGRAM_BINS];
+
+static uint32_t isqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+static void sum_tdcs(const uint16_t (*tdcs)[RANGER_HISTOGRAM_BINS])
+{
+    memset(work, 0, sizeof(work));
+
+    for (int tdc = 0; tdc < RANGER_HISTOGRAM_TDC_COUNT; tdc++) {
+        for (int bin = 0; bin < RANGER_HISTOGRAM_BINS; bin++) {
+            work[bin] += tdcs[tdc][bin];
+        }
+    }
+}
+
+// The quietest RANGER_HISTOGRAM_AMBIENT_WINDOW consecutive bins (sliding sum) give a first estimate, it is
+// biased low by the noise.  The ambient level is the mean of all the bins within 3 noise deviations of it.
+static uint32_t ambient_level(void)
+{
+    uint32_t sum = 0;
+    uint32_t lowest;
+    uint32_t limit;
+    uint32_t count = 0;
+
+    for (int bin = 0; bin < RANGER_HISTOGRAM_AMBIENT_WINDOW; bin++) {
+        sum += work[bin];
+    }
+    lowest = sum;
+
+    for (int bin = RANGER_HISTOGRAM_AMBIENT_WINDOW; bin < RANGER_HISTOGRAM_BINS; bin++) {
+        sum += work[bin] - work[bin - RANGER_HISTOGRAM_AMBIENT_WINDOW];
+        if (sum < lowest) {
+            lowest = sum;
+        }
+    }
+
+    lowest /= RANGER_HISTOGRAM_AMBIENT_WINDOW;
+    limit = lowest + 3 * isqrt(lowest) + 1;
+
+    sum = 0;
+    for (int bin = 0; bin < RANGER_HISTOGRAM_BINS; bin++) {
+        if (work[bin] <= limit) {
+            sum += work[bin];
+            count++;
+        }
+    }
+    return count ? sum / count : lowest;
+}
+
+// Smoothed bin, [1 2 1] so 4x the counts
+static inline uint32_t smoothed(int bin)
+{
+    return work[bin - 1] + 2 * work[bin] + work[bin + 1];
+}
+
+void ranger_histogram_cfg_setup(ranger_histogram_cfg_t* cfg)
+{
+    cfg->maxTargets = RANGER_HISTOGRAM_MAX_TARGETS;
+    cfg->minStrength = 0;
+    cfg->binWidthUm = RANGER_HISTOGRAM_BIN_WIDTH_UM_DEFAULT;
+    cfg->offsetMm = RANGER_HISTOGRAM_OFFSET_MM_DEFAULT;
+}
+
+void ranger_histogram_make_xtalk(const uint16_t (*tdcs)[RANGER_HISTOGRAM_BINS], uint32_t* xtalk)
+{
+    uint32_t ambient;
+
+    sum_tdcs(tdcs);
+    ambient = ambient_level();
+
+    for (int bin = 0; bin < RANGER_HISTOGRAM_BINS; bin++) {
+        xtalk[bin] = (work[bin] > ambient) ? work[bin] - ambient : 0;
+    }
+}
+
+uint8_t ranger_histogram_find_targets(const uint16_t (*tdcs)[RANGER_HISTOGRAM_BINS], const uint32_t* xtalk,
+                                      const ranger_histogram_cfg_t* cfg, ranger_histogram_targets_t* targets)
+{
+    uint8_t maxTargets = cfg->maxTargets;
+    uint32_t base;
+    uint32_t noise;
+    uint32_t threshold;
+    uint32_t left, center, right;
+
+    if ((maxTargets == 0) || (maxTargets > RANGER_HISTOGRAM_MAX_TARGETS)) {
+        maxTargets = RANGER_HISTOGRAM_MAX_TARGETS;
+    }
+
+    targets->count = 0;
+
+    sum_tdcs(tdcs);
+    if (xtalk != NULL) {
+        for (int bin = 0; bin < RANGER_HISTOGRAM_BINS; bin++) {
+            work[bin] = (work[bin] > xtalk[bin]) ? work[bin] - xtalk[bin] : 0;
+        }
+    }
+
+    // Thresholds on the smoothed scale, the [1 2 1] sum of three bins at the ambient level has a variance of
+    // 6 * ambient
+    targets->ambient = ambient_level();
+    base = 4 * targets->ambient;
+    noise = isqrt(6 * targets->ambient);
+    threshold = base + RANGER_HISTOGRAM_SIGMA * (noise ? noise : 1) + 4 * (uint32_t)cfg->minStrength;
+
+    left = smoothed(1);
+    center = smoothed(2);
+
+    for (int bin = 2; bin < RANGER_HISTOGRAM_BINS - 2; bin++) {
+
+        right = smoothed(bin + 1);
+
+        bool peak = (center > threshold) && (center > left) && (center >= right);
+
+        // The subtracted crosstalk reference adds its own photon noise, the reference ambient level and the
+        // crosstalk counts of both histograms
+        if (peak && (xtalk != NULL)) {
+            uint32_t variance = 6 * (2 * targets->ambient + 2 * xtalk[bin]);
+            peak = center > base + RANGER_HISTOGRAM_SIGMA * isqrt(variance) + 4 * (uint32_t)cfg->minStrength;
+        }
+
+        if (peak) {
+
+            uint32_t strength = (center - base) / 4;
+            int32_t curvature = (int32_t)left - 2 * (int32_t)center + (int32_t)right;
+            int32_t position = bin * 256;
+            int64_t distance;
+            int slot = targets->count;
+
+            // Vertex of the parabola through the peak and its neighbours, in 1/256 bin
+            if (curvature < 0) {
+                int32_t shift = (128 * ((int32_t)left - (int32_t)right)) / curvature;
+                position += (shift > 128) ? 128 : ((shift < -128) ? -128 : shift);
+            }
+
+            distance = ((int64_t)position * cfg->binWidthUm) / (256 * 1000) + cfg->offsetMm;
+            if (strength > 0xFFFF) {
+                strength = 0xFFFF;
+            }
+
+            // Keep the strongest, replace the weakest kept target once the list is full
+            if (slot == maxTargets) {
+                slot = 0;
+                for (int i = 1; i < maxTargets; i++) {
+                    if (targets->targets[i].strength < targets->targets[slot].strength) {
+                        slot = i;
+                    }
+                }
+                if (targets->targets[slot].strength >= strength) {
+                    slot = -1;
+                }
+            }
+
+            // Peaks before bin 0 (offsetMm) are what is left of the crosstalk
+            if ((slot >= 0) && (distance >= 0) && (distance <= INT16_MAX)) {
+                targets->targets[slot].distance_mm = (int16_t)distance;
+                targets->targets[slot].strength = (uint16_t)strength;
+                if (slot == targets->count) {
+                    targets->count++;
+                }
+            }
+        }
+
+        left = center;
+        center = right;
+    }
+
+    // Nearest first
+    for (int i = 1; i < targets->count; i++) {
+        ranger_histogram_target_t target = targets->targets[i];
+        int j = i;
+        while ((j > 0) && (targets->targets[j - 1].distance_mm > target.distance_mm)) {
+            targets->targets[j] = targets->targets[j - 1];
+            j--;
+        }
+        targets->targets[j] = target;
+    }
+
+    return targets->count;
+}
@@ -0,0 +1,69 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Multi-target detection on TMF8801 distance histograms.
+//
+// The TMF8801 only reports the strongest peak of its histograms.  On a partially filled shelf that is often the
+// back wall rather than the product at the front, both show up in the histogram as separate peaks.
+// ranger_histogram_find_targets() runs on the M4 with the histogram dump of a sensor (5 TDCs of 128 bins):
+//
+// - The TDCs are summed per bin and the crosstalk reference is subtracted.  The reference is a histogram taken
+//   with nothing in front of the sensor, it holds the light the cover glass reflects straight back.
+// - The ambient level is the mean of the quietest RANGER_HISTOGRAM_AMBIENT_WINDOW bins, it is subtracted too.
+// - The histogram is smoothed with a [1 2 1] kernel and every local maximum more than
+//   RANGER_HISTOGRAM_SIGMA noise deviations (photon noise, sqrt of the ambient level) above the ambient level is
+//   a candidate.  The strongest maxTargets candidates are kept, their position is refined to 1/256 bin with a
+//   parabola through the peak and its neighbours.
+//
+// Everything is integer math on a single static work buffer, the functions are not reentrant.  The module only
+// depends on the C library so it can be built and fed recorded histograms on a host.
+
+#define RANGER_HISTOGRAM_TDC_COUNT          5
+#define RANGER_HISTOGRAM_BINS               128
+#define RANGER_HISTOGRAM_MAX_TARGETS        4
+
+// Bins averaged for the ambient estimate and the detection threshold in noise deviations
+#define RANGER_HISTOGRAM_AMBIENT_WINDOW     16
+#define RANGER_HISTOGRAM_SIGMA              5
+
+// Nominal bin width, 128 bins cover the 2.5m range of the TMF8801.  Calibrate binWidthUm and offsetMm against
+// targets at known distances for the best accuracy.
+#define RANGER_HISTOGRAM_BIN_WIDTH_UM_DEFAULT   20000
+#define RANGER_HISTOGRAM_OFFSET_MM_DEFAULT      0
+
+typedef struct
+{
+    uint8_t maxTargets;             // 1 - RANGER_HISTOGRAM_MAX_TARGETS
+    uint16_t minStrength;           // Smallest peak reported, counts above the ambient level
+    uint16_t binWidthUm;            // Distance per bin in micrometers
+    int16_t offsetMm;               // Distance of bin 0
+} ranger_histogram_cfg_t;
+
+typedef struct
+{
+    int16_t distance_mm;
+    uint16_t strength;              // Peak height above the ambient level in counts, saturates at 0xFFFF
+} ranger_histogram_target_t;
+
+typedef struct
+{
+    uint8_t count;                  // Targets found, nearest first
+    ranger_histogram_target_t targets[RANGER_HISTOGRAM_MAX_TARGETS];
+    uint32_t ambient;               // Ambient counts per bin
+} ranger_histogram_targets_t;
+
+// Sets up cfg with the defaults above, RANGER_HISTOGRAM_MAX_TARGETS targets and no minimum strength
+void ranger_histogram_cfg_setup(ranger_histogram_cfg_t* cfg);
+
+// Turns a histogram taken with nothing in front of the sensor into a crosstalk reference for
+// ranger_histogram_find_targets(), the ambient level is removed
+void ranger_histogram_make_xtalk(const uint16_t (*tdcs)[RANGER_HISTOGRAM_BINS], uint32_t* xtalk);
+
+// Finds up to cfg->maxTargets targets in a histogram dump, xtalk can be NULL.  Returns targets->count.
+uint8_t ranger_histogram_find_targets(const uint16_t (*tdcs)[RANGER_HISTOGRAM_BINS], const uint32_t* xtalk,
+                                      const ranger_histogram_cfg_t* cfg, ranger_histogram_targets_t* targets);
@@ -0,0 +1,143 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include <string.h>
+#include "shelf_analytics.h"
+
+// No object in front of the people sensor, sorts behind every range
+#define NO_OBJECT INT16_MAX
+
+static int16_t median(const shelf_analytics_t* analytics)
+{
+    int16_t sorted[SHELF_ANALYTICS_MEDIAN_WINDOW];
+
+    for (int i = 0; i < analytics->samples; i++) {
+        int16_t value = analytics->window[i];
+        int j = i;
+        while ((j > 0) && (sorted[j - 1] > value)) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    return sorted[analytics->samples / 2];
+}
+
+static void add_range(shelf_analytics_t* analytics, int16_t range_mm)
+{
+    analytics->window[analytics->next] = range_mm;
+    analytics->next = (analytics->next + 1) % SHELF_ANALYTICS_MEDIAN_WINDOW;
+    if (analytics->samples < SHELF_ANALYTICS_MEDIAN_WINDOW) {
+        analytics->samples++;
+    }
+}
+
+void shelf_analytics_cfg_setup(shelf_analytics_cfg_t* cfg, shelf_analytics_mode_t mode)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->mode = mode;
+    cfg->hysteresisPct = SHELF_ANALYTICS_HYSTERESIS_PCT_DEFAULT;
+    cfg->presenceMm = SHELF_ANALYTICS_PRESENCE_MM_DEFAULT;
+    cfg->presenceOnCount = SHELF_ANALYTICS_PRESENCE_ON_DEFAULT;
+    cfg->presenceOffCount = SHELF_ANALYTICS_PRESENCE_OFF_DEFAULT;
+}
+
+bool shelf_analytics_cfg_valid(const shelf_analytics_cfg_t* cfg)
+{
+    if (cfg->mode == SHELF_ANALYTICS_PRESENCE) {
+        return (cfg->presenceMm != 0) && (cfg->presenceOnCount != 0) && (cfg->presenceOffCount != 0);
+    }
+    return (cfg->emptyMm > cfg->fullMm) && (cfg->emptyMm <= INT16_MAX) && (cfg->hysteresisPct <= 100);
+}
+
+void shelf_analytics_setup(shelf_analytics_t* analytics, const shelf_analytics_cfg_t* cfg)
+{
+    memset(analytics, 0, sizeof(*analytics));
+    analytics->cfg = *cfg;
+    analytics->median_mm = -1;
+    analytics->level = SHELF_ANALYTICS_LEVEL_UNKNOWN;
+}
+
+uint8_t shelf_analytics_fill_pct(const shelf_analytics_cfg_t* cfg, int range_mm)
+{
+    if (range_mm < 0) {
+        return SHELF_ANALYTICS_LEVEL_UNKNOWN;
+    }
+    if (range_mm >= cfg->emptyMm) {
+        return 0;
+    }
+    if (range_mm <= cfg->fullMm) {
+        return 100;
+    }
+
+    // Rounded to the nearest percent
+    return (uint8_t)(((cfg->emptyMm - range_mm) * 200 / (cfg->emptyMm - cfg->fullMm) + 1) / 2);
+}
+
+bool shelf_analytics_update(shelf_analytics_t* analytics, int range_mm, uint8_t* previous)
+{
+    uint8_t level;
+
+    if (range_mm > INT16_MAX - 1) {
+        range_mm = INT16_MAX - 1;
+    }
+
+    if (analytics->cfg.mode == SHELF_ANALYTICS_STOCK) {
+
+        if (range_mm < 0) {
+            return false;
+        }
+
+        add_range(analytics, (int16_t)range_mm);
+        analytics->median_mm = median(analytics);
+
+        // The first level is reported once the window is full
+        if (analytics->samples < SHELF_ANALYTICS_MEDIAN_WINDOW) {
+            return false;
+        }
+
+        level = shelf_analytics_fill_pct(&analytics->cfg, analytics->median_mm);
+
+        if (analytics->level != SHELF_ANALYTICS_LEVEL_UNKNOWN) {
+
+            int change = (level > analytics->level) ? level - analytics->level : analytics->level - level;
+
+            // Becoming empty or full is always reported
+            if (!change || ((change < analytics->cfg.hysteresisPct) && (level != 0) && (level != 100))) {
+                return false;
+            }
+        }
+    }
+    else {
+
+        add_range(analytics, (range_mm < 0) ? NO_OBJECT : (int16_t)range_mm);
+        analytics->median_mm = median(analytics);
+        if (analytics->median_mm == NO_OBJECT) {
+            analytics->median_mm = -1;
+        }
+
+        if (analytics->samples < SHELF_ANALYTICS_MEDIAN_WINDOW) {
+            return false;
+        }
+
+        level = ((analytics->median_mm >= 0) && (analytics->median_mm < analytics->cfg.presenceMm)) ? 1 : 0;
+
+        if (analytics->level != SHELF_ANALYTICS_LEVEL_UNKNOWN) {
+
+            if (level == analytics->level) {
+                analytics->debounce = 0;
+                return false;
+            }
+
+            analytics->debounce++;
+            if (analytics->debounce < (level ? analytics->cfg.presenceOnCount : analytics->cfg.presenceOffCount)) {
+                return false;
+            }
+        }
+        analytics->debounce = 0;
+    }
+
+    *previous = analytics->level;
+    analytics->level = level;
+    return true;
+}
@@ -0,0 +1,80 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Stock level and presence detection on the LightRanger5 ranges.
+//
+// A shelf sensor looks along the shelf from the front, with the shelf full it sees the first product (fullMm),
+// with the shelf empty the back wall (emptyMm).  shelf_analytics_update() takes every new result of a sensor:
+//
+// - The ranges are median filtered over the last SHELF_ANALYTICS_MEDIAN_WINDOW results, a customer's hand or a
+//   single bad result doesn't move the level.
+// - A shelf sensor converts the median to a fill level in percent, a change is only reported once it reaches
+//   hysteresisPct or the shelf becomes empty or full, so the level doesn't toggle around a boundary.
+// - The people sensor compares the median against presenceMm, presence is only reported after presenceOnCount
+//   results in a row with someone in front of the shelf and cleared after presenceOffCount results without.
+//
+// The module only depends on the C library so it can be built and fed recorded ranges on a host.
+
+#define SHELF_ANALYTICS_MEDIAN_WINDOW   5
+
+// Level before the first report
+#define SHELF_ANALYTICS_LEVEL_UNKNOWN   0xFF
+
+// Defaults, the hysteresis in percent of the fill level and the debounce in results (100ms each by default)
+#define SHELF_ANALYTICS_HYSTERESIS_PCT_DEFAULT  10
+#define SHELF_ANALYTICS_PRESENCE_MM_DEFAULT     1000
+#define SHELF_ANALYTICS_PRESENCE_ON_DEFAULT     3
+#define SHELF_ANALYTICS_PRESENCE_OFF_DEFAULT    10
+
+typedef enum
+{
+    SHELF_ANALYTICS_STOCK = 0,      // Fill level in percent
+    SHELF_ANALYTICS_PRESENCE        // 1 if someone is in front of the shelf, otherwise 0
+} shelf_analytics_mode_t;
+
+typedef struct
+{
+    shelf_analytics_mode_t mode;
+
+    // SHELF_ANALYTICS_STOCK, emptyMm has to be larger than fullMm
+    uint16_t emptyMm;               // Range with the shelf empty
+    uint16_t fullMm;                // Range with the shelf full
+    uint8_t hysteresisPct;          // Smallest change reported
+
+    // SHELF_ANALYTICS_PRESENCE
+    uint16_t presenceMm;            // Someone nearer than this is in front of the shelf
+    uint8_t presenceOnCount;        // Results in a row that set presence
+    uint8_t presenceOffCount;       // Results in a row that clear presence
+} shelf_analytics_cfg_t;
+
+typedef struct
+{
+    shelf_analytics_cfg_t cfg;
+    int16_t window[SHELF_ANALYTICS_MEDIAN_WINDOW];
+    uint8_t samples;                // Entries in window[]
+    uint8_t next;                   // Entry the next range goes to
+    int16_t median_mm;              // -1 until there is a range, or no object (presence)
+    uint8_t level;                  // Reported level, SHELF_ANALYTICS_LEVEL_UNKNOWN before the first report
+    uint8_t debounce;               // Results in a row that disagree with level (presence)
+} shelf_analytics_t;
+
+// Sets up cfg with the defaults above for the given mode, emptyMm and fullMm are 0 (not calibrated)
+void shelf_analytics_cfg_setup(shelf_analytics_cfg_t* cfg, shelf_analytics_mode_t mode);
+
+// Checks a configuration, a stock configuration needs emptyMm > fullMm
+bool shelf_analytics_cfg_valid(const shelf_analytics_cfg_t* cfg);
+
+// Starts over with a new configuration, the level is unknown until the next report
+void shelf_analytics_setup(shelf_analytics_t* analytics, const shelf_analytics_cfg_t* cfg);
+
+// Fill level in percent (0 - 100) for a range, 0xFF for no range (-1)
+uint8_t shelf_analytics_fill_pct(const shelf_analytics_cfg_t* cfg, int range_mm);
+
+// Takes the next range of the sensor, -1 for no object.  A shelf sensor skips ranges without an object, the back
+// wall is always in range.  Returns true if the reported level changed, previous gets the level before.
+bool shelf_analytics_update(shelf_analytics_t* analytics, int range_mm, uint8_t* previous);
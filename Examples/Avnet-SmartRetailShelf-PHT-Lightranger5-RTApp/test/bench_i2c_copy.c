@@ -0,0 +1,85 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host benchmark for the copy the LightRanger5 histogram blocks no longer make.  A read into a buffer outside
+// SYSRAM goes into the i2c_frame bounce buffer and is copied out, hist_block is in SYSRAM so the DMA writes
+// each 128 byte block straight into it.  A histogram is LIGHTRANGER5_HIST_BLOCK_COUNT blocks.
+//
+// The blocks are copied with the host memcpy() and with a byte loop like the size optimized memcpy() of
+// newlib-nano, which the M4 build links (-specs=nano.specs).  These are host times, not M4 cycles.
+//
+//   ./out/bench_i2c_copy
+
+#include <stdint.h>
+#include <string.h>
+#include "host_test.h"
+#include "lightranger5.h"
+
+#define PASSES 1000000
+
+static uint8_t i2c_frame[255];
+static uint8_t hist_block[LIGHTRANGER5_HIST_BLOCK_SIZE];
+
+// newlib-nano's memcpy() when it is built for size, the bench is built without vectorizing so it stays a byte
+// loop
+static void* byte_copy(void* dst, const void* src, size_t len)
+{
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+
+    while (len--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
+
+static void* (*volatile copy_fn)(void*, const void*, size_t);
+
+// ns to bounce one histogram, the best of a few runs
+static double time_copy(void* (*fn)(void*, const void*, size_t))
+{
+    double best = 1e30;
+
+    copy_fn = fn;
+    for (int run = 0; run < 5; run++) {
+        double start = host_time_ns();
+        for (int pass = 0; pass < PASSES; pass++) {
+            for (int block = 0; block < LIGHTRANGER5_HIST_BLOCK_COUNT; block++) {
+                copy_fn(hist_block, i2c_frame, sizeof(hist_block));
+            }
+        }
+        double ns = (host_time_ns() - start) / PASSES;
+        best = (ns < best) ? ns : best;
+    }
+    return best;
+}
+
+int main(void)
+{
+    static const struct
+    {
+        const char* name;
+        void* (*fn)(void*, const void*, size_t);
+    } copies[] = {
+        {"memcpy", memcpy},
+        {"byte loop", byte_copy},
+    };
+    const int bytes = LIGHTRANGER5_HIST_BLOCK_COUNT * LIGHTRANGER5_HIST_BLOCK_SIZE;
+
+    for (int i = 0; i < (int)sizeof(i2c_frame); i++) {
+        i2c_frame[i] = (uint8_t)i;
+    }
+
+    printf("Copy of a histogram, %d blocks of %d bytes, host ns\n\n", LIGHTRANGER5_HIST_BLOCK_COUNT,
+           LIGHTRANGER5_HIST_BLOCK_SIZE);
+    printf("%-10s %13s %13s %13s %13s\n", "", "bounce", "per block", "per byte", "direct (now)");
+    for (size_t i = 0; i < sizeof(copies) / sizeof(copies[0]); i++) {
+        double ns = time_copy(copies[i].fn);
+
+        printf("%-10s %13.1f %13.1f %13.3f %13.1f\n", copies[i].name, ns, ns / LIGHTRANGER5_HIST_BLOCK_COUNT,
+               ns / bytes, 0.0);
+        CHECK(memcmp(hist_block, i2c_frame, sizeof(hist_block)) == 0);
+    }
+
+    return host_test_result("bench_i2c_copy");
+}
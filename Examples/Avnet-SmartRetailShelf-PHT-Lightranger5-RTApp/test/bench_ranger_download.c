@@ -0,0 +1,202 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Simulated TMF8801 firmware download times, the old download against the current one.  Both run on the
+// simulated bus and bootloader in bootloader_sim.h: the current one is lightranger5_update_firmware() from the
+// driver, the old one is legacy_update_firmware() below, the driver's download before it sent 128 byte records
+// (16 byte W_RAM records at 100KHz, fixed 100ms sleeps after EN and the reset, the status polled back to back).
+// The times are simulated bus and sleep times, not measurements on a board, see bootloader_sim.h for what is
+// assumed.  The measurement app then takes the same time to its first range with either download.
+//
+//   ./out/bench_ranger_download
+
+#include "host_test.h"
+#include "bootloader_sim.h"
+
+#define LEGACY_RECORD_SIZE 16
+
+typedef struct
+{
+    const char* name;
+    bool ok;
+    bool complete;                  // The whole image made it to the RAM
+    uint32_t records;
+    uint32_t busBytes;
+    uint32_t download_ms;
+    uint32_t total_ms;              // lightranger5_init() to the measurement app answering
+} DownloadTimes;
+
+static void legacy_wait_ready(lightranger5_t* ctx)
+{
+    uint8_t readBuf[3];
+
+    do {
+        lightranger5_generic_read(ctx, LIGHTRANGER5_REG_CMD_DATA7, readBuf, 3);
+    } while ((readBuf[0] != 0x00) || (readBuf[1] != 0x00) || (readBuf[2] != 0xFF));
+}
+
+static void legacy_write(lightranger5_t* ctx, const uint8_t* data, uint8_t len)
+{
+    uint8_t frame[1 + 2 + LEGACY_RECORD_SIZE + 1];
+
+    frame[0] = LIGHTRANGER5_REG_CMD_DATA7;
+    memcpy(&frame[1], data, len);
+    i2c_master_write(&ctx->i2c, frame, len + 1);
+}
+
+// The download the driver did before, less its printf()s.  The old loop stopped at 0x2A5D / 16 records, so the
+// last 12 bytes of the image were never sent.
+static bool legacy_update_firmware(DownloadTimes* times)
+{
+    lightranger5_t ctx;
+    lightranger5_cfg_t cfg;
+    uint8_t readBuf[4];
+    uint8_t reg_tmp;
+
+    memset(&ctx, 0, sizeof(ctx));
+    lightranger5_cfg_setup(&cfg);
+    cfg.en = 0;
+    cfg.scl = OS_HAL_I2C_ISU2;
+    cfg.sda = OS_HAL_I2C_ISU2;
+    ctx.slave_address = LIGHTRANGER5_SET_DEV_ADDR;
+    ctx.i2c.config.addr = LIGHTRANGER5_SET_DEV_ADDR;
+
+    ULONG start = tx_time_get();
+
+    lightranger5_init(&ctx, &cfg, true);
+    mtk_os_hal_gpio_set_output(cfg.en, OS_HAL_GPIO_DATA_HIGH);
+    tx_thread_sleep(100);
+
+    lightranger5_generic_read(&ctx, LIGHTRANGER5_REG_DEVICE_ID, &reg_tmp, 1);
+    if (reg_tmp != LIGHTRANGER5_EXPECTED_ID) {
+        return false;
+    }
+
+    // lightranger5_device_reset()
+    uint8_t reset[2];
+    lightranger5_generic_read(&ctx, LIGHTRANGER5_REG_ENABLE, &reg_tmp, 1);
+    reset[0] = LIGHTRANGER5_REG_ENABLE;
+    reset[1] = reg_tmp | LIGHTRANGER5_ENABLE_RESET;
+    i2c_master_write(&ctx.i2c, reset, 2);
+    tx_thread_sleep(100);
+
+    lightranger5_generic_read(&ctx, LIGHTRANGER5_REG_ENABLE, &reg_tmp, 1);
+    if (!(reg_tmp & LIGHTRANGER5_BIT_CPU_RDY)) {
+        return false;
+    }
+
+    uint8_t enable[2] = {LIGHTRANGER5_REG_ENABLE, LIGHTRANGER5_BIT_PON};
+    i2c_master_write(&ctx.i2c, enable, 2);
+    do {
+        lightranger5_generic_read(&ctx, LIGHTRANGER5_REG_ENABLE, readBuf, 1);
+    } while (readBuf[0] != 0x41);
+
+    lightranger5_generic_read(&ctx, LIGHTRANGER5_REG_APPID, readBuf, 4);
+    legacy_wait_ready(&ctx);
+
+    ULONG download_start = tx_time_get();
+
+    const uint8_t initBuf[] = {0x14, 0x01, 0x29, 0xC1};
+    legacy_write(&ctx, initBuf, sizeof(initBuf));
+    legacy_wait_ready(&ctx);
+
+    const uint8_t initAddrPtr[] = {0x43, 0x02, 0x00, 0x00, 0xBA};
+    legacy_write(&ctx, initAddrPtr, sizeof(initAddrPtr));
+    legacy_wait_ready(&ctx);
+
+    const uint8_t* imagePtr = tof_bin_image;
+    uint8_t writeBuffer[LEGACY_RECORD_SIZE + 3];
+
+    for (int i = 0; i < 0x2A5D / LEGACY_RECORD_SIZE; i++) {
+        uint8_t chkSum = LEGACY_RECORD_SIZE + 0x41;
+
+        writeBuffer[0] = 0x41;
+        writeBuffer[1] = LEGACY_RECORD_SIZE;
+        for (int j = 0; j < LEGACY_RECORD_SIZE; j++) {
+            writeBuffer[j + 2] = *imagePtr++;
+            chkSum += writeBuffer[j + 2];
+        }
+        writeBuffer[LEGACY_RECORD_SIZE + 2] = chkSum ^ 0xFF;
+
+        legacy_write(&ctx, writeBuffer, sizeof(writeBuffer));
+        legacy_wait_ready(&ctx);
+        times->records++;
+    }
+    times->download_ms = tx_time_get() - download_start;
+
+    const uint8_t ramremap_reset[] = {0x11, 0x00, 0xEE};
+    legacy_write(&ctx, ramremap_reset, sizeof(ramremap_reset));
+    do {
+        if (lightranger5_generic_read(&ctx, LIGHTRANGER5_REG_ENABLE, readBuf, 1) != I2C_MASTER_SUCCESS) {
+            readBuf[0] = 0;
+        }
+        tx_thread_sleep(10);
+    } while (readBuf[0] != 0x41);
+
+    times->total_ms = tx_time_get() - start;
+    return true;
+}
+
+static bool current_update_firmware(uint32_t speed, DownloadTimes* times)
+{
+    lightranger5_download_stats_t stats;
+    ULONG start = tx_time_get();
+
+    if (lightranger5_update_firmware(OS_HAL_I2C_ISU2, 0, 0x00, speed, &stats) != LIGHTRANGER5_OK) {
+        return false;
+    }
+
+    times->records = stats.records;
+    times->download_ms = stats.download_ms;
+    times->total_ms = tx_time_get() - start;
+    return true;
+}
+
+static void finish(DownloadTimes* times, bool ok)
+{
+    times->ok = ok;
+    times->complete = bl_sim_image_loaded();
+    times->busBytes = bl_sim.busBytes;
+}
+
+int main(void)
+{
+    static const struct
+    {
+        const char* name;
+        uint32_t speed;
+    } speeds[] = {
+        {"128 byte records, polled, 100KHz", I2C_MASTER_SPEED_STANDARD},
+        {"128 byte records, polled, 400KHz", I2C_MASTER_SPEED_FULL},
+        {"128 byte records, polled, 1MHz", I2C_MASTER_SPEED_FAST},
+    };
+    DownloadTimes times[1 + sizeof(speeds) / sizeof(speeds[0])];
+    int runs = 0;
+
+    memset(times, 0, sizeof(times));
+
+    bl_sim_off();
+    bl_sim.now = 0;
+    times[runs].name = "old: 16 byte records, 100KHz";
+    finish(&times[runs], legacy_update_firmware(&times[runs]));
+    runs++;
+
+    for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++, runs++) {
+        bl_sim_off();
+        bl_sim.now = 0;
+        times[runs].name = speeds[i].name;
+        finish(&times[runs], current_update_firmware(speeds[i].speed, &times[runs]));
+        CHECK(times[runs].ok && times[runs].complete);
+        CHECK(bl_sim.badFrames == 0);
+    }
+
+    printf("\nSimulated TMF8801 firmware download, %lu byte image, times in ms\n\n", tof_bin_image_length);
+    printf("%-34s %8s %8s %9s %8s %9s\n", "", "records", "bus B", "download", "EN->app", "complete");
+    for (int i = 0; i < runs; i++) {
+        printf("%-34s %8u %8u %9u %8u %9s\n", times[i].name, times[i].records, times[i].busBytes,
+               times[i].download_ms, times[i].total_ms,
+               !times[i].ok ? "failed" : (times[i].complete ? "yes" : "no"));
+    }
+
+    return host_test_result("bench_ranger_download");
+}
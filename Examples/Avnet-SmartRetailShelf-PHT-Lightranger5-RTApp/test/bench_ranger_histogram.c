@@ -0,0 +1,51 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host benchmark for the histogram kernel: the time per ranger_histogram_find_targets() call on a dump file,
+// with and without a crosstalk reference.  The kernel is called through a volatile pointer so the compiler
+// can't hoist it out of the loop.  These are host times, the M4 reports the cycles of every histogram in
+// rangerTargets[].kernelCycles.
+//
+//   ./out/bench_ranger_histogram histograms/front_and_back_wall.csv
+
+#include "host_test.h"
+#include "histogram_dump.h"
+
+#define PASSES 200000
+
+static uint8_t (*volatile find_targets)(const uint16_t (*)[RANGER_HISTOGRAM_BINS], const uint32_t*,
+                                        const ranger_histogram_cfg_t*, ranger_histogram_targets_t*) =
+    ranger_histogram_find_targets;
+
+int main(int argc, char* argv[])
+{
+    static HistogramDump dump;
+    static HistogramDump reference;
+    static uint32_t xtalk[RANGER_HISTOGRAM_BINS];
+    ranger_histogram_cfg_t cfg;
+    ranger_histogram_targets_t found;
+
+    if ((argc < 2) || !histogram_dump_load(argv[1], &dump)) {
+        printf("usage: bench_ranger_histogram <dump file>\n");
+        return 1;
+    }
+    if (dump.xtalk[0] && histogram_dump_load(dump.xtalk, &reference)) {
+        ranger_histogram_make_xtalk(reference.bins, xtalk);
+    }
+
+    ranger_histogram_cfg_setup(&cfg);
+
+    for (int withXtalk = 0; withXtalk < 2; withXtalk++) {
+
+        double start = host_time_ns();
+        for (int pass = 0; pass < PASSES; pass++) {
+            find_targets(dump.bins, withXtalk ? xtalk : NULL, &cfg, &found);
+        }
+        double ns = (host_time_ns() - start) / PASSES;
+
+        printf("%s crosstalk reference: %.0f ns per histogram on the host, %u targets\n",
+               withXtalk ? "with" : "without", ns, found.count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// A simulated TMF8801 on a simulated I2C bus for the firmware download benchmark.  Unlike ranger_sim.h, which
+// simulates the LightRanger5 driver functions, this one simulates the mikroSDK I2C master functions so the real
+// driver (lightranger5.c) runs on top of it, down to the bootloader command frames.
+//
+// The clock is kept in us.  An I2C transfer takes its bits on the wire at the bus speed, 9 bits per byte with
+// the address byte and a start and a stop (and a repeated start for a read), plus SIM_I2C_SETUP_US for the
+// OS_HAL driver to set the transfer up and take the completion interrupt.  tx_thread_sleep() moves the clock on
+// to the tick boundary the thread would wake up at, one tick is 1ms like on the M4.
+//
+// One sensor is simulated, it answers at 0x41 once it is out of reset.  The bootloader checks the checksum of
+// every command frame, reports BUSY for SIM_BL_COMMAND_US plus SIM_BL_BYTE_US per data byte after each command
+// and READY after that, it writes the W_RAM records to a RAM image that can be compared against tof_bin_image.
+// RAMREMAP_RESET starts the measurement app SIM_APP_BOOT_US later.  The device NACKs while it resets or
+// boots.
+//
+// SIM_I2C_SETUP_US, SIM_BL_COMMAND_US, SIM_BL_BYTE_US and the boot times are assumptions, not measurements:
+// the datasheet doesn't give the bootloader command times.  The bus time, which dominates a download, follows
+// from the frame sizes and the bus speed.
+//
+// Include it in exactly one source file per executable, it defines the I2C, GPIO, delay and ThreadX functions.
+
+#include <stdbool.h>
+#include <string.h>
+#include "lightranger5.h"
+#include "tx_api.h"
+
+// tof_bin_image.h defines the image, lightranger5.c includes it
+extern const unsigned long tof_bin_image_length;
+extern const unsigned char tof_bin_image[];
+
+#define SIM_I2C_SETUP_US        30.0    // Per transfer driver and interrupt overhead on the M4
+#define SIM_BL_COMMAND_US       50.0    // Bootloader command handling
+#define SIM_BL_BYTE_US          0.2     // and per data byte
+#define SIM_BOOT_US             2000.0  // EN high or reset to the bootloader answering
+#define SIM_PON_US              500.0   // PON to the oscillator running
+#define SIM_APP_BOOT_US         25000.0 // RAMREMAP_RESET to the measurement app answering
+
+#define SIM_RAM_SIZE            0x3000
+#define SIM_APPID_MEASUREMENT   0x03
+
+typedef enum
+{
+    BL_SIM_OFF = 0,
+    BL_SIM_BOOTING,                 // Out of reset, NACKs until readyAt
+    BL_SIM_BOOTLOADER,
+    BL_SIM_APP_BOOTING,             // After RAMREMAP_RESET, NACKs until readyAt
+    BL_SIM_APP
+} BootloaderSimPhase;
+
+typedef struct
+{
+    double now;                     // us
+    BootloaderSimPhase phase;
+    double readyAt;                 // End of BOOTING or APP_BOOTING
+    double ponAt;                   // Oscillator running, 0 if PON isn't set
+    double busyUntil;               // Bootloader reports BUSY until then
+    uint8_t status[3];              // Bootloader status, size, checksum
+    uint16_t ramAddress;
+    uint8_t ram[SIM_RAM_SIZE];
+    uint32_t ramBytes;              // Written by W_RAM
+    uint32_t records;
+    uint32_t badFrames;             // Rejected checksums or unknown commands
+    uint32_t transfers;
+    uint32_t busBytes;
+} BootloaderSim;
+
+static BootloaderSim bl_sim;
+
+// Powered down, the clock keeps running
+static inline void bl_sim_off(void)
+{
+    double now = bl_sim.now;
+
+    memset(&bl_sim, 0, sizeof(bl_sim));
+    bl_sim.now = now;
+}
+
+// Out of reset, the bootloader starts
+static inline void bl_sim_boot(void)
+{
+    bl_sim_off();
+    bl_sim.phase = BL_SIM_BOOTING;
+    bl_sim.readyAt = bl_sim.now + SIM_BOOT_US;
+    bl_sim.status[2] = 0xFF;                    // READY, the same as bl_sim_status(LIGHTRANGER5_BL_STATUS_READY)
+}
+
+static inline double bl_sim_bus_hz(uint32_t speed)
+{
+    switch (speed) {
+    case I2C_MASTER_SPEED_FULL:
+        return 400e3;
+    case I2C_MASTER_SPEED_FAST:
+        return 1e6;
+    default:
+        return 100e3;
+    }
+}
+
+// Wire time of one transfer: bytes include the address byte(s), a write_then_read has a repeated start
+static inline void bl_sim_transfer(i2c_master_t* obj, uint32_t bytes, uint32_t conditions)
+{
+    bl_sim.now += (bytes * 9.0 + conditions) * 1e6 / bl_sim_bus_hz(obj->config.speed) + SIM_I2C_SETUP_US;
+    bl_sim.transfers++;
+    bl_sim.busBytes += bytes;
+}
+
+// The device answers at 0x41 unless it's off, resetting or booting
+static inline bool bl_sim_acks(i2c_master_t* obj)
+{
+    if (((bl_sim.phase == BL_SIM_BOOTING) || (bl_sim.phase == BL_SIM_APP_BOOTING)) && (bl_sim.now >= bl_sim.readyAt)) {
+        bl_sim.phase = (bl_sim.phase == BL_SIM_BOOTING) ? BL_SIM_BOOTLOADER : BL_SIM_APP;
+    }
+    return (obj->config.addr == LIGHTRANGER5_SET_DEV_ADDR) &&
+           ((bl_sim.phase == BL_SIM_BOOTLOADER) || (bl_sim.phase == BL_SIM_APP));
+}
+
+static inline uint8_t bl_sim_checksum(const uint8_t* data, uint32_t len)
+{
+    uint8_t sum = 0;
+
+    while (len--) {
+        sum += *data++;
+    }
+    return sum ^ 0xFF;
+}
+
+static inline void bl_sim_status(uint8_t status)
+{
+    bl_sim.status[0] = status;
+    bl_sim.status[1] = 0;
+    bl_sim.status[2] = bl_sim_checksum(bl_sim.status, 2);
+}
+
+// A bootloader command frame written to CMD_DATA7: cmd, size, data[size], checksum
+static inline void bl_sim_command(const uint8_t* frame, uint32_t len)
+{
+    uint8_t cmd = frame[0];
+    uint8_t size = frame[1];
+
+    if ((len < 3) || (len != size + 3u) || (frame[size + 2] != bl_sim_checksum(frame, size + 2))) {
+        bl_sim.badFrames++;
+        bl_sim_status(0x01);
+        return;
+    }
+
+    switch (cmd) {
+    case LIGHTRANGER5_BL_CMD_DOWNLOAD_INIT:
+        break;
+    case LIGHTRANGER5_BL_CMD_ADDR_RAM:
+        bl_sim.ramAddress = frame[2] | (frame[3] << 8);
+        break;
+    case LIGHTRANGER5_BL_CMD_W_RAM:
+        if (bl_sim.ramAddress + size <= SIM_RAM_SIZE) {
+            memcpy(&bl_sim.ram[bl_sim.ramAddress], &frame[2], size);
+        }
+        bl_sim.ramAddress += size;
+        bl_sim.ramBytes += size;
+        bl_sim.records++;
+        break;
+    case LIGHTRANGER5_BL_CMD_RAMREMAP_RESET:
+        bl_sim.phase = BL_SIM_APP_BOOTING;
+        bl_sim.readyAt = bl_sim.now + SIM_APP_BOOT_US;
+        return;
+    default:
+        bl_sim.badFrames++;
+        bl_sim_status(0x01);
+        return;
+    }
+
+    bl_sim_status(LIGHTRANGER5_BL_STATUS_BUSY);
+    bl_sim.busyUntil = bl_sim.now + SIM_BL_COMMAND_US + size * SIM_BL_BYTE_US;
+}
+
+// True once the image in the simulated RAM matches tof_bin_image
+static inline bool bl_sim_image_loaded(void)
+{
+    return (bl_sim.ramBytes == tof_bin_image_length) && (memcmp(bl_sim.ram, tof_bin_image, tof_bin_image_length) == 0);
+}
+
+void i2c_master_configure_default(i2c_master_config_t* config)
+{
+    memset(config, 0, sizeof(*config));
+}
+
+err_t i2c_master_open(i2c_master_t* obj, i2c_master_config_t* config)
+{
+    obj->config.addr = config->addr;
+    return I2C_MASTER_SUCCESS;
+}
+
+err_t i2c_master_set_speed(i2c_master_t* obj, uint32_t speed)
+{
+    obj->config.speed = speed;
+    return I2C_MASTER_SUCCESS;
+}
+
+err_t i2c_master_set_slave_address(i2c_master_t* obj, uint8_t address)
+{
+    obj->config.addr = address;
+    return I2C_MASTER_SUCCESS;
+}
+
+err_t i2c_master_write(i2c_master_t* obj, uint8_t* write_data_buf, size_t len_write_data)
+{
+    if (!bl_sim_acks(obj)) {
+        bl_sim_transfer(obj, 1, 2);
+        return I2C_MASTER_ERROR;
+    }
+    bl_sim_transfer(obj, 1 + len_write_data, 2);
+
+    if (write_data_buf[0] == LIGHTRANGER5_REG_ENABLE) {
+        if (write_data_buf[1] & LIGHTRANGER5_ENABLE_RESET) {
+            bl_sim_boot();
+        }
+        else if ((write_data_buf[1] & LIGHTRANGER5_BIT_PON) && (bl_sim.ponAt == 0)) {
+            bl_sim.ponAt = bl_sim.now + SIM_PON_US;
+        }
+    }
+    else if ((write_data_buf[0] == LIGHTRANGER5_REG_CMD_DATA7) && (bl_sim.phase == BL_SIM_BOOTLOADER)) {
+        bl_sim_command(&write_data_buf[1], len_write_data - 1);
+    }
+    return I2C_MASTER_SUCCESS;
+}
+
+err_t i2c_master_write_then_read(i2c_master_t* obj, uint8_t* write_data_buf, size_t len_write_data,
+                                 uint8_t* read_data_buf, size_t len_read_data)
+{
+    if (!bl_sim_acks(obj)) {
+        bl_sim_transfer(obj, 1, 2);
+        return I2C_MASTER_ERROR;
+    }
+    bl_sim_transfer(obj, 2 + len_write_data + len_read_data, 3);
+
+    if ((bl_sim.status[0] == LIGHTRANGER5_BL_STATUS_BUSY) && (bl_sim.now >= bl_sim.busyUntil)) {
+        bl_sim_status(LIGHTRANGER5_BL_STATUS_READY);
+    }
+
+    memset(read_data_buf, 0, len_read_data);
+    switch (write_data_buf[0]) {
+    case LIGHTRANGER5_REG_APPID:
+        read_data_buf[0] = (bl_sim.phase == BL_SIM_APP) ? SIM_APPID_MEASUREMENT : LIGHTRANGER5_APPID_BOOTLOADER;
+        break;
+    case LIGHTRANGER5_REG_CMD_DATA7:
+        memcpy(read_data_buf, bl_sim.status, (len_read_data < 3) ? len_read_data : 3);
+        break;
+    case LIGHTRANGER5_REG_ENABLE:
+        read_data_buf[0] = LIGHTRANGER5_BIT_CPU_RDY;
+        if ((bl_sim.phase == BL_SIM_APP) || ((bl_sim.ponAt > 0) && (bl_sim.now >= bl_sim.ponAt))) {
+            read_data_buf[0] |= LIGHTRANGER5_BIT_PON;
+        }
+        break;
+    case LIGHTRANGER5_REG_DEVICE_ID:
+        read_data_buf[0] = LIGHTRANGER5_EXPECTED_ID;
+        break;
+    }
+    return I2C_MASTER_SUCCESS;
+}
+
+ULONG tx_time_get(void)
+{
+    return (ULONG)(bl_sim.now / 1000.0);
+}
+
+UINT tx_thread_sleep(ULONG ticks)
+{
+    bl_sim.now = (tx_time_get() + ticks) * 1000.0;
+    return 0;
+}
+
+void Delay_ms(uint32_t time_ms)
+{
+    tx_thread_sleep(time_ms);
+}
+
+void Delay_10ms(void)
+{
+    tx_thread_sleep(10);
+}
+
+int mtk_os_hal_gpio_set_output(os_hal_gpio_pin pin, os_hal_gpio_data out_val)
+{
+    if (out_val == OS_HAL_GPIO_DATA_LOW) {
+        bl_sim_off();
+    }
+    else if (bl_sim.phase == BL_SIM_OFF) {
+        bl_sim_boot();
+    }
+    return 0;
+}
+
+err_t digital_out_init(digital_out_t* out, pin_name_t name)
+{
+    out->pin = name;
+    return 0;
+}
+
+void digital_out_high(digital_out_t* out)
+{
+    mtk_os_hal_gpio_set_output(out->pin, OS_HAL_GPIO_DATA_HIGH);
+}
+
+void digital_out_low(digital_out_t* out)
+{
+    mtk_os_hal_gpio_set_output(out->pin, OS_HAL_GPIO_DATA_LOW);
+}
+
+void digital_out_write(digital_out_t* out, uint8_t value)
+{
+    mtk_os_hal_gpio_set_output(out->pin, value ? OS_HAL_GPIO_DATA_HIGH : OS_HAL_GPIO_DATA_LOW);
+}
+
+err_t digital_in_init(digital_in_t* in, pin_name_t name)
+{
+    in->pin = name;
+    return 0;
+}
+
+uint8_t digital_in_read(digital_in_t* in)
+{
+    return 0;
+}
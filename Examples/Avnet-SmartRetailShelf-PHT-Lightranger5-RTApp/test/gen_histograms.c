@@ -0,0 +1,76 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Writes the synthesized dumps in test/histograms from the model in histogram_dump.h.  They stand in for
+// recordings until dumps of real shelves are added next to them:
+//
+//   ./out/gen_histograms histograms
+
+#include "histogram_dump.h"
+
+typedef struct
+{
+    const char* name;
+    const char* description;
+    double ambient;
+    double xtalk;
+    HistogramModelTarget targets[3];
+    int count;
+    const char* expect;
+    const char* xtalkReference;
+} Scenario;
+
+static const Scenario scenarios[] = {
+    {"xtalk_reference", "cover glass crosstalk, nothing in front of the sensor", 40.0, 600.0, {{0}}, 0, NULL, NULL},
+    {"single_600mm", "one target at 600mm", 40.0, 600.0, {{600.0, 900.0}}, 1, "600", "xtalk_reference.csv"},
+    {"front_and_back_wall", "product at 412mm, part of the back wall at 1180mm behind it", 40.0, 600.0,
+     {{412.0, 700.0}, {1180.0, 260.0}}, 2, "412 1180", "xtalk_reference.csv"},
+    {"empty_shelf", "only the back wall at 1200mm", 40.0, 600.0, {{1200.0, 500.0}}, 1, "1200", "xtalk_reference.csv"},
+    {"three_rows", "products at 300mm and 520mm, back wall at 1000mm", 40.0, 600.0,
+     {{300.0, 500.0}, {520.0, 350.0}, {1000.0, 200.0}}, 3, "300 520 1000", "xtalk_reference.csv"},
+    {"close_targets", "two targets 100mm apart at 700mm and 800mm", 40.0, 600.0,
+     {{700.0, 500.0}, {800.0, 400.0}}, 2, "700 800", "xtalk_reference.csv"},
+    {"bright_ambient", "target at 800mm under bright ambient light", 400.0, 600.0, {{800.0, 600.0}}, 1, "800",
+     "xtalk_reference.csv"},
+    {"weak_far_target", "weak target at 1800mm", 40.0, 600.0, {{1800.0, 90.0}}, 1, "1800", "xtalk_reference.csv"},
+    {"nothing_in_range", "nothing within the range, ambient light only", 150.0, 600.0, {{0}}, 0, "",
+     "xtalk_reference.csv"},
+    {"near_target_in_xtalk", "target at 100mm on the tail of the crosstalk", 40.0, 600.0, {{100.0, 400.0}}, 1, "100",
+     "xtalk_reference.csv"},
+    {"no_xtalk_reference", "target at 900mm, no crosstalk reference, the cover glass shows up at 50mm", 40.0, 600.0,
+     {{900.0, 600.0}}, 1, "50 900", NULL},
+};
+
+int main(int argc, char* argv[])
+{
+    const char* dir = (argc > 1) ? argv[1] : ".";
+    static uint16_t bins[RANGER_HISTOGRAM_TDC_COUNT][RANGER_HISTOGRAM_BINS];
+
+    for (unsigned i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+
+        const Scenario* s = &scenarios[i];
+        char path[512];
+
+        snprintf(path, sizeof(path), "%s/%s.csv", dir, s->name);
+        FILE* file = fopen(path, "w");
+        if (file == NULL) {
+            perror(path);
+            return 1;
+        }
+
+        histogram_model(bins, s->ambient, s->xtalk, s->targets, s->count, 1000 + i);
+
+        fprintf(file, "# LightRanger5 histogram dump, synthesized by gen_histograms: %s\n", s->description);
+        fprintf(file, "# ambient %.0f, crosstalk %.0f counts per TDC\n", s->ambient, s->xtalk);
+        if (s->expect != NULL) {
+            fprintf(file, "# expect %s\n", s->expect);
+        }
+        if (s->xtalkReference != NULL) {
+            fprintf(file, "# xtalk %s\n", s->xtalkReference);
+        }
+        histogram_dump_save(file, bins);
+        fclose(file);
+    }
+
+    return 0;
+}
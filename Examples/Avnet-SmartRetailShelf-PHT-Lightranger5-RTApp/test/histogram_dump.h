@@ -0,0 +1,172 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// TMF8801 histogram dumps for the ranger_histogram.c host tests.  A dump file holds one histogram dump, one TDC
+// of 128 comma separated bin counts per line, the format the application prints on the debug port with
+// RANGER_HISTOGRAM_PRINT_DUMPS defined in buildOptions.h.  Lines that start with '#' are comments, except for
+// the directives that say what the test expects:
+//
+//   # expect 412 1180      distances in mm of the targets that have to be found, nearest first, none if empty
+//   # tolerance 10         allowed distance error in mm, default HISTOGRAM_DUMP_TOLERANCE_MM
+//   # xtalk reference.csv  crosstalk reference dump taken with nothing in front of the sensor, relative to the
+//                          dump file
+//
+// histogram_model() synthesizes dumps from a simple model of the sensor: a constant ambient level, the cover
+// glass crosstalk in the first bins, a Gaussian pulse per target and photon (Poisson) noise, with slightly
+// different gains per TDC.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranger_histogram.h"
+
+#define HISTOGRAM_DUMP_TOLERANCE_MM     10
+#define HISTOGRAM_DUMP_MAX_EXPECTED     RANGER_HISTOGRAM_MAX_TARGETS
+
+#define HISTOGRAM_MODEL_BIN_MM          (RANGER_HISTOGRAM_BIN_WIDTH_UM_DEFAULT / 1000.0)
+#define HISTOGRAM_MODEL_PULSE_BINS      1.2     // Pulse sigma
+#define HISTOGRAM_MODEL_XTALK_BIN       2.5     // Cover glass reflection
+#define HISTOGRAM_MODEL_XTALK_BINS      0.8
+
+typedef struct
+{
+    uint16_t bins[RANGER_HISTOGRAM_TDC_COUNT][RANGER_HISTOGRAM_BINS];
+    int expected[HISTOGRAM_DUMP_MAX_EXPECTED];
+    int expectedCount;
+    bool hasExpected;
+    int toleranceMm;
+    char xtalk[256];                // Path of the crosstalk reference, empty if none
+} HistogramDump;
+
+typedef struct
+{
+    double distanceMm;
+    double amplitude;               // Peak counts per TDC
+} HistogramModelTarget;
+
+// Loads a dump file, returns false if it doesn't hold 5 TDCs of 128 bins
+static inline bool histogram_dump_load(const char* path, HistogramDump* dump)
+{
+    FILE* file = fopen(path, "r");
+    char line[2048];
+    int tdc = 0;
+
+    memset(dump, 0, sizeof(*dump));
+    dump->toleranceMm = HISTOGRAM_DUMP_TOLERANCE_MM;
+
+    if (file == NULL) {
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+
+        char name[200];
+
+        if (line[0] == '#') {
+
+            if (!strncmp(line, "# expect", 8)) {
+                char* p = line + 8;
+                char* end;
+                dump->hasExpected = true;
+                for (long d = strtol(p, &end, 10); (end != p) && (dump->expectedCount < HISTOGRAM_DUMP_MAX_EXPECTED);
+                     d = strtol(p, &end, 10)) {
+                    dump->expected[dump->expectedCount++] = (int)d;
+                    p = end;
+                }
+            }
+            else if (sscanf(line, "# tolerance %d", &dump->toleranceMm) == 1) {
+            }
+            else if (sscanf(line, "# xtalk %199s", name) == 1) {
+
+                // Relative to the directory of the dump file
+                const char* slash = strrchr(path, '/');
+                int dirLength = slash ? (int)(slash - path + 1) : 0;
+                snprintf(dump->xtalk, sizeof(dump->xtalk), "%.*s%s", dirLength, path, name);
+            }
+            continue;
+        }
+
+        if (tdc == RANGER_HISTOGRAM_TDC_COUNT) {
+            continue;
+        }
+
+        char* p = line;
+        int bin = 0;
+        while (bin < RANGER_HISTOGRAM_BINS) {
+            char* end;
+            long count = strtol(p, &end, 10);
+            if (end == p) {
+                break;
+            }
+            dump->bins[tdc][bin++] = (uint16_t)count;
+            p = (*end == ',') ? end + 1 : end;
+        }
+
+        if (bin == RANGER_HISTOGRAM_BINS) {
+            tdc++;
+        }
+        else if (bin != 0) {
+            break;
+        }
+    }
+
+    fclose(file);
+    return tdc == RANGER_HISTOGRAM_TDC_COUNT;
+}
+
+static inline void histogram_dump_save(FILE* file, const uint16_t (*bins)[RANGER_HISTOGRAM_BINS])
+{
+    for (int tdc = 0; tdc < RANGER_HISTOGRAM_TDC_COUNT; tdc++) {
+        for (int bin = 0; bin < RANGER_HISTOGRAM_BINS; bin++) {
+            fprintf(file, "%u%s", bins[tdc][bin], (bin < RANGER_HISTOGRAM_BINS - 1) ? "," : "\n");
+        }
+    }
+}
+
+// Reproducible on every host C library
+static uint32_t histogram_model_state;
+
+static inline double histogram_model_uniform(void)
+{
+    histogram_model_state = histogram_model_state * 1664525u + 1013904223u;
+    return ((histogram_model_state >> 8) + 0.5) / 16777216.0;
+}
+
+// Photon counts, Poisson approximated by a normal distribution with the same variance
+static inline uint16_t histogram_model_counts(double mean)
+{
+    double u1 = histogram_model_uniform();
+    double u2 = histogram_model_uniform();
+    double counts = mean + sqrt(mean) * sqrt(-2.0 * log(u1)) * cos(2.0 * 3.14159265358979323846 * u2);
+
+    counts = floor(counts + 0.5);
+    return (uint16_t)((counts < 0.0) ? 0.0 : ((counts > 65535.0) ? 65535.0 : counts));
+}
+
+// Synthesizes a dump, ambient and xtalk (the crosstalk peak) are counts per TDC
+static inline void histogram_model(uint16_t (*bins)[RANGER_HISTOGRAM_BINS], double ambient, double xtalk,
+                                   const HistogramModelTarget* targets, int count, uint32_t seed)
+{
+    histogram_model_state = seed;
+
+    for (int tdc = 0; tdc < RANGER_HISTOGRAM_TDC_COUNT; tdc++) {
+
+        double gain = 1.0 + 0.03 * (tdc - 2);
+
+        for (int bin = 0; bin < RANGER_HISTOGRAM_BINS; bin++) {
+
+            double x = bin - HISTOGRAM_MODEL_XTALK_BIN;
+            double mean = ambient + xtalk * exp(-x * x / (2.0 * HISTOGRAM_MODEL_XTALK_BINS * HISTOGRAM_MODEL_XTALK_BINS));
+
+            for (int i = 0; i < count; i++) {
+                x = bin - targets[i].distanceMm / HISTOGRAM_MODEL_BIN_MM;
+                mean += targets[i].amplitude * exp(-x * x / (2.0 * HISTOGRAM_MODEL_PULSE_BINS * HISTOGRAM_MODEL_PULSE_BINS));
+            }
+
+            bins[tdc][bin] = histogram_model_counts(gain * mean);
+        }
+    }
+}
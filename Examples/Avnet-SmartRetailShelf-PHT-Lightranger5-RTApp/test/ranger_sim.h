@@ -0,0 +1,307 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Simulated TMF8801 sensors and clock for the bring up scheduler tests.  The sensors are simulated at the level
+// of the LightRanger5 driver functions ranger_bringup.c calls, the bootloader protocol itself isn't: a download
+// takes SIM_DOWNLOAD_MS of bus time, the image then starts, a requested address change takes effect and the
+// factory calibration completes after the times below.  A sensor NACKs (the driver call fails) while it is in
+// reset, booting, starting the image or changing address.
+//
+// Sensor n is wired to EN pin n.  Every sensor comes out of reset at 0x41, a transfer to an address that more
+// than one sensor on the same ISU answers at is counted as a bus conflict and fails.  The clock only moves
+// when the scheduler sleeps or a download runs, one tick is 1ms like on the M4.
+//
+// Include it in exactly one source file per executable, it defines the driver, OS_HAL and ThreadX functions.
+
+#include <stdbool.h>
+#include <string.h>
+#include "ranger_bringup.h"
+
+#define SIM_MAX_SENSORS         4
+
+#define SIM_BOOT_MS             2       // EN high to the bootloader answering
+#define SIM_DOWNLOAD_MS         290     // The image at 400KHz with the status polls, bench_ranger_download: 272ms
+#define SIM_DOWNLOAD_RECORDS    85      // The 10844 byte image in 128 byte W_RAM records
+#define SIM_APP_BOOT_MS         25      // RAMREMAP_RESET to CPU_RDY
+#define SIM_ADDRESS_MS          3       // Address change request to answering at the new address
+#define SIM_CALIBRATION_MS      1100    // Factory calibration
+
+#define SIM_APPID_BOOTLOADER    0x80
+
+typedef enum
+{
+    SIM_OFF = 0,
+    SIM_BOOTLOADER,
+    SIM_APP_BOOT,
+    SIM_ADDRESS,
+    SIM_RUNNING,
+    SIM_CALIBRATING
+} SimulatedPhase;
+
+typedef struct
+{
+    bool present;                   // Fitted, a missing sensor never answers
+    pin_name_t isu;                 // SDA pin, sensors with the same SDA share a bus
+    SimulatedPhase phase;
+    ULONG readyAt;                  // Tick the running phase completes
+    uint8_t address;
+    uint8_t appid;                  // App the image runs once started
+    uint8_t version[LIGHTRANGER5_APP_VERSION_SIZE];
+    ULONG downloadStart;            // Ticks of the last download and calibration
+    ULONG calibrationDone;
+    uint32_t downloads;
+    uint32_t calibrations;
+} SimulatedTmf8801;
+
+typedef struct
+{
+    ULONG now;
+    SimulatedTmf8801 sensors[SIM_MAX_SENSORS];
+    uint32_t conflicts;             // Transfers more than one sensor answered
+    uint32_t transfers;
+} RangerSim;
+
+static RangerSim sim;
+
+static const uint8_t sim_version[LIGHTRANGER5_APP_VERSION_SIZE] = {1, 7, 23};
+
+// Sensors start powered with the image not loaded, like after a power cycle with EN pulled up
+static inline void sim_reset(int count)
+{
+    memset(&sim, 0, sizeof(sim));
+    sim.now = 1000;
+
+    for (int i = 0; i < count; i++) {
+        sim.sensors[i].present = true;
+        sim.sensors[i].isu = 2;
+        sim.sensors[i].phase = SIM_BOOTLOADER;
+        sim.sensors[i].address = LIGHTRANGER5_SET_DEV_ADDR;
+        sim.sensors[i].appid = LIGHTRANGER5_APPID_MEASUREMENT;
+        memcpy(sim.sensors[i].version, sim_version, sizeof(sim_version));
+    }
+}
+
+// Sets up a bring up entry for sensor index, address is where it ends up
+static inline void sim_ranger(ranger_bringup_t* r, lightranger5_t* ctx, int index, uint8_t address)
+{
+    memset(r, 0, sizeof(*r));
+    memset(ctx, 0, sizeof(*ctx));
+    r->ctx = ctx;
+    r->cfg.en = index;
+    r->cfg.sda = sim.sensors[index].isu;
+    r->cfg.i2c_address = address;
+    r->start = LIGHTRANGER5_START_COLD;
+}
+
+static inline void sim_update(SimulatedTmf8801* s)
+{
+    if (((s->phase == SIM_APP_BOOT) || (s->phase == SIM_ADDRESS)) && ((LONG)(sim.now - s->readyAt) >= 0)) {
+        s->phase = SIM_RUNNING;
+    }
+    if ((s->phase == SIM_CALIBRATING) && ((LONG)(sim.now - s->readyAt) >= 0)) {
+        s->phase = SIM_RUNNING;
+        s->calibrationDone = s->readyAt;
+    }
+}
+
+// The sensor that answers at the context's address, NULL if none or more than one does
+static inline SimulatedTmf8801* sim_sensor(lightranger5_t* ctx)
+{
+    SimulatedTmf8801* found = NULL;
+    int answering = 0;
+
+    sim.transfers++;
+    for (int i = 0; i < SIM_MAX_SENSORS; i++) {
+
+        SimulatedTmf8801* s = &sim.sensors[i];
+
+        sim_update(s);
+        if (s->present && (s->phase != SIM_OFF) && (s->isu == ctx->i2c.config.sda) &&
+            (s->address == ctx->slave_address)) {
+            found = s;
+            answering++;
+        }
+    }
+
+    if (answering > 1) {
+        sim.conflicts++;
+        return NULL;
+    }
+
+    // NACK while the bootloader or the image starts up
+    if ((found != NULL) && (found->phase == SIM_BOOTLOADER) && ((LONG)(sim.now - found->readyAt) < 0)) {
+        return NULL;
+    }
+    if ((found != NULL) && ((found->phase == SIM_APP_BOOT) || (found->phase == SIM_ADDRESS))) {
+        return NULL;
+    }
+    return found;
+}
+
+ULONG tx_time_get(void)
+{
+    return sim.now;
+}
+
+UINT tx_thread_sleep(ULONG ticks)
+{
+    sim.now += ticks;
+    return 0;
+}
+
+int mtk_os_hal_gpio_set_output(os_hal_gpio_pin pin, os_hal_gpio_data out_val)
+{
+    SimulatedTmf8801* s = &sim.sensors[pin];
+
+    if (out_val == OS_HAL_GPIO_DATA_LOW) {
+        s->phase = SIM_OFF;
+    }
+    else if (s->phase == SIM_OFF) {
+        s->phase = SIM_BOOTLOADER;
+        s->readyAt = sim.now + SIM_BOOT_MS;
+        s->address = LIGHTRANGER5_SET_DEV_ADDR;
+    }
+    return 0;
+}
+
+err_t lightranger5_init(lightranger5_t* ctx, lightranger5_cfg_t* cfg, bool includeResets)
+{
+    ctx->en.pin = cfg->en;
+    ctx->i2c.config.sda = cfg->sda;
+    ctx->i2c.config.scl = cfg->scl;
+    ctx->slave_address = cfg->i2c_address;
+    return I2C_MASTER_SUCCESS;
+}
+
+err_t lightranger5_set_pin_state_io0(lightranger5_t* ctx, uint8_t io0_state)
+{
+    return LIGHTRANGER5_OK;
+}
+
+err_t lightranger5_generic_read(lightranger5_t* ctx, uint8_t reg, uint8_t* rx_buf, uint8_t rx_len)
+{
+    SimulatedTmf8801* s = sim_sensor(ctx);
+
+    if (s == NULL) {
+        return I2C_MASTER_ERROR;
+    }
+
+    memset(rx_buf, 0, rx_len);
+    if (reg == LIGHTRANGER5_REG_DEVICE_ID) {
+        rx_buf[0] = LIGHTRANGER5_EXPECTED_ID;
+    }
+    else if ((reg == LIGHTRANGER5_REG_ENABLE) && (s->phase != SIM_BOOTLOADER)) {
+        rx_buf[0] = LIGHTRANGER5_BIT_CPU_RDY | LIGHTRANGER5_BIT_PON;
+    }
+    return I2C_MASTER_SUCCESS;
+}
+
+err_t lightranger5_generic_write(lightranger5_t* ctx, uint8_t reg, uint8_t* tx_buf, uint8_t tx_len)
+{
+    SimulatedTmf8801* s = sim_sensor(ctx);
+
+    if (s == NULL) {
+        return I2C_MASTER_ERROR;
+    }
+
+    if ((reg == LIGHTRANGER5_REG_APPREQID) && (s->phase == SIM_RUNNING)) {
+        s->appid = tx_buf[0];
+    }
+    return I2C_MASTER_SUCCESS;
+}
+
+err_t lightranger5_bootloader_start(lightranger5_t* ctx, lightranger5_download_stats_t* stats)
+{
+    SimulatedTmf8801* s = sim_sensor(ctx);
+
+    return ((s != NULL) && (s->phase == SIM_BOOTLOADER)) ? LIGHTRANGER5_OK : LIGHTRANGER5_ERROR;
+}
+
+err_t lightranger5_download_and_start(lightranger5_t* ctx, uint32_t download_speed,
+                                      lightranger5_download_stats_t* stats)
+{
+    SimulatedTmf8801* s = sim_sensor(ctx);
+
+    if ((s == NULL) || (s->phase != SIM_BOOTLOADER)) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    s->downloadStart = sim.now;
+    s->downloads++;
+    sim.now += SIM_DOWNLOAD_MS;
+    stats->records = SIM_DOWNLOAD_RECORDS;
+    stats->download_ms = SIM_DOWNLOAD_MS;
+
+    s->phase = SIM_APP_BOOT;
+    s->readyAt = sim.now + SIM_APP_BOOT_MS;
+    s->appid = LIGHTRANGER5_APPID_MEASUREMENT;
+    return LIGHTRANGER5_OK;
+}
+
+err_t lightranger5_request_i2c_address(lightranger5_t* ctx, uint8_t new_i2c_address)
+{
+    SimulatedTmf8801* s = sim_sensor(ctx);
+
+    if ((s == NULL) || (s->phase != SIM_RUNNING)) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    s->phase = SIM_ADDRESS;
+    s->readyAt = sim.now + SIM_ADDRESS_MS;
+    s->address = new_i2c_address;
+    ctx->slave_address = new_i2c_address;
+    return LIGHTRANGER5_OK;
+}
+
+err_t lightranger5_get_app_version(lightranger5_t* ctx, uint8_t* appid, uint8_t* version)
+{
+    SimulatedTmf8801* s = sim_sensor(ctx);
+
+    if ((s == NULL) || (s->phase == SIM_BOOTLOADER)) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    *appid = s->appid;
+    memcpy(version, s->version, LIGHTRANGER5_APP_VERSION_SIZE);
+    return LIGHTRANGER5_OK;
+}
+
+err_t lightranger5_start_calib_cmd(lightranger5_t* ctx)
+{
+    SimulatedTmf8801* s = sim_sensor(ctx);
+
+    if ((s == NULL) || (s->phase != SIM_RUNNING) || (s->appid != LIGHTRANGER5_APPID_MEASUREMENT)) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    s->phase = SIM_CALIBRATING;
+    s->readyAt = sim.now + SIM_CALIBRATION_MS;
+    s->calibrations++;
+    return LIGHTRANGER5_OK;
+}
+
+err_t lightranger5_get_status(lightranger5_t* ctx, uint8_t* status)
+{
+    SimulatedTmf8801* s = sim_sensor(ctx);
+
+    if (s == NULL) {
+        return I2C_MASTER_ERROR;
+    }
+
+    *status = (s->phase == SIM_CALIBRATING) ? 0x01 : 0x00;
+    return I2C_MASTER_SUCCESS;
+}
+
+err_t lightranger5_get_factory_calib_data(lightranger5_t* ctx, uint8_t* factory_calib_data)
+{
+    SimulatedTmf8801* s = sim_sensor(ctx);
+
+    if ((s == NULL) || (s->calibrationDone == 0)) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    memset(factory_calib_data, 0xA5, LIGHTRANGER5_FACTORY_CALIB_SIZE);
+    return LIGHTRANGER5_OK;
+}
@@ -0,0 +1,16 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Just enough of the mikroSDK digital input driver for the host tests to build the LightRanger5 driver
+
+#include "drv_i2c_master.h"
+
+typedef struct
+{
+    pin_name_t pin;
+} digital_in_t;
+
+err_t digital_in_init(digital_in_t* in, pin_name_t name);
+uint8_t digital_in_read(digital_in_t* in);
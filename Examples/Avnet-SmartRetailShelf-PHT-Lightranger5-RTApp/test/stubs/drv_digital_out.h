@@ -0,0 +1,19 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Just enough of the mikroSDK digital output driver for the host tests to build the LightRanger5 driver
+
+#include "drv_i2c_master.h"
+#include "os_hal_gpio.h"
+
+typedef struct
+{
+    pin_name_t pin;
+} digital_out_t;
+
+err_t digital_out_init(digital_out_t* out, pin_name_t name);
+void digital_out_high(digital_out_t* out);
+void digital_out_low(digital_out_t* out);
+void digital_out_write(digital_out_t* out, uint8_t value);
@@ -0,0 +1,58 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Just enough of the mikroSDK I2C master driver for the host tests to build the LightRanger5 driver.  The
+// tests don't link the mikroSDK driver: the bring up tests simulate the LightRanger5 functions, the download
+// benchmark builds the LightRanger5 driver itself and simulates the I2C functions below.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "os_hal_i2c.h"
+
+typedef int32_t err_t;
+typedef int32_t pin_name_t;
+
+#define HAL_PIN_NC ((pin_name_t)-1)
+
+typedef enum
+{
+    I2C_MASTER_SUCCESS = 0,
+    I2C_MASTER_ERROR = -1
+} i2c_master_err_t;
+
+typedef enum
+{
+    I2C_MASTER_SPEED_STANDARD = 0,
+    I2C_MASTER_SPEED_FULL,
+    I2C_MASTER_SPEED_FAST
+} i2c_master_speed_t;
+
+typedef struct
+{
+    uint8_t addr;
+    pin_name_t sda;
+    pin_name_t scl;
+    uint32_t speed;
+    uint16_t timeout_pass_count;
+} i2c_master_config_t;
+
+typedef struct
+{
+    void* handle;
+    i2c_master_config_t config;
+} i2c_master_t;
+
+void i2c_master_configure_default(i2c_master_config_t* config);
+err_t i2c_master_open(i2c_master_t* obj, i2c_master_config_t* config);
+err_t i2c_master_set_speed(i2c_master_t* obj, uint32_t speed);
+err_t i2c_master_set_slave_address(i2c_master_t* obj, uint8_t address);
+err_t i2c_master_write(i2c_master_t* obj, uint8_t* write_data_buf, size_t len_write_data);
+err_t i2c_master_write_then_read(i2c_master_t* obj, uint8_t* write_data_buf, size_t len_write_data,
+                                 uint8_t* read_data_buf, size_t len_read_data);
+
+// mikroSDK delays, the drivers get them through the same headers
+void Delay_ms(uint32_t time_ms);
+void Delay_10ms(void);
@@ -0,0 +1,17 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Just enough of the OS_HAL GPIO API for the host tests, mtk_os_hal_gpio_set_output() is provided by the
+// test, the LightRanger5 simulation uses it for the EN pins
+
+typedef int os_hal_gpio_pin;
+
+typedef enum
+{
+    OS_HAL_GPIO_DATA_LOW = 0,
+    OS_HAL_GPIO_DATA_HIGH = 1
+} os_hal_gpio_data;
+
+int mtk_os_hal_gpio_set_output(os_hal_gpio_pin pin, os_hal_gpio_data out_val);
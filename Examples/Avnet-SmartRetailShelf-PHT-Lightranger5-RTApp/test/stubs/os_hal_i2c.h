@@ -0,0 +1,16 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Just enough of the OS_HAL I2C API for the host tests to build the LightRanger5 headers
+
+typedef enum
+{
+    OS_HAL_I2C_ISU0 = 0,
+    OS_HAL_I2C_ISU1,
+    OS_HAL_I2C_ISU2,
+    OS_HAL_I2C_ISU3,
+    OS_HAL_I2C_ISU4,
+    OS_HAL_I2C_ISU_MAX
+} i2c_num;
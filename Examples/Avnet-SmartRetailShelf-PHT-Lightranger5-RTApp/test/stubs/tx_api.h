@@ -0,0 +1,21 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Just enough of the ThreadX API for the host tests to build the shelf sources, tx_time_get() and
+// tx_thread_sleep() are provided by the test's simulated clock.
+
+#include <stdint.h>
+
+typedef unsigned long ULONG;
+typedef long LONG;
+typedef unsigned int UINT;
+typedef unsigned char UCHAR;
+typedef char CHAR;
+typedef void VOID;
+
+#define TX_TIMER_TICKS_PER_SECOND 100
+
+ULONG tx_time_get(void);
+UINT tx_thread_sleep(ULONG ticks);
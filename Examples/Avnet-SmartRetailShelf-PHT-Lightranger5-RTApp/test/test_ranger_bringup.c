@@ -0,0 +1,228 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for the parallel LightRanger5 bring up, ranger_bringup.c run against the simulated sensors in
+// ranger_sim.h.  They check the shelf schedule (the second sensor gets its image while the first one
+// calibrates), the bring up time against a single sensor and a sequential bring up, the cached calibration and
+// the address arbitration: never two sensors answering at 0x41 on one ISU, a missing sensor or an unresolvable
+// address conflict fails without holding up the others.
+
+#include "host_test.h"
+#include "ranger_sim.h"
+
+#define SHELF1_ADDRESS 0x51
+
+// Bring up time of a single cold sensor without a cached calibration
+static ULONG single_ms;
+
+static ULONG run(ranger_bringup_t* rangers, int count, bool* ok)
+{
+    ULONG start = tx_time_get();
+
+    *ok = ranger_bringup_run(rangers, count, I2C_MASTER_SPEED_FAST);
+    return tx_time_get() - start;
+}
+
+// One sensor: boot, download, image start, calibration, every wait polled instead of slept
+static void test_single(void)
+{
+    lightranger5_t ctx;
+    ranger_bringup_t r;
+    bool ok;
+
+    sim_reset(1);
+    sim_ranger(&r, &ctx, 0, LIGHTRANGER5_SET_DEV_ADDR);
+
+    single_ms = run(&r, 1, &ok);
+    printf("single sensor: %lu ms\n", single_ms);
+
+    CHECK(ok);
+    CHECK(r.state == RANGER_BRINGUP_DONE);
+    CHECK(r.calibrated && r.calibrationValid);
+    CHECK(!memcmp(r.appVersion, sim_version, LIGHTRANGER5_APP_VERSION_SIZE));
+    CHECK(r.stats.records == SIM_DOWNLOAD_RECORDS);
+    CHECK(sim.sensors[0].downloads == 1);
+    CHECK(sim.conflicts == 0);
+
+    // At most a poll interval lost per wait
+    CHECK(single_ms <= SIM_BOOT_MS + SIM_DOWNLOAD_MS + SIM_APP_BOOT_MS + SIM_CALIBRATION_MS +
+                       RANGER_BRINGUP_CALIBRATION_POLL_TICKS + 3 * RANGER_BRINGUP_BOOT_POLL_TICKS);
+}
+
+// The shelf: sensor 0 moves to 0x51, sensor 1 stays at 0x41 on the same ISU.  Sensor 1 only comes out of reset
+// once sensor 0 left 0x41 and is downloaded while sensor 0 calibrates, both are done in about the time of one
+// sensor plus a download.
+static void test_shelf(void)
+{
+    lightranger5_t ctx[2];
+    ranger_bringup_t r[2];
+    bool ok;
+
+    sim_reset(2);
+    sim_ranger(&r[0], &ctx[0], 0, SHELF1_ADDRESS);
+    sim_ranger(&r[1], &ctx[1], 1, LIGHTRANGER5_SET_DEV_ADDR);
+
+    ULONG total = run(r, 2, &ok);
+    printf("two sensors: %lu ms, sequential %lu ms\n", total, 2 * single_ms);
+
+    CHECK(ok);
+    CHECK(r[0].state == RANGER_BRINGUP_DONE && r[1].state == RANGER_BRINGUP_DONE);
+    CHECK(r[0].calibrated && r[1].calibrated);
+    CHECK(sim.sensors[0].address == SHELF1_ADDRESS);
+    CHECK(sim.sensors[1].address == LIGHTRANGER5_SET_DEV_ADDR);
+    CHECK(sim.conflicts == 0);
+
+    // Sensor 1's download runs while sensor 0 calibrates
+    CHECK(sim.sensors[1].downloadStart > sim.sensors[0].downloadStart + SIM_DOWNLOAD_MS);
+    CHECK(sim.sensors[1].downloadStart + SIM_DOWNLOAD_MS < sim.sensors[0].calibrationDone);
+
+    CHECK(total <= single_ms + SIM_DOWNLOAD_MS + SIM_APP_BOOT_MS + SIM_ADDRESS_MS + 10);
+    CHECK(total < 2 * single_ms * 2 / 3);
+}
+
+// With the calibration cached for the running image version nothing is calibrated, a cache for another
+// version is replaced
+static void test_cached_calibration(void)
+{
+    lightranger5_t ctx[2];
+    ranger_bringup_t r[2];
+    bool ok;
+
+    sim_reset(2);
+    sim_ranger(&r[0], &ctx[0], 0, SHELF1_ADDRESS);
+    sim_ranger(&r[1], &ctx[1], 1, LIGHTRANGER5_SET_DEV_ADDR);
+    for (int i = 0; i < 2; i++) {
+        r[i].calibrationValid = true;
+        memcpy(r[i].appVersion, sim_version, LIGHTRANGER5_APP_VERSION_SIZE);
+    }
+
+    ULONG total = run(r, 2, &ok);
+    printf("two sensors, cached calibration: %lu ms\n", total);
+
+    CHECK(ok);
+    CHECK(!r[0].calibrated && !r[1].calibrated);
+    CHECK(sim.sensors[0].calibrations == 0 && sim.sensors[1].calibrations == 0);
+    CHECK(total < 2 * (SIM_DOWNLOAD_MS + SIM_APP_BOOT_MS) + 50);
+
+    sim_reset(1);
+    sim_ranger(&r[0], &ctx[0], 0, LIGHTRANGER5_SET_DEV_ADDR);
+    r[0].calibrationValid = true;
+    memcpy(r[0].appVersion, sim_version, LIGHTRANGER5_APP_VERSION_SIZE);
+    r[0].appVersion[2]++;
+
+    run(r, 1, &ok);
+    CHECK(ok);
+    CHECK(r[0].calibrated);
+    CHECK(sim.sensors[0].calibrations == 1);
+    CHECK(!memcmp(r[0].appVersion, sim_version, LIGHTRANGER5_APP_VERSION_SIZE));
+}
+
+// Sensors on different ISUs don't wait for each other, both can stay at 0x41
+static void test_separate_buses(void)
+{
+    lightranger5_t ctx[2];
+    ranger_bringup_t r[2];
+    bool ok;
+
+    sim_reset(2);
+    sim.sensors[1].isu = 4;
+    sim_ranger(&r[0], &ctx[0], 0, LIGHTRANGER5_SET_DEV_ADDR);
+    sim_ranger(&r[1], &ctx[1], 1, LIGHTRANGER5_SET_DEV_ADDR);
+
+    ULONG total = run(r, 2, &ok);
+    printf("two sensors on two ISUs: %lu ms\n", total);
+
+    CHECK(ok);
+    CHECK(sim.conflicts == 0);
+    CHECK(total <= single_ms + SIM_DOWNLOAD_MS + 10);
+}
+
+// Two sensors that both stay at 0x41 on one ISU can't both come up, one fails instead of hanging and the
+// other is brought up
+static void test_address_conflict(void)
+{
+    lightranger5_t ctx[2];
+    ranger_bringup_t r[2];
+    bool ok;
+
+    sim_reset(2);
+    sim_ranger(&r[0], &ctx[0], 0, LIGHTRANGER5_SET_DEV_ADDR);
+    sim_ranger(&r[1], &ctx[1], 1, LIGHTRANGER5_SET_DEV_ADDR);
+
+    run(r, 2, &ok);
+
+    CHECK(!ok);
+    CHECK(r[0].state == RANGER_BRINGUP_DONE);
+    CHECK(r[1].state == RANGER_BRINGUP_FAILED);
+    CHECK(sim.sensors[1].phase == SIM_OFF);
+    CHECK(sim.conflicts == 0);
+}
+
+// A sensor that isn't fitted times out in the boot state and is held in reset, the next one on the ISU is
+// brought up after it
+static void test_missing_sensor(void)
+{
+    lightranger5_t ctx[2];
+    ranger_bringup_t r[2];
+    bool ok;
+
+    sim_reset(2);
+    sim.sensors[0].present = false;
+    sim_ranger(&r[0], &ctx[0], 0, SHELF1_ADDRESS);
+    sim_ranger(&r[1], &ctx[1], 1, LIGHTRANGER5_SET_DEV_ADDR);
+
+    ULONG total = run(r, 2, &ok);
+    printf("first sensor missing: %lu ms\n", total);
+
+    CHECK(!ok);
+    CHECK(r[0].state == RANGER_BRINGUP_FAILED);
+    CHECK(r[1].state == RANGER_BRINGUP_DONE);
+    CHECK(sim.sensors[0].phase == SIM_OFF);
+    CHECK(total <= LIGHTRANGER5_BOOT_TIMEOUT_MS + single_ms + 10);
+}
+
+// Warm sensors are left alone, an image loaded sensor only gets the measurement app and its calibration
+static void test_warm_start(void)
+{
+    lightranger5_t ctx[2];
+    ranger_bringup_t r[2];
+    bool ok;
+
+    sim_reset(2);
+    sim.sensors[0].phase = SIM_RUNNING;
+    sim.sensors[0].address = SHELF1_ADDRESS;
+    sim.sensors[1].phase = SIM_RUNNING;
+    sim.sensors[1].appid = SIM_APPID_BOOTLOADER;
+    sim_ranger(&r[0], &ctx[0], 0, SHELF1_ADDRESS);
+    sim_ranger(&r[1], &ctx[1], 1, LIGHTRANGER5_SET_DEV_ADDR);
+    for (int i = 0; i < 2; i++) {
+        lightranger5_init(&ctx[i], &r[i].cfg, false);
+    }
+    r[0].start = LIGHTRANGER5_START_WARM;
+    r[1].start = LIGHTRANGER5_START_IMAGE_LOADED;
+
+    uint32_t transfers = sim.transfers;
+    ULONG total = run(r, 2, &ok);
+
+    CHECK(ok);
+    CHECK(r[0].state == RANGER_BRINGUP_DONE && r[1].state == RANGER_BRINGUP_DONE);
+    CHECK(sim.sensors[0].downloads == 0 && sim.sensors[1].downloads == 0);
+    CHECK(sim.sensors[0].calibrations == 0);
+    CHECK(sim.sensors[1].appid == LIGHTRANGER5_APPID_MEASUREMENT);
+    CHECK(sim.sensors[1].calibrations == 1);
+    CHECK(sim.transfers > transfers);
+    CHECK(total <= SIM_CALIBRATION_MS + RANGER_BRINGUP_CALIBRATION_POLL_TICKS + 5);
+}
+
+int main(void)
+{
+    test_single();
+    test_shelf();
+    test_cached_calibration();
+    test_separate_buses();
+    test_address_conflict();
+    test_missing_sensor();
+    test_warm_start();
+
+    return host_test_result("ranger_bringup");
+}
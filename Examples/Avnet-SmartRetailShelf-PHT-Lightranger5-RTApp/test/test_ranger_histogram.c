@@ -0,0 +1,141 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for the TMF8801 histogram kernel in ranger_histogram.c.  Every dump file given on the command line
+// (test/histograms, see histogram_dump.h for the format) is run through ranger_histogram_find_targets() with the
+// default settings and, if the file names one, its crosstalk reference, and the targets found are checked
+// against the file's expect line.  The settings themselves are checked on synthesized histograms.
+
+#include "host_test.h"
+#include "histogram_dump.h"
+
+static void print_targets(const ranger_histogram_targets_t* found)
+{
+    printf("  ambient %u, %u targets:", found->ambient, found->count);
+    for (int i = 0; i < found->count; i++) {
+        printf(" %dmm (%u)", found->targets[i].distance_mm, found->targets[i].strength);
+    }
+    printf("\n");
+}
+
+static void test_dump(const char* path)
+{
+    static HistogramDump dump;
+    static HistogramDump reference;
+    static uint32_t xtalk[RANGER_HISTOGRAM_BINS];
+    ranger_histogram_cfg_t cfg;
+    ranger_histogram_targets_t found;
+    bool useXtalk = false;
+
+    printf("%s\n", path);
+    if (!histogram_dump_load(path, &dump)) {
+        CHECK(!"dump file can't be read");
+        return;
+    }
+
+    if (dump.xtalk[0]) {
+        if (!histogram_dump_load(dump.xtalk, &reference)) {
+            CHECK(!"crosstalk reference can't be read");
+            return;
+        }
+        ranger_histogram_make_xtalk(reference.bins, xtalk);
+        useXtalk = true;
+    }
+
+    ranger_histogram_cfg_setup(&cfg);
+    ranger_histogram_find_targets(dump.bins, useXtalk ? xtalk : NULL, &cfg, &found);
+    print_targets(&found);
+
+    // A dump without an expect line, the crosstalk reference for example, only has to load
+    if (!dump.hasExpected) {
+        return;
+    }
+
+    CHECK(found.count == dump.expectedCount);
+    for (int i = 0; (i < found.count) && (i < dump.expectedCount); i++) {
+        CHECK_NEAR(found.targets[i].distance_mm, dump.expected[i], dump.toleranceMm);
+    }
+}
+
+// maxTargets keeps the strongest targets, still nearest first, minStrength drops the weak ones
+static void test_settings(void)
+{
+    static uint16_t bins[RANGER_HISTOGRAM_TDC_COUNT][RANGER_HISTOGRAM_BINS];
+    const HistogramModelTarget targets[] = {{300.0, 300.0}, {700.0, 900.0}, {1500.0, 600.0}};
+    ranger_histogram_cfg_t cfg;
+    ranger_histogram_targets_t found;
+
+    histogram_model(bins, 40.0, 0.0, targets, 3, 7);
+
+    ranger_histogram_cfg_setup(&cfg);
+    CHECK(ranger_histogram_find_targets(bins, NULL, &cfg, &found) == 3);
+    CHECK_NEAR(found.ambient, 5 * 40, 10);
+
+    cfg.maxTargets = 1;
+    CHECK(ranger_histogram_find_targets(bins, NULL, &cfg, &found) == 1);
+    CHECK_NEAR(found.targets[0].distance_mm, 700, HISTOGRAM_DUMP_TOLERANCE_MM);
+
+    cfg.maxTargets = 2;
+    CHECK(ranger_histogram_find_targets(bins, NULL, &cfg, &found) == 2);
+    CHECK_NEAR(found.targets[0].distance_mm, 700, HISTOGRAM_DUMP_TOLERANCE_MM);
+    CHECK_NEAR(found.targets[1].distance_mm, 1500, HISTOGRAM_DUMP_TOLERANCE_MM);
+
+    // Strength is the summed peak height above the ambient level, about 5 x 300 for the weakest target
+    ranger_histogram_cfg_setup(&cfg);
+    cfg.minStrength = 2000;
+    CHECK(ranger_histogram_find_targets(bins, NULL, &cfg, &found) == 2);
+    CHECK_NEAR(found.targets[0].distance_mm, 700, HISTOGRAM_DUMP_TOLERANCE_MM);
+
+    // Bin width and offset calibration, bin 35 at 15mm per bin plus 40mm
+    ranger_histogram_cfg_setup(&cfg);
+    cfg.binWidthUm = 15000;
+    cfg.offsetMm = 40;
+    ranger_histogram_find_targets(bins, NULL, &cfg, &found);
+    CHECK_NEAR(found.targets[1].distance_mm, 35 * 15 + 40, 8);
+
+    // An out of range maxTargets is the maximum
+    ranger_histogram_cfg_setup(&cfg);
+    cfg.maxTargets = 0;
+    CHECK(ranger_histogram_find_targets(bins, NULL, &cfg, &found) == 3);
+}
+
+// Sweeping one target over the range, the position refinement keeps the error well inside a bin
+static void test_sweep(void)
+{
+    static uint16_t bins[RANGER_HISTOGRAM_TDC_COUNT][RANGER_HISTOGRAM_BINS];
+    ranger_histogram_cfg_t cfg;
+    ranger_histogram_targets_t found;
+    double maxError = 0.0;
+    int missed = 0;
+
+    ranger_histogram_cfg_setup(&cfg);
+
+    for (double mm = 100.0; mm <= 2400.0; mm += 7.0) {
+
+        HistogramModelTarget target = {mm, 500.0};
+
+        histogram_model(bins, 40.0, 0.0, &target, 1, (uint32_t)mm);
+        if (ranger_histogram_find_targets(bins, NULL, &cfg, &found) != 1) {
+            missed++;
+            continue;
+        }
+        maxError = fmax(maxError, fabs(found.targets[0].distance_mm - mm));
+    }
+
+    printf("sweep 100 - 2400mm: max error %.1f mm, %d missed\n", maxError, missed);
+    CHECK(missed == 0);
+    CHECK(maxError <= HISTOGRAM_DUMP_TOLERANCE_MM);
+}
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        test_dump(argv[i]);
+    }
+    CHECK(argc > 1);
+
+    test_settings();
+    test_sweep();
+
+    return host_test_result("ranger_histogram");
+}
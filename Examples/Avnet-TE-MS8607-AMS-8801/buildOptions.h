@@ -10,3 +10,23 @@
 #if defined(REV1_BOARD) && defined(REV2_BOARD)
 #error "Invalid configuration, only one board revision can be defined!"
 #endif
+
+// I2C speed used while the TMF8801 firmware image is downloaded.  The MS8607 on the PHT click shares the
+// bus and only supports Fast-mode (400KHz), use I2C_MASTER_SPEED_FAST (Fast-mode Plus, 1MHz) only when
+// every device on the ISU supports it
+#define LIGHTRANGER5_DOWNLOAD_I2C_SPEED I2C_MASTER_SPEED_FULL
+
+// I2C Bus Statistics
+// Both clicks lock ISU2 through the I2C bus manager (i2c_bus.h).  Define I2C_BUS_PRINT_STATS to print how much of
+// the time since the previous telemetry message each click held the bus, its transactions and errors on the debug
+// UART with every telemetry message.  The sensor bring up at startup is not counted.
+//#define I2C_BUS_PRINT_STATS
+
+// LightRanger5 Interrupt Selection
+// The TMF8801 drives its INT pin low when a new distance result is ready.  If INT is wired to an MT3620 GPIO
+// that supports external interrupts (GPIO0 - GPIO23), define LIGHTRANGER5_INT_GPIO as that GPIO number and add
+// it to the "Gpio" capability in app_manifest.json.  The ranging thread then only reads the sensor when INT
+// falls.  Otherwise the ranging thread polls the sensor every 20ms.  On the Rev1 board both click sockets use
+// GPIO2, on the Rev2 board click socket #1 uses GPIO5 and click socket #2 (GPIO34) does not support external
+// interrupts.
+//#define LIGHTRANGER5_INT_GPIO 5     // Click socket #1 INT pin (Rev2 board)
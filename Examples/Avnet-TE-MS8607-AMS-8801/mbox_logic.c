@@ -33,10 +33,20 @@
 #include "avnet_starter_kit_hw.h"
 #include "pht.h"
 #include "drv.h"
+#include "i2c_bus.h"
+#include "cycle_counter.h"
+
+#ifdef LIGHTRANGER5_INT_GPIO
+#include "os_hal_gpio.h"
+#include "os_hal_eint.h"
+#endif
 
 // Add MT3620 constant
 #define MT3620_TIMER_TICKS_PER_SECOND ((ULONG) 100*10)
 
+// M4 core clock (197.6MHz) in cycles per microsecond, converts DWT cycle counts
+#define MT3620_M4_CYCLES_PER_US 197
+
 /* Configurations */
 #define APP_STACK_SIZE      1024
 #define DEMO_BYTE_POOL_SIZE 9120
@@ -47,6 +57,17 @@
 #define COMPONENT_ID_LEN_IN_SHARED_MEMORY 16
 #define COMMAND_BLOCK_OFFSET 20
 
+// The ranging thread checks the LightRanger5 for a new result this often when LIGHTRANGER5_INT_GPIO is not
+// defined.  The sensor measures every 100ms and only holds the latest result, polling faster doesn't miss one.
+#define RANGING_POLL_MS 20
+
+// With LIGHTRANGER5_INT_GPIO defined the ranging thread still checks the sensor this often, in case an edge
+// was missed
+#define RANGING_INT_TIMEOUT_MS 250
+
+// getRange() only returns a result younger than this, an older one means the sensor stopped measuring
+#define RANGER_RESULT_MAX_AGE_MS 1000
+
 // Define the memory layout of the incomming and outgoing message buffer
 typedef struct __attribute__((packed))
 {
@@ -83,7 +104,8 @@ static volatile bool hardwareInitOK = false;
 // Define the bits used for the telemetry event flag construct
 enum triggers {
     HIGH_LEVEL_MESSAGE = 0,
-    PERIODIC_TELEMETRY = 1
+    PERIODIC_TELEMETRY = 1,
+    RANGER_RESULT = 2
 };
 
 /* Define Semaphores */
@@ -97,6 +119,7 @@ volatile UCHAR  blockFifoSema;
 TX_THREAD               thread_mbox;
 TX_THREAD               thread_set_telemetry_flag;
 TX_THREAD               tx_hardware_init_thread;
+TX_THREAD               thread_ranging;
 
 // Application memory pool
 TX_BYTE_POOL            byte_pool_0;
@@ -104,32 +127,76 @@ UCHAR                   memory_area[DEMO_BYTE_POOL_SIZE];
 
 // Application flags
 TX_EVENT_FLAGS_GROUP    event_flags;
+
+// Protects lightranger5Calibration and lightranger5Config, written by the mbox thread and read by the hardware
+// init and ranging threads
+TX_MUTEX                calibration_mutex;
+
+// Protects lightranger5Result, written by the ranging thread and read by the mbox thread
+TX_MUTEX                results_mutex;
+
 //TX_EVENT_FLAGS_GROUP    send_telemetry_event_flags_0;
 
 /* Define thread prototypes.  */
 void tx_thread_mbox_entry(ULONG thread_input);
 void set_telemetry_flag_thread_entry(ULONG thread_input);
 void hardware_init_thread(ULONG thread_input);
+void ranging_thread_entry(ULONG thread_input);
 
 /* Function prototypes */
 void mbox_fifo_cb(struct mtk_os_hal_mbox_cb_data *data);
 void mbox_swint_cb(struct mtk_os_hal_mbox_cb_data *data);
 void mbox_print(UCHAR *mbox_buf, UINT mbox_data_len);
 bool initialize_hardware(void);
+bool initialize_lightranger5(lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5, lightranger5_start_t start);
+lightranger5_start_t check_lightranger5(lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5);
+void sendCalibration(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void sendConfig(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
 void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
 void display_status_no_error (void);
 void display_status_error (void);
+bool enable_lightranger5_results(lightranger5_t* lightranger5);
+void start_lightranger5(lightranger5_t* lightranger5, uint8_t* factoryCalib);
+void restart_lightranger5(void);
+void printI2cStats(void);
 
 // LightRanger5 
 int getRange(void);
+void getRangerResult(IC_PHT_LIGHTRANGER5_RESULT* rangerResult);
 static lightranger5_t lightranger5;
 static uint8_t status_old = 255;
 static uint8_t status;
-static uint8_t factory_calib_data[ 14 ];
-static uint8_t tmf8801_algo_state[ 11 ] = { 0xB1, 0xA9, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-static uint8_t command_data[ 9 ] = { 0x03, 0x23, 0x00, 0x00, 0x00, 0x64, 0xFF, 0xFF, 0x02 };
+static uint8_t tmf8801_algo_state[ LIGHTRANGER5_ALGO_STATE_SIZE ] = { 0xB1, 0xA9, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+// Calibration download write frames, longer than the I2C FIFO so they are sent by DMA out of SYSRAM
+static uint8_t factoryCalibFrame[LIGHTRANGER5_FRAME_SIZE(LIGHTRANGER5_FACTORY_CALIB_SIZE)] __attribute__((section(".sysram")));
+static uint8_t algoStateFrame[LIGHTRANGER5_FRAME_SIZE(LIGHTRANGER5_ALGO_STATE_SIZE)] __attribute__((section(".sysram")));
 static uint8_t appid_data;
 
+// Factory calibration, either taken by this application after a firmware download or cached by the high level
+// application (IC_PHT_LIGHTRANGER5_SET_CALIBRATION).  A cached calibration lets a cold start skip the factory
+// calibration and its appVersion lets a warm start skip the firmware download.
+static IC_PHT_LIGHTRANGER5_CALIBRATION lightranger5Calibration;
+static uint8_t lightranger5StartMode;
+static uint32_t hardwareInitMs = 0;
+
+// Measurement settings, set by the high level application (IC_PHT_LIGHTRANGER5_SET_CONFIG).  The ranging thread
+// restarts the measurement when lightranger5ConfigChanged is set.
+static IC_PHT_LIGHTRANGER5_CONFIG lightranger5Config = {
+    LIGHTRANGER5_MEASURE_PERIOD_DEFAULT_MS, LIGHTRANGER5_MEASURE_KILO_ITERATIONS_DEFAULT, LIGHTRANGER5_MEASURE_ALGO_DEFAULT, 0
+};
+static bool lightranger5ConfigChanged = false;
+
+// Latest result, collected by the ranging thread once lightranger5Measuring is set
+static volatile bool lightranger5Measuring = false;
+static bool lightranger5ResultValid = false;
+static ULONG lightranger5ResultTime;    // Tick the result was read
+static lightranger5_result_t lightranger5Result;
+
+// Both clicks share ISU2, the ranging thread reads the LightRanger5 while the mbox thread reads the PHT click.
+// Each click locks the bus through the I2C bus manager, which counts its bus time and errors.
+static i2c_bus_device_t rangerBus;
+static i2c_bus_device_t phtBus;
+
 // PHT Click
 static pht_t pht;
 static float pressure;
@@ -139,6 +206,9 @@ static float temperature;
 /* Define main entry point.  */
 void tx_main(void)
 {
+    /* Enable the DWT cycle counter used to time the I2C bus */
+    cycle_counter_init();
+
     /* Enter the ThreadX kernel.  */
     tx_kernel_enter();
 }
@@ -171,6 +241,27 @@ void tx_application_define(void *first_unused_memory)
         printf("failed to create event_flags\r\n");
     }
 
+    status = tx_mutex_create(&calibration_mutex, "calibration mutex", TX_NO_INHERIT);
+    if (status != TX_SUCCESS)
+    {
+        printf("failed to create calibration_mutex\r\n");
+    }
+
+    status = tx_mutex_create(&results_mutex, "results mutex", TX_NO_INHERIT);
+    if (status != TX_SUCCESS)
+    {
+        printf("failed to create results_mutex\r\n");
+    }
+
+    status = i2c_bus_init();
+    if (status != TX_SUCCESS)
+    {
+        printf("failed to create the i2c bus manager\r\n");
+    }
+
+    i2c_bus_device_init(&rangerBus, "LightRanger5", MIKROBUS_CLICK1_SDA);
+    i2c_bus_device_init(&phtBus, "PHT", MIKROBUS_CLICK1_SDA);
+
     // -------------------------------- Threads --------------------------------
 
     /* Allocate the stack for thread_mbox.  */
@@ -194,6 +285,13 @@ void tx_application_define(void *first_unused_memory)
     tx_thread_create(&tx_hardware_init_thread, "hardware init thread", hardware_init_thread, 0,
         pointer, APP_STACK_SIZE, 6, 6, TX_NO_TIME_SLICE, TX_AUTO_START);
 
+    /* Allocate the stack for the ranging thread  */
+    tx_byte_allocate(&byte_pool_0, (VOID**) &pointer, APP_STACK_SIZE, TX_NO_WAIT);
+
+    // Create the ranging thread, it runs above the mbox thread so a result is read before the next one overwrites it
+    tx_thread_create(&thread_ranging, "ranging thread", ranging_thread_entry, 0,
+        pointer, APP_STACK_SIZE, 7, 7, TX_NO_TIME_SLICE, TX_AUTO_START);
+
     // -------------------------------- mailbox channels --------------------------------
 
     /* Open the MBOX channel of A7 <-> M4 */
@@ -213,6 +311,9 @@ void tx_thread_mbox_entry(ULONG thread_input)
     INT result;
     ULONG actual_flags;
     bool queuedMessages = true;
+    IC_PHT_LIGHTRANGER5_RESULT rangerResult;
+    IC_PHT_LIGHTRANGER5_CONFIG config;
+    err_t err;
 
     printf("MBOX Task Started\n");
 
@@ -334,13 +435,16 @@ void tx_thread_mbox_entry(ULONG thread_input)
                         if(hardwareInitOK){
 
                             // Read the sensor data
-                            pht_get_temperature_pressure ( &pht, &temperature, &pressure);
-                            pht_get_relative_humidity ( &pht, &humidity);
+                            i2c_bus_lock(&phtBus);
+                            err = pht_get_measurement(&pht, &temperature, &pressure, &humidity);
+                            i2c_bus_unlock(&phtBus, err == PHT_OK);
 
                             payloadPtrOutgoing->payload.temp = temperature;
                             payloadPtrOutgoing->payload.pressure = pressure;
                             payloadPtrOutgoing->payload.hum = humidity;
                             payloadPtrOutgoing->payload.range_mm = getRange();
+                            getRangerResult(&rangerResult);
+                            payloadPtrOutgoing->payload.result = rangerResult;
 
                             printf("tempC: %.2fC, pressure: %.2f mbar, humidity: %.2f%%, range: %dmm\n\r", 
                                 payloadPtrOutgoing->payload.temp,
@@ -353,6 +457,53 @@ void tx_thread_mbox_entry(ULONG thread_input)
                         }
                         break;
 
+                    // The high level application sends the calibration it persisted from an earlier
+                    // IC_PHT_LIGHTRANGER5_GET_CALIBRATION response.  Send this as soon as the real time
+                    // application starts, a cold start waits a couple of seconds before it downloads the
+                    // firmware and looks for a cached calibration after the download.
+                    case IC_PHT_LIGHTRANGER5_SET_CALIBRATION:
+
+                        tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+                        lightranger5Calibration = payloadPtrIncomming->payload.calibration;
+                        tx_mutex_put(&calibration_mutex);
+
+                        // Echo back the calibration along with how the sensor was started
+                        sendCalibration(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    // The high level application is requesting the current calibration to persist it
+                    case IC_PHT_LIGHTRANGER5_GET_CALIBRATION:
+
+                        sendCalibration(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    // The high level application sends new measurement settings, invalid settings are ignored
+                    case IC_PHT_LIGHTRANGER5_SET_CONFIG:
+
+                        config = payloadPtrIncomming->payload.config;
+                        if((config.periodMs == 0) || (config.kiloIterations == 0) || (config.algorithm == 0) ||
+                           (config.minConfidence > 63)){
+                            printf("Invalid LightRanger5 config\n");
+                        }
+                        else{
+                            tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+                            lightranger5Config = config;
+                            lightranger5ConfigChanged = true;
+                            tx_mutex_put(&calibration_mutex);
+
+                            // The ranging thread restarts the measurement, wake it if it waits for the INT pin
+                            tx_event_flags_set(&event_flags, 0x01 << RANGER_RESULT, TX_OR);
+                        }
+
+                        // Echo back the settings in use
+                        sendConfig(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
+                    case IC_PHT_LIGHTRANGER5_GET_CONFIG:
+
+                        sendConfig(outbound, inbound, mbox_shared_buf_size);
+                        break;
+
                     case IC_PHT_LIGHTRANGER5_HEARTBEAT:
                         printf("Realtime app processing heartbeat command\n");
 
@@ -413,13 +564,88 @@ void set_telemetry_flag_thread_entry(ULONG thread_input)
 // only purpose in life is to initialize the hardware.
 void hardware_init_thread(ULONG thread_input)
 {
+    ULONG startTime = tx_time_get();
+
     // Initialize the hardware
     if (initialize_hardware())
     {
         hardwareInitOK = true;
     }
 
-    printf("Hardware Init - %s\r\n", hardwareInitOK ? "OK" : "FAIL");
+    hardwareInitMs = (uint32_t)(tx_time_get() - startTime) * 1000 / MT3620_TIMER_TICKS_PER_SECOND;
+    printf("Hardware Init - %s in %lu ms\r\n", hardwareInitOK ? "OK" : "FAIL", hardwareInitMs);
+}
+
+#ifdef LIGHTRANGER5_INT_GPIO
+// EINT handler for the LightRanger5 INT pin.  This runs in interrupt context, so just set the flag and let the
+// ranging thread read the result.
+static void lightranger5_int_handler(void)
+{
+    tx_event_flags_set(&event_flags, 0x01 << RANGER_RESULT, TX_OR);
+}
+#endif
+
+// The ranging thread reads every LightRanger5 result as it comes in, so telemetry only copies the latest one.
+// The TMF8801 drives its INT pin low when a result is ready, with LIGHTRANGER5_INT_GPIO defined the EINT wakes
+// this thread, otherwise it polls INT_STATUS.
+void ranging_thread_entry(ULONG thread_input)
+{
+    lightranger5_result_t result;
+    uint8_t missed;
+    bool changed;
+    err_t err;
+
+#ifdef LIGHTRANGER5_INT_GPIO
+    ULONG actual_flags;
+#endif
+
+    printf("Ranging Task Started\n");
+
+    while (true) {
+
+        if (hardwareInitOK && lightranger5Measuring) {
+
+            // Restart the measurement if the high level application sent new settings
+            tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+            changed = lightranger5ConfigChanged;
+            lightranger5ConfigChanged = false;
+            tx_mutex_put(&calibration_mutex);
+
+            if (changed) {
+                restart_lightranger5();
+            }
+
+            // INT only falls again once the result was read, so read until there is nothing new
+            do {
+                i2c_bus_lock(&rangerBus);
+                err = lightranger5_read_result(&lightranger5, &result);
+                i2c_bus_unlock(&rangerBus, err >= 0);
+
+                if (err > 0) {
+
+                    // A jump in the result number means a result was overwritten before it was read
+                    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+                    missed = lightranger5ResultValid ?
+                             (uint8_t)(result.result_number - lightranger5Result.result_number - 1) : 0;
+                    lightranger5Result = result;
+                    lightranger5ResultTime = tx_time_get();
+                    lightranger5ResultValid = true;
+                    tx_mutex_put(&results_mutex);
+
+                    if (missed) {
+                        printf("LightRanger5: missed %u results\n", missed);
+                    }
+                }
+            } while (err > 0);
+        }
+
+#ifdef LIGHTRANGER5_INT_GPIO
+        tx_event_flags_get(&event_flags, 0x01 << RANGER_RESULT, TX_OR_CLEAR, &actual_flags,
+                           RANGING_INT_TIMEOUT_MS * MT3620_TIMER_TICKS_PER_SECOND / 1000);
+#else
+        tx_thread_sleep(RANGING_POLL_MS * MT3620_TIMER_TICKS_PER_SECOND / 1000);
+#endif
+    }
 }
 
 /* Mailbox Fifo Interrupt handler.
@@ -491,6 +717,9 @@ void mbox_print(u8 *mbox_buf, u32 mbox_data_len)
 }
 
 void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_PHT_LIGHTRANGER5_RESULT rangerResult;
+    err_t err;
     
     // Init a pointer to the outgoing message, cast it so we can index into the structure.
     IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
@@ -506,11 +735,14 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
     if(hardwareInitOK){
         
         // Read the sensor data
-        pht_get_temperature_pressure(&pht, &temperature, &pressure);
-        pht_get_relative_humidity(&pht, &humidity);
+        i2c_bus_lock(&phtBus);
+        err = pht_get_measurement(&pht, &temperature, &pressure, &humidity);
+        i2c_bus_unlock(&phtBus, err == PHT_OK);
         
         // Copy the sensor data into the outgoing payload structure
         payloadPtrOutgoing->payload.range_mm = getRange();
+        getRangerResult(&rangerResult);
+        payloadPtrOutgoing->payload.result = rangerResult;
         payloadPtrOutgoing->payload.temp = temperature;
         payloadPtrOutgoing->payload.pressure = pressure;
         payloadPtrOutgoing->payload.hum = humidity;
@@ -531,103 +763,210 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
 
     printf("\n\nSending to A7: %s\n",payloadPtrOutgoing->payload.telemetryJSON);
 
+#ifdef I2C_BUS_PRINT_STATS
+    printI2cStats();
+#endif
+
     /* Write to the high level application, enqueue to mailbox */
     EnqueueData(inbound, outbound, mbox_shared_buf_size, payloadPtrOutgoing, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
 }
-// Initialize the RelayClick hardware
-bool initialize_hardware(void) {
 
-    // Enable the sleep if you neeed to set a breakpoint at startup...
-    tx_thread_sleep(2000);
+#ifdef I2C_BUS_PRINT_STATS
+// Prints each click's use of ISU2 since the previous call, the counters start over
+void printI2cStats(void){
 
-    pht_cfg_t pht_cfg;  /**< Click config object. */
+    static ULONG statsStart;
+    i2c_bus_device_t* devices[] = { &rangerBus, &phtBus };
+    ULONG now = tx_time_get();
+    uint64_t windowUs = (uint64_t)(now - statsStart) * (1000000 / MT3620_TIMER_TICKS_PER_SECOND);
 
-    // Click initialization.
-    pht_cfg_setup( &pht_cfg );
+    statsStart = now;
 
-    // Setup the pin mapping
-    PHT_MAP_MIKROBUS( pht_cfg, CLICK1 );
-    err_t init_flag = pht_init( &pht, &pht_cfg );
-    if ( init_flag == I2C_MASTER_ERROR ) {
-        printf(" Application Init Error. " );
-        return false;
+    for(int i = 0; i < 2; i++){
+
+        i2c_bus_stats_t stats;
+        uint32_t busyPermille;
+
+        i2c_bus_get_stats(devices[i], &stats, true);
+        busyPermille = windowUs ? (uint32_t)((stats.busyCycles / MT3620_M4_CYCLES_PER_US * 1000 + windowUs / 2) / windowUs) : 0;
+
+        printf("I2C %s: %lu.%lu%% busy over %lu ms, %lu transactions, %lu errors, longest %lu us\n", devices[i]->name,
+               (unsigned long)(busyPermille / 10), (unsigned long)(busyPermille % 10), (unsigned long)(windowUs / 1000),
+               (unsigned long)stats.transactions, (unsigned long)stats.errors,
+               (unsigned long)(stats.maxCycles / MT3620_M4_CYCLES_PER_US));
     }
-    
-    printf("---------------------------- \r\n " );
-    printf(" Device reset \r\n" );
-    pht_reset( &pht );
-    Delay_ms( 100 );
-    printf("---------------------------- \r\n " );
-    printf(" Set Oversampling Ratio \r\n" );
-    pht_set_ratio( &pht, PHT_PT_CMD_RATIO_2048, PHT_PT_CMD_RATIO_2048);
-    Delay_ms( 100 );
-    printf("---------------------------- \r\n " );
+}
+#endif
 
-    // Drive the Click site #1 EN pin low to hold the device in reset
-    mtk_os_hal_gpio_set_output((os_hal_gpio_pin)MIKROBUS_CLICK1_CS, OS_HAL_GPIO_DATA_LOW);
+// Sends the LightRanger5 calibration and how the sensor was started to the high level application, the
+// incomming message in mbox_local_buf has been processed already
+void sendCalibration(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
 
-    // Call the routine that will update the firmwae
-    lightranger5_update_firmware ( MIKROBUS_CLICK1_SDA, MIKROBUS_CLICK1_CS, 0x00);
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
 
-    // Lightranger5 init
-    lightranger5_cfg_t lightranger5_cfg;
-    lightranger5_cfg_setup( &lightranger5_cfg );
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    payloadPtrOutgoing->payload.calibration = lightranger5Calibration;
+    tx_mutex_put(&calibration_mutex);
 
-    // Initialize the configuration structure. 
-    LIGHTRANGER5_MAP_MIKROBUS( lightranger5_cfg, CLICK1 );
+    payloadPtrOutgoing->payload.startMode = lightranger5StartMode;
+    payloadPtrOutgoing->payload.hardwareInitMs = hardwareInitMs;
 
-    init_flag = lightranger5_init( &lightranger5, &lightranger5_cfg, false );
-    if ( init_flag == I2C_MASTER_ERROR ) {
-        printf(" Application Init Error. " );
-        printf(" Please, run program again... " );
+    // Write to A7, enqueue to mailbox, the cmd byte already contains the command we're responding to
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
 
-        return false;
+void sendConfig(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size){
+
+    IC_SHARED_MEMORY_BLOCK_RT_TO_HL *payloadPtrOutgoing = (IC_SHARED_MEMORY_BLOCK_RT_TO_HL*)mbox_local_buf;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    payloadPtrOutgoing->payload.config = lightranger5Config;
+    tx_mutex_put(&calibration_mutex);
+
+    // Write to A7, enqueue to mailbox, the cmd byte already contains the command we're responding to
+    EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+}
+
+// Sets up the context for a LightRanger5 that has not been reset and checks if it still runs the firmware image
+// from before the real time application restarted.  The image version has to match the cached calibration, until
+// the high level application sends one any running measurement app is accepted since only this application
+// starts it.
+lightranger5_start_t check_lightranger5(lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5){
+
+    IC_PHT_LIGHTRANGER5_CALIBRATION calibration;
+
+    if ( lightranger5_init( lightranger5, lightranger_cfg, false ) == I2C_MASTER_ERROR ) {
+        return LIGHTRANGER5_START_COLD;
+    }
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    calibration = lightranger5Calibration;
+    tx_mutex_put(&calibration_mutex);
+
+    return lightranger5_check_warm_start( lightranger5, calibration.valid ? calibration.appVersion : NULL );
+}
+
+// Starts the periodic distance measurement on the LightRanger5.  A warm started sensor is already measuring, after
+// a firmware download (cold) or if only the measurement was stopped (image loaded) the cached factory calibration
+// is used if it was taken with the same image version, otherwise the factory calibration is run.
+bool initialize_lightranger5(lightranger5_cfg_t* lightranger_cfg, lightranger5_t* lightranger5, lightranger5_start_t start){
+
+    IC_PHT_LIGHTRANGER5_CALIBRATION calibration;
+    uint8_t appVersion[LIGHTRANGER5_APP_VERSION_SIZE];
+
+    int err_count = 128;
+
+    lightranger5StartMode = start;
+
+    if ( start == LIGHTRANGER5_START_WARM ) {
+        printf(" Measurement app already running, warm start.\r\n" );
+        return enable_lightranger5_results( lightranger5 );
+    }
+
+    if ( start == LIGHTRANGER5_START_COLD ) {
+
+        err_t init_flag = lightranger5_init( lightranger5, lightranger_cfg, false );
+        if ( init_flag == I2C_MASTER_ERROR ) {
+            printf(" Application Init Error. " );
+            printf(" Please, run program again... " );
+            return false;
+        }
+        
+        lightranger5_default_cfg( lightranger5 );
+        printf(" Application Task " );
+        Delay_ms( 100 );
     }
-    
-    lightranger5_default_cfg( &lightranger5 );
-    printf(" Application Task " );
-    Delay_ms( 100 );
-    
-    if ( !lightranger5_check_factory_calibration( &lightranger5 ) ) {
-        printf(" Factory calibration success." );
-    } else {
-        printf(" Factory calibration FAILED.\n" );
-        printf(" Please, run program again...\n" );
 
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    calibration = lightranger5Calibration;
+    tx_mutex_put(&calibration_mutex);
+
+    // Make sure the measurement app is running, then check the cached calibration belongs to this image
+    lightranger5_get_currently_run_app( lightranger5, &appid_data );
+    if ( appid_data != LIGHTRANGER5_APPID_MEASUREMENT ) {
+        lightranger5_load_app( lightranger5 );
+    }
+    if ( lightranger5_get_app_version( lightranger5, &appid_data, appVersion ) ||
+         ( appid_data != LIGHTRANGER5_APPID_MEASUREMENT ) ) {
+        printf(" Measurement app FAILED to start.\n" );
         return false;
     }
 
-    do {
-        lightranger5_get_status( &lightranger5, &status );
+    if ( calibration.valid && !memcmp( calibration.appVersion, appVersion, LIGHTRANGER5_APP_VERSION_SIZE ) ) {
+        printf(" Using cached factory calibration.\r\n" );
+    }
+    else {
 
-        if ( status_old != status ) {
-            if ( status < LIGHTRANGER5_STATUS_OK ) {
-                display_status_no_error( );    
-            } else {
-                display_status_error( );   
-            }  
-            status_old = status;
+        if ( !lightranger5_check_factory_calibration( lightranger5 ) ) {
+            printf(" Factory calibration success." );
+        } else {
+            printf(" Factory calibration FAILED.\n" );
+            printf(" Please, run program again...\n" );
+            return false;
         }
-        Delay_ms( 250 );
-    } while ( status );
-    
-    lightranger5_get_factory_calib_data( &lightranger5, factory_calib_data );
+
+        do {
+            lightranger5_get_status( lightranger5, &status );
+
+            if ( status_old != status ) {
+                if ( status < LIGHTRANGER5_STATUS_OK ) {
+                    display_status_no_error( );    
+                } else {
+                    display_status_error( );   
+                }  
+                status_old = status;
+            }
+            Delay_ms( 250 );
+            if(--err_count <= 0){
+                return false;
+            }
+        } while ( status );
+
+        lightranger5_get_factory_calib_data( lightranger5, calibration.factoryCalib );
+        memcpy( calibration.appVersion, appVersion, LIGHTRANGER5_APP_VERSION_SIZE );
+        calibration.valid = 1;
+
+        // Keep it for the high level application to read with IC_PHT_LIGHTRANGER5_GET_CALIBRATION
+        tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+        lightranger5Calibration = calibration;
+        tx_mutex_put(&calibration_mutex);
+    }
     
+    start_lightranger5( lightranger5, calibration.factoryCalib );
+    return enable_lightranger5_results( lightranger5 );
+}
+
+// Downloads the factory calibration, the algorithm state and the measurement command with the settings in
+// lightranger5Config, this starts the periodic distance measurement
+void start_lightranger5(lightranger5_t* lightranger5, uint8_t* factoryCalib){
+
+    lightranger5_measure_cfg_t measureCfg;
+
+    lightranger5_measure_cfg_setup( &measureCfg );
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    measureCfg.period_ms = lightranger5Config.periodMs;
+    measureCfg.kilo_iterations = lightranger5Config.kiloIterations;
+    measureCfg.algorithm = lightranger5Config.algorithm;
+    tx_mutex_put(&calibration_mutex);
+
     printf("------------------------------\r\n" );
     printf(" factory_calib_data[ 14 ] =\r\n { " );
     
     for ( uint8_t n_cnt = 0 ; n_cnt < 14 ; n_cnt++ ) {
-        printf("0x%.2X, ", factory_calib_data[ n_cnt ] );
+        printf("0x%.2X, ", factoryCalib[ n_cnt ] );
     }
 
     printf("};\r\n" );
     printf("------------------------------\r\n" );
     
-    lightranger5_set_command( &lightranger5, LIGHTRANGER5_CMD_DL_CALIB_AND_STATE );
-    lightranger5_set_factory_calib_data( &lightranger5, factory_calib_data );
-    lightranger5_set_algorithm_state_data( &lightranger5, tmf8801_algo_state );
-    lightranger5_set_command_data( &lightranger5, command_data );
-    lightranger5_get_status( &lightranger5, &status );
+    lightranger5_set_command( lightranger5, LIGHTRANGER5_CMD_DL_CALIB_AND_STATE );
+    memcpy( &factoryCalibFrame[1], factoryCalib, LIGHTRANGER5_FACTORY_CALIB_SIZE );
+    memcpy( &algoStateFrame[1], tmf8801_algo_state, LIGHTRANGER5_ALGO_STATE_SIZE );
+    lightranger5_set_factory_calib_data( lightranger5, factoryCalibFrame );
+    lightranger5_set_algorithm_state_data( lightranger5, algoStateFrame );
+    lightranger5_start_measurement( lightranger5, &measureCfg );
+    lightranger5_get_status( lightranger5, &status );
         
     if ( status_old != status ) {
         if ( status < LIGHTRANGER5_STATUS_OK ) {
@@ -638,7 +977,7 @@ bool initialize_hardware(void) {
         status_old = status;
     }
     
-    lightranger5_get_currently_run_app( &lightranger5, &appid_data );
+    lightranger5_get_currently_run_app( lightranger5, &appid_data );
     
     if ( appid_data == LIGHTRANGER5_APPID_MEASUREMENT ) {
         printf(" Measurement app running.\r\n" );
@@ -648,11 +987,129 @@ bool initialize_hardware(void) {
     } else {
         printf(" Result: 0x%X\r\n", appid_data );    
     }
+}
+
+// Restarts the measurement with the settings in lightranger5Config, called by the ranging thread.  The
+// measurement command needs the factory calibration, without one the settings are used at the next start.
+void restart_lightranger5(void){
+
+    IC_PHT_LIGHTRANGER5_CALIBRATION calibration;
+    bool restarted = false;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    calibration = lightranger5Calibration;
+    tx_mutex_put(&calibration_mutex);
+
+    if ( !calibration.valid ) {
+        printf("LightRanger5: no factory calibration, new settings are used at the next start\n" );
+        return;
+    }
+
+    i2c_bus_lock(&rangerBus);
+    if ( lightranger5_stop_measurement( &lightranger5 ) == LIGHTRANGER5_OK ) {
+        start_lightranger5( &lightranger5, calibration.factoryCalib );
+        restarted = ( lightranger5_enable_result_interrupt( &lightranger5, true ) == LIGHTRANGER5_OK );
+    }
+    i2c_bus_unlock(&rangerBus, restarted);
+
+    // The result numbers start over
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    lightranger5ResultValid = false;
+    tx_mutex_put(&results_mutex);
 
+    printf("LightRanger5: restart %s\n", restarted ? "OK" : "FAILED" );
+}
 
+// Raises the result interrupt of the measuring LightRanger5 and hands it to the ranging thread.  A warm started
+// sensor may still have a result pending from before the restart, it is cleared here.
+bool enable_lightranger5_results(lightranger5_t* lightranger5){
 
+    if ( lightranger5_enable_result_interrupt( lightranger5, true ) != LIGHTRANGER5_OK ) {
+        printf(" Result interrupt FAILED to enable.\n" );
+        return false;
+    }
+    lightranger5Measuring = true;
     return true;
+}
+
+// Initialize the RelayClick hardware
+bool initialize_hardware(void) {
 
+    lightranger5_cfg_t lightranger5_cfg;
+    lightranger5_start_t start;
+
+    // Lightranger5 init
+    lightranger5_cfg_setup( &lightranger5_cfg );
+
+    // Initialize the configuration structure. 
+    LIGHTRANGER5_MAP_MIKROBUS( lightranger5_cfg, CLICK1 );
+
+    // Open the EN pin for output and keep it high.  If only the real time application restarted the
+    // device may still be running the firmware image and measuring
+    mtk_os_hal_gpio_set_output((os_hal_gpio_pin)MIKROBUS_CLICK1_CS, OS_HAL_GPIO_DATA_HIGH);
+    if( 0 != mtk_os_hal_gpio_set_direction((os_hal_gpio_pin)MIKROBUS_CLICK1_CS, OS_HAL_GPIO_DIR_OUTPUT)){
+        return false;
+    }
+
+    start = check_lightranger5( &lightranger5_cfg, &lightranger5 );
+    printf("LightRanger5 start: %d (0 cold, 1 image loaded, 2 warm)\n", start);
+
+    if ( start == LIGHTRANGER5_START_COLD ) {
+
+        // Enable the sleep if you neeed to set a breakpoint at startup...  This also gives the high level
+        // application time to send its cached calibration (IC_PHT_LIGHTRANGER5_SET_CALIBRATION)
+        tx_thread_sleep(2000);
+    }
+
+    pht_cfg_t pht_cfg;  /**< Click config object. */
+
+    // Click initialization.
+    pht_cfg_setup( &pht_cfg );
+
+    // Setup the pin mapping
+    PHT_MAP_MIKROBUS( pht_cfg, CLICK1 );
+    err_t init_flag = pht_init( &pht, &pht_cfg );
+    if ( init_flag == I2C_MASTER_ERROR ) {
+        printf(" Application Init Error. " );
+        return false;
+    }
+    
+    printf("---------------------------- \r\n " );
+    printf(" Device reset \r\n" );
+    pht_reset( &pht );
+    Delay_ms( 100 );
+    printf("---------------------------- \r\n " );
+    printf(" Set Oversampling Ratio \r\n" );
+    pht_set_ratio( &pht, PHT_PT_CMD_RATIO_2048, PHT_PT_CMD_RATIO_2048);
+    Delay_ms( 100 );
+    printf("---------------------------- \r\n " );
+
+    if ( start == LIGHTRANGER5_START_COLD ) {
+
+        // Drive the Click site #1 EN pin low to hold the device in reset
+        mtk_os_hal_gpio_set_output((os_hal_gpio_pin)MIKROBUS_CLICK1_CS, OS_HAL_GPIO_DATA_LOW);
+
+        // Call the routine that will update the firmware
+        if ( lightranger5_update_firmware ( MIKROBUS_CLICK1_SDA, MIKROBUS_CLICK1_CS, 0x00,
+                                            LIGHTRANGER5_DOWNLOAD_I2C_SPEED, NULL) != LIGHTRANGER5_OK ) {
+            return false;
+        }
+    }
+
+    if ( !initialize_lightranger5( &lightranger5_cfg, &lightranger5, start ) ) {
+        return false;
+    }
+
+#ifdef LIGHTRANGER5_INT_GPIO
+
+    // The INT pin is active low, a result pending from before the handler was registered is picked up by the
+    // ranging thread's first pass
+    mtk_os_hal_gpio_set_direction((os_hal_gpio_pin)LIGHTRANGER5_INT_GPIO, OS_HAL_GPIO_DIR_INPUT);
+    mtk_os_hal_eint_register((eint_number)LIGHTRANGER5_INT_GPIO, HAL_EINT_EDGE_FALLING, lightranger5_int_handler);
+
+#endif
+
+    return true;
 }
 
 void display_status_no_error ( void ) {
@@ -735,12 +1192,37 @@ void display_status_error ( void ) {
 
 int getRange(void){
 
-    if ( lightranger5_check_data_ready( &lightranger5 ) == LIGHTRANGER5_DATA_IS_READY ) {
-        uint16_t distance_mm = lightranger5_measure_distance( &lightranger5 );
-        
-        if ( distance_mm ) {
-            return distance_mm;    
-        }    
+    IC_PHT_LIGHTRANGER5_RESULT rangerResult;
+
+    getRangerResult( &rangerResult );
+    return rangerResult.distance_mm;
+}
+
+// Copies the latest result the ranging thread collected, the distance is -1 if the result is too old or its
+// confidence is below the minimum set with IC_PHT_LIGHTRANGER5_SET_CONFIG
+void getRangerResult(IC_PHT_LIGHTRANGER5_RESULT* rangerResult){
+
+    uint8_t minConfidence;
+
+    tx_mutex_get(&calibration_mutex, TX_WAIT_FOREVER);
+    minConfidence = lightranger5Config.minConfidence;
+    tx_mutex_put(&calibration_mutex);
+
+    memset( rangerResult, 0, sizeof(*rangerResult) );
+    rangerResult->distance_mm = -1;
+
+    tx_mutex_get(&results_mutex, TX_WAIT_FOREVER);
+    if ( lightranger5ResultValid ) {
+
+        rangerResult->confidence = lightranger5Result.confidence;
+        rangerResult->resultNumber = lightranger5Result.result_number;
+        rangerResult->temperature = lightranger5Result.temperature;
+
+        if ( lightranger5Result.distance_mm && ( rangerResult->confidence >= minConfidence ) &&
+             ( ( tx_time_get() - lightranger5ResultTime ) <= 
+               ( RANGER_RESULT_MAX_AGE_MS * MT3620_TIMER_TICKS_PER_SECOND / 1000 ) ) ) {
+            rangerResult->distance_mm = lightranger5Result.distance_mm;
+        }
     }
-    return -1;
-}
\ No newline at end of file
+    tx_mutex_put(&results_mutex);
+}
@@ -62,6 +62,21 @@ extern "C"{
 #define PHT_RH_MEASURE_RH_HOLD                                     0xE5
 #define PHT_RH_MEASURE_RH_NO_HOLD                                  0xF5
 
+/**
+ * @brief PHT relative humidity resolution.
+ * @details User register resolution bits and maximum RH conversion times of PHT Click driver.
+ */
+#define PHT_RH_USER_REG_RESOLUTION_MASK                            0x81
+#define PHT_RH_USER_REG_RESOLUTION_12BIT                           0x00
+#define PHT_RH_USER_REG_RESOLUTION_11BIT                           0x81
+#define PHT_RH_USER_REG_RESOLUTION_10BIT                           0x80
+#define PHT_RH_USER_REG_RESOLUTION_8BIT                            0x01
+
+#define PHT_RH_CONV_TIME_12BIT_MS                                  16
+#define PHT_RH_CONV_TIME_11BIT_MS                                  9
+#define PHT_RH_CONV_TIME_10BIT_MS                                  5
+#define PHT_RH_CONV_TIME_8BIT_MS                                   3
+
 /**
  * @brief PHT Command for pressure and temperature.
  * @details Specified commands for pressure and temperature of PHT Click driver.
@@ -158,6 +173,22 @@ typedef struct
 
 } pht_cfg_t;
 
+/**
+ * @brief PHT compensation constants.
+ * @details PROM coefficients scaled for the integer compensation of PHT Click driver,
+ * computed once when pht_reset reads the PROM.
+ */
+typedef struct
+{
+    int64_t sens;           /**< C1 * 2^16 */
+    int64_t off;            /**< C2 * 2^17 */
+    int32_t tcs;            /**< C3 */
+    int32_t tco;            /**< C4 */
+    int32_t temp_ref;       /**< C5 * 2^8 */
+    int32_t temp_sens;      /**< C6 */
+
+} pht_prom_const_t;
+
 /**
  * @brief PHT Click return value data.
  * @details Predefined enum values for driver return values.
@@ -356,6 +387,28 @@ uint8_t pht_measure_rh ( pht_t *ctx, uint16_t *rh_data );
  */
 void pht_get_temperature_pressure ( pht_t *ctx, float *temperature, float *pressure );
 
+/**
+ * @brief Temperature and pressure compensation function.
+ * @details The function applies the first and second order compensation of the
+ * MS8607 datasheet to raw ADC results in 64-bit integer math. It does not touch
+ * the bus or any shared state so it can run in any context.
+ * @param[in] prom : Compensation constants, see #pht_get_prom_const.
+ * @param[in] adc_temp : Raw temperature (D2).
+ * @param[in] adc_press : Raw pressure (D1).
+ * @param[out] temperature : Temperature in 0.01 degrees Celsius.
+ * @param[out] pressure : Pressure in 0.01 mBar.
+ * @return Nothing.
+ */
+void pht_compensate ( const pht_prom_const_t *prom, uint32_t adc_temp, uint32_t adc_press, 
+                      int32_t *temperature, int32_t *pressure );
+
+/**
+ * @brief Get compensation constants function.
+ * @details The function returns the compensation constants computed from the PROM by #pht_reset.
+ * @return Compensation constants.
+ */
+const pht_prom_const_t *pht_get_prom_const ( void );
+
 /**
  * @brief Get humidity function.
  * @details The function performs humidity measurements
@@ -370,6 +423,25 @@ void pht_get_temperature_pressure ( pht_t *ctx, float *temperature, float *press
  */
 void pht_get_relative_humidity ( pht_t *ctx, float *humidity );
 
+/**
+ * @brief Get temperature, pressure and humidity function.
+ * @details The function measures temperature, pressure and humidity
+ * of MS8607 PHT ( Pressure, Humidity and Temperature ) Combination Sensor
+ * on the PHT click board. The humidity conversion runs on the RH die while
+ * the P&T die converts temperature and pressure, so a full sample takes the
+ * longer of the two instead of their sum.
+ * @param[in] ctx : Click context object.
+ * See #pht_t object definition for detailed explanation.
+ * @param[out] temperature : Pointer to the memory location where temperature (degrees Celsius) be stored.
+ * @param[out] pressure : Pointer to the memory location where pressure (mBar) be stored.
+ * @param[out] humidity : Pointer to the memory location where humidity (percentage) be stored.
+ * @return @li @c  0 - Success,
+ *         @li @c -1 - Error, one of the transfers failed and the results aren't valid.
+ *
+ * See #err_t definition for detailed explanation.
+ */
+err_t pht_get_measurement ( pht_t *ctx, float *temperature, float *pressure, float *humidity );
+
 #ifdef __cplusplus
 }
 #endif
@@ -323,8 +323,7 @@ void tx_thread_mbox_entry(ULONG thread_input)
 
                         if(hardwareInitOK){
                             // Read the sensor data
-                            pht_get_temperature_pressure ( &pht, &temperature, &pressure);
-                            pht_get_relative_humidity ( &pht, &humidity);
+                            pht_get_measurement(&pht, &temperature, &pressure, &humidity);
 
                             payloadPtrOutgoing->payload.temp = temperature;
                             payloadPtrOutgoing->payload.pressure = pressure;
@@ -494,8 +493,7 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
     if(hardwareInitOK){
         
         // Read the sensor data
-        pht_get_temperature_pressure(&pht, &temperature, &pressure);
-        pht_get_relative_humidity(&pht, &humidity);
+        pht_get_measurement(&pht, &temperature, &pressure, &humidity);
 
         payloadPtrOutgoing->payload.temp = temperature;
         payloadPtrOutgoing->payload.pressure = pressure;
@@ -0,0 +1,58 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Benchmark for the MS8607 integer compensation: host time per pht_compensate() call over raw values spread
+// across the operating range, next to the datasheet formulas in double precision.  These are host times,
+// on the M4 the 64 bit multiplies and shifts are what the integer path costs.
+
+#include "host_test.h"
+#include "pht_reference.h"
+
+#define SAMPLES 4096
+#define PASSES 2000
+
+static uint32_t d1[SAMPLES];
+static uint32_t d2[SAMPLES];
+
+static volatile int64_t sink;
+
+// Called through pointers so neither is inlined into the loop
+static void (*volatile compensate)(const pht_prom_const_t*, uint32_t, uint32_t, int32_t*, int32_t*) = pht_compensate;
+static void (*volatile reference)(const uint32_t*, double, double, double*, double*) = pht_reference_compensate;
+
+int main(void)
+{
+    pht_prom_const_t prom = pht_reference_prom(pht_datasheet_c);
+    int64_t acc = 0;
+    double accDouble = 0.0;
+
+    for (int i = 0; i < SAMPLES; i++) {
+        d2[i] = pht_reference_d2(pht_datasheet_c, -4000 + (12500.0 * i) / SAMPLES);
+        d1[i] = pht_reference_d1(pht_datasheet_c, d2[i], 1000 + ((i * 7919) % SAMPLES) * 199000.0 / SAMPLES);
+    }
+
+    double start = host_time_ns();
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (int i = 0; i < SAMPLES; i++) {
+            int32_t temperature, pressure;
+            compensate(&prom, d2[i], d1[i], &temperature, &pressure);
+            acc += temperature + pressure;
+        }
+    }
+    double integer = (host_time_ns() - start) / ((double)PASSES * SAMPLES);
+
+    start = host_time_ns();
+    for (int pass = 0; pass < PASSES; pass++) {
+        for (int i = 0; i < SAMPLES; i++) {
+            double temperature, pressure;
+            reference(pht_datasheet_c, d2[i], d1[i], &temperature, &pressure);
+            accDouble += temperature + pressure;
+        }
+    }
+    double exact = (host_time_ns() - start) / ((double)PASSES * SAMPLES);
+
+    printf("pht_compensate %.1f ns, double precision reference %.1f ns per sample on the host\n", integer, exact);
+
+    sink = acc + (int64_t)accDouble;
+    return 0;
+}
@@ -0,0 +1,74 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// The MS8607 pressure and temperature compensation from the datasheet, evaluated in double precision to
+// check the driver's integer pht_compensate() against.  The only rounding kept is the first order TEMP, a 32
+// bit integer in the datasheet that the second order terms are computed from; everything else is exact.
+// pht_reference_prom() scales the PROM coefficients the way pht_reset() does.
+
+#include <math.h>
+#include <stdint.h>
+#include "pht.h"
+
+// The datasheet example part: C1..C6
+static const uint32_t pht_datasheet_c[6] = {46372, 43981, 29059, 27842, 31553, 28165};
+
+static inline pht_prom_const_t pht_reference_prom(const uint32_t c[6])
+{
+    pht_prom_const_t prom;
+
+    prom.sens = (int64_t)c[0] << 16;
+    prom.off = (int64_t)c[1] << 17;
+    prom.tcs = (int32_t)c[2];
+    prom.tco = (int32_t)c[3];
+    prom.temp_ref = (int32_t)c[4] << 8;
+    prom.temp_sens = (int32_t)c[5];
+    return prom;
+}
+
+// Temperature in 0.01C and pressure in 0.01mbar, first and second order
+static inline void pht_reference_compensate(const uint32_t c[6], double d2, double d1, double* temperature,
+                                            double* pressure)
+{
+    double dT = d2 - c[4] * 256.0;
+    double temp = 2000.0 + floor(dT * c[5] / 8388608.0);
+    double off = c[1] * 131072.0 + c[3] * dT / 64.0;
+    double sens = c[0] * 65536.0 + c[2] * dT / 128.0;
+    double t2, off2, sens2;
+
+    if (temp < 2000.0) {
+        t2 = 3.0 * dT * dT / 8589934592.0;
+        off2 = 61.0 * (temp - 2000.0) * (temp - 2000.0) / 16.0;
+        sens2 = 29.0 * (temp - 2000.0) * (temp - 2000.0) / 16.0;
+        if (temp < -1500.0) {
+            off2 += 17.0 * (temp + 1500.0) * (temp + 1500.0);
+            sens2 += 9.0 * (temp + 1500.0) * (temp + 1500.0);
+        }
+    }
+    else {
+        t2 = 5.0 * dT * dT / 274877906944.0;
+        off2 = 0.0;
+        sens2 = 0.0;
+    }
+
+    *temperature = temp - t2;
+    *pressure = (d1 * (sens - sens2) / 2097152.0 - (off - off2)) / 32768.0;
+}
+
+// The raw D2 that gives a first order temperature of temp (0.01C) and the D1 that then gives pressure
+// (0.01mbar), both before the second order correction
+static inline uint32_t pht_reference_d2(const uint32_t c[6], double temp)
+{
+    return (uint32_t)lround(c[4] * 256.0 + (temp - 2000.0) * 8388608.0 / c[5]);
+}
+
+static inline uint32_t pht_reference_d1(const uint32_t c[6], uint32_t d2, double pressure)
+{
+    double dT = d2 - c[4] * 256.0;
+    double off = c[1] * 131072.0 + c[3] * dT / 64.0;
+    double sens = c[0] * 65536.0 + c[2] * dT / 128.0;
+
+    return (uint32_t)lround((pressure * 32768.0 + off) * 2097152.0 / sens);
+}
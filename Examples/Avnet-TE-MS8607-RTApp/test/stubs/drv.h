@@ -0,0 +1,10 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// The mikroSDK delay the PHT Click driver uses, defined in drv_stubs.c
+
+#include "drv_i2c_master.h"
+
+void Delay_10ms(void);
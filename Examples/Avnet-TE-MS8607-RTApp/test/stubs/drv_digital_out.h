@@ -0,0 +1,8 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Included by the PHT Click driver, nothing in it is used by the host tests
+
+#include "drv_i2c_master.h"
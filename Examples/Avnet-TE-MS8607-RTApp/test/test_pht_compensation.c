@@ -0,0 +1,87 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for the MS8607 integer compensation in pht_compensate(): the datasheet example, and a sweep over
+// the operating range of the part, -40..85C and 10..2000mbar, against the datasheet formulas evaluated in
+// double precision (pht_reference.h).  The sweep crosses into both second order corrections, below 20C and
+// below -15C.
+
+#include "host_test.h"
+#include "pht_reference.h"
+
+// D1 = 6465444 and D2 = 8077636 give 20.00C and 1100.02mbar
+static void test_datasheet(void)
+{
+    pht_prom_const_t prom = pht_reference_prom(pht_datasheet_c);
+    int32_t temperature, pressure;
+
+    pht_compensate(&prom, 8077636, 6465444, &temperature, &pressure);
+    CHECK(temperature == 2000);
+    CHECK(pressure == 110002);
+}
+
+// The integer result stays within 1 LSB of the exact one, 0.01C and 0.01mbar, in all three temperature ranges.
+// The final shifts truncate, the intermediate ones add a few hundredths of an LSB on top.
+static void test_sweep(void)
+{
+    pht_prom_const_t prom = pht_reference_prom(pht_datasheet_c);
+    double maxTemperatureError = 0.0, maxPressureError = 0.0;
+    int cold = 0, veryCold = 0, points = 0;
+
+    for (int temp = -4000; temp <= 8500; temp += 25) {
+
+        uint32_t d2 = pht_reference_d2(pht_datasheet_c, temp);
+
+        for (int press = 1000; press <= 200000; press += 500) {
+
+            uint32_t d1 = pht_reference_d1(pht_datasheet_c, d2, press);
+            double expectedTemperature, expectedPressure;
+            int32_t temperature, pressure;
+
+            pht_reference_compensate(pht_datasheet_c, d2, d1, &expectedTemperature, &expectedPressure);
+            pht_compensate(&prom, d2, d1, &temperature, &pressure);
+
+            maxTemperatureError = fmax(maxTemperatureError, fabs(temperature - expectedTemperature));
+            maxPressureError = fmax(maxPressureError, fabs(pressure - expectedPressure));
+            points++;
+        }
+
+        cold += (temp < 2000);
+        veryCold += (temp < -1500);
+    }
+
+    printf("%d points, max error %.2f (0.01C) %.2f (0.01mbar)\n", points, maxTemperatureError, maxPressureError);
+
+    CHECK(cold > 0 && veryCold > 0);
+    CHECK(maxTemperatureError < 1.05);
+    CHECK(maxPressureError < 1.05);
+}
+
+// Second order matters: at -20C the first order result alone is tenths of a degree and millibars off
+static void test_second_order(void)
+{
+    pht_prom_const_t prom = pht_reference_prom(pht_datasheet_c);
+    uint32_t d2 = pht_reference_d2(pht_datasheet_c, -2000);
+    uint32_t d1 = pht_reference_d1(pht_datasheet_c, d2, 101325);
+    double expectedTemperature, expectedPressure;
+    int32_t temperature, pressure;
+
+    pht_reference_compensate(pht_datasheet_c, d2, d1, &expectedTemperature, &expectedPressure);
+    pht_compensate(&prom, d2, d1, &temperature, &pressure);
+
+    CHECK_NEAR(temperature, expectedTemperature, 1.0);
+    CHECK_NEAR(pressure, expectedPressure, 1.0);
+
+    // The first order values are the sweep's inputs, -20.00C and 1013.25mbar
+    CHECK(fabs(temperature - -2000) > 10);
+    CHECK(fabs(pressure - 101325) > 100);
+}
+
+int main(void)
+{
+    test_datasheet();
+    test_sweep();
+    test_second_order();
+
+    return host_test_result("pht_compensation");
+}
@@ -19,3 +19,17 @@
 #if defined(CLICK_SOCKET_1) && defined(CLICK_SOCKET_2)
 #error "Invalid configuration, only one CLICK socket can be defined!"
 #endif
+
+// I2C speed used while the TMF8801 firmware image is downloaded.  Nothing else on the click I2C bus is used
+// by this application so the download runs at Fast-mode Plus (1MHz), use I2C_MASTER_SPEED_FULL (400KHz) if
+// another device on the ISU doesn't support Fast-mode Plus
+#define LIGHTRANGER5_DOWNLOAD_I2C_SPEED I2C_MASTER_SPEED_FAST
+
+// LightRanger5 Interrupt Selection
+// The TMF8801 drives its INT pin low when a new distance result is ready.  If INT is wired to an MT3620 GPIO
+// that supports external interrupts (GPIO0 - GPIO23), define LIGHTRANGER5_INT_GPIO as that GPIO number and add
+// it to the "Gpio" capability in app_manifest.json.  The ranging thread then only reads the sensor when INT
+// falls.  Otherwise the ranging thread polls the sensor every 20ms.  On the Rev1 board both click sockets use
+// GPIO2, on the Rev2 board click socket #1 uses GPIO5 and click socket #2 (GPIO34) does not support external
+// interrupts.
+//#define LIGHTRANGER5_INT_GPIO 2     // Click socket INT pin (Rev1 board)
@@ -28,6 +28,7 @@
 #include "lightranger5.h"
 #include "tx_api.h"
 #include "tof_bin_image.h"
+#include <string.h>
 
 // ---------------------------------------------- PRIVATE FUNCTION DECLARATIONS 
 
@@ -37,6 +38,12 @@
  */
 static void dev_reset_delay ( void );
 
+/**
+ * @brief Single register write.
+ * @details Writes one data byte, the frame is built on the stack.
+ */
+static err_t dev_write_register ( lightranger5_t *ctx, uint8_t reg, uint8_t data );
+
 // ------------------------------------------------ PUBLIC FUNCTION DEFINITIONS
 
 void lightranger5_cfg_setup ( lightranger5_cfg_t *cfg ) {
@@ -110,21 +117,51 @@ err_t lightranger5_default_cfg ( lightranger5_t *ctx ) {
     return LIGHTRANGER5_OK;
 }
 
-err_t lightranger5_generic_write ( lightranger5_t *ctx, uint8_t reg, uint8_t *tx_buf, uint8_t tx_len ) {
-    uint8_t data_buf[ 257 ];
-    uint8_t cnt;
+// With OSAI_ENABLE_DMA the MT3620 I2C driver moves transfers longer than its FIFO with DMA, and the DMA engine
+// can't reach TCM (thread stacks and .bss).  Writes that fit the FIFO are built on the stack, longer ones are
+// sent straight out of a frame the caller keeps in SYSRAM with the register address in front of the data, like
+// bl_frame, so no write is copied.  Reads go straight into the caller's buffer when it is in SYSRAM
+// (hist_block, bl_response) and bounce through i2c_frame otherwise.  Like bl_frame i2c_frame is shared by every
+// LightRanger5, the callers already serialize the bus.
+#define SYSRAM_START 0x22000000UL
+#define SYSRAM_END   0x22010000UL
+#define IN_SYSRAM( buf, len ) ( ( ( uintptr_t )( buf ) >= SYSRAM_START ) && ( ( uintptr_t )( buf ) + ( len ) <= SYSRAM_END ) )
 
-    data_buf[ 0 ] = reg;
+static uint8_t i2c_frame[ 255 ] __attribute__( ( section( ".sysram" ) ) );
+static uint8_t i2c_reg __attribute__( ( section( ".sysram" ) ) );
 
-    for ( cnt = 1; cnt <= tx_len; cnt++ ) {
-        data_buf[ cnt ] = tx_buf[ cnt - 1 ];
+err_t lightranger5_generic_write ( lightranger5_t *ctx, uint8_t reg, uint8_t *tx_buf, uint8_t tx_len ) {
+    uint8_t frame[ LIGHTRANGER5_I2C_FIFO_SIZE ];
+
+    // Longer writes go by DMA, see lightranger5_write_frame()
+    if ( LIGHTRANGER5_FRAME_SIZE( tx_len ) > LIGHTRANGER5_I2C_FIFO_SIZE ) {
+        return I2C_MASTER_ERROR;
     }
 
-    return i2c_master_write( &ctx->i2c, data_buf, tx_len + 1 );
+    frame[ 0 ] = reg;
+    memcpy( &frame[ 1 ], tx_buf, tx_len );
+
+    return i2c_master_write( &ctx->i2c, frame, LIGHTRANGER5_FRAME_SIZE( tx_len ) );
+}
+
+err_t lightranger5_write_frame ( lightranger5_t *ctx, uint8_t *frame, uint8_t len ) {
+    return i2c_master_write( &ctx->i2c, frame, len );
 }
 
 err_t lightranger5_generic_read ( lightranger5_t *ctx, uint8_t reg, uint8_t *rx_buf, uint8_t rx_len ) {
-    return i2c_master_write_then_read( &ctx->i2c, &reg, 1, rx_buf, rx_len );
+    err_t error_flag;
+
+    i2c_reg = reg;
+
+    if ( IN_SYSRAM( rx_buf, rx_len ) ) {
+        return i2c_master_write_then_read( &ctx->i2c, &i2c_reg, 1, rx_buf, rx_len );
+    }
+
+    error_flag = i2c_master_write_then_read( &ctx->i2c, &i2c_reg, 1, i2c_frame, rx_len );
+    if ( error_flag == I2C_MASTER_SUCCESS ) {
+        memcpy( rx_buf, i2c_frame, rx_len );
+    }
+    return error_flag;
 }
 
 err_t lightranger5_enable_device ( lightranger5_t *ctx ) {
@@ -219,13 +256,16 @@ err_t lightranger5_get_status ( lightranger5_t *ctx, uint8_t *status ) {
 }
 
 err_t lightranger5_set_command ( lightranger5_t *ctx, uint8_t cmd ) {
-    err_t error_flag = lightranger5_generic_write( ctx, LIGHTRANGER5_REG_STATUS, &cmd, 1 );
+    err_t error_flag = dev_write_register( ctx, LIGHTRANGER5_REG_STATUS, cmd );
     
     return error_flag;
 }
 
-err_t lightranger5_set_factory_calib_data ( lightranger5_t *ctx, uint8_t *factory_calib_data ) {
-    err_t error_flag = lightranger5_generic_write( ctx, LIGHTRANGER5_REG_FACTORY_CALIB_0, factory_calib_data, 14 );
+err_t lightranger5_set_factory_calib_data ( lightranger5_t *ctx, uint8_t *factory_calib_frame ) {
+    factory_calib_frame[ 0 ] = LIGHTRANGER5_REG_FACTORY_CALIB_0;
+
+    err_t error_flag = lightranger5_write_frame( ctx, factory_calib_frame,
+                                                 LIGHTRANGER5_FRAME_SIZE( LIGHTRANGER5_FACTORY_CALIB_SIZE ) );
     
     return error_flag;
 }
@@ -236,20 +276,25 @@ err_t lightranger5_get_factory_calib_data ( lightranger5_t *ctx, uint8_t *factor
     return error_flag;
 }
 
-err_t lightranger5_set_algorithm_state_data ( lightranger5_t *ctx, uint8_t *alg_state_data ) {
-    err_t error_flag = lightranger5_generic_write( ctx, LIGHTRANGER5_REG_STATE_DATA_WR_0, alg_state_data, 11 );
+err_t lightranger5_set_algorithm_state_data ( lightranger5_t *ctx, uint8_t *alg_state_frame ) {
+    alg_state_frame[ 0 ] = LIGHTRANGER5_REG_STATE_DATA_WR_0;
+
+    err_t error_flag = lightranger5_write_frame( ctx, alg_state_frame,
+                                                 LIGHTRANGER5_FRAME_SIZE( LIGHTRANGER5_ALGO_STATE_SIZE ) );
     
     return error_flag;
 }
 
-err_t lightranger5_set_command_data ( lightranger5_t *ctx, uint8_t *cmd_data ) {
-    err_t error_flag = lightranger5_generic_write( ctx, LIGHTRANGER5_REG_CMD_DATA7, cmd_data, 9 );
+err_t lightranger5_set_command_data ( lightranger5_t *ctx, uint8_t *cmd_frame ) {
+    cmd_frame[ 0 ] = LIGHTRANGER5_REG_CMD_DATA7;
+
+    err_t error_flag = lightranger5_write_frame( ctx, cmd_frame, LIGHTRANGER5_FRAME_SIZE( LIGHTRANGER5_CMD_DATA_SIZE ) );
     
     return error_flag;
 }
 
 err_t lightranger5_check_previous_command ( lightranger5_t *ctx, uint8_t *previous_cmd ) {   
-    err_t error_flag = lightranger5_generic_write( ctx, LIGHTRANGER5_REG_PREVIOUS, previous_cmd, 1 );
+    err_t error_flag = lightranger5_generic_read( ctx, LIGHTRANGER5_REG_PREVIOUS, previous_cmd, 1 );
     
     return error_flag;
 }
@@ -260,6 +305,42 @@ err_t lightranger5_get_currently_run_app ( lightranger5_t *ctx, uint8_t *appid_d
     return error_flag;
 }
 
+err_t lightranger5_get_app_version ( lightranger5_t *ctx, uint8_t *appid, uint8_t *version ) {
+    uint8_t rx_buf[ 2 ];
+
+    // APPID and APPREV_MAJOR are next to each other, minor and patch are at 0x12 and 0x13
+    if ( ( lightranger5_generic_read( ctx, LIGHTRANGER5_REG_APPID, rx_buf, 2 ) != I2C_MASTER_SUCCESS ) ||
+         ( lightranger5_generic_read( ctx, LIGHTRANGER5_REG_APPREV_MINOR, &version[ 1 ], 2 ) != I2C_MASTER_SUCCESS ) ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    *appid = rx_buf[ 0 ];
+    version[ 0 ] = rx_buf[ 1 ];
+
+    return LIGHTRANGER5_OK;
+}
+
+lightranger5_start_t lightranger5_check_warm_start ( lightranger5_t *ctx, const uint8_t *expected_version ) {
+    uint8_t appid;
+    uint8_t version[ LIGHTRANGER5_APP_VERSION_SIZE ];
+    uint8_t previous_cmd;
+
+    // A device that doesn't answer, is in the bootloader or runs another image version needs a download
+    if ( ( lightranger5_get_app_version( ctx, &appid, version ) != LIGHTRANGER5_OK ) ||
+         ( appid != LIGHTRANGER5_APPID_MEASUREMENT ) ||
+         ( ( expected_version != NULL ) && memcmp( version, expected_version, LIGHTRANGER5_APP_VERSION_SIZE ) ) ) {
+        return LIGHTRANGER5_START_COLD;
+    }
+
+    // The last command the measurement app executed tells if the periodic measurement is running
+    if ( ( lightranger5_check_previous_command( ctx, &previous_cmd ) != LIGHTRANGER5_OK ) ||
+         ( previous_cmd != LIGHTRANGER5_CMD_DISTANCE_MEASURE_MODE_1 ) ) {
+        return LIGHTRANGER5_START_IMAGE_LOADED;
+    }
+
+    return LIGHTRANGER5_START_WARM;
+}
+
 lightranger5_return_data_ready_t lightranger5_check_data_ready ( lightranger5_t *ctx ) {
     uint8_t rx_buf;
     
@@ -289,34 +370,351 @@ uint8_t lightranger5_check_int ( lightranger5_t *ctx ) {
     return digital_in_read( &ctx->int_pin );
 }
 
+// Sets or clears one INT_ENAB bit, the other interrupt keeps its setting.  A pending interrupt is cleared first.
+static err_t set_interrupt_enable ( lightranger5_t *ctx, uint8_t bit, bool enable ) {
+    uint8_t reg_tmp;
+
+    if ( dev_write_register( ctx, LIGHTRANGER5_REG_INT_STATUS, bit ) != I2C_MASTER_SUCCESS ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    if ( lightranger5_generic_read( ctx, LIGHTRANGER5_REG_INT_ENAB, &reg_tmp, 1 ) != I2C_MASTER_SUCCESS ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    reg_tmp = enable ? ( reg_tmp | bit ) : ( reg_tmp & ~bit );
+    if ( dev_write_register( ctx, LIGHTRANGER5_REG_INT_ENAB, reg_tmp ) != I2C_MASTER_SUCCESS ) {
+        return LIGHTRANGER5_ERROR;
+    }
+    
+    return LIGHTRANGER5_OK;
+}
+
+err_t lightranger5_enable_result_interrupt ( lightranger5_t *ctx, bool enable ) {
+    return set_interrupt_enable( ctx, LIGHTRANGER5_INT_RESULT, enable );
+}
+
+err_t lightranger5_read_result ( lightranger5_t *ctx, lightranger5_result_t *result ) {
+    uint8_t rx_buf[ LIGHTRANGER5_RESULT_BLOCK_SIZE ];
+    uint8_t int_status;
+
+    if ( lightranger5_generic_read( ctx, LIGHTRANGER5_REG_INT_STATUS, &int_status, 1 ) != I2C_MASTER_SUCCESS ) {
+        return LIGHTRANGER5_ERROR;
+    }
+    if ( !( int_status & LIGHTRANGER5_INT_RESULT ) ) {
+        return 0;
+    }
+
+    // Write the bit back to clear it, then read REGISTER_CONTENTS up to OBJECT_HITS_3
+    if ( ( dev_write_register( ctx, LIGHTRANGER5_REG_INT_STATUS, LIGHTRANGER5_INT_RESULT ) != I2C_MASTER_SUCCESS ) ||
+         ( lightranger5_generic_read( ctx, LIGHTRANGER5_REG_REGISTER_CONTENTS, rx_buf, sizeof( rx_buf ) ) != I2C_MASTER_SUCCESS ) ||
+         ( rx_buf[ 0 ] != LIGHTRANGER5_CMD_RESULT ) ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+#define RESULT_BYTE( reg )  rx_buf[ ( reg ) - LIGHTRANGER5_REG_REGISTER_CONTENTS ]
+#define RESULT_U32( reg )   ( ( uint32_t )RESULT_BYTE( reg ) | ( ( uint32_t )RESULT_BYTE( ( reg ) + 1 ) << 8 ) | \
+                              ( ( uint32_t )RESULT_BYTE( ( reg ) + 2 ) << 16 ) | ( ( uint32_t )RESULT_BYTE( ( reg ) + 3 ) << 24 ) )
+
+    result->result_number = RESULT_BYTE( LIGHTRANGER5_REG_RESULT_NUMBER );
+    result->confidence = RESULT_BYTE( LIGHTRANGER5_REG_RESULT_INFO ) & 0x3F;
+    result->status = RESULT_BYTE( LIGHTRANGER5_REG_RESULT_INFO ) >> 6;
+    result->distance_mm = ( uint16_t )RESULT_BYTE( LIGHTRANGER5_REG_DISTANCE_PEAK_0 ) |
+                          ( ( uint16_t )RESULT_BYTE( LIGHTRANGER5_REG_DISTANCE_PEAK_1 ) << 8 );
+    result->sys_clock = RESULT_U32( LIGHTRANGER5_REG_SYS_CLOCK_0 );
+    result->temperature = ( int8_t )RESULT_BYTE( LIGHTRANGER5_REG_STATE_DATA_10_TJ );
+    result->reference_hits = RESULT_U32( LIGHTRANGER5_REG_REFERENCE_HITS_0 );
+    result->object_hits = RESULT_U32( LIGHTRANGER5_REG_OBJECT_HITS_0 );
+
+#undef RESULT_BYTE
+#undef RESULT_U32
+
+    return 1;
+}
+
+void lightranger5_measure_cfg_setup ( lightranger5_measure_cfg_t *cfg ) {
+    cfg->calibration = LIGHTRANGER5_MEASURE_CALIB_FACTORY | LIGHTRANGER5_MEASURE_CALIB_ALGO_STATE;
+    cfg->algorithm = LIGHTRANGER5_MEASURE_ALGO_DEFAULT;
+    cfg->period_ms = LIGHTRANGER5_MEASURE_PERIOD_DEFAULT_MS;
+    cfg->kilo_iterations = LIGHTRANGER5_MEASURE_KILO_ITERATIONS_DEFAULT;
+}
+
+err_t lightranger5_start_measurement ( lightranger5_t *ctx, const lightranger5_measure_cfg_t *cfg ) {
+    
+    // CMD_DATA7 to CMD_DATA1, GPIO control (CMD_DATA5) and CMD_DATA4/3 stay 0.  The command registers only
+    // latch, the measurement starts with the COMMAND write, so the frame is split in two that each fit the I2C
+    // FIFO and are built on the stack.
+    uint8_t cmd_frame[ LIGHTRANGER5_I2C_FIFO_SIZE ] = { LIGHTRANGER5_REG_CMD_DATA7, cfg->calibration, cfg->algorithm,
+                                                        0x00, 0x00, 0x00, cfg->period_ms,
+                                                        ( uint8_t )( cfg->kilo_iterations & 0xFF ) };
+    uint8_t command_frame[ 3 ] = { LIGHTRANGER5_REG_CMD_DATA0, ( uint8_t )( cfg->kilo_iterations >> 8 ),
+                                   LIGHTRANGER5_CMD_DISTANCE_MEASURE_MODE_1 };
+
+    if ( lightranger5_write_frame( ctx, cmd_frame, sizeof( cmd_frame ) ) != I2C_MASTER_SUCCESS ) {
+        return I2C_MASTER_ERROR;
+    }
+    return lightranger5_write_frame( ctx, command_frame, sizeof( command_frame ) );
+}
+
+err_t lightranger5_stop_measurement ( lightranger5_t *ctx ) {
+    uint8_t reg_tmp;
+    ULONG start = tx_time_get( );
+
+    if ( dev_write_register( ctx, LIGHTRANGER5_REG_COMMAND, LIGHTRANGER5_CMD_STOP_MEASUREMENT ) != I2C_MASTER_SUCCESS ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    do {
+        if ( ( lightranger5_check_previous_command( ctx, &reg_tmp ) == I2C_MASTER_SUCCESS ) &&
+             ( reg_tmp == LIGHTRANGER5_CMD_STOP_MEASUREMENT ) ) {
+            return LIGHTRANGER5_OK;
+        }
+        tx_thread_sleep( 1 );
+    } while ( ( tx_time_get( ) - start ) < LIGHTRANGER5_BOOT_TIMEOUT_MS );
+
+    return LIGHTRANGER5_ERROR;
+}
+
 // ----------------------------------------------- PRIVATE FUNCTION DEFINITIONS
 
 static void dev_reset_delay ( void ) {
     tx_thread_sleep(100);
 }
 
+static err_t dev_write_register ( lightranger5_t *ctx, uint8_t reg, uint8_t data ) {
+    uint8_t frame[ 2 ] = { reg, data };
+
+    return i2c_master_write( &ctx->i2c, frame, sizeof( frame ) );
+}
+
 // ------------------------------------------------------------------------- END
 
 
-void waitForReadyStatus(lightranger5_t* ctx){
+// ------------------------------------------------------------ FIRMWARE DOWNLOAD
 
-    uint8_t readBuf[4] = {0x00};
-        
-    do{
+// Bootloader command frame, built in place after the register address so a whole W_RAM record goes out
+// with a single i2c_master_write() and doesn't need another copy on the (small) thread stack.  Both buffers
+// are in SYSRAM so the records and the read back go through DMA without a copy.
+static uint8_t bl_frame[ 1 + 2 + LIGHTRANGER5_BL_MAX_DATA_SIZE + 1 ] __attribute__( ( section( ".sysram" ) ) );
 
-        // Read back Status register (should read back as 00 00 FF )
-        // S 41 W 08 Sr 41 R A A N P 
-        lightranger5_generic_read (ctx, LIGHTRANGER5_REG_CMD_DATA7, readBuf, 3);
+#ifdef LIGHTRANGER5_VERIFY_DOWNLOAD
+static uint8_t bl_response[ 2 + LIGHTRANGER5_BL_MAX_DATA_SIZE + 1 ] __attribute__( ( section( ".sysram" ) ) );
+#endif
+
+static uint8_t bl_checksum ( const uint8_t *data, uint16_t len ) {
+    uint8_t sum = 0;
 
+    while ( len-- ) {
+        sum += *data++;
     }
-    while ((readBuf[0] != 0x00) || (readBuf[1] != 0x00) || (readBuf[2] != 0xFF));
+    return sum ^ 0xFF;
 }
 
-err_t lightranger5_update_firmware ( i2c_num isu, pin_name_t en, uint8_t new_i2c_address){
-    
-    uint8_t readBuf[64] = {0x00};
-    const uint8_t* imagePtr = NULL;
+// Bounded backoff used by all the polls below.  The first polls are back to back, the TMF8801 normally
+// finishes a bootloader command in less time than it takes to read the status back.  After that the thread
+// sleeps 1, 2, 4 and then 8 ticks between polls.  Returns false once timeout_ms (1 tick = 1ms) is up.
+static bool poll_backoff ( ULONG start, uint32_t timeout_ms, uint32_t *poll, lightranger5_download_stats_t *stats ) {
+
+    if ( ( tx_time_get( ) - start ) >= timeout_ms ) {
+        return false;
+    }
+
+    if ( *poll >= LIGHTRANGER5_POLL_SPIN_COUNT ) {
+        uint32_t shift = *poll - LIGHTRANGER5_POLL_SPIN_COUNT;
+        tx_thread_sleep( 1UL << ( ( shift < 3 ) ? shift : 3 ) );
+    }
+
+    ( *poll )++;
+    if ( stats != NULL ) {
+        stats->busy_polls++;
+    }
+    return true;
+}
+
+// Polls a register until ( value & mask ) == expected, reads that fail (the device NAKs while it resets)
+// are retried the same way
+static err_t poll_register ( lightranger5_t *ctx, uint8_t reg, uint8_t mask, uint8_t expected,
+                             uint32_t timeout_ms, lightranger5_download_stats_t *stats ) {
+    ULONG start = tx_time_get( );
+    uint32_t poll = 0;
+    uint8_t reg_tmp;
+
+    do {
+        if ( ( lightranger5_generic_read( ctx, reg, &reg_tmp, 1 ) == I2C_MASTER_SUCCESS ) &&
+             ( ( reg_tmp & mask ) == expected ) ) {
+            return LIGHTRANGER5_OK;
+        }
+    } while ( poll_backoff( start, timeout_ms, &poll, stats ) );
+
+    return LIGHTRANGER5_ERROR;
+}
+
+// Sends one bootloader command, data can be NULL if len is 0
+static err_t bl_send_command ( lightranger5_t *ctx, uint8_t cmd, const uint8_t *data, uint8_t len ) {
+
+    bl_frame[ 0 ] = LIGHTRANGER5_REG_CMD_DATA7;
+    bl_frame[ 1 ] = cmd;
+    bl_frame[ 2 ] = len;
+    if ( len ) {
+        memcpy( &bl_frame[ 3 ], data, len );
+    }
+    bl_frame[ 3 + len ] = bl_checksum( &bl_frame[ 1 ], len + 2 );
+
+    return i2c_master_write( &ctx->i2c, bl_frame, len + 4 );
+}
+
+// Waits for the bootloader to finish the last command and reads back status, size, data[size], checksum.
+// A status other than READY means the bootloader rejected the command (for example a W_RAM record with a
+// bad checksum), that fails straight away rather than waiting for the timeout.
+static err_t bl_wait_ready ( lightranger5_t *ctx, uint8_t *response, uint8_t size, lightranger5_download_stats_t *stats ) {
+    ULONG start = tx_time_get( );
+    uint32_t poll = 0;
+
+    do {
+        if ( lightranger5_generic_read( ctx, LIGHTRANGER5_REG_CMD_DATA7, response, size + 3 ) == I2C_MASTER_SUCCESS ) {
+
+            if ( response[ 0 ] < LIGHTRANGER5_BL_STATUS_BUSY ) {
+
+                if ( ( response[ 0 ] != LIGHTRANGER5_BL_STATUS_READY ) || ( response[ 1 ] != size ) ||
+                     ( response[ size + 2 ] != bl_checksum( response, size + 2 ) ) ) {
+                    return LIGHTRANGER5_ERROR;
+                }
+                return LIGHTRANGER5_OK;
+            }
+        }
+    } while ( poll_backoff( start, LIGHTRANGER5_BL_COMMAND_TIMEOUT_MS, &poll, stats ) );
+
+    return LIGHTRANGER5_ERROR;
+}
+
+static err_t bl_command ( lightranger5_t *ctx, uint8_t cmd, const uint8_t *data, uint8_t len,
+                          lightranger5_download_stats_t *stats ) {
+    uint8_t status[ 3 ];
+
+    if ( bl_send_command( ctx, cmd, data, len ) != I2C_MASTER_SUCCESS ) {
+        return LIGHTRANGER5_ERROR;
+    }
+    return bl_wait_ready( ctx, status, 0, stats );
+}
+
+// Streams tof_bin_image to RAM address 0 (0x2000_0000, only the lower 16-bits are used) in the largest
+// records the bootloader accepts.  The bootloader checks every record against its checksum and reports
+// a failure in the status read back, so a corrupted record stops the download at that record.
+static err_t bl_download_image ( lightranger5_t *ctx, lightranger5_download_stats_t *stats ) {
+    const uint8_t download_init[ ] = { LIGHTRANGER5_BL_DOWNLOAD_INIT_SEED };
+    const uint8_t ram_address[ ] = { 0x00, 0x00 };
+    uint32_t offset;
+    uint8_t len;
+
+    if ( bl_command( ctx, LIGHTRANGER5_BL_CMD_DOWNLOAD_INIT, download_init, sizeof( download_init ), stats ) ||
+         bl_command( ctx, LIGHTRANGER5_BL_CMD_ADDR_RAM, ram_address, sizeof( ram_address ), stats ) ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    // The last record carries whatever is left of the image
+    for ( offset = 0; offset < tof_bin_image_length; offset += len ) {
+
+        len = ( ( tof_bin_image_length - offset ) < LIGHTRANGER5_BL_MAX_DATA_SIZE ) ?
+              ( uint8_t )( tof_bin_image_length - offset ) : LIGHTRANGER5_BL_MAX_DATA_SIZE;
+
+        if ( bl_command( ctx, LIGHTRANGER5_BL_CMD_W_RAM, &tof_bin_image[ offset ], len, stats ) ) {
+            printf( "W_RAM failed at offset 0x%04lx\n", offset );
+            return LIGHTRANGER5_ERROR;
+        }
+        stats->records++;
+    }
+
+#ifdef LIGHTRANGER5_VERIFY_DOWNLOAD
+
+    // Read the image back from address 0 and compare it
+    if ( bl_command( ctx, LIGHTRANGER5_BL_CMD_ADDR_RAM, ram_address, sizeof( ram_address ), stats ) ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    for ( offset = 0; offset < tof_bin_image_length; offset += len ) {
+
+        len = ( ( tof_bin_image_length - offset ) < LIGHTRANGER5_BL_MAX_DATA_SIZE ) ?
+              ( uint8_t )( tof_bin_image_length - offset ) : LIGHTRANGER5_BL_MAX_DATA_SIZE;
+
+        if ( ( bl_send_command( ctx, LIGHTRANGER5_BL_CMD_R_RAM, &len, 1 ) != I2C_MASTER_SUCCESS ) ||
+             bl_wait_ready( ctx, bl_response, len, stats ) ||
+             memcmp( &bl_response[ 2 ], &tof_bin_image[ offset ], len ) ) {
+            printf( "Image verify failed at offset 0x%04lx\n", offset );
+            return LIGHTRANGER5_ERROR;
+        }
+    }
+    stats->verified = true;
+
+#endif // LIGHTRANGER5_VERIFY_DOWNLOAD
+
+    return LIGHTRANGER5_OK;
+}
+
+err_t lightranger5_bootloader_start ( lightranger5_t *ctx, lightranger5_download_stats_t *stats ) {
+    uint8_t appid[ 4 ];
+
+    // Reset the device so it's in the bootloader whatever it was doing, then wait for the CPU
+    dev_write_register( ctx, LIGHTRANGER5_REG_ENABLE, LIGHTRANGER5_ENABLE_RESET );
+    if ( poll_register( ctx, LIGHTRANGER5_REG_ENABLE, LIGHTRANGER5_BIT_CPU_RDY, LIGHTRANGER5_BIT_CPU_RDY,
+                        LIGHTRANGER5_BOOT_TIMEOUT_MS, stats ) ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    // Power on the oscillator, ENABLE reads back 0x41 (CPU_RDY | PON) once it's running
+    //S 41 W E0 01 P
+    dev_write_register( ctx, LIGHTRANGER5_REG_ENABLE, LIGHTRANGER5_BIT_PON );
+    if ( poll_register( ctx, LIGHTRANGER5_REG_ENABLE, 0xFF, LIGHTRANGER5_BIT_CPU_RDY | LIGHTRANGER5_BIT_PON,
+                        LIGHTRANGER5_BOOT_TIMEOUT_MS, stats ) ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    // Read the bootloader app ID + version
+    //S 41 W 00 Sr 41 R A A A N P
+    if ( ( lightranger5_generic_read( ctx, LIGHTRANGER5_REG_APPID, appid, sizeof( appid ) ) != I2C_MASTER_SUCCESS ) ||
+         ( appid[ 0 ] != LIGHTRANGER5_APPID_BOOTLOADER ) ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    return LIGHTRANGER5_OK;
+}
+
+err_t lightranger5_download_and_start ( lightranger5_t *ctx, uint32_t download_speed,
+                                        lightranger5_download_stats_t *stats ) {
+    lightranger5_download_stats_t local_stats;
+    uint32_t bus_speed = ctx->i2c.config.speed;
+    err_t error_flag;
+
+    if ( stats == NULL ) {
+        memset( &local_stats, 0, sizeof( local_stats ) );
+        stats = &local_stats;
+    }
+
+    // Run the download with the bus at download_speed, the bus goes back to the speed it had before
+    // whatever happens so the other devices on the ISU aren't affected.  i2c_master_set_speed() stores the
+    // new speed in the context, so it's saved first.
+    i2c_master_set_speed( &ctx->i2c, download_speed );
+    ULONG download_start = tx_time_get( );
+
+    error_flag = bl_download_image( ctx, stats );
+    stats->download_ms = tx_time_get( ) - download_start;
+
+    // Send RAMREMAP_RESET, the device restarts and runs the image from RAM
+    // S 41 W 08 11 00 EE P
+    if ( error_flag == LIGHTRANGER5_OK ) {
+        error_flag = bl_send_command( ctx, LIGHTRANGER5_BL_CMD_RAMREMAP_RESET, NULL, 0 );
+    }
+
+    i2c_master_set_speed( &ctx->i2c, bus_speed );
+
+    return ( error_flag == LIGHTRANGER5_OK ) ? LIGHTRANGER5_OK : LIGHTRANGER5_ERROR;
+}
+
+err_t lightranger5_update_firmware ( i2c_num isu, pin_name_t en, uint8_t new_i2c_address,
+                                     uint32_t download_speed, lightranger5_download_stats_t *stats ){
+
+    lightranger5_download_stats_t local_stats;
     uint8_t reg_tmp;
+    ULONG start;
 
     lightranger5_t lightranger5;
 
@@ -349,125 +747,143 @@ err_t lightranger5_update_firmware ( i2c_num isu, pin_name_t en, uint8_t new_i2c
     // Take the device out of reset
     mtk_os_hal_gpio_set_output(en, OS_HAL_GPIO_DATA_HIGH);
 
-    tx_thread_sleep(100);
+    if ( stats == NULL ) {
+        stats = &local_stats;
+    }
+    memset( stats, 0, sizeof( *stats ) );
+    start = tx_time_get( );
 
-    lightranger5_generic_read( &lightranger5, LIGHTRANGER5_REG_DEVICE_ID, &reg_tmp, 1 );
-    if ( reg_tmp != LIGHTRANGER5_EXPECTED_ID ) {
+    // Rather than sleeping a fixed time poll until the device answers on the bus
+    if ( poll_register( &lightranger5, LIGHTRANGER5_REG_DEVICE_ID, 0xFF, LIGHTRANGER5_EXPECTED_ID,
+                        LIGHTRANGER5_BOOT_TIMEOUT_MS, stats ) ) {
         return LIGHTRANGER5_ERROR;
     }
-    
-    lightranger5_device_reset( &lightranger5 );
-    lightranger5_generic_read( &lightranger5, LIGHTRANGER5_REG_ENABLE, &reg_tmp, 1 );
-    if ( !( reg_tmp & LIGHTRANGER5_BIT_CPU_RDY ) ) {
+
+    if ( lightranger5_bootloader_start( &lightranger5, stats ) ) {
         return LIGHTRANGER5_ERROR;
     }
 
-    //Write a 0x1 to register 0xE0 (ENABLE)
-    //S 41 W E0 01 P
-    uint8_t enBuf[] = {0x01};
-    printf("Send Enable Command\n");
-    lightranger5_generic_write ( &lightranger5, LIGHTRANGER5_REG_ENABLE, enBuf, sizeof(enBuf));
+    if ( lightranger5_download_and_start( &lightranger5, download_speed, stats ) ||
+         poll_register( &lightranger5, LIGHTRANGER5_REG_ENABLE, 0xFF, LIGHTRANGER5_BIT_CPU_RDY | LIGHTRANGER5_BIT_PON,
+                        LIGHTRANGER5_BOOT_TIMEOUT_MS, stats ) ) {
+        printf( "LightRanger5 firmware download failed\n" );
+        return LIGHTRANGER5_ERROR;
+    }
 
-    // Poll register 0xE0 until the value 0x41 is read back (see section 4.1)
-    do{
+    lightranger5_get_app_version( &lightranger5, &reg_tmp, stats->app_version );
 
-        lightranger5_generic_read (&lightranger5, LIGHTRANGER5_REG_ENABLE, readBuf, 1);
+    if ( new_i2c_address != 0x00 ) {
+        if ( lightranger5_change_12c_address( &lightranger5, new_i2c_address ) ) {
+            return LIGHTRANGER5_ERROR;
+        }
+    }
 
-    } while (readBuf[0] != 0x41);
-    // printf("Device is ready!\n");
+    stats->total_ms = tx_time_get( ) - start;
+    printf( "LightRanger5 firmware: %u records in %lu ms, ready in %lu ms, %u busy polls%s\n",
+            stats->records, stats->download_ms, stats->total_ms, stats->busy_polls,
+            stats->verified ? ", verified" : "" );
 
-    // Read the bootloader app ID + version
-    //S 41 W 00 Sr 41 R A A A N P
-    // printf("Read Bootloader App ID and Version\n");
-    lightranger5_generic_read (&lightranger5, LIGHTRANGER5_REG_APPID, readBuf, 4);
-    // printf("Bootloader App ID and Version: 0x%0x 0x%0x 0x%0x, 0x%0x\n", readBuf[0], readBuf[1],readBuf[2],readBuf[3]);
+    return LIGHTRANGER5_OK;
+}
 
-    waitForReadyStatus(&lightranger5);
+err_t lightranger5_request_i2c_address ( lightranger5_t* ctx, uint8_t new_i2c_address ){
+
+    // The host driver sends the following I²C string (assuming the device shall be reprogrammed 
+    //to 7-bit address 0x51 == upshifted by 1 to 0xA2) : S 41 W 0E A2 00 49 P
     
-    //Send DOWNLOAD_INIT
-    //S 41 W 08 14 01 29 C1 P
-    // printf("Send Download Init Command\n");
-    uint8_t initBuf[] = {0x14, 0x01, 0x29, 0xC1};
-    lightranger5_generic_write (&lightranger5, LIGHTRANGER5_REG_CMD_DATA7, initBuf, sizeof(initBuf));
-
-    waitForReadyStatus(&lightranger5);
-
-    // Set up address pointer to address 0x2000_0000, only lower 16-bits are used of address (Intel Hex
-    //    record :020000042000DA)
-    // S 41 W 08 43 02 00 00 BA P 
-    // printf("Send ADDR_RAM command for address 0\n");
-    uint8_t initAddrPtr[] = {0x43, 0x02, 0x00, 0x00, 0xBA};
-    lightranger5_generic_write (&lightranger5, LIGHTRANGER5_REG_CMD_DATA7, initAddrPtr, sizeof(initAddrPtr));
-
-    waitForReadyStatus(&lightranger5);
-
-    // Setup to send the image
-    imagePtr = tof_bin_image;
-    uint8_t writeBuffer[16 + 3] = {0x00};
-    uint8_t chkSum = 0;
-
-    // Send the image 16 bytes at a time until we're done
-    for(int i = 0; i < 0x2A5D/0x10; i++) {
-
-        writeBuffer[0] = 0x41;
-        writeBuffer[1] = 0x10;
-        chkSum = 0x10 + 0x41; 
-        for(int j = 0; j < 0x10; j++){
-            writeBuffer[j+2] = (uint8_t)*imagePtr++ ;
-            chkSum += (uint8_t)writeBuffer[j+2];
-        }
+    // printf("Update the current TMF8801 device to use new I2C address 0x%x\n", new_i2c_address);
+    uint8_t changeI2cAddressCmd[4];
+
+    // Register 0x0E first, calculate the CheckSum for the command and write it into the last array element
+    changeI2cAddressCmd[0] = 0x0E;
+    changeI2cAddressCmd[1] = new_i2c_address << 1;
+    changeI2cAddressCmd[2] = 0x00;
+    changeI2cAddressCmd[3] = 0x49;
 
-        writeBuffer[18] = chkSum ^ 0xFF;
+    lightranger5_write_frame (ctx, changeI2cAddressCmd, sizeof(changeI2cAddressCmd));
 
-        // Send W_RAM command with the current 16 bytes
-        lightranger5_generic_write (&lightranger5, LIGHTRANGER5_REG_CMD_DATA7, writeBuffer, 19);
+    // The host driver sends the following I²C string (this I²C request might actually fail, if the 
+    // device has itself already reprogrammed to the new address – this depends on the internal 
+    // state of the device). S 41 W 10 ff P   
+    dev_write_register (ctx, 0x10, 0xFF);
 
-        waitForReadyStatus(&lightranger5);
+    // Now the device is reprogramming itself, talk to it at the new address from here on
+    ctx->slave_address = new_i2c_address;
+    if ( i2c_master_set_slave_address( &ctx->i2c, new_i2c_address ) == I2C_MASTER_ERROR ) {
+        return LIGHTRANGER5_ERROR;
     }
 
-    // Send RAMREMAP_RESET command
-    // S 41 W 08 11 00 EE P
-    uint8_t ramremap_reset[] = {0x11, 0x00, 0xEE};
-    lightranger5_generic_write (&lightranger5, LIGHTRANGER5_REG_CMD_DATA7, ramremap_reset, sizeof(ramremap_reset));
+    return LIGHTRANGER5_OK;
+}
+
+err_t lightranger5_change_12c_address ( lightranger5_t* ctx, uint8_t new_i2c_address ){
+
+    if ( lightranger5_request_i2c_address( ctx, new_i2c_address ) ) {
+        return LIGHTRANGER5_ERROR;
+    }
+
+    // Poll register 0xE0 at the new address until the device answers with 0x41: S 51 W e0 Sr 51 R A P
+    return poll_register( ctx, LIGHTRANGER5_REG_ENABLE, 0xFF, LIGHTRANGER5_BIT_CPU_RDY | LIGHTRANGER5_BIT_PON,
+                          LIGHTRANGER5_BOOT_TIMEOUT_MS, NULL );
+}
+
+// ------------------------------------------------------------- HISTOGRAM DUMP
 
-    do{
+// One block of the dump, static like bl_frame so the read doesn't add 128 bytes to the caller's stack.  Only one
+// histogram is read at a time.
+static uint8_t hist_block[ LIGHTRANGER5_HIST_BLOCK_SIZE ] __attribute__( ( section( ".sysram" ) ) );
 
-        lightranger5_generic_read (&lightranger5, LIGHTRANGER5_REG_ENABLE, readBuf, 1);
-        tx_thread_sleep(10);
+err_t lightranger5_configure_histograms ( lightranger5_t *ctx, uint8_t types ) {
 
-    } while (readBuf[0] != 0x41);
-//    printf("Device is programmed!\n");
+    // CMD_DATA0 and COMMAND
+    uint8_t cmd_frame[ 3 ] = { LIGHTRANGER5_REG_CMD_DATA0, types, LIGHTRANGER5_CMD_HISTOGRAM_CONFIG };
 
-    if(new_i2c_address != 0x00){
-      lightranger5_change_12c_address ( &lightranger5, new_i2c_address );  
+    if ( ( lightranger5_write_frame( ctx, cmd_frame, sizeof( cmd_frame ) ) != I2C_MASTER_SUCCESS ) ||
+         poll_register( ctx, LIGHTRANGER5_REG_PREVIOUS, 0xFF, LIGHTRANGER5_CMD_HISTOGRAM_CONFIG,
+                        LIGHTRANGER5_BOOT_TIMEOUT_MS, NULL ) ) {
+        return LIGHTRANGER5_ERROR;
     }
 
-    return LIGHTRANGER5_OK;
+    return set_interrupt_enable( ctx, LIGHTRANGER5_INT_HISTOGRAM, types != 0 );
 }
 
-err_t lightranger5_change_12c_address ( lightranger5_t* ctx, uint8_t new_i2c_address ){
+err_t lightranger5_read_histogram ( lightranger5_t *ctx, lightranger5_histogram_t *histogram ) {
+    uint8_t reg_tmp;
 
-    // The host driver sends the following I²C string (assuming the device shall be reprogrammed 
-    //to 7-bit address 0x51 == upshifted by 1 to 0xA2) : S 41 W 0E A2 00 49 P
-    
-    // printf("Update the current TMF8801 device to use new I2C address 0x%x\n", new_i2c_address);
-    uint8_t changeI2cAddressCmd[3];
+    if ( lightranger5_generic_read( ctx, LIGHTRANGER5_REG_INT_STATUS, &reg_tmp, 1 ) != I2C_MASTER_SUCCESS ) {
+        return LIGHTRANGER5_ERROR;
+    }
+    if ( !( reg_tmp & LIGHTRANGER5_INT_HISTOGRAM ) ) {
+        return 0;
+    }
 
-    // Calculate the CheckSum for the command and write it into the 3rd array element
-    changeI2cAddressCmd[0] = new_i2c_address << 1;
-    changeI2cAddressCmd[1] = 0x00;
-    changeI2cAddressCmd[2] = 0x49;
+    if ( dev_write_register( ctx, LIGHTRANGER5_REG_INT_STATUS, LIGHTRANGER5_INT_HISTOGRAM ) != I2C_MASTER_SUCCESS ) {
+        return LIGHTRANGER5_ERROR;
+    }
 
-    lightranger5_generic_write (ctx, 0x0E, changeI2cAddressCmd, sizeof(changeI2cAddressCmd));
+    // The TMF8801 copies a block to the data registers once it sees the read command, REGISTER_CONTENTS tells
+    // when it is there.  The measurement carries on once the last block was read.
+    for ( uint8_t block = 0; block < LIGHTRANGER5_HIST_BLOCK_COUNT; block++ ) {
 
-    // The host driver sends the following I²C string (this I²C request might actually fail, if the 
-    // device has itself already reprogrammed to the new address – this depends on the internal 
-    // state of the device). S 41 W 10 ff P   
-    uint8_t newCmd[] = {0xFF};
-    lightranger5_generic_write (ctx, 0x10, newCmd, sizeof(newCmd));
+        uint16_t *bins = histogram->bins[ block / 2 ];
 
-    // Now the device is reprogrammed. You can test to access it by sending the following string to 
-    // read out register 0xE0 ( the device will have the value 0x41 in this register): S 51 W e0 Sr 51 R A P
+        reg_tmp = LIGHTRANGER5_CMD_READ_HISTOGRAM + block;
+        if ( ( dev_write_register( ctx, LIGHTRANGER5_REG_COMMAND, reg_tmp ) != I2C_MASTER_SUCCESS ) ||
+             poll_register( ctx, LIGHTRANGER5_REG_REGISTER_CONTENTS, 0xFF, reg_tmp, LIGHTRANGER5_HIST_TIMEOUT_MS, NULL ) ||
+             ( lightranger5_generic_read( ctx, LIGHTRANGER5_REG_HIST_DATA, hist_block, sizeof( hist_block ) ) != I2C_MASTER_SUCCESS ) ) {
+            return LIGHTRANGER5_ERROR;
+        }
 
-    return LIGHTRANGER5_OK;
+        if ( block & 1 ) {
+            for ( uint8_t n = 0; n < LIGHTRANGER5_HIST_BIN_COUNT; n++ ) {
+                bins[ n ] |= ( uint16_t )hist_block[ n ] << 8;
+            }
+        } else {
+            for ( uint8_t n = 0; n < LIGHTRANGER5_HIST_BIN_COUNT; n++ ) {
+                bins[ n ] = hist_block[ n ];
+            }
+        }
+    }
+
+    return 1;
 }
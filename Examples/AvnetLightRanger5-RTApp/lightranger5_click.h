@@ -13,10 +13,51 @@ typedef enum
 	IC_LIGHTRANGER5_CLICK_HEARTBEAT,
 	IC_LIGHTRANGER5_CLICK_READ_SENSOR_RESPOND_WITH_TELEMETRY, 
 	IC_LIGHTRANGER5_CLICK_SET_AUTO_TELEMETRY_RATE,
-	IC_LIGHTRANGER5_CLICK_READ_SENSOR
+	IC_LIGHTRANGER5_CLICK_READ_SENSOR,
+	IC_LIGHTRANGER5_CLICK_GET_CALIBRATION,
+	IC_LIGHTRANGER5_CLICK_SET_CALIBRATION,
+	IC_LIGHTRANGER5_CLICK_GET_CONFIG,
+	IC_LIGHTRANGER5_CLICK_SET_CONFIG
 } INTER_CORE_CMD_LIGHTRANGER5_CLICK;
 typedef uint8_t cmdType;
 
+// How the LightRanger5 was started, matches lightranger5_start_t in lightranger5.h
+#define IC_LIGHTRANGER5_CLICK_START_COLD          0   // Firmware downloaded
+#define IC_LIGHTRANGER5_CLICK_START_IMAGE_LOADED  1   // Firmware was still loaded, measurement restarted
+#define IC_LIGHTRANGER5_CLICK_START_WARM          2   // Firmware was still loaded and measuring
+
+// TMF8801 factory calibration and the version of the firmware image it was taken with.  Returned by
+// IC_LIGHTRANGER5_CLICK_GET_CALIBRATION for the high level application to persist and sent back down with
+// IC_LIGHTRANGER5_CLICK_SET_CALIBRATION when the real time application starts.  A valid calibration replaces
+// the factory calibration after a firmware download and its appVersion is the image version the warm start
+// check expects the sensor to be running.
+typedef struct  __attribute__((packed))
+{
+    uint8_t valid;
+    uint8_t appVersion[3];      // Major, minor, patch
+    uint8_t factoryCalib[14];
+} IC_LIGHTRANGER5_CLICK_CALIBRATION;
+
+// TMF8801 measurement settings, IC_LIGHTRANGER5_CLICK_SET_CONFIG restarts the measurement with them.  More iterations
+// give a better accuracy and range at the cost of a longer measurement, the TMF8801 stretches the period if
+// the iterations don't fit in it.
+typedef struct  __attribute__((packed))
+{
+    uint8_t periodMs;           // Repetition period 1 - 255ms, default 100
+    uint16_t kiloIterations;    // Iterations per result in thousands, default 0xFFFF (TMF8801 default)
+    uint8_t algorithm;          // TMF8801 algorithm setting (CMD_DATA6), default 0x23
+    uint8_t minConfidence;      // Results below this confidence (0 - 63) report no object, default 0
+} IC_LIGHTRANGER5_CLICK_CONFIG;
+
+// Latest LightRanger5 result
+typedef struct  __attribute__((packed))
+{
+    int distance_mm;            // -1 if there is no recent result or it is below minConfidence
+    uint8_t confidence;         // 0 - 63, 0 means no object was detected
+    uint8_t resultNumber;       // Increments with every result
+    int8_t temperature;         // TMF8801 die temperature in degrees C
+} IC_LIGHTRANGER5_CLICK_RESULT;
+
 // Define the expected data structure. 
 typedef struct  __attribute__((packed))
 {
@@ -25,6 +66,8 @@ typedef struct  __attribute__((packed))
 	////////////////////////////////////////////////////////////////////////////////////////
 	// Don't change the declarations above or the generic RTApp implementation will break //
 	////////////////////////////////////////////////////////////////////////////////////////
+    IC_LIGHTRANGER5_CLICK_CALIBRATION calibration;
+    IC_LIGHTRANGER5_CLICK_CONFIG config;
 } IC_COMMAND_BLOCK_LIGHTRANGER5_CLICK_HL_TO_RT;
 
 typedef struct  __attribute__((packed))
@@ -36,4 +79,9 @@ typedef struct  __attribute__((packed))
 	// Don't change the declarations above or the generic RTApp implementation will break //
 	////////////////////////////////////////////////////////////////////////////////////////
     int range_mm;
+    IC_LIGHTRANGER5_CLICK_CALIBRATION calibration;
+    uint8_t startMode;
+    uint32_t hardwareInitMs;    // Hardware init thread start to the LightRanger5 measuring
+    IC_LIGHTRANGER5_CLICK_CONFIG config;
+    IC_LIGHTRANGER5_CLICK_RESULT result;
 } IC_COMMAND_BLOCK_LIGHTRANGER5_CLICK_RT_TO_HL;
\ No newline at end of file
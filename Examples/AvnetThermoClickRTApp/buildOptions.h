@@ -37,6 +37,12 @@
 #error "The Rev2 board Click socket #2 does not have access to the SPI CS without modifying R61 and R62 on the board to enable"
 #endif 
 
+// Thermocouple channels
+// Use this section to define the chip select of each Thermo CLICK on the SPI bus, channel 0 first.  On the Rev1 board
+// both CLICK sockets share ISU1, so a Thermo CLICK in each socket can be read as two channels.
+#define THERMO_CHANNEL_CHIP_SELECTS { SPI_CS }
+//#define THERMO_CHANNEL_CHIP_SELECTS { SPI_SELECT_DEVICE_0, SPI_SELECT_DEVICE_1 }
+
 
 // This file is used to make build time configuration changes for the example application
 
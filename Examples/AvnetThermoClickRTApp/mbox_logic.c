@@ -44,6 +44,8 @@
 #include "os_hal_mbox_shared_mem.h"
 #include "thermo_click_rt_app.h"
 #include "thermo.h"
+#include "thermocouple.h"
+#include "cycle_counter.h"
  
 // Add MT3620 constant
 #define MT3620_TIMER_TICKS_PER_SECOND ((ULONG) 100*10)
@@ -93,6 +95,41 @@ static UINT send_telemetry_thread_period = 0;
 // Variable to track if the harware has been initialized
 static volatile bool hardwareInitOK = false;
 
+// Background sampling configuration.  The MAX31855 converts continuously and takes up to 100ms per conversion,
+// reading it faster just returns the same frame again.
+#define SAMPLE_INTERVAL_DEFAULT_MS  500
+#define SAMPLE_INTERVAL_MIN_MS      100
+#define SAMPLE_INTERVAL_MAX_MS      (3600 * 1000)
+static volatile uint32_t sample_interval_ms = SAMPLE_INTERVAL_DEFAULT_MS;
+
+// Thermocouple type used to linearize the MAX31855 readings, the Thermo CLICK uses the MAX31855K
+static volatile thermocouple_type_t thermocouple_type = THERMOCOUPLE_TYPE_K;
+
+// Set by the mbox thread when the type changes, the sample thread then restarts the worst case cycle count
+static volatile bool thermocouple_type_changed = false;
+
+// One read of every thermocouple channel as published by the sample thread
+typedef struct
+{
+    thermo_reading_t channel[THERMO_MAX_CHANNELS];
+    bool channelValid[THERMO_MAX_CHANNELS];     // false if the SPI transfer failed
+    float temperature[THERMO_MAX_CHANNELS];     // Linearized temperature, the MAX31855 temperature if it can't be linearized
+    thermocouple_type_t thermocoupleType;
+    uint32_t linearizeCycles;
+    uint32_t linearizeMaxCycles;
+    uint32_t sampleCount;                       // 0 until the first read completes
+    ULONG timestamp;                            // tx_time_get() when the channels were read
+} ThermoSnapshot;
+
+// Double buffered readings.  The sample thread fills the buffer readers are not using and then publishes it
+// by incrementing snapshot_sequence, so the mbox thread answers from the last complete read without touching
+// the SPI bus.  A reader copies snapshots[sequence & 1] and retries if another snapshot was published meanwhile.
+static ThermoSnapshot snapshots[2];
+static volatile uint32_t snapshot_sequence = 0;
+
+// Compiler barrier, keeps the snapshot accesses on the right side of the sequence counter accesses
+#define SNAPSHOT_BARRIER() __asm__ volatile("" ::: "memory")
+
 // Define the bits used for the telemetry event flag construct
 enum triggers {
     HIGH_LEVEL_MESSAGE = 0,
@@ -110,6 +147,7 @@ volatile UCHAR  blockFifoSema;
 TX_THREAD               thread_mbox;
 TX_THREAD               thread_set_telemetry_flag;
 TX_THREAD               tx_hardware_init_thread;
+TX_THREAD               thread_thermo_sample;
 
 // Application memory pool
 TX_BYTE_POOL            byte_pool_0;
@@ -123,6 +161,7 @@ TX_EVENT_FLAGS_GROUP    hardware_event_flags_0;
 void tx_thread_mbox_entry(ULONG thread_input);
 void set_telemetry_flag_thread_entry(ULONG thread_input);
 void hardware_init_thread(ULONG thread_input);
+void thermo_sample_thread_entry(ULONG thread_input);
 
 /* Function prototypes */
 void mbox_fifo_cb(struct mtk_os_hal_mbox_cb_data *data);
@@ -130,10 +169,15 @@ void mbox_swint_cb(struct mtk_os_hal_mbox_cb_data *data);
 void mbox_print(UCHAR *mbox_buf, UINT mbox_data_len);
 bool initialize_hardware(void);
 void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound, UINT mbox_shared_buf_size);
+void readSnapshot(ThermoSnapshot* snapshot);
+void fillSensorReading(IC_COMMAND_BLOCK_THERMO_CLICK_RT_TO_HL* payload);
 
 /* Define main entry point.  */
 void tx_main(void)
 {
+    /* Enable the DWT cycle counter used to benchmark the thermocouple linearization */
+    cycle_counter_init();
+
     /* Enter the ThreadX kernel.  */
     tx_kernel_enter();
 }
@@ -189,6 +233,13 @@ void tx_application_define(void *first_unused_memory)
     tx_thread_create(&tx_hardware_init_thread, "hardware init thread", hardware_init_thread, 0,
         pointer, APP_STACK_SIZE, 6, 6, TX_NO_TIME_SLICE, TX_AUTO_START);            
 
+    /* Allocate the stack for the thermo sample thread  */
+    tx_byte_allocate(&byte_pool_0, (VOID**) &pointer, APP_STACK_SIZE, TX_NO_WAIT);
+
+    // Create the thermo sample thread, it runs ahead of the mbox thread so a reader never waits on a half written snapshot
+    tx_thread_create(&thread_thermo_sample, "thermo sample thread", thermo_sample_thread_entry, 0,
+        pointer, APP_STACK_SIZE, 7, 7, TX_NO_TIME_SLICE, TX_AUTO_START);
+
     // -------------------------------- mailbox channels --------------------------------
 
     /* Open the MBOX channel of A7 <-> M4 */
@@ -326,8 +377,8 @@ void tx_thread_mbox_entry(ULONG thread_input)
                     // what the data is and what needs to be done with it at both the high level and real time applcations.
                     case IC_THERMO_CLICK_READ_SENSOR:
 
-                        // Read the temperature
-                        payloadPtrOutgoing->payload.temperature = thermo_get_temperature();
+                        // Answer from the last read of the sample thread, sampleCount is 0 if there is no read yet
+                        fillSensorReading(&payloadPtrOutgoing->payload);
 
                         printf("RealTime App sending sensor reading: %.2f\n", payloadPtrOutgoing->payload.temperature);
 
@@ -335,6 +386,54 @@ void tx_thread_mbox_entry(ULONG thread_input)
                         EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
                         break;
 
+                    // The high level application is changing how often the thermocouples are read
+                    case IC_THERMO_CLICK_SET_SAMPLE_CONFIG:
+                    {
+                        uint32_t interval = payloadPtrIncomming->payload.sampleIntervalMs;
+
+                        if(interval != 0){
+                            if(interval < SAMPLE_INTERVAL_MIN_MS){
+                                interval = SAMPLE_INTERVAL_MIN_MS;
+                            }
+                            if(interval > SAMPLE_INTERVAL_MAX_MS){
+                                interval = SAMPLE_INTERVAL_MAX_MS;
+                            }
+                            sample_interval_ms = interval;
+
+                            // Wake up the sample thread so that the new interval is used right away
+                            tx_thread_wait_abort(&thread_thermo_sample);
+                        }
+
+                        printf("Set the thermocouple sample interval to %lu ms\n", sample_interval_ms);
+
+                        fillSensorReading(&payloadPtrOutgoing->payload);
+
+                        // Write to A7, enqueue to mailbox, we're echoing back the command with the interval in use
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+                    }
+
+                    // The high level application is selecting the thermocouple type used to linearize the readings
+                    case IC_THERMO_CLICK_SET_THERMOCOUPLE_TYPE:
+
+                        if(payloadPtrIncomming->payload.thermocoupleType < THERMOCOUPLE_TYPE_COUNT){
+                            thermocouple_type = (thermocouple_type_t)payloadPtrIncomming->payload.thermocoupleType;
+                            thermocouple_type_changed = true;
+
+                            // Wake up the sample thread so that the next reading uses the new type
+                            tx_thread_wait_abort(&thread_thermo_sample);
+                        }
+
+                        printf("Thermocouple type set to %s\n", thermocouple_type_name(thermocouple_type));
+
+                        // Echo back the type, the readings use the new type once the sample thread has run
+                        fillSensorReading(&payloadPtrOutgoing->payload);
+                        payloadPtrOutgoing->payload.thermocoupleType = thermocouple_type;
+
+                        // Write to A7, enqueue to mailbox, we're echoing back the command with the type in use
+                        EnqueueData(inbound, outbound, mbox_shared_buf_size, mbox_local_buf, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
+                        break;
+
                     case IC_THERMO_CLICK_HEARTBEAT:
                         printf("Realtime app processing heartbeat command\n");
 
@@ -392,6 +491,80 @@ void set_telemetry_flag_thread_entry(ULONG thread_input)
     }
 }
 
+// This thread owns the SPI bus.  It reads every thermocouple channel once per sample_interval_ms and publishes the
+// readings to the double buffered snapshot.
+void thermo_sample_thread_entry(ULONG thread_input)
+{
+    ThermoSnapshot* next;
+    uint32_t sequence;
+    uint32_t sampleCount = 0;
+    uint8_t channelCount;
+    thermocouple_type_t type;
+    uint32_t linearizeCycles = 0;
+    uint32_t linearizeMaxCycles = 0;
+    ULONG started;
+    ULONG elapsed;
+    ULONG interval;
+
+    printf("Thermo Sample Task Started\n");
+
+    // The hardware init thread runs first, wait for it to bring up the SPI master
+    while(!hardwareInitOK){
+        tx_thread_sleep(MT3620_TIMER_TICKS_PER_SECOND / 10);
+    }
+
+    channelCount = thermo_get_channel_count();
+
+    while (1) {
+
+        started = tx_time_get();
+
+        // Fill the buffer readers are not using, then publish it
+        sequence = snapshot_sequence;
+        next = &snapshots[(sequence + 1) & 1];
+        for(uint8_t channel = 0; channel < channelCount; channel++){
+            next->channelValid[channel] = (thermo_read(channel, &next->channel[channel]) == THERMO_OK);
+        }
+
+        // Linearize the valid readings, the MAX31855 only scales the thermocouple voltage by a fixed sensitivity
+        type = thermocouple_type;
+        if(thermocouple_type_changed){
+            thermocouple_type_changed = false;
+            linearizeMaxCycles = 0;
+        }
+        for(uint8_t channel = 0; channel < channelCount; channel++){
+
+            thermo_reading_t *reading = &next->channel[channel];
+            next->temperature[channel] = reading->temperature;
+
+            if(type != THERMOCOUPLE_TYPE_NONE && next->channelValid[channel] && !reading->fault){
+
+                uint32_t cycles = cycle_counter_get();
+                thermocouple_linearize(type, reading->temperature, reading->junction_temperature, &next->temperature[channel]);
+                cycles = cycle_counter_get() - cycles;
+
+                linearizeCycles = cycles;
+                if(cycles > linearizeMaxCycles){
+                    linearizeMaxCycles = cycles;
+                }
+            }
+        }
+        next->thermocoupleType = type;
+        next->linearizeCycles = linearizeCycles;
+        next->linearizeMaxCycles = linearizeMaxCycles;
+        next->sampleCount = ++sampleCount;
+        next->timestamp = tx_time_get();
+        SNAPSHOT_BARRIER();
+        snapshot_sequence = sequence + 1;
+
+        // Sleep for the rest of the interval, tx_thread_wait_abort() ends the sleep early when the
+        // interval changes
+        elapsed = tx_time_get() - started;
+        interval = sample_interval_ms * MT3620_TIMER_TICKS_PER_SECOND / 1000;
+        tx_thread_sleep((elapsed < interval) ? interval - elapsed : 1);
+    }
+}
+
 // only purpose in life is to initialize the hardware.
 void hardware_init_thread(ULONG thread_input)
 {
@@ -494,36 +667,56 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
     // Set the response message ID
     payloadPtrOutgoing->payload.cmd = IC_THERMO_CLICK_READ_SENSOR_RESPOND_WITH_TELEMETRY;
 
-    if(hardwareInitOK){
-        
-        //  Check to make sure the sensor is not reading any faults
-        if(thermo_check_fault() == 0){
+    ThermoSnapshot snapshot;
+    readSnapshot(&snapshot);
 
-            // Construct the telemetry response
-            snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE,  "{\"tempC\": %.2f}", thermo_get_temperature());
-        }
+    if(hardwareInitOK && snapshot.sampleCount > 0){
 
-        // There is a fault, determine the fault and report it in the return telemetry
-        else{
-            if(thermo_short_circuited_vcc() != 0){
-                                        
-                // Device is shorted to VCC
-                snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE,  "{\"error\":\"Thermocoulpler is shorted to VCC\"}");
-            }
-            else if (thermo_short_circuited_gnd() != 0){
+        char *json = payloadPtrOutgoing->payload.telemetryJSON;
+        int len = snprintf(json, JSON_STRING_MAX_SIZE, "{");
+
+        // Channel 0 reports tempC/error, any other channel n reports tempCn/errorn
+        for(uint8_t channel = 0; channel < thermo_get_channel_count() && len < JSON_STRING_MAX_SIZE; channel++){
 
-                // Device is shorted to Ground
-                snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE,  "{\"error\":\"Thermocoulpler is shorted to Ground\"}");
+            thermo_reading_t *reading = &snapshot.channel[channel];
+            const char *separator = (channel == 0) ? "" : ", ";
+            char suffix[4] = "";
+            const char *error = NULL;
 
+            if(channel != 0){
+                snprintf(suffix, sizeof(suffix), "%d", channel);
             }
-            else{
 
-                // Thermocoupler not connected (open)
-                snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE,  "{\"error\":\"Thermocoulpler not found\"}");
+            //  Check to make sure the sensor is not reading any faults
+            if(!snapshot.channelValid[channel]){
+                error = "Thermocoulpler could not be read";
+            }
+            else if(reading->short_vcc){
+                error = "Thermocoulpler is shorted to VCC";
+            }
+            else if(reading->short_gnd){
+                error = "Thermocoulpler is shorted to Ground";
+            }
+            else if(reading->fault){
+                error = "Thermocoulpler not found";
+            }
 
+            if(error == NULL){
+                len += snprintf(json + len, JSON_STRING_MAX_SIZE - len, "%s\"tempC%s\": %.2f", separator, suffix, snapshot.temperature[channel]);
+            }
+            else{
+                len += snprintf(json + len, JSON_STRING_MAX_SIZE - len, "%s\"error%s\":\"%s\"", separator, suffix, error);
             }
         }
-    
+
+        if(len < JSON_STRING_MAX_SIZE){
+            snprintf(json + len, JSON_STRING_MAX_SIZE - len, "}");
+        }
+    }
+    else if(hardwareInitOK){
+
+        // The sample thread has not read the sensor yet
+        snprintf(payloadPtrOutgoing->payload.telemetryJSON, JSON_STRING_MAX_SIZE,  "{\"error\":\"No sensor reading available yet\"}");
     }
     else{
                         
@@ -535,4 +728,53 @@ void readSensorsAndSendTelemetry(BufferHeader *outbound, BufferHeader *inbound,
 
     /* Write to the high level application, enqueue to mailbox */
     EnqueueData(inbound, outbound, mbox_shared_buf_size, payloadPtrOutgoing, sizeof(IC_SHARED_MEMORY_BLOCK_RT_TO_HL));
-}
\ No newline at end of file
+}
+
+// Copy the last published reading, retrying if the sample thread published a new one meanwhile
+void readSnapshot(ThermoSnapshot* snapshot)
+{
+    uint32_t sequence;
+
+    do {
+        sequence = snapshot_sequence;
+        SNAPSHOT_BARRIER();
+        *snapshot = snapshots[sequence & 1];
+        SNAPSHOT_BARRIER();
+    } while (sequence != snapshot_sequence);
+}
+
+// Fill in the cached readings and the sampling configuration for the high level application
+void fillSensorReading(IC_COMMAND_BLOCK_THERMO_CLICK_RT_TO_HL* payload)
+{
+    ThermoSnapshot snapshot;
+    uint8_t channelCount = thermo_get_channel_count();
+
+    readSnapshot(&snapshot);
+
+    payload->sampleIntervalMs = sample_interval_ms;
+    payload->channelCount = channelCount;
+    payload->sampleCount = snapshot.sampleCount;
+    payload->sampleAgeMs = (snapshot.sampleCount > 0) ? (tx_time_get() - snapshot.timestamp) * (1000 / MT3620_TIMER_TICKS_PER_SECOND) : 0;
+
+    for(uint8_t channel = 0; channel < IC_THERMO_CLICK_MAX_CHANNELS; channel++){
+
+        payload->channelTemperature[channel] = 0;
+        payload->channelMax31855Temperature[channel] = 0;
+        payload->channelJunctionTemperature[channel] = 0;
+        payload->channelFault[channel] = IC_THERMO_CLICK_FAULT_NO_READING;
+
+        if(channel < channelCount && snapshot.sampleCount > 0 && snapshot.channelValid[channel]){
+            payload->channelTemperature[channel] = snapshot.temperature[channel];
+            payload->channelMax31855Temperature[channel] = snapshot.channel[channel].temperature;
+            payload->channelJunctionTemperature[channel] = snapshot.channel[channel].junction_temperature;
+            payload->channelFault[channel] = snapshot.channel[channel].frame & (IC_THERMO_CLICK_FAULT_OPEN | 
+                                                                               IC_THERMO_CLICK_FAULT_SHORT_GND | 
+                                                                               IC_THERMO_CLICK_FAULT_SHORT_VCC);
+        }
+    }
+
+    payload->temperature = payload->channelTemperature[0];
+    payload->thermocoupleType = (snapshot.sampleCount > 0) ? snapshot.thermocoupleType : thermocouple_type;
+    payload->linearizeCycles = snapshot.linearizeCycles;
+    payload->linearizeMaxCycles = snapshot.linearizeMaxCycles;
+}
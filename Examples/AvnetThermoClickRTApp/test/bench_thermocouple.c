@@ -0,0 +1,44 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host benchmark for the thermocouple linearization: the time per thermocouple_linearize() call for every type
+// over readings from 25C to 925C with the cold junction at 23.5C.  It's called through a volatile pointer so the
+// compiler can't hoist or vectorize across the passes.  These are host times, the M4 reports the DWT cycles of
+// every linearization in linearizeCycles/linearizeMaxCycles.
+
+#include "host_test.h"
+#include "nist_tables.h"
+
+#define READINGS 1024
+#define PASSES 2000
+
+static volatile float sink;
+static bool (*volatile linearize)(thermocouple_type_t, float, float, float*) = thermocouple_linearize;
+
+int main(void)
+{
+    for (int type = THERMOCOUPLE_TYPE_K; type < THERMOCOUPLE_TYPE_COUNT; type++) {
+
+        static float readings[READINGS];
+        float acc = 0.0f;
+
+        for (int i = 0; i < READINGS; i++) {
+            readings[i] = 25.0f + 900.0f * i / READINGS;
+        }
+
+        double start = host_time_ns();
+        for (int pass = 0; pass < PASSES; pass++) {
+            for (int i = 0; i < READINGS; i++) {
+                float temperature = 0.0f;
+                linearize((thermocouple_type_t)type, readings[i], 23.5f, &temperature);
+                acc += temperature;
+            }
+        }
+        double ns = (host_time_ns() - start) / ((double)PASSES * READINGS);
+
+        printf("type %s: %.1f ns per linearization on the host\n", thermocouple_type_name((thermocouple_type_t)type), ns);
+        sink = acc;
+    }
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+// Reference points from the NIST ITS-90 thermocouple tables (NIST Monograph 175), EMF in mV with the
+// reference junction at 0C, rounded to 1uV like the printed tables.  The forward tables only cover the range
+// thermocouple_linearize() needs for the cold junction, the points above it only check the inverse tables.
+
+#include "thermocouple.h"
+
+typedef struct
+{
+    thermocouple_type_t type;
+    float temperature;              // degrees C
+    float emf;                      // mV
+    bool forward;                   // inside the forward tables, J stops at 760C and R/S at 1064.18C
+} NistPoint;
+
+static const NistPoint nist_points[] = {
+    {THERMOCOUPLE_TYPE_K, -200.0f, -5.891f, true},
+    {THERMOCOUPLE_TYPE_K, -100.0f, -3.554f, true},
+    {THERMOCOUPLE_TYPE_K, 100.0f, 4.096f, true},
+    {THERMOCOUPLE_TYPE_K, 200.0f, 8.138f, true},
+    {THERMOCOUPLE_TYPE_K, 300.0f, 12.209f, true},
+    {THERMOCOUPLE_TYPE_K, 500.0f, 20.644f, true},
+    {THERMOCOUPLE_TYPE_K, 800.0f, 33.275f, true},
+    {THERMOCOUPLE_TYPE_K, 1000.0f, 41.276f, true},
+    {THERMOCOUPLE_TYPE_K, 1200.0f, 48.838f, true},
+
+    {THERMOCOUPLE_TYPE_J, -100.0f, -4.633f, true},
+    {THERMOCOUPLE_TYPE_J, 100.0f, 5.269f, true},
+    {THERMOCOUPLE_TYPE_J, 200.0f, 10.779f, true},
+    {THERMOCOUPLE_TYPE_J, 500.0f, 27.393f, true},
+    {THERMOCOUPLE_TYPE_J, 700.0f, 39.132f, true},
+    {THERMOCOUPLE_TYPE_J, 1000.0f, 57.953f, false},
+
+    {THERMOCOUPLE_TYPE_N, -100.0f, -2.407f, true},
+    {THERMOCOUPLE_TYPE_N, 100.0f, 2.774f, true},
+    {THERMOCOUPLE_TYPE_N, 200.0f, 5.913f, true},
+    {THERMOCOUPLE_TYPE_N, 500.0f, 16.748f, true},
+    {THERMOCOUPLE_TYPE_N, 1000.0f, 36.256f, true},
+
+    {THERMOCOUPLE_TYPE_T, -200.0f, -5.603f, true},
+    {THERMOCOUPLE_TYPE_T, -100.0f, -3.379f, true},
+    {THERMOCOUPLE_TYPE_T, 100.0f, 4.279f, true},
+    {THERMOCOUPLE_TYPE_T, 200.0f, 9.288f, true},
+    {THERMOCOUPLE_TYPE_T, 300.0f, 14.862f, true},
+    {THERMOCOUPLE_TYPE_T, 400.0f, 20.872f, true},
+
+    {THERMOCOUPLE_TYPE_E, -200.0f, -8.825f, true},
+    {THERMOCOUPLE_TYPE_E, -100.0f, -5.237f, true},
+    {THERMOCOUPLE_TYPE_E, 100.0f, 6.319f, true},
+    {THERMOCOUPLE_TYPE_E, 200.0f, 13.421f, true},
+    {THERMOCOUPLE_TYPE_E, 500.0f, 37.005f, true},
+    {THERMOCOUPLE_TYPE_E, 1000.0f, 76.373f, true},
+
+    {THERMOCOUPLE_TYPE_R, 100.0f, 0.647f, true},
+    {THERMOCOUPLE_TYPE_R, 200.0f, 1.469f, true},
+    {THERMOCOUPLE_TYPE_R, 500.0f, 4.471f, true},
+    {THERMOCOUPLE_TYPE_R, 1000.0f, 10.506f, true},
+    {THERMOCOUPLE_TYPE_R, 1500.0f, 17.451f, false},
+
+    {THERMOCOUPLE_TYPE_S, 100.0f, 0.646f, true},
+    {THERMOCOUPLE_TYPE_S, 200.0f, 1.441f, true},
+    {THERMOCOUPLE_TYPE_S, 500.0f, 4.233f, true},
+    {THERMOCOUPLE_TYPE_S, 1000.0f, 9.587f, true},
+    {THERMOCOUPLE_TYPE_S, 1500.0f, 15.582f, false},
+};
+
+#define NIST_POINT_COUNT (sizeof(nist_points) / sizeof(nist_points[0]))
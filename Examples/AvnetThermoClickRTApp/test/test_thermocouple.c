@@ -0,0 +1,127 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+// Host tests for thermocouple.c against the NIST ITS-90 tables: the forward polynomials at the printed table
+// points, the inverse polynomials back from them, a forward/inverse round trip over every type's range and the
+// MAX31855 linearization of a hot junction far away from the cold junction.
+
+#include "host_test.h"
+#include "nist_tables.h"
+
+// The forward polynomials reproduce the printed tables to their 1uV rounding, single precision adds another uV
+// at the ends of the ranges.  Above the forward tables there's no EMF.
+static void test_forward(void)
+{
+    for (unsigned i = 0; i < NIST_POINT_COUNT; i++) {
+
+        float emf = NAN;
+
+        if (!nist_points[i].forward) {
+            CHECK(!thermocouple_emf(nist_points[i].type, nist_points[i].temperature, &emf));
+            continue;
+        }
+
+        CHECK(thermocouple_emf(nist_points[i].type, nist_points[i].temperature, &emf));
+        CHECK_NEAR(emf, nist_points[i].emf, 0.0015);
+    }
+}
+
+// The inverse polynomials are within the NIST fit error, at most 0.06C, plus the table's 0.5uV rounding over
+// the thermocouple's sensitivity at that point
+static void test_inverse(void)
+{
+    for (unsigned i = 0; i < NIST_POINT_COUNT; i++) {
+
+        float temperature = NAN;
+        // Seebeck coefficient at the point from its neighbours in the table, mV per degree C
+        double seebeck = nist_points[i].emf / nist_points[i].temperature;
+        if (i > 0 && nist_points[i - 1].type == nist_points[i].type) {
+            seebeck = (nist_points[i].emf - nist_points[i - 1].emf) /
+                      (nist_points[i].temperature - nist_points[i - 1].temperature);
+        }
+
+        CHECK(thermocouple_temperature(nist_points[i].type, nist_points[i].emf, &temperature));
+        CHECK_NEAR(temperature, nist_points[i].temperature, 0.06 + 0.0005 / seebeck);
+    }
+}
+
+// Forward then inverse stays within the NIST inverse fit error wherever both tables are defined, just inside
+// the ends so single precision rounding doesn't push the EMF out of the inverse range
+static void test_round_trip(void)
+{
+    static const float ranges[THERMOCOUPLE_TYPE_COUNT][2] = {
+        [THERMOCOUPLE_TYPE_K] = {-199.5f, 1371.5f}, [THERMOCOUPLE_TYPE_J] = {-209.5f, 760.0f},
+        [THERMOCOUPLE_TYPE_N] = {-199.5f, 1300.0f}, [THERMOCOUPLE_TYPE_T] = {-199.5f, 399.5f},
+        [THERMOCOUPLE_TYPE_E] = {-199.5f, 999.5f}, [THERMOCOUPLE_TYPE_R] = {-49.5f, 1064.0f},
+        [THERMOCOUPLE_TYPE_S] = {-49.5f, 1064.0f},
+    };
+
+    for (int type = THERMOCOUPLE_TYPE_K; type < THERMOCOUPLE_TYPE_COUNT; type++) {
+
+        double maxError = 0.0;
+
+        for (float t = ranges[type][0]; t <= ranges[type][1]; t += 0.5f) {
+
+            float emf = NAN, temperature = NAN;
+
+            if (!thermocouple_emf((thermocouple_type_t)type, t, &emf) ||
+                !thermocouple_temperature((thermocouple_type_t)type, emf, &temperature)) {
+                CHECK(!"round trip out of range");
+                printf("type %s at %.1f C\n", thermocouple_type_name((thermocouple_type_t)type), t);
+                break;
+            }
+            maxError = fmax(maxError, fabs(temperature - t));
+        }
+
+        printf("type %s: round trip max error %.3f C\n", thermocouple_type_name((thermocouple_type_t)type), maxError);
+        CHECK(maxError < 0.07);
+    }
+}
+
+// A MAX31855K reading of a hot junction far from the cold junction is many degrees off, linearized it's back
+// within the table accuracy.  Outside the tables and without a type nothing is returned.
+static float max31855k_reading(float hot, float cold)
+{
+    const float sensitivityK = 0.041276f;
+    float coldEmf, hotEmf;
+
+    thermocouple_emf(THERMOCOUPLE_TYPE_K, cold, &coldEmf);
+    thermocouple_emf(THERMOCOUPLE_TYPE_K, hot, &hotEmf);
+    return (hotEmf - coldEmf) / sensitivityK + cold;
+}
+
+static void test_linearize(void)
+{
+    static const float hot[] = {-100.0f, 500.0f, 1200.0f};
+    float temperature = NAN;
+
+    for (unsigned i = 0; i < sizeof(hot) / sizeof(hot[0]); i++) {
+
+        float max31855 = max31855k_reading(hot[i], 25.0f);
+
+        printf("K %.0f C with the cold junction at 25 C: MAX31855 %.2f C\n", hot[i], max31855);
+        CHECK(thermocouple_linearize(THERMOCOUPLE_TYPE_K, max31855, 25.0f, &temperature));
+        CHECK_NEAR(temperature, hot[i], 0.06);
+
+        // The MAX31855 reports in 0.25C steps
+        CHECK(thermocouple_linearize(THERMOCOUPLE_TYPE_K, roundf(max31855 * 4.0f) / 4.0f, 25.0f, &temperature));
+        CHECK_NEAR(temperature, hot[i], 0.2);
+    }
+    CHECK(fabsf(max31855k_reading(-100.0f, 25.0f) + 100.0f) > 10.0f);
+    CHECK(fabsf(max31855k_reading(1200.0f, 25.0f) - 1200.0f) > 10.0f);
+
+    temperature = 42.0f;
+    CHECK(!thermocouple_linearize(THERMOCOUPLE_TYPE_NONE, 500.0f, 25.0f, &temperature));
+    CHECK(!thermocouple_linearize(THERMOCOUPLE_TYPE_K, 5000.0f, 25.0f, &temperature));
+    CHECK(temperature == 42.0f);
+}
+
+int main(void)
+{
+    test_forward();
+    test_inverse();
+    test_round_trip();
+    test_linearize();
+
+    return host_test_result("thermocouple");
+}
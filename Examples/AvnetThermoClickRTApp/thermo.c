@@ -37,6 +37,10 @@
 /****************************************************************************/
 /* Global Variables */
 /****************************************************************************/
+
+// SPI chip select of each thermocouple channel, see buildOptions.h
+static const uint8_t thermo_chip_selects[] = THERMO_CHANNEL_CHIP_SELECTS;
+
 static struct mtk_spi_config spi_default_config = {
 	.cpol = SPI_CPOL_0, 
 	.cpha = SPI_CPHA_0, 
@@ -46,7 +50,8 @@ static struct mtk_spi_config spi_default_config = {
 	.cs_polar = SPI_CS_POLARITY_LOW,
 };
 
-uint8_t buffer[4];
+// The SPI DMA engine can't reach TCM, the receive buffer lives in SYSRAM
+static uint8_t buffer[4] __attribute__((section(".sysram")));
 
 THERMO_RETVAL thermo_init (void)
 {
@@ -60,7 +65,15 @@ THERMO_RETVAL thermo_init (void)
     }
 }
 
-static inline ssize_t SPIMaster_Read(uint8_t *readData, size_t lenReadData)
+uint8_t thermo_get_channel_count (void)
+{
+    uint8_t count = sizeof(thermo_chip_selects) / sizeof(thermo_chip_selects[0]);
+
+    return (count > THERMO_MAX_CHANNELS) ? THERMO_MAX_CHANNELS : count;
+}
+
+// Read the 32 bit MAX31855 frame in a single DMA transfer
+static inline ssize_t SPIMaster_Read(uint8_t chipSelect, uint8_t *readData, size_t lenReadData)
 {
 
 	struct mtk_spi_transfer xfer;
@@ -68,11 +81,13 @@ static inline ssize_t SPIMaster_Read(uint8_t *readData, size_t lenReadData)
 
 	memset(&xfer, 0, sizeof(xfer));
 
+    spi_default_config.slave_sel = chipSelect;
+
 	xfer.tx_buf = NULL;     // Read only, pass is NULL for the TX buffer
 	xfer.rx_buf = readData;
-	xfer.use_dma = 0;       // Don't use DMA transfer
-	xfer.speed_khz = 10000; 
-	xfer.len = 4;           // Read 4 bytes of data;
+	xfer.use_dma = 1;       // One DMA transfer for the whole frame
+	xfer.speed_khz = 5000;  // MAX31855 maximum SCK frequency
+	xfer.len = lenReadData;
 	xfer.opcode = 0x00;
 	xfer.opcode_len = 0;    // Read only, pass in opcode length of zero
 
@@ -87,16 +102,17 @@ static inline ssize_t SPIMaster_Read(uint8_t *readData, size_t lenReadData)
 	return xfer.len;
 }
 
-uint32_t thermo_read_data (void)
+THERMO_RETVAL thermo_read_frame (uint8_t channel, uint32_t *frame)
 {
-
     uint32_t result;
-    size_t transferCount = 0;
 
-    transferCount = SPIMaster_Read(buffer, 4);
+    if(channel >= thermo_get_channel_count()){
+        return THERMO_CHANNEL_ERROR;
+    }
 
-    if(transferCount != 4){
+    if(SPIMaster_Read(thermo_chip_selects[channel], buffer, sizeof(buffer)) != sizeof(buffer)){
         printf("Read failed!\n");
+        return THERMO_READ_ERROR;
     }
 
     result = buffer[ 0 ];
@@ -107,118 +123,95 @@ uint32_t thermo_read_data (void)
     result <<= 8;
     result |= buffer[ 3 ];
 
-//    printf("Result: 0x%X\n", (uint32_t)result);
-    return result;
+    *frame = result;
+    return THERMO_OK;
 }
 
-float thermo_get_temperature (void)
+void thermo_decode (uint32_t frame, thermo_reading_t *reading)
 {
-    uint8_t buffer[ 4 ];
-    uint32_t temp_all_data;
-    uint16_t temp_data;
-    float temperature;
-
-    temp_all_data = thermo_read_data();
-    buffer[0] = (uint8_t)(temp_all_data >> 24);
-    buffer[1] = (uint8_t)(temp_all_data >> 16);
-    
-    temp_data = buffer[ 0 ];
-    temp_data <<= 8;
-    temp_data |= buffer[ 1 ];
-
-    if ( buffer[ 0 ] > 128 )
-    {
-        temp_data = ~temp_data;
-
-        temperature = ( float )( ( temp_data >> 2 ) & 0x03 );
-        temperature *= -0.25;
-        temperature -= ( float )( temp_data >> 4 );
-        temperature += 1.0;
-    }
-    else
-    {
-        temperature = ( float )( ( temp_data >> 2 ) & 0x03 );
-        temperature *= 0.25;
-        temperature += ( float )( temp_data >> 4 );
-    }
+    reading->frame = frame;
+
+    // D31-D18, 14 bit two's complement thermocouple temperature, 0.25 degrees per LSB
+    reading->temperature = (float)((int16_t)(frame >> 16) >> 2) * 0.25f;
+
+    // D15-D4, 12 bit two's complement reference junction temperature, 0.0625 degrees per LSB
+    reading->junction_temperature = (float)((int16_t)(frame & 0xFFFF) >> 4) * 0.0625f;
 
-    return temperature;
+    reading->fault = (frame >> 16) & 0x01;
+    reading->short_vcc = (frame >> 2) & 0x01;
+    reading->short_gnd = (frame >> 1) & 0x01;
+    reading->open_circuit = frame & 0x01;
 }
 
-float thermo_get_junction_temperature (void)
+THERMO_RETVAL thermo_read (uint8_t channel, thermo_reading_t *reading)
 {
- //   uint8_t buffer[ 4 ];
-    uint32_t temp_all_data;
-    uint16_t temp_data;
-    float temperature;
+    uint32_t frame;
+    THERMO_RETVAL ret;
 
-    temp_all_data = thermo_read_data();
+    ret = thermo_read_frame(channel, &frame);
+    if(ret == THERMO_OK){
+        thermo_decode(frame, reading);
+    }
 
-    temp_data = ( uint16_t )temp_all_data;
+    return ret;
+}
 
-    if ( temp_data > 32768 )
-    {
-        temp_data = ~temp_data;
+uint32_t thermo_read_data (void)
+{
+    uint32_t frame = 0;
 
-        temperature = ( float )( ( temp_data >> 4 ) & 0x0F );
-        temperature *= -0.0625;
-        temperature -= ( float )( temp_data >> 8 );
-        temperature += 1.0;
-    }
-    else
-    {
-        temperature = ( float )( ( temp_data >> 4 ) & 0x0F );
-        temperature *= 0.0625;
-        temperature += ( float )( temp_data >> 8 );
-        temperature -= 1.0;
-    }
+    thermo_read_frame(0, &frame);
 
-    return temperature;
+    return frame;
 }
 
-uint8_t thermo_check_fault (void)
+// The functions below each read a frame from channel 0 and decode one field, use thermo_read() when
+// more than one field is needed
+
+float thermo_get_temperature (void)
 {
-    uint32_t tmp;
+    thermo_reading_t reading;
 
-    tmp = thermo_read_data();
+    thermo_decode(thermo_read_data(), &reading);
+    return reading.temperature;
+}
 
-    tmp >>= 16;
-    tmp &= 0x01;
+float thermo_get_junction_temperature (void)
+{
+    thermo_reading_t reading;
 
-    return tmp;
+    thermo_decode(thermo_read_data(), &reading);
+    return reading.junction_temperature;
 }
 
-uint8_t thermo_short_circuited_vcc (void)
+uint8_t thermo_check_fault (void)
 {
-    uint32_t tmp;
+    thermo_reading_t reading;
 
-    tmp = thermo_read_data();
+    thermo_decode(thermo_read_data(), &reading);
+    return reading.fault;
+}
 
-    tmp >>= 2;
-    tmp &= 0x01;
+uint8_t thermo_short_circuited_vcc (void)
+{
+    thermo_reading_t reading;
 
-    return tmp;
+    thermo_decode(thermo_read_data(), &reading);
+    return reading.short_vcc;
 }
 
 uint8_t thermo_short_circuited_gnd (void)
 {
-    uint32_t tmp;
+    thermo_reading_t reading;
 
-    tmp = thermo_read_data();
-
-    tmp >>= 1;
-    tmp &= 0x01;
-
-    return tmp;
+    thermo_decode(thermo_read_data(), &reading);
+    return reading.short_gnd;
 }
 
 uint8_t thermo_check_connections (void)
 {
-    uint32_t tmp;
-
-    tmp = thermo_read_data();
-
-    tmp &= 0x01;
+    thermo_reading_t reading;
 
-    return tmp;
+    thermo_decode(thermo_read_data(), &reading);
+    return reading.open_circuit;
 }
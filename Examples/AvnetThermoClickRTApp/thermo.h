@@ -65,9 +65,33 @@
 #define THERMO_RETVAL  uint8_t
 
 #define THERMO_OK           0x00
+#define THERMO_READ_ERROR   0x01
+#define THERMO_CHANNEL_ERROR 0x02
 #define THERMO_INIT_ERROR   0xFF
 /** \} */
 
+// The MT3620 SPI master has two chip selects, so up to two Thermo clicks can share the bus
+#define THERMO_MAX_CHANNELS 2
+
+/**
+ * \defgroup type Types
+ * \{
+ */
+
+// All fields of one MAX31855 frame
+typedef struct
+{
+    uint32_t frame;                 // Raw 32 bit frame
+    float temperature;              // Thermocouple temperature in degree Celsius
+    float junction_temperature;     // Reference junction temperature in degree Celsius
+    bool fault;                     // Any of the faults below is active
+    bool short_vcc;
+    bool short_gnd;
+    bool open_circuit;
+
+} thermo_reading_t;
+/** \} */
+
 /** \} */ // End group macro 
 
 // ----------------------------------------------- PUBLIC FUNCTION DECLARATIONS
@@ -100,6 +124,47 @@ THERMO_RETVAL thermo_init (void);
  */
 uint32_t thermo_read_data (void);
 
+/**
+ * @brief Number of thermocouple channels
+ *
+ * @returns Number of entries in THERMO_CHANNEL_CHIP_SELECTS (buildOptions.h)
+ */
+uint8_t thermo_get_channel_count (void);
+
+/**
+ * @brief Read raw frame function
+ *
+ * @param channel Thermocouple channel, 0 to thermo_get_channel_count() - 1
+ * @param frame 32-bit frame read from the MAX31855
+ *
+ * @returns THERMO_OK, THERMO_READ_ERROR or THERMO_CHANNEL_ERROR
+ *
+ * @description Function reads the 32-bit frame of one channel in a single DMA transfer.
+ */
+THERMO_RETVAL thermo_read_frame (uint8_t channel, uint32_t *frame);
+
+/**
+ * @brief Decode frame function
+ *
+ * @param frame 32-bit frame read from the MAX31855
+ * @param reading Decoded temperatures and fault bits
+ *
+ * @description Function decodes every field of a frame without touching the bus.
+ */
+void thermo_decode (uint32_t frame, thermo_reading_t *reading);
+
+/**
+ * @brief Read channel function
+ *
+ * @param channel Thermocouple channel, 0 to thermo_get_channel_count() - 1
+ * @param reading Decoded temperatures and fault bits
+ *
+ * @returns THERMO_OK, THERMO_READ_ERROR or THERMO_CHANNEL_ERROR
+ *
+ * @description Function reads one frame and decodes all fields from it.
+ */
+THERMO_RETVAL thermo_read (uint8_t channel, thermo_reading_t *reading);
+
 /**
  * @brief Get thermocouple temperature function
  *
@@ -13,9 +13,31 @@ typedef enum   __attribute__((packed))
     IC_THERMO_CLICK_HEARTBEAT,
 	IC_THERMO_CLICK_READ_SENSOR_RESPOND_WITH_TELEMETRY, 
 	IC_THERMO_CLICK_SET_AUTO_TELEMETRY_RATE,
-	IC_THERMO_CLICK_READ_SENSOR
+	IC_THERMO_CLICK_READ_SENSOR,
+	IC_THERMO_CLICK_SET_SAMPLE_CONFIG,
+	IC_THERMO_CLICK_SET_THERMOCOUPLE_TYPE
 } INTER_CORE_CMD_THERMO_CLICK;
 
+// Thermocouple channels reported by IC_THERMO_CLICK_READ_SENSOR, see THERMO_CHANNEL_CHIP_SELECTS in buildOptions.h
+#define IC_THERMO_CLICK_MAX_CHANNELS 2
+
+// Bits in channelFault, the same as the low bits of the MAX31855 frame
+#define IC_THERMO_CLICK_FAULT_OPEN       0x01
+#define IC_THERMO_CLICK_FAULT_SHORT_GND  0x02
+#define IC_THERMO_CLICK_FAULT_SHORT_VCC  0x04
+#define IC_THERMO_CLICK_FAULT_NO_READING 0x80   // The channel could not be read
+
+// Thermocouple types for IC_THERMO_CLICK_SET_THERMOCOUPLE_TYPE.  The type must match the MAX31855 variant
+// on the board, the Thermo CLICK uses the MAX31855K.
+#define IC_THERMO_CLICK_TYPE_NONE   0   // No linearization, report the MAX31855 temperature
+#define IC_THERMO_CLICK_TYPE_K      1   // Default
+#define IC_THERMO_CLICK_TYPE_J      2
+#define IC_THERMO_CLICK_TYPE_N      3
+#define IC_THERMO_CLICK_TYPE_T      4
+#define IC_THERMO_CLICK_TYPE_E      5
+#define IC_THERMO_CLICK_TYPE_R      6
+#define IC_THERMO_CLICK_TYPE_S      7
+
 // Define the data structure that the high level app sends
 typedef struct  __attribute__((packed))
 {
@@ -24,6 +46,8 @@ typedef struct  __attribute__((packed))
 	////////////////////////////////////////////////////////////////////////////////////////
 	// Don't change the declarations above or the generic RTApp implementation will break //
 	////////////////////////////////////////////////////////////////////////////////////////
+    uint32_t sampleIntervalMs;      // Time between background reads of all channels, 0 keeps the current interval
+    uint8_t thermocoupleType;       // IC_THERMO_CLICK_TYPE_*
 } IC_COMMAND_BLOCK_THERMO_CLICK_HL_TO_RT;
 
 // Define the data structure that the real time app sends
@@ -36,5 +60,16 @@ typedef struct  __attribute__((packed))
 	////////////////////////////////////////////////////////////////////////////////////////
 	// Don't change the declarations above or the generic RTApp implementation will break //
 	////////////////////////////////////////////////////////////////////////////////////////
-    float temperature;
+    float temperature;              // Channel 0
+    uint32_t sampleIntervalMs;
+    uint8_t channelCount;
+    uint32_t sampleCount;           // Background reads completed, 0 until the first read
+    uint32_t sampleAgeMs;           // Time since the channels were read
+    float channelTemperature[IC_THERMO_CLICK_MAX_CHANNELS];
+    float channelJunctionTemperature[IC_THERMO_CLICK_MAX_CHANNELS];
+    uint8_t channelFault[IC_THERMO_CLICK_MAX_CHANNELS];    // IC_THERMO_CLICK_FAULT_* bits
+    uint8_t thermocoupleType;       // IC_THERMO_CLICK_TYPE_*, temperature and channelTemperature are linearized for this type
+    float channelMax31855Temperature[IC_THERMO_CLICK_MAX_CHANNELS];   // Temperature as reported by the MAX31855
+    uint32_t linearizeCycles;       // DWT cycles for the last linearization of one channel
+    uint32_t linearizeMaxCycles;    // Worst case since the type was last set
 } IC_COMMAND_BLOCK_THERMO_CLICK_RT_TO_HL;
\ No newline at end of file
@@ -0,0 +1,356 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#include <stddef.h>
+#include <math.h>
+#include "thermocouple.h"
+
+// Coefficients are from the NIST ITS-90 thermocouple database (NIST Monograph 175).  Each polynomial is
+// c[0] + c[1]x + ... + c[n-1]x^(n-1).  Forward polynomials take degrees C and return mV, inverse polynomials
+// take mV and return degrees C.
+
+// One polynomial and the range it is valid for
+typedef struct
+{
+    float lower;                // Range in degrees C (forward) or mV (inverse)
+    float upper;
+    uint8_t count;              // Number of coefficients
+    const float* coef;
+    const float* expTerm;       // Type K forward only, a0 * exp(a1 * (t - a2)^2) is added to the polynomial
+} thermocouple_poly_t;
+
+typedef struct
+{
+    const char* name;
+    float sensitivity;          // MAX31855 Seebeck coefficient for this type in mV per degree C
+    uint8_t forwardCount;
+    const thermocouple_poly_t* forward;
+    uint8_t inverseCount;
+    const thermocouple_poly_t* inverse;
+} thermocouple_tables_t;
+
+#define POLY(lower, upper, coef) { lower, upper, sizeof(coef) / sizeof(coef[0]), coef, NULL }
+#define COUNT_OF(array) (sizeof(array) / sizeof(array[0]))
+
+// Type K
+
+static const float k_fwd_neg[] = {
+    0.000000000000E+00f,  0.394501280250E-01f,  0.236223735980E-04f, -0.328589067840E-06f,
+   -0.499048287770E-08f, -0.675090591730E-10f, -0.574103274280E-12f, -0.310888728940E-14f,
+   -0.104516093650E-16f, -0.198892668780E-19f, -0.163226974860E-22f };
+
+static const float k_fwd_pos[] = {
+   -0.176004136860E-01f,  0.389212049750E-01f,  0.185587700320E-04f, -0.994575928740E-07f,
+    0.318409457190E-09f, -0.560728448890E-12f,  0.560750590590E-15f, -0.320207200030E-18f,
+    0.971511471520E-22f, -0.121047212750E-25f };
+
+static const float k_fwd_exp[] = { 0.118597600000E+00f, -0.118343200000E-03f, 0.126968600000E+03f };
+
+static const float k_inv_0[] = {
+    0.0000000E+00f,  2.5173462E+01f, -1.1662878E+00f, -1.0833638E+00f, -8.9773540E-01f,
+   -3.7342377E-01f, -8.6632643E-02f, -1.0450598E-02f, -5.1920577E-04f };
+
+static const float k_inv_1[] = {
+    0.000000E+00f,  2.508355E+01f,  7.860106E-02f, -2.503131E-01f,  8.315270E-02f,
+   -1.228034E-02f,  9.804036E-04f, -4.413030E-05f,  1.057734E-06f, -1.052755E-08f };
+
+static const float k_inv_2[] = {
+   -1.318058E+02f,  4.830222E+01f, -1.646031E+00f,  5.464731E-02f, -9.650715E-04f,
+    8.802193E-06f, -3.110810E-08f };
+
+static const thermocouple_poly_t k_forward[] = {
+    POLY(-270.0f, 0.0f, k_fwd_neg),
+    { 0.0f, 1372.0f, COUNT_OF(k_fwd_pos), k_fwd_pos, k_fwd_exp } };
+
+static const thermocouple_poly_t k_inverse[] = {
+    POLY(-5.891f, 0.0f, k_inv_0),
+    POLY(0.0f, 20.644f, k_inv_1),
+    POLY(20.644f, 54.886f, k_inv_2) };
+
+// Type J
+
+static const float j_fwd[] = {
+    0.000000000000E+00f,  0.503811878150E-01f,  0.304758369300E-04f, -0.856810657200E-07f,
+    0.132281952950E-09f, -0.170529583370E-12f,  0.209480906970E-15f, -0.125383953360E-18f,
+    0.156317256970E-22f };
+
+static const float j_inv_0[] = {
+    0.0000000E+00f,  1.9528268E+01f, -1.2286185E+00f, -1.0752178E+00f, -5.9086933E-01f,
+   -1.7256713E-01f, -2.8131513E-02f, -2.3963370E-03f, -8.3823321E-05f };
+
+static const float j_inv_1[] = {
+    0.000000E+00f,  1.978425E+01f, -2.001204E-01f,  1.036969E-02f, -2.549687E-04f,
+    3.585153E-06f, -5.344285E-08f,  5.099890E-10f };
+
+static const float j_inv_2[] = {
+   -3.11358187E+03f,  3.00543684E+02f, -9.94773230E+00f,  1.70276630E-01f, -1.43033468E-03f,
+    4.73886084E-06f };
+
+static const thermocouple_poly_t j_forward[] = {
+    POLY(-210.0f, 760.0f, j_fwd) };
+
+static const thermocouple_poly_t j_inverse[] = {
+    POLY(-8.095f, 0.0f, j_inv_0),
+    POLY(0.0f, 42.919f, j_inv_1),
+    POLY(42.919f, 69.553f, j_inv_2) };
+
+// Type N
+
+static const float n_fwd_neg[] = {
+    0.000000000000E+00f,  0.261591059620E-01f,  0.109574842280E-04f, -0.938411115540E-07f,
+   -0.464120397590E-10f, -0.263033577160E-11f, -0.226534380030E-13f, -0.760893007910E-16f,
+   -0.934196678350E-19f };
+
+static const float n_fwd_pos[] = {
+    0.000000000000E+00f,  0.259293946010E-01f,  0.157101418800E-04f,  0.438256272370E-07f,
+   -0.252611697940E-09f,  0.643118193390E-12f, -0.100634715190E-14f,  0.997453389920E-18f,
+   -0.608632456070E-21f,  0.208492293390E-24f, -0.306821961510E-28f };
+
+static const float n_inv_0[] = {
+    0.0000000E+00f,  3.8436847E+01f,  1.1010485E+00f,  5.2229312E+00f,  7.2060525E+00f,
+    5.8488586E+00f,  2.7754916E+00f,  7.7075166E-01f,  1.1582665E-01f,  7.3138868E-03f };
+
+static const float n_inv_1[] = {
+    0.00000E+00f,  3.86896E+01f, -1.08267E+00f,  4.70205E-02f, -2.12169E-06f,
+   -1.17272E-04f,  5.39280E-06f, -7.98156E-08f };
+
+static const float n_inv_2[] = {
+    1.972485E+01f,  3.300943E+01f, -3.915159E-01f,  9.855391E-03f, -1.274371E-04f,
+    7.767022E-07f };
+
+static const thermocouple_poly_t n_forward[] = {
+    POLY(-270.0f, 0.0f, n_fwd_neg),
+    POLY(0.0f, 1300.0f, n_fwd_pos) };
+
+static const thermocouple_poly_t n_inverse[] = {
+    POLY(-3.990f, 0.0f, n_inv_0),
+    POLY(0.0f, 20.613f, n_inv_1),
+    POLY(20.613f, 47.513f, n_inv_2) };
+
+// Type T
+
+static const float t_fwd_neg[] = {
+    0.000000000000E+00f,  0.387481063640E-01f,  0.441944343470E-04f,  0.118443231050E-06f,
+    0.200329735540E-07f,  0.901380195590E-09f,  0.226511565930E-10f,  0.360711542050E-12f,
+    0.384939398830E-14f,  0.282135219250E-16f,  0.142515947790E-18f,  0.487686622860E-21f,
+    0.107955392700E-23f,  0.139450270620E-26f,  0.797951539270E-30f };
+
+static const float t_fwd_pos[] = {
+    0.000000000000E+00f,  0.387481063640E-01f,  0.332922278800E-04f,  0.206182434040E-06f,
+   -0.218822568460E-08f,  0.109968809280E-10f, -0.308157587720E-13f,  0.454791352900E-16f,
+   -0.275129016730E-19f };
+
+static const float t_inv_0[] = {
+    0.0000000E+00f,  2.5949192E+01f, -2.1316967E-01f,  7.9018692E-01f,  4.2527777E-01f,
+    1.3304473E-01f,  2.0241446E-02f,  1.2668171E-03f };
+
+static const float t_inv_1[] = {
+    0.000000E+00f,  2.592800E+01f, -7.602961E-01f,  4.637791E-02f, -2.165394E-03f,
+    6.048144E-05f, -7.293422E-07f };
+
+static const thermocouple_poly_t t_forward[] = {
+    POLY(-270.0f, 0.0f, t_fwd_neg),
+    POLY(0.0f, 400.0f, t_fwd_pos) };
+
+static const thermocouple_poly_t t_inverse[] = {
+    POLY(-5.603f, 0.0f, t_inv_0),
+    POLY(0.0f, 20.872f, t_inv_1) };
+
+// Type E
+
+static const float e_fwd_neg[] = {
+    0.000000000000E+00f,  0.586655087080E-01f,  0.454109771240E-04f, -0.779980486860E-06f,
+   -0.258001608430E-07f, -0.594525830570E-09f, -0.932140586670E-11f, -0.102876055340E-12f,
+   -0.803701236210E-15f, -0.439794973910E-17f, -0.164147763550E-19f, -0.396736195160E-22f,
+   -0.558273287210E-25f, -0.346578420130E-28f };
+
+static const float e_fwd_pos[] = {
+    0.000000000000E+00f,  0.586655087100E-01f,  0.450322755820E-04f,  0.289084072120E-07f,
+   -0.330568966520E-09f,  0.650244032700E-12f, -0.191974955040E-15f, -0.125366004970E-17f,
+    0.214892175690E-20f, -0.143880417820E-23f,  0.359608994810E-27f };
+
+static const float e_inv_0[] = {
+    0.0000000E+00f,  1.6977288E+01f, -4.3514970E-01f, -1.5859697E-01f, -9.2502871E-02f,
+   -2.6084314E-02f, -4.1360199E-03f, -3.4034030E-04f, -1.1564890E-05f };
+
+static const float e_inv_1[] = {
+    0.0000000E+00f,  1.7057035E+01f, -2.3301759E-01f,  6.5435585E-03f, -7.3562749E-05f,
+   -1.7896001E-06f,  8.4036165E-08f, -1.3735879E-09f,  1.0629823E-11f, -3.2447087E-14f };
+
+static const thermocouple_poly_t e_forward[] = {
+    POLY(-270.0f, 0.0f, e_fwd_neg),
+    POLY(0.0f, 1000.0f, e_fwd_pos) };
+
+static const thermocouple_poly_t e_inverse[] = {
+    POLY(-8.825f, 0.0f, e_inv_0),
+    POLY(0.0f, 76.373f, e_inv_1) };
+
+// Type R
+
+static const float r_fwd[] = {
+    0.000000000000E+00f,  0.528961729765E-02f,  0.139166589782E-04f, -0.238855693017E-07f,
+    0.356916001063E-10f, -0.462347666298E-13f,  0.500777441034E-16f, -0.373105886191E-19f,
+    0.157716482367E-22f, -0.281038625251E-26f };
+
+static const float r_inv_0[] = {
+    0.0000000E+00f,  1.8891380E+02f, -9.3835290E+01f,  1.3068619E+02f, -2.2703580E+02f,
+    3.5145659E+02f, -3.8953900E+02f,  2.8239471E+02f, -1.2607281E+02f,  3.1353611E+01f,
+   -3.3187769E+00f };
+
+static const float r_inv_1[] = {
+    1.334584505E+01f,  1.472644573E+02f, -1.844024844E+01f,  4.031129726E+00f, -6.249428360E-01f,
+    6.468412046E-02f, -4.458750426E-03f,  1.994710149E-04f, -5.313401790E-06f,  6.481976217E-08f };
+
+static const float r_inv_2[] = {
+   -8.199599416E+01f,  1.553962042E+02f, -8.342197663E+00f,  4.279433549E-01f, -1.191577910E-02f,
+    1.492290091E-04f };
+
+static const float r_inv_3[] = {
+    3.406177836E+04f, -7.023729171E+03f,  5.582903813E+02f, -1.952394635E+01f,  2.560740231E-01f };
+
+static const thermocouple_poly_t r_forward[] = {
+    POLY(-50.0f, 1064.18f, r_fwd) };
+
+static const thermocouple_poly_t r_inverse[] = {
+    POLY(-0.227f, 1.923f, r_inv_0),
+    POLY(1.923f, 13.228f, r_inv_1),
+    POLY(13.228f, 19.739f, r_inv_2),
+    POLY(19.739f, 21.103f, r_inv_3) };
+
+// Type S
+
+static const float s_fwd[] = {
+    0.000000000000E+00f,  0.540313308631E-02f,  0.125934289740E-04f, -0.232477968689E-07f,
+    0.322028823036E-10f, -0.331465196389E-13f,  0.255744251786E-16f, -0.125068871393E-19f,
+    0.271443176145E-23f };
+
+static const float s_inv_0[] = {
+    0.00000000E+00f,  1.84949460E+02f, -8.00504062E+01f,  1.02237430E+02f, -1.52248592E+02f,
+    1.88821343E+02f, -1.59085941E+02f,  8.23027880E+01f, -2.34181944E+01f,  2.79786260E+00f };
+
+static const float s_inv_1[] = {
+    1.291507177E+01f,  1.466298863E+02f, -1.534713402E+01f,  3.145945973E+00f, -4.163257839E-01f,
+    3.187963771E-02f, -1.291637500E-03f,  2.183475087E-05f, -1.447379511E-07f,  8.211272125E-09f };
+
+static const float s_inv_2[] = {
+   -8.087801117E+01f,  1.621573104E+02f, -8.536869453E+00f,  4.719686976E-01f, -1.441693666E-02f,
+    2.081618890E-04f };
+
+static const float s_inv_3[] = {
+    5.333875126E+04f, -1.235892298E+04f,  1.092657613E+03f, -4.265693686E+01f,  6.247205420E-01f };
+
+static const thermocouple_poly_t s_forward[] = {
+    POLY(-50.0f, 1064.18f, s_fwd) };
+
+static const thermocouple_poly_t s_inverse[] = {
+    POLY(-0.236f, 1.874f, s_inv_0),
+    POLY(1.874f, 11.950f, s_inv_1),
+    POLY(11.950f, 17.536f, s_inv_2),
+    POLY(17.536f, 18.693f, s_inv_3) };
+
+// Indexed by thermocouple_type_t.  The sensitivities are the MAX31855K/J/N/T/E/R/S datasheet values.
+static const thermocouple_tables_t thermocouple_tables[THERMOCOUPLE_TYPE_COUNT] = {
+    [THERMOCOUPLE_TYPE_NONE] = { "none", 0.0f, 0, NULL, 0, NULL },
+    [THERMOCOUPLE_TYPE_K] = { "K", 0.041276f, COUNT_OF(k_forward), k_forward, COUNT_OF(k_inverse), k_inverse },
+    [THERMOCOUPLE_TYPE_J] = { "J", 0.057953f, COUNT_OF(j_forward), j_forward, COUNT_OF(j_inverse), j_inverse },
+    [THERMOCOUPLE_TYPE_N] = { "N", 0.036256f, COUNT_OF(n_forward), n_forward, COUNT_OF(n_inverse), n_inverse },
+    [THERMOCOUPLE_TYPE_T] = { "T", 0.052180f, COUNT_OF(t_forward), t_forward, COUNT_OF(t_inverse), t_inverse },
+    [THERMOCOUPLE_TYPE_E] = { "E", 0.076373f, COUNT_OF(e_forward), e_forward, COUNT_OF(e_inverse), e_inverse },
+    [THERMOCOUPLE_TYPE_R] = { "R", 0.010506f, COUNT_OF(r_forward), r_forward, COUNT_OF(r_inverse), r_inverse },
+    [THERMOCOUPLE_TYPE_S] = { "S", 0.009587f, COUNT_OF(s_forward), s_forward, COUNT_OF(s_inverse), s_inverse },
+};
+
+// Horner evaluation, one multiply-add per coefficient
+static float horner(const float* coef, uint8_t count, float x)
+{
+    float result = coef[count - 1];
+
+    for (int i = count - 2; i >= 0; i--) {
+        result = result * x + coef[i];
+    }
+
+    return result;
+}
+
+// Find the polynomial whose range holds x, the first match wins where ranges meet
+static const thermocouple_poly_t* find_poly(const thermocouple_poly_t* polys, uint8_t count, float x)
+{
+    for (uint8_t i = 0; i < count; i++) {
+        if (x >= polys[i].lower && x <= polys[i].upper) {
+            return &polys[i];
+        }
+    }
+
+    return NULL;
+}
+
+const char* thermocouple_type_name(thermocouple_type_t type)
+{
+    if (type >= THERMOCOUPLE_TYPE_COUNT) {
+        return "none";
+    }
+
+    return thermocouple_tables[type].name;
+}
+
+bool thermocouple_emf(thermocouple_type_t type, float temperature, float* emf)
+{
+    const thermocouple_poly_t* poly;
+    float result;
+
+    if (type == THERMOCOUPLE_TYPE_NONE || type >= THERMOCOUPLE_TYPE_COUNT) {
+        return false;
+    }
+
+    poly = find_poly(thermocouple_tables[type].forward, thermocouple_tables[type].forwardCount, temperature);
+    if (poly == NULL) {
+        return false;
+    }
+
+    result = horner(poly->coef, poly->count, temperature);
+    if (poly->expTerm != NULL) {
+        float t = temperature - poly->expTerm[2];
+        result += poly->expTerm[0] * expf(poly->expTerm[1] * t * t);
+    }
+
+    *emf = result;
+    return true;
+}
+
+bool thermocouple_temperature(thermocouple_type_t type, float emf, float* temperature)
+{
+    const thermocouple_poly_t* poly;
+
+    if (type == THERMOCOUPLE_TYPE_NONE || type >= THERMOCOUPLE_TYPE_COUNT) {
+        return false;
+    }
+
+    poly = find_poly(thermocouple_tables[type].inverse, thermocouple_tables[type].inverseCount, emf);
+    if (poly == NULL) {
+        return false;
+    }
+
+    *temperature = horner(poly->coef, poly->count, emf);
+    return true;
+}
+
+bool thermocouple_linearize(thermocouple_type_t type, float max31855Temperature, float junctionTemperature,
+                            float* temperature)
+{
+    float junctionEmf;
+
+    if (type == THERMOCOUPLE_TYPE_NONE || type >= THERMOCOUPLE_TYPE_COUNT) {
+        return false;
+    }
+
+    // EMF of the cold junction relative to 0 degrees C
+    if (!thermocouple_emf(type, junctionTemperature, &junctionEmf)) {
+        return false;
+    }
+
+    // The MAX31855 scaled the measured voltage by its fixed sensitivity and added the cold junction
+    // temperature, undo that to get the measured voltage back and add the cold junction EMF to it
+    return thermocouple_temperature(type,
+        (max31855Temperature - junctionTemperature) * thermocouple_tables[type].sensitivity + junctionEmf,
+        temperature);
+}
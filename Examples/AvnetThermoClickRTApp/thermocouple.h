@@ -0,0 +1,48 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// NIST ITS-90 thermocouple linearization.
+//
+// The MAX31855 reports (V / S) + Tcj, where V is the measured thermocouple voltage, S is the fixed Seebeck
+// coefficient of the MAX31855 variant and Tcj is the cold junction temperature.  The real thermocouple is not
+// linear, so the reported temperature drifts away from the true one the further it is from the cold junction.
+// thermocouple_linearize() recovers V from the MAX31855 reading, adds the EMF of the cold junction (NIST forward
+// polynomial) and converts the total EMF back to a temperature with the NIST inverse polynomial.
+//
+// The coefficient tables are const and are placed in RODATA_REGION (see linker.ld), the polynomials are evaluated
+// in single precision with Horner's method so the M4 FPU does all the work.
+
+// Thermocouple types, the value matches IC_THERMO_CLICK_TYPE_* in thermo_click_rt_app.h.  Use the type that
+// matches the MAX31855 variant on the board, the Thermo CLICK uses the MAX31855K.
+typedef enum
+{
+    THERMOCOUPLE_TYPE_NONE = 0,     // No linearization, use the MAX31855 temperature
+    THERMOCOUPLE_TYPE_K,
+    THERMOCOUPLE_TYPE_J,
+    THERMOCOUPLE_TYPE_N,
+    THERMOCOUPLE_TYPE_T,
+    THERMOCOUPLE_TYPE_E,
+    THERMOCOUPLE_TYPE_R,
+    THERMOCOUPLE_TYPE_S,
+    THERMOCOUPLE_TYPE_COUNT
+} thermocouple_type_t;
+
+// Returns the type name ("K", "J", ...) or "none"
+const char* thermocouple_type_name(thermocouple_type_t type);
+
+// Thermocouple EMF in mV for a junction at temperature (degrees C) relative to 0 degrees C.  The forward
+// tables cover the NIST range(s) around the cold junction temperature, returns false outside of them.
+bool thermocouple_emf(thermocouple_type_t type, float temperature, float* emf);
+
+// Temperature in degrees C for a thermocouple EMF in mV, returns false outside of the NIST inverse ranges
+bool thermocouple_temperature(thermocouple_type_t type, float emf, float* temperature);
+
+// Linearized hot junction temperature from a MAX31855 reading.  Returns false if the type is
+// THERMOCOUPLE_TYPE_NONE or the reading is outside of the NIST ranges, temperature is left unchanged then.
+bool thermocouple_linearize(thermocouple_type_t type, float max31855Temperature, float junctionTemperature,
+                            float* temperature);
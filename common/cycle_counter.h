@@ -0,0 +1,36 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdint.h>
+
+// Helpers to read the Cortex-M4 DWT cycle counter, shared by the example applications that time
+// their kernels and I2C transfers on target.  The applications add ../../common to their include
+// directories.  On a host build (no ARM core) they compile to no-ops so the same source can be
+// exercised off target.
+
+#if defined(__ARM_ARCH)
+#include "mt3620.h"
+
+static inline void cycle_counter_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t cycle_counter_get(void)
+{
+    return DWT->CYCCNT;
+}
+#else
+static inline void cycle_counter_init(void)
+{
+}
+
+static inline uint32_t cycle_counter_get(void)
+{
+    return 0;
+}
+#endif
@@ -0,0 +1,47 @@
+/* Copyright (c) Avnet Incorporated. All rights reserved.
+   Licensed under the MIT License. */
+
+#pragma once
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+// Minimal checks for the host tests of the example applications, every failure is printed and counted, main()
+// returns host_test_result().  The test builds add ../../../common/test to their include directories.
+
+static int host_test_failures = 0;
+
+#define CHECK(cond)                                                                             \
+    do {                                                                                        \
+        if (!(cond)) {                                                                          \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                     \
+            host_test_failures++;                                                               \
+        }                                                                                       \
+    } while (0)
+
+// Passes if |actual - expected| <= tolerance
+#define CHECK_NEAR(actual, expected, tolerance)                                                 \
+    do {                                                                                        \
+        double a_ = (actual);                                                                   \
+        double e_ = (expected);                                                                 \
+        if (!(fabs(a_ - e_) <= (tolerance))) {                                                  \
+            printf("%s:%d: %s = %.6f, expected %.6f\n", __FILE__, __LINE__, #actual, a_, e_);   \
+            host_test_failures++;                                                               \
+        }                                                                                       \
+    } while (0)
+
+static inline int host_test_result(const char* name)
+{
+    printf("%s: %s\n", name, host_test_failures ? "FAILED" : "passed");
+    return host_test_failures ? 1 : 0;
+}
+
+// Host wall clock for the benchmarks, the cycle counts on the M4 are reported by the application itself
+static inline double host_time_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}